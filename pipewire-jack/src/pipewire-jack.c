@@ -94,9 +94,9 @@ static struct globals globals;
 
 #define OBJECT_CHUNK	8
 
-typedef void (*mix2_func) (float *dst, float *src1, float *src2, int n_samples);
+typedef void (*mix_func) (float *dst, const float *src[], uint32_t n_src, int n_samples);
 
-static mix2_func mix2;
+static mix_func mixn;
 
 struct object {
 	struct spa_list link;
@@ -545,40 +545,72 @@ static struct buffer *dequeue_buffer(struct mix *mix)
 	return b;
 }
 
+/* sources added to the output in one pass, more sources take more passes */
+#define MIX_MAX_PASS	8u
+
 #if defined (__SSE__)
 #include <xmmintrin.h>
-static void mix2_sse(float *dst, float *src1, float *src2, int n_samples)
+static void mix_n_sse(float *dst, const float *src[], uint32_t n_src, bool add, int n_samples)
 {
 	int n, unrolled;
-	__m128 in[2];
+	uint32_t i;
+	__m128 in[4];
+	const float *s;
 
-	if (SPA_IS_ALIGNED(src1, 16) &&
-	    SPA_IS_ALIGNED(src2, 16) &&
-	    SPA_IS_ALIGNED(dst, 16))
-		unrolled = n_samples / 4;
-	else
-		unrolled = 0;
+	unrolled = SPA_IS_ALIGNED(dst, 16) ? n_samples & ~15 : 0;
+	for (i = 0; i < n_src && unrolled > 0; i++) {
+		if (!SPA_IS_ALIGNED(src[i], 16))
+			unrolled = 0;
+	}
+
+	for (n = 0; n < unrolled; n += 16) {
+		s = add ? dst : src[0];
+		in[0] = _mm_load_ps(&s[n+ 0]);
+		in[1] = _mm_load_ps(&s[n+ 4]);
+		in[2] = _mm_load_ps(&s[n+ 8]);
+		in[3] = _mm_load_ps(&s[n+12]);
+
+		for (i = add ? 0 : 1; i < n_src; i++) {
+			s = src[i];
+			in[0] = _mm_add_ps(in[0], _mm_load_ps(&s[n+ 0]));
+			in[1] = _mm_add_ps(in[1], _mm_load_ps(&s[n+ 4]));
+			in[2] = _mm_add_ps(in[2], _mm_load_ps(&s[n+ 8]));
+			in[3] = _mm_add_ps(in[3], _mm_load_ps(&s[n+12]));
+		}
 
-	for (n = 0; unrolled--; n += 4) {
-		in[0] = _mm_load_ps(&src1[n]),
-		in[1] = _mm_load_ps(&src2[n]),
-		in[0] = _mm_add_ps(in[0], in[1]);
-		_mm_store_ps(&dst[n], in[0]);
+		_mm_store_ps(&dst[n+ 0], in[0]);
+		_mm_store_ps(&dst[n+ 4], in[1]);
+		_mm_store_ps(&dst[n+ 8], in[2]);
+		_mm_store_ps(&dst[n+12], in[3]);
 	}
 	for (; n < n_samples; n++) {
-		in[0] = _mm_load_ss(&src1[n]),
-		in[1] = _mm_load_ss(&src2[n]),
-		in[0] = _mm_add_ss(in[0], in[1]);
+		s = add ? dst : src[0];
+		in[0] = _mm_load_ss(&s[n]);
+		for (i = add ? 0 : 1; i < n_src; i++)
+			in[0] = _mm_add_ss(in[0], _mm_load_ss(&src[i][n]));
 		_mm_store_ss(&dst[n], in[0]);
 	}
 }
+
+static void mix_sse(float *dst, const float *src[], uint32_t n_src, int n_samples)
+{
+	uint32_t i;
+	for (i = 0; i < n_src; i += MIX_MAX_PASS)
+		mix_n_sse(dst, &src[i], SPA_MIN(n_src - i, MIX_MAX_PASS), i > 0, n_samples);
+}
 #endif
 
-static void mix2_c(float *dst, float *src1, float *src2, int n_samples)
+static void mix_c(float *dst, const float *src[], uint32_t n_src, int n_samples)
 {
-	int i;
-	for (i = 0; i < n_samples; i++)
-		dst[i] = src1[i] + src2[i];
+	int n;
+	uint32_t i;
+
+	for (n = 0; n < n_samples; n++)
+		dst[n] = src[0][n] + src[1][n];
+	for (i = 2; i < n_src; i++) {
+		for (n = 0; n < n_samples; n++)
+			dst[n] += src[i][n];
+	}
 }
 
 SPA_EXPORT
@@ -2238,13 +2270,13 @@ jack_client_t * jack_client_open (const char *client_name,
 
 	support = pw_context_get_support(client->context.context, &n_support);
 
-	mix2 = mix2_c;
+	mixn = mix_c;
 	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
 	if (cpu_iface) {
 #if defined (__SSE__)
 		uint32_t flags = spa_cpu_get_flags(cpu_iface);
 		if (flags & SPA_CPU_FLAG_SSE)
-			mix2 = mix2_sse;
+			mixn = mix_sse;
 #endif
 	}
 
@@ -3106,8 +3138,8 @@ static inline void *get_buffer_input_float(struct client *c, struct port *p, jac
 	struct mix *mix;
 	struct buffer *b;
 	struct spa_io_buffers *io;
-	int layer = 0;
-	void *ptr = NULL;
+	const float *src[CONNECTION_NUM_FOR_PORT];
+	uint32_t n_src = 0;
 
 	spa_list_for_each(mix, &p->mix, port_link) {
 		pw_log_trace(NAME" %p: port %p mix %d.%d get buffer %d",
@@ -3120,15 +3152,18 @@ static inline void *get_buffer_input_float(struct client *c, struct port *p, jac
 
 		io->status = SPA_STATUS_NEED_DATA;
 		b = &mix->buffers[io->buffer_id];
-		if (layer++ == 0)
-			ptr = b->datas[0].data;
-		else  {
-			mix2(p->emptyptr, ptr, b->datas[0].data, frames);
-			ptr = p->emptyptr;
-			p->zeroed = false;
-		}
+		if (n_src < CONNECTION_NUM_FOR_PORT)
+			src[n_src++] = b->datas[0].data;
 	}
-	return ptr;
+	/* a single input is passed on as is, more are summed in one go */
+	if (n_src == 0)
+		return NULL;
+	if (n_src == 1)
+		return (void*)src[0];
+
+	mixn(p->emptyptr, src, n_src, frames);
+	p->zeroed = false;
+	return p->emptyptr;
 }
 
 static inline void *get_buffer_input_midi(struct client *c, struct port *p, jack_nframes_t frames)
@@ -48,6 +48,7 @@ enum spa_param_type {
 	SPA_PARAM_EnumRoute,		/**< routing enumeration as SPA_TYPE_OBJECT_ParamRoute */
 	SPA_PARAM_Route,		/**< routing configuration as SPA_TYPE_OBJECT_ParamRoute */
 	SPA_PARAM_Control,		/**< Control parameter, a SPA_TYPE_Sequence */
+	SPA_PARAM_Timing,		/**< timing statistics as SPA_TYPE_OBJECT_ParamTiming */
 };
 
 /** information about a parameter */
@@ -136,6 +137,22 @@ enum spa_param_route {
 						  *  (Id enum spa_param_route_availability) */
 };
 
+/** properties for SPA_TYPE_OBJECT_ParamTiming. The histograms have a bucket
+ * for each of the bounds, a value goes into the first bucket with a bound
+ * larger than the value. The last bucket collects all larger values. */
+enum spa_param_timing {
+	SPA_PARAM_TIMING_START,
+	SPA_PARAM_TIMING_cycles,		/**< number of measured cycles (Long) */
+	SPA_PARAM_TIMING_bounds,		/**< upper bounds of the histogram buckets in
+						  *  nanoseconds (Array of Long) */
+	SPA_PARAM_TIMING_wakeup,		/**< histogram of the time between the signal
+						  *  and the wakeup of the node (Array of Long) */
+	SPA_PARAM_TIMING_wakeupMax,		/**< max wakeup time in nanoseconds (Long) */
+	SPA_PARAM_TIMING_process,		/**< histogram of the time between the wakeup
+						  *  and the end of processing (Array of Long) */
+	SPA_PARAM_TIMING_processMax,		/**< max process time in nanoseconds (Long) */
+};
+
 
 #ifdef __cplusplus
 }  /* extern "C" */
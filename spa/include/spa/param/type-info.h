@@ -54,6 +54,7 @@ static const struct spa_type_info spa_type_param[] = {
 	{ SPA_PARAM_EnumRoute, SPA_TYPE_OBJECT_ParamRoute, SPA_TYPE_INFO_PARAM_ID_BASE "EnumRoute", NULL },
 	{ SPA_PARAM_Route, SPA_TYPE_OBJECT_ParamRoute, SPA_TYPE_INFO_PARAM_ID_BASE "Route", NULL },
 	{ SPA_PARAM_Control, SPA_TYPE_Sequence, SPA_TYPE_INFO_PARAM_ID_BASE "Control", NULL },
+	{ SPA_PARAM_Timing, SPA_TYPE_OBJECT_ParamTiming, SPA_TYPE_INFO_PARAM_ID_BASE "Timing", NULL },
 	{ 0, 0, NULL, NULL },
 };
 
@@ -328,6 +329,20 @@ static const struct spa_type_info spa_type_param_route[] = {
 	{ 0, 0, NULL, NULL },
 };
 
+#define SPA_TYPE_INFO_PARAM_Timing		SPA_TYPE_INFO_PARAM_BASE "Timing"
+#define SPA_TYPE_INFO_PARAM_TIMING_BASE		SPA_TYPE_INFO_PARAM_Timing ":"
+
+static const struct spa_type_info spa_type_param_timing[] = {
+	{ SPA_PARAM_TIMING_START, SPA_TYPE_Id, SPA_TYPE_INFO_PARAM_TIMING_BASE, spa_type_param, },
+	{ SPA_PARAM_TIMING_cycles, SPA_TYPE_Long, SPA_TYPE_INFO_PARAM_TIMING_BASE "cycles", NULL, },
+	{ SPA_PARAM_TIMING_bounds, SPA_TYPE_Array, SPA_TYPE_INFO_PARAM_TIMING_BASE "bounds", NULL, },
+	{ SPA_PARAM_TIMING_wakeup, SPA_TYPE_Array, SPA_TYPE_INFO_PARAM_TIMING_BASE "wakeup", NULL, },
+	{ SPA_PARAM_TIMING_wakeupMax, SPA_TYPE_Long, SPA_TYPE_INFO_PARAM_TIMING_BASE "wakeupMax", NULL, },
+	{ SPA_PARAM_TIMING_process, SPA_TYPE_Array, SPA_TYPE_INFO_PARAM_TIMING_BASE "process", NULL, },
+	{ SPA_PARAM_TIMING_processMax, SPA_TYPE_Long, SPA_TYPE_INFO_PARAM_TIMING_BASE "processMax", NULL, },
+	{ 0, 0, NULL, NULL },
+};
+
 #include <spa/param/profiler.h>
 
 #define SPA_TYPE_INFO_Profiler		SPA_TYPE_INFO_OBJECT_BASE "Profiler"
@@ -128,13 +128,24 @@ struct spa_loop_control_hooks {
 #define spa_loop_control_hook_before(l) spa_hook_list_call_simple(l, struct spa_loop_control_hooks, before, 0)
 #define spa_loop_control_hook_after(l) spa_hook_list_call_simple(l, struct spa_loop_control_hooks, after, 0)
 
+/** Statistics of the invoke queue of a loop */
+struct spa_loop_stats {
+	uint32_t queued;		/**< number of items in the invoke queue */
+	uint32_t max_queued;		/**< max number of items in the invoke queue */
+	uint32_t failed;		/**< number of invokes that could not be
+					  *  queued */
+	uint64_t invoked;		/**< total number of queued invoke items */
+	uint64_t wakeups;		/**< number of wakeups of the loop to process
+					  *  the invoke queue */
+};
+
 /**
  * Control an event loop
  */
 struct spa_loop_control_methods {
 	/* the version of this structure. This can be used to expand this
 	 * structure in the future */
-#define SPA_VERSION_LOOP_CONTROL_METHODS	0
+#define SPA_VERSION_LOOP_CONTROL_METHODS	1
 	uint32_t version;
 
 	int (*get_fd) (void *object);
@@ -176,6 +187,14 @@ struct spa_loop_control_methods {
 	 * The number of dispatched fds is returned.
 	 */
 	int (*iterate) (void *object, int timeout);
+
+	/** Get the statistics of the invoke queue
+	 * \param ctrl the control
+	 * \param stats the statistics to fill
+	 *
+	 * Since version 1
+	 */
+	int (*get_stats) (void *object, struct spa_loop_stats *stats);
 };
 
 #define spa_loop_control_method_v(o,method,version,...)			\
@@ -201,6 +220,7 @@ struct spa_loop_control_methods {
 #define spa_loop_control_enter(l)		spa_loop_control_method_v(l,enter,0)
 #define spa_loop_control_leave(l)		spa_loop_control_method_v(l,leave,0)
 #define spa_loop_control_iterate(l,...)		spa_loop_control_method_r(l,iterate,0,__VA_ARGS__)
+#define spa_loop_control_get_stats(l,...)	spa_loop_control_method_r(l,get_stats,1,__VA_ARGS__)
 
 typedef void (*spa_source_io_func_t) (void *data, int fd, uint32_t mask);
 typedef void (*spa_source_idle_func_t) (void *data);
@@ -0,0 +1,161 @@
+/* Simple Plugin API
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_RAMP_H
+#define SPA_RAMP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#define SPA_RAMP_MAX_CHANNELS	64
+
+/** the exponential ramp can't start or stop at 0, it ramps from or
+ * to this level (-60dB) instead and steps to the target at the end */
+#define SPA_RAMP_FLOOR		0.001f
+
+enum spa_ramp_type {
+	SPA_RAMP_NONE,			/**< step to the new gain */
+	SPA_RAMP_LINEAR,		/**< constant gain increment per sample */
+	SPA_RAMP_EXPONENTIAL,		/**< constant gain factor per sample */
+};
+
+/**
+ * Per channel gains that move to a target in a fixed number of samples.
+ *
+ * The processing code applies \a gain and \a step to \a remaining samples
+ * and then calls spa_ramp_advance().
+ */
+struct spa_ramp {
+	enum spa_ramp_type type;
+	uint32_t duration;		/**< length of a ramp in samples, 0 to step */
+	uint32_t remaining;		/**< samples left in the current ramp */
+	float gain[SPA_RAMP_MAX_CHANNELS];	/**< gain of the next sample */
+	float target[SPA_RAMP_MAX_CHANNELS];	/**< gain at the end of the ramp */
+	float step[SPA_RAMP_MAX_CHANNELS];	/**< increment or factor per sample */
+};
+
+static inline enum spa_ramp_type spa_ramp_type_from_label(const char *label)
+{
+	if (strcmp(label, "linear") == 0)
+		return SPA_RAMP_LINEAR;
+	else if (strcmp(label, "exponential") == 0)
+		return SPA_RAMP_EXPONENTIAL;
+	return SPA_RAMP_NONE;
+}
+
+/** Set all gains to 1.0 and stop the ramp */
+static inline void spa_ramp_reset(struct spa_ramp *ramp)
+{
+	uint32_t i;
+	for (i = 0; i < SPA_RAMP_MAX_CHANNELS; i++)
+		ramp->gain[i] = ramp->target[i] = 1.0f;
+	ramp->remaining = 0;
+}
+
+/** The gain of the next sample after \a gain */
+static inline float spa_ramp_next(enum spa_ramp_type type, float gain, float step)
+{
+	return type == SPA_RAMP_EXPONENTIAL ? gain * step : gain + step;
+}
+
+/** Check if \a step leaves the gain unchanged */
+static inline bool spa_ramp_is_flat(enum spa_ramp_type type, float step)
+{
+	return type == SPA_RAMP_EXPONENTIAL ? step == 1.0f : step == 0.0f;
+}
+
+/**
+ * Move to \a gains. With \a smooth and a configured ramp, the gains ramp to
+ * the target, else they step. A ramp in progress continues from the current
+ * gain.
+ *
+ * \return false when nothing changed
+ */
+static inline bool spa_ramp_set_gains(struct spa_ramp *ramp, uint32_t n_channels,
+		const float *gains, bool smooth)
+{
+	uint32_t i, n_samples = ramp->duration;
+	float from, to;
+
+	if (ramp->remaining == 0 &&
+	    memcmp(ramp->gain, gains, n_channels * sizeof(float)) == 0)
+		return false;
+
+	if (!smooth || ramp->type == SPA_RAMP_NONE || n_samples == 0) {
+		memcpy(ramp->gain, gains, n_channels * sizeof(float));
+		memcpy(ramp->target, gains, n_channels * sizeof(float));
+		ramp->remaining = 0;
+		return true;
+	}
+
+	for (i = 0; i < n_channels; i++) {
+		from = ramp->gain[i];
+		to = gains[i];
+		ramp->target[i] = to;
+
+		if (ramp->type == SPA_RAMP_EXPONENTIAL) {
+			if (from == to) {
+				ramp->step[i] = 1.0f;
+				continue;
+			}
+			from = SPA_MAX(from, SPA_RAMP_FLOOR);
+			to = SPA_MAX(to, SPA_RAMP_FLOOR);
+			ramp->gain[i] = from;
+			ramp->step[i] = powf(to / from, 1.0f / n_samples);
+		} else {
+			ramp->step[i] = (to - from) / n_samples;
+		}
+	}
+	ramp->remaining = n_samples;
+	return true;
+}
+
+/**
+ * Account for \a n_samples processed with the ramp. At the end of the ramp
+ * the gains are set to the exact target.
+ *
+ * \return true when the ramp is done
+ */
+static inline bool spa_ramp_advance(struct spa_ramp *ramp, uint32_t n_channels,
+		uint32_t n_samples)
+{
+	ramp->remaining -= SPA_MIN(n_samples, ramp->remaining);
+	if (ramp->remaining > 0)
+		return false;
+	memcpy(ramp->gain, ramp->target, n_channels * sizeof(float));
+	return true;
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* SPA_RAMP_H */
@@ -774,6 +774,8 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	case SPA_PARAM_Props:
 	{
 		res = spa_node_set_param(this->channelmix, id, flags, param);
+		/* the dither is done when converting to the output format */
+		spa_node_set_param(this->fmt[SPA_DIRECTION_OUTPUT], id, flags, param);
 		break;
 	}
 	default:
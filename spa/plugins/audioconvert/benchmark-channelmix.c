@@ -0,0 +1,215 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "channelmix-ops.h"
+
+typedef void (*channelmix_func_t) (struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+			uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples);
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t src_chan;
+	uint32_t dst_chan;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	4096
+#define MAX_CHANNELS	16
+
+#define MAX_COUNT 100
+
+static float samp_in[MAX_CHANNELS][MAX_SAMPLES];
+static float samp_out[MAX_CHANNELS][MAX_SAMPLES];
+
+static const int sample_sizes[] = { 0, 1, 128, 513, 1024, 4096 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * 70
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+#define MASK_16	(MASK_7_1|_M(FLC)|_M(FRC)|_M(RC)|_M(TC)|_M(TFL)|_M(TFC)|_M(TFR)|_M(TRL))
+
+static void run_test1(const char *name, const char *impl, struct channelmix *mix,
+		channelmix_func_t func, int n_samples)
+{
+	int i;
+	const void *ip[MAX_CHANNELS];
+	void *op[MAX_CHANNELS];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+
+	for (i = 0; i < MAX_CHANNELS; i++) {
+		ip[i] = samp_in[i];
+		op[i] = samp_out[i];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		func(mix, mix->dst_chan, op, mix->src_chan, ip, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.src_chan = mix->src_chan,
+		.dst_chan = mix->dst_chan,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / SPA_MAX(t2 - t1, 1u),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl,
+		uint32_t src_chan, uint64_t src_mask, uint32_t dst_chan, uint64_t dst_mask,
+		channelmix_func_t func)
+{
+	struct channelmix mix;
+	float volumes[MAX_CHANNELS];
+	size_t i;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.dst_chan = dst_chan;
+	mix.src_mask = src_mask;
+	mix.dst_mask = dst_mask;
+	if (channelmix_init(&mix) < 0)
+		return;
+
+	/* not the unity volume so that the real mixing code is measured */
+	for (i = 0; i < src_chan; i++)
+		volumes[i] = 0.5f;
+	mix.set_volume(&mix, 1.0f, false, src_chan, volumes);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++)
+		run_test1(name, impl, &mix, func, sample_sizes[i]);
+}
+
+static void test_copy(void)
+{
+	run_test("test_copy", "c", 8, MASK_7_1, 8, MASK_7_1, channelmix_copy_c);
+#if defined (HAVE_SSE)
+	run_test("test_copy", "sse", 8, MASK_7_1, 8, MASK_7_1, channelmix_copy_sse);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_copy", "avx2", 8, MASK_7_1, 8, MASK_7_1, channelmix_copy_avx2);
+#endif
+#if defined (HAVE_AVX512F)
+	run_test("test_copy", "avx512", 8, MASK_7_1, 8, MASK_7_1, channelmix_copy_avx512);
+#endif
+}
+
+static void test_5p1_2(void)
+{
+	run_test("test_f32_5p1_2", "c", 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_c);
+#if defined (HAVE_SSE)
+	run_test("test_f32_5p1_2", "sse", 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_sse);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32_5p1_2", "avx2", 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_avx2);
+#endif
+#if defined (HAVE_AVX512F)
+	run_test("test_f32_5p1_2", "avx512", 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_avx512);
+#endif
+}
+
+static void test_7p1_2(void)
+{
+	run_test("test_f32_7p1_2", "c", 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_c);
+#if defined (HAVE_AVX2)
+	run_test("test_f32_7p1_2", "avx2", 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_avx2);
+#endif
+#if defined (HAVE_AVX512F)
+	run_test("test_f32_7p1_2", "avx512", 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_avx512);
+#endif
+}
+
+static void test_7p1_4(void)
+{
+	run_test("test_f32_7p1_4", "c", 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_c);
+#if defined (HAVE_AVX2)
+	run_test("test_f32_7p1_4", "avx2", 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_avx2);
+#endif
+}
+
+static void test_n_m(void)
+{
+	run_test("test_f32_n_m", "c", 16, MASK_16, 2, MASK_STEREO, channelmix_f32_n_m_c);
+	run_test("test_f32_n_m", "c", 16, MASK_16, 6, MASK_5_1, channelmix_f32_n_m_c);
+#if defined (HAVE_AVX2)
+	run_test("test_f32_n_m", "avx2", 16, MASK_16, 2, MASK_STEREO, channelmix_f32_n_m_avx2);
+	run_test("test_f32_n_m", "avx2", 16, MASK_16, 6, MASK_5_1, channelmix_f32_n_m_avx2);
+#endif
+#if defined (HAVE_AVX512F)
+	run_test("test_f32_n_m", "avx512", 16, MASK_16, 2, MASK_STEREO, channelmix_f32_n_m_avx512);
+	run_test("test_f32_n_m", "avx512", 16, MASK_16, 6, MASK_5_1, channelmix_f32_n_m_avx512);
+#endif
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->src_chan - b->src_chan) != 0) return diff;
+	if ((diff = a->dst_chan - b->dst_chan) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	test_copy();
+	test_5p1_2();
+	test_7p1_2();
+	test_7p1_4();
+	test_n_m();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, channels %d -> %d\n",
+				s->perf, s->name, s->impl, s->n_samples, s->src_chan, s->dst_chan);
+	}
+	return 0;
+}
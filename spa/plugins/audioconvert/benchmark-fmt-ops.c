@@ -53,7 +53,7 @@ static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int channel_counts[] = { 1, 2, 4, 6, 8, 11 };
 
-#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 70
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 100
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -68,6 +68,7 @@ static void run_test1(const char *name, const char *impl, bool in_packed, bool o
 	uint64_t count, t1, t2;
 	struct convert conv;
 
+	spa_zero(conv);
 	conv.n_channels = n_channels;
 
 	for (j = 0; j < n_channels; j++) {
@@ -147,6 +148,16 @@ static void test_f32_s16(void)
 	run_test("test_f32d_s16", "avx2", false, true, conv_f32d_to_s16_avx2);
 	run_testc("test_f32d_s16_2", "avx2", false, true, conv_f32d_to_s16_2_avx2, 2);
 	run_testc("test_f32d_s16_4", "avx2", false, true, conv_f32d_to_s16_4_avx2, 4);
+#endif
+	run_test("test_f32d_s16_dither", "c", false, true, conv_f32d_to_s16_dither_c);
+	run_test("test_f32d_s16_shaped", "c", false, true, conv_f32d_to_s16_shaped_c);
+#if defined (HAVE_SSE2)
+	run_test("test_f32d_s16_dither", "sse2", false, true, conv_f32d_to_s16_dither_sse2);
+	run_test("test_f32d_s16_shaped", "sse2", false, true, conv_f32d_to_s16_shaped_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s16_dither", "avx2", false, true, conv_f32d_to_s16_dither_avx2);
+	run_test("test_f32d_s16_shaped", "avx2", false, true, conv_f32d_to_s16_shaped_avx2);
 #endif
 	run_test("test_f32_s16d", "c", true, false, conv_f32_to_s16d_c);
 	run_test("test_f32d_s16d", "c", false, false, conv_f32d_to_s16d_c);
@@ -200,6 +211,12 @@ static void test_f32_s24(void)
 {
 	run_test("test_f32_s24", "c", true, true, conv_f32_to_s24_c);
 	run_test("test_f32d_s24", "c", false, true, conv_f32d_to_s24_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_f32d_s24", "ssse3", false, true, conv_f32d_to_s24_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s24", "avx2", false, true, conv_f32d_to_s24_avx2);
+#endif
 	run_test("test_f32_s24d", "c", true, false, conv_f32_to_s24d_c);
 	run_test("test_f32d_s24d", "c", false, false, conv_f32d_to_s24d_c);
 }
@@ -224,6 +241,56 @@ static void test_s24_f32(void)
 	run_test("test_s24d_f32d", "c", false, false, conv_s24d_to_f32d_c);
 }
 
+static void test_f32_oe(void)
+{
+	run_test("test_f32d_s16s", "c", false, true, conv_f32d_to_s16s_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_f32d_s16s", "ssse3", false, true, conv_f32d_to_s16s_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s16s", "avx2", false, true, conv_f32d_to_s16s_avx2);
+#endif
+	run_test("test_f32d_s24s", "c", false, true, conv_f32d_to_s24s_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_f32d_s24s", "ssse3", false, true, conv_f32d_to_s24s_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s24s", "avx2", false, true, conv_f32d_to_s24s_avx2);
+#endif
+	run_test("test_f32d_s32s", "c", false, true, conv_f32d_to_s32s_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_f32d_s32s", "ssse3", false, true, conv_f32d_to_s32s_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s32s", "avx2", false, true, conv_f32d_to_s32s_avx2);
+#endif
+}
+
+static void test_oe_f32(void)
+{
+	run_test("test_s16s_f32d", "c", true, false, conv_s16s_to_f32d_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_s16s_f32d", "ssse3", true, false, conv_s16s_to_f32d_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s16s_f32d", "avx2", true, false, conv_s16s_to_f32d_avx2);
+#endif
+	run_test("test_s24s_f32d", "c", true, false, conv_s24s_to_f32d_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_s24s_f32d", "ssse3", true, false, conv_s24s_to_f32d_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s24s_f32d", "avx2", true, false, conv_s24s_to_f32d_avx2);
+#endif
+	run_test("test_s32s_f32d", "c", true, false, conv_s32s_to_f32d_c);
+#if defined (HAVE_SSSE3)
+	run_test("test_s32s_f32d", "ssse3", true, false, conv_s32s_to_f32d_ssse3);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s32s_f32d", "avx2", true, false, conv_s32s_to_f32d_avx2);
+#endif
+}
+
 static void test_f32_s24_32(void)
 {
 	run_test("test_f32_s24_32", "c", true, true, conv_f32_to_s24_32_c);
@@ -279,6 +346,8 @@ int main(int argc, char *argv[])
 	test_s32_f32();
 	test_f32_s24();
 	test_s24_f32();
+	test_f32_oe();
+	test_oe_f32();
 	test_f32_s24_32();
 	test_s24_32_f32();
 	test_interleave();
@@ -32,7 +32,7 @@
 #include "resample.h"
 
 #define MAX_SAMPLES	4096
-#define MAX_CHANNELS	11
+#define MAX_CHANNELS	64
 
 #define MAX_COUNT 200
 
@@ -50,14 +50,20 @@ static float samp_in[MAX_SAMPLES * MAX_CHANNELS];
 static float samp_out[MAX_SAMPLES * MAX_CHANNELS];
 
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
-static const int in_rates[] = { 44100, 44100, 48000, 96000, 22050, 96000 };
-static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100 };
+static const int in_rates[] = { 44100, 44100, 48000, 96000, 22050, 96000, 192000, 384000 };
+static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100, 48000, 48000 };
+
+/* multichannel streams, 1024 samples */
+static const int channels[] = { 8, 16, 64 };
+static const int mc_in_rates[] = { 44100, 48000 };
+static const int mc_out_rates[] = { 48000, 44100 };
 
 
 #define MAX_RESAMPLER	5
 #define MAX_SIZES	SPA_N_ELEMENTS(sample_sizes)
 #define MAX_RATES	SPA_N_ELEMENTS(in_rates)
-#define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES
+#define MAX_MC		(SPA_N_ELEMENTS(channels) * SPA_N_ELEMENTS(mc_in_rates))
+#define MAX_RESULTS	MAX_RESAMPLER * (MAX_SIZES * MAX_RATES + MAX_MC)
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -109,6 +115,26 @@ static void run_test(const char *name, const char *impl, struct resample *r)
 		run_test1(name, impl, r, sample_sizes[i]);
 }
 
+static void run_channels(const char *name, const char *impl, uint32_t cpu_flags)
+{
+	struct resample r;
+	size_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(channels); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(mc_in_rates); j++) {
+			spa_zero(r);
+			r.channels = channels[i];
+			r.cpu_flags = cpu_flags;
+			r.i_rate = mc_in_rates[j];
+			r.o_rate = mc_out_rates[j];
+			r.quality = RESAMPLE_DEFAULT_QUALITY;
+			resample_native_init(&r);
+			run_test1(name, impl, &r, 1024);
+			resample_free(&r);
+		}
+	}
+}
+
 static int compare_func(const void *_a, const void *_b)
 {
 	const struct stats *a = _a, *b = _b;
@@ -138,6 +164,7 @@ int main(int argc, char *argv[])
 		run_test("native", "c", &r);
 		resample_free(&r);
 	}
+	run_channels("native", "c", 0);
 #if defined (HAVE_SSE)
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
 		spa_zero(r);
@@ -150,6 +177,7 @@ int main(int argc, char *argv[])
 		run_test("native", "sse", &r);
 		resample_free(&r);
 	}
+	run_channels("native", "sse", SPA_CPU_FLAG_SSE);
 #endif
 #if defined (HAVE_SSSE3)
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
@@ -163,6 +191,7 @@ int main(int argc, char *argv[])
 		run_test("native", "ssse3", &r);
 		resample_free(&r);
 	}
+	run_channels("native", "ssse3", SPA_CPU_FLAG_SSSE3 | SPA_CPU_FLAG_SLOW_UNALIGNED);
 #endif
 #if defined (HAVE_AVX) && defined(HAVE_FMA)
 	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
@@ -176,6 +205,21 @@ int main(int argc, char *argv[])
 		run_test("native", "avx", &r);
 		resample_free(&r);
 	}
+	run_channels("native", "avx", SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3);
+#endif
+#if defined (HAVE_AVX512F)
+	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+		spa_zero(r);
+		r.channels = 2;
+		r.cpu_flags = SPA_CPU_FLAG_AVX512;
+		r.i_rate = in_rates[i];
+		r.o_rate = out_rates[i];
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
+		resample_native_init(&r);
+		run_test("native", "avx512", &r);
+		resample_free(&r);
+	}
+	run_channels("native", "avx512", SPA_CPU_FLAG_AVX512);
 #endif
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
@@ -0,0 +1,166 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/cpu.h>
+
+#include "volume-ops.h"
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t n_channels;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	4096
+#define MAX_CHANNELS	8
+
+#define MAX_COUNT 100
+
+static float samp_in[MAX_CHANNELS][MAX_SAMPLES] SPA_ALIGNED(32);
+static float samp_out[MAX_CHANNELS][MAX_SAMPLES] SPA_ALIGNED(32);
+
+static const int sample_sizes[] = { 0, 1, 128, 513, 1024, 4096 };
+static const int channel_counts[] = { 2, 8 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 12
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void run_test1(const char *name, const char *impl, struct volume *vol, int n_samples)
+{
+	int i;
+	const void *ip[MAX_CHANNELS];
+	void *op[MAX_CHANNELS];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+
+	for (i = 0; i < MAX_CHANNELS; i++) {
+		ip[i] = samp_in[i];
+		op[i] = samp_out[i];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		volume_process(vol, op, ip, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_channels = vol->n_channels,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / SPA_MAX(t2 - t1, 1u),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl, uint32_t cpu_flags,
+		enum spa_ramp_type ramp)
+{
+	struct volume vol;
+	float gains[MAX_CHANNELS];
+	size_t i, j, k;
+
+	for (i = 0; i < SPA_N_ELEMENTS(channel_counts); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(sample_sizes); j++) {
+			spa_zero(vol);
+			vol.n_channels = channel_counts[i];
+			vol.cpu_flags = cpu_flags;
+			vol.ramp.type = ramp;
+			/* long enough to stay in the ramp for the whole run */
+			vol.ramp.duration = MAX_COUNT * MAX_SAMPLES + 1;
+			if (volume_init(&vol) < 0)
+				return;
+
+			memset(gains, 0, sizeof(gains));
+			volume_set_gains(&vol, gains, false);
+			for (k = 0; k < MAX_CHANNELS; k++)
+				gains[k] = 0.5f + 0.05f * k;
+			volume_set_gains(&vol, gains, ramp != SPA_RAMP_NONE);
+
+			run_test1(name, impl, &vol, sample_sizes[j]);
+		}
+	}
+}
+
+static void test_arch(const char *impl, uint32_t cpu_flags)
+{
+	run_test("test_volume", impl, cpu_flags, SPA_RAMP_NONE);
+	run_test("test_volume_linear", impl, cpu_flags, SPA_RAMP_LINEAR);
+	run_test("test_volume_exponential", impl, cpu_flags, SPA_RAMP_EXPONENTIAL);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->n_channels - b->n_channels) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	test_arch("c", 0);
+#if defined (HAVE_SSE)
+	test_arch("sse", SPA_CPU_FLAG_SSE);
+#endif
+#if defined (HAVE_AVX2)
+	test_arch("avx2", SPA_CPU_FLAG_AVX2);
+#endif
+#if defined (HAVE_NEON)
+	test_arch("neon", SPA_CPU_FLAG_NEON);
+#endif
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, channels %d\n",
+				s->perf, s->name, s->impl, s->n_samples, s->n_channels);
+	}
+	return 0;
+}
@@ -0,0 +1,457 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "channelmix-ops.h"
+
+#include <immintrin.h>
+
+/* The channel buffers are only guaranteed to be 16 bytes aligned so we use
+ * unaligned loads and stores, they don't cost extra on aligned memory. */
+
+void channelmix_copy_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~31;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->identity) {
+		for (i = 0; i < n_dst; i++)
+			spa_memcpy(d[i], s[i], n_samples * sizeof(float));
+	}
+	else {
+		for (i = 0; i < n_dst; i++) {
+			float *di = d[i];
+			const float *si = s[i];
+			__m256 t[4];
+			const __m256 vol = _mm256_set1_ps(mix->matrix[i][i]);
+
+			for(n = 0; n < unrolled; n += 32) {
+				t[0] = _mm256_loadu_ps(&si[n]);
+				t[1] = _mm256_loadu_ps(&si[n+8]);
+				t[2] = _mm256_loadu_ps(&si[n+16]);
+				t[3] = _mm256_loadu_ps(&si[n+24]);
+				_mm256_storeu_ps(&di[n], _mm256_mul_ps(t[0], vol));
+				_mm256_storeu_ps(&di[n+8], _mm256_mul_ps(t[1], vol));
+				_mm256_storeu_ps(&di[n+16], _mm256_mul_ps(t[2], vol));
+				_mm256_storeu_ps(&di[n+24], _mm256_mul_ps(t[3], vol));
+			}
+			for(; n < n_samples; n++)
+				_mm_store_ss(&di[n], _mm_mul_ss(_mm_load_ss(&si[n]),
+							_mm256_castps256_ps128(vol)));
+		}
+	}
+}
+
+/* Generic matrix mix. For each output channel we only read the source channels
+ * with a non-zero coefficient and accumulate 32 samples at a time in registers
+ * so that each output sample is written exactly once. */
+void
+channelmix_f32_n_m_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, j, k, n, n_coef, unrolled = n_samples & ~31;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float *sj[n_src];
+	float coef[n_src];
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		__m256 acc[4], c;
+
+		for (j = 0, n_coef = 0; j < n_src; j++) {
+			if (mix->matrix[i][j] == 0.0f)
+				continue;
+			sj[n_coef] = s[j];
+			coef[n_coef++] = mix->matrix[i][j];
+		}
+		if (n_coef == 0) {
+			memset(di, 0, n_samples * sizeof(float));
+			continue;
+		}
+		if (n_coef == 1 && coef[0] == 1.0f) {
+			spa_memcpy(di, sj[0], n_samples * sizeof(float));
+			continue;
+		}
+
+		for (n = 0; n < unrolled; n += 32) {
+			c = _mm256_set1_ps(coef[0]);
+			acc[0] = _mm256_mul_ps(_mm256_loadu_ps(&sj[0][n]), c);
+			acc[1] = _mm256_mul_ps(_mm256_loadu_ps(&sj[0][n+8]), c);
+			acc[2] = _mm256_mul_ps(_mm256_loadu_ps(&sj[0][n+16]), c);
+			acc[3] = _mm256_mul_ps(_mm256_loadu_ps(&sj[0][n+24]), c);
+			for (k = 1; k < n_coef; k++) {
+				c = _mm256_set1_ps(coef[k]);
+				acc[0] = _mm256_add_ps(acc[0], _mm256_mul_ps(_mm256_loadu_ps(&sj[k][n]), c));
+				acc[1] = _mm256_add_ps(acc[1], _mm256_mul_ps(_mm256_loadu_ps(&sj[k][n+8]), c));
+				acc[2] = _mm256_add_ps(acc[2], _mm256_mul_ps(_mm256_loadu_ps(&sj[k][n+16]), c));
+				acc[3] = _mm256_add_ps(acc[3], _mm256_mul_ps(_mm256_loadu_ps(&sj[k][n+24]), c));
+			}
+			_mm256_storeu_ps(&di[n], acc[0]);
+			_mm256_storeu_ps(&di[n+8], acc[1]);
+			_mm256_storeu_ps(&di[n+16], acc[2]);
+			_mm256_storeu_ps(&di[n+24], acc[3]);
+		}
+		for (; n < n_samples; n++) {
+			float sum = 0.0f;
+			for (k = 0; k < n_coef; k++)
+				sum += sj[k][n] * coef[k];
+			di[n] = sum;
+		}
+	}
+}
+
+void
+channelmix_f32_2_4_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~7;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const __m256 v0 = _mm256_set1_ps(mix->matrix[0][0]);
+	const __m256 v1 = _mm256_set1_ps(mix->matrix[1][1]);
+	const __m256 v2 = _mm256_set1_ps(mix->matrix[2][0]);
+	const __m256 v3 = _mm256_set1_ps(mix->matrix[3][1]);
+	__m256 in;
+	const float *sFL = s[0], *sFR = s[1];
+	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		spa_memcpy(dFL, sFL, n_samples * sizeof(float));
+		spa_memcpy(dRL, sFL, n_samples * sizeof(float));
+		spa_memcpy(dFR, sFR, n_samples * sizeof(float));
+		spa_memcpy(dRR, sFR, n_samples * sizeof(float));
+	}
+	else {
+		for(n = 0; n < unrolled; n += 8) {
+			in = _mm256_loadu_ps(&sFL[n]);
+			_mm256_storeu_ps(&dFL[n], _mm256_mul_ps(in, v0));
+			_mm256_storeu_ps(&dRL[n], _mm256_mul_ps(in, v2));
+			in = _mm256_loadu_ps(&sFR[n]);
+			_mm256_storeu_ps(&dFR[n], _mm256_mul_ps(in, v1));
+			_mm256_storeu_ps(&dRR[n], _mm256_mul_ps(in, v3));
+		}
+		for(; n < n_samples; n++) {
+			dFL[n] = sFL[n] * mix->matrix[0][0];
+			dRL[n] = sFL[n] * mix->matrix[2][0];
+			dFR[n] = sFR[n] * mix->matrix[1][1];
+			dRR[n] = sFR[n] * mix->matrix[3][1];
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled = n_samples & ~7;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float c = mix->matrix[2][0], l = mix->matrix[3][0];
+	const float s0 = mix->matrix[4][0], s1 = mix->matrix[4][1];
+	const __m256 v0 = _mm256_set1_ps(m0);
+	const __m256 v1 = _mm256_set1_ps(m1);
+	const __m256 clev = _mm256_set1_ps(c);
+	const __m256 llev = _mm256_set1_ps(l);
+	const __m256 slev0 = _mm256_set1_ps(s0);
+	const __m256 slev1 = _mm256_set1_ps(s1);
+	__m256 in, ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1];
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < unrolled; n += 8) {
+		ctr = _mm256_mul_ps(_mm256_loadu_ps(&sFC[n]), clev);
+		ctr = _mm256_add_ps(ctr, _mm256_mul_ps(_mm256_loadu_ps(&sLFE[n]), llev));
+		in = _mm256_mul_ps(_mm256_loadu_ps(&sFL[n]), v0);
+		in = _mm256_add_ps(in, ctr);
+		in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&sSL[n]), slev0));
+		_mm256_storeu_ps(&dFL[n], in);
+		in = _mm256_mul_ps(_mm256_loadu_ps(&sFR[n]), v1);
+		in = _mm256_add_ps(in, ctr);
+		in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&sSR[n]), slev1));
+		_mm256_storeu_ps(&dFR[n], in);
+	}
+	for(; n < n_samples; n++) {
+		const float t = c * sFC[n] + l * sLFE[n];
+		dFL[n] = sFL[n] * m0 + t + (s0 * sSL[n]);
+		dFR[n] = sFR[n] * m1 + t + (s1 * sSR[n]);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_5p1_3p1_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~7;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float m2 = mix->matrix[2][2], m3 = mix->matrix[3][3];
+	const float m4 = mix->matrix[0][4], m5 = mix->matrix[1][5];
+	const __m256 v0 = _mm256_set1_ps(m0);
+	const __m256 v1 = _mm256_set1_ps(m1);
+	const __m256 v2 = _mm256_set1_ps(m2);
+	const __m256 v3 = _mm256_set1_ps(m3);
+	const __m256 slev0 = _mm256_set1_ps(m4);
+	const __m256 slev1 = _mm256_set1_ps(m5);
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1], *dFC = d[2], *dLFE = d[3];
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < unrolled; n += 8) {
+		_mm256_storeu_ps(&dFL[n], _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sFL[n]), v0),
+				_mm256_mul_ps(_mm256_loadu_ps(&sSL[n]), slev0)));
+		_mm256_storeu_ps(&dFR[n], _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sFR[n]), v1),
+				_mm256_mul_ps(_mm256_loadu_ps(&sSR[n]), slev1)));
+		_mm256_storeu_ps(&dFC[n], _mm256_mul_ps(_mm256_loadu_ps(&sFC[n]), v2));
+		_mm256_storeu_ps(&dLFE[n], _mm256_mul_ps(_mm256_loadu_ps(&sLFE[n]), v3));
+	}
+	for(; n < n_samples; n++) {
+		dFL[n] = sFL[n] * m0 + sSL[n] * m4;
+		dFR[n] = sFR[n] * m1 + sSR[n] * m5;
+		dFC[n] = sFC[n] * m2;
+		dLFE[n] = sLFE[n] * m3;
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+RL+RR*/
+void
+channelmix_f32_5p1_4_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~7;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float c = mix->matrix[2][0], l = mix->matrix[3][0];
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float m4 = mix->matrix[2][4], m5 = mix->matrix[3][5];
+	const __m256 clev = _mm256_set1_ps(c);
+	const __m256 llev = _mm256_set1_ps(l);
+	const __m256 v0 = _mm256_set1_ps(m0);
+	const __m256 v1 = _mm256_set1_ps(m1);
+	const __m256 v4 = _mm256_set1_ps(m4);
+	const __m256 v5 = _mm256_set1_ps(m5);
+	__m256 ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < unrolled; n += 8) {
+		ctr = _mm256_mul_ps(_mm256_loadu_ps(&sFC[n]), clev);
+		ctr = _mm256_add_ps(ctr, _mm256_mul_ps(_mm256_loadu_ps(&sLFE[n]), llev));
+		_mm256_storeu_ps(&dFL[n], _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&sFL[n]), v0), ctr));
+		_mm256_storeu_ps(&dFR[n], _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&sFR[n]), v1), ctr));
+		_mm256_storeu_ps(&dRL[n], _mm256_mul_ps(_mm256_loadu_ps(&sSL[n]), v4));
+		_mm256_storeu_ps(&dRR[n], _mm256_mul_ps(_mm256_loadu_ps(&sSR[n]), v5));
+	}
+	for(; n < n_samples; n++) {
+		const float t = sFC[n] * c + sLFE[n] * l;
+		dFL[n] = sFL[n] * m0 + t;
+		dFR[n] = sFR[n] * m1 + t;
+		dRL[n] = sSL[n] * m4;
+		dRR[n] = sSR[n] * m5;
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR */
+void
+channelmix_f32_7p1_2_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled = n_samples & ~7;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float c = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float l = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float s0 = mix->matrix[0][4], s1 = mix->matrix[1][5];
+	const float r0 = mix->matrix[0][6], r1 = mix->matrix[1][7];
+	const __m256 v0 = _mm256_set1_ps(m0);
+	const __m256 v1 = _mm256_set1_ps(m1);
+	const __m256 clev = _mm256_set1_ps(c);
+	const __m256 llev = _mm256_set1_ps(l);
+	const __m256 slev0 = _mm256_set1_ps(s0);
+	const __m256 slev1 = _mm256_set1_ps(s1);
+	const __m256 rlev0 = _mm256_set1_ps(r0);
+	const __m256 rlev1 = _mm256_set1_ps(r1);
+	__m256 in, ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1];
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < unrolled; n += 8) {
+		ctr = _mm256_mul_ps(_mm256_loadu_ps(&sFC[n]), clev);
+		ctr = _mm256_add_ps(ctr, _mm256_mul_ps(_mm256_loadu_ps(&sLFE[n]), llev));
+		in = _mm256_mul_ps(_mm256_loadu_ps(&sFL[n]), v0);
+		in = _mm256_add_ps(in, ctr);
+		in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&sSL[n]), slev0));
+		in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&sRL[n]), rlev0));
+		_mm256_storeu_ps(&dFL[n], in);
+		in = _mm256_mul_ps(_mm256_loadu_ps(&sFR[n]), v1);
+		in = _mm256_add_ps(in, ctr);
+		in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&sSR[n]), slev1));
+		in = _mm256_add_ps(in, _mm256_mul_ps(_mm256_loadu_ps(&sRR[n]), rlev1));
+		_mm256_storeu_ps(&dFR[n], in);
+	}
+	for(; n < n_samples; n++) {
+		const float t = c * sFC[n] + l * sLFE[n];
+		dFL[n] = sFL[n] * m0 + t + sSL[n] * s0 + sRL[n] * r0;
+		dFR[n] = sFR[n] * m1 + t + sSR[n] * s1 + sRR[n] * r1;
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_7p1_3p1_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~7;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float m2 = mix->matrix[2][2], m3 = mix->matrix[3][3];
+	const float m4 = (mix->matrix[0][4] + mix->matrix[0][6]) * 0.5f;
+	const float m5 = (mix->matrix[1][5] + mix->matrix[1][6]) * 0.5f;
+	const __m256 v0 = _mm256_set1_ps(m0);
+	const __m256 v1 = _mm256_set1_ps(m1);
+	const __m256 v2 = _mm256_set1_ps(m2);
+	const __m256 v3 = _mm256_set1_ps(m3);
+	const __m256 v4 = _mm256_set1_ps(m4);
+	const __m256 v5 = _mm256_set1_ps(m5);
+	__m256 sr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1], *dFC = d[2], *dLFE = d[3];
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < unrolled; n += 8) {
+		sr = _mm256_add_ps(_mm256_loadu_ps(&sSL[n]), _mm256_loadu_ps(&sRL[n]));
+		_mm256_storeu_ps(&dFL[n], _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sFL[n]), v0),
+				_mm256_mul_ps(sr, v4)));
+		sr = _mm256_add_ps(_mm256_loadu_ps(&sSR[n]), _mm256_loadu_ps(&sRR[n]));
+		_mm256_storeu_ps(&dFR[n], _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sFR[n]), v1),
+				_mm256_mul_ps(sr, v5)));
+		_mm256_storeu_ps(&dFC[n], _mm256_mul_ps(_mm256_loadu_ps(&sFC[n]), v2));
+		_mm256_storeu_ps(&dLFE[n], _mm256_mul_ps(_mm256_loadu_ps(&sLFE[n]), v3));
+	}
+	for(; n < n_samples; n++) {
+		dFL[n] = sFL[n] * m0 + (sSL[n] + sRL[n]) * m4;
+		dFR[n] = sFR[n] * m1 + (sSR[n] + sRR[n]) * m5;
+		dFC[n] = sFC[n] * m2;
+		dLFE[n] = sLFE[n] * m3;
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+RL+RR*/
+void
+channelmix_f32_7p1_4_avx2(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~7;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float c = (mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f;
+	const float l = (mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f;
+	const float s0 = mix->matrix[0][4], s1 = mix->matrix[1][5];
+	const float r0 = mix->matrix[0][6], r1 = mix->matrix[1][7];
+	const __m256 v0 = _mm256_set1_ps(m0);
+	const __m256 v1 = _mm256_set1_ps(m1);
+	const __m256 clev = _mm256_set1_ps(c);
+	const __m256 llev = _mm256_set1_ps(l);
+	const __m256 slev0 = _mm256_set1_ps(s0);
+	const __m256 slev1 = _mm256_set1_ps(s1);
+	const __m256 rlev0 = _mm256_set1_ps(r0);
+	const __m256 rlev1 = _mm256_set1_ps(r1);
+	__m256 ctr, sl, sr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < unrolled; n += 8) {
+		ctr = _mm256_mul_ps(_mm256_loadu_ps(&sFC[n]), clev);
+		ctr = _mm256_add_ps(ctr, _mm256_mul_ps(_mm256_loadu_ps(&sLFE[n]), llev));
+		sl = _mm256_mul_ps(_mm256_loadu_ps(&sSL[n]), slev0);
+		sr = _mm256_mul_ps(_mm256_loadu_ps(&sSR[n]), slev1);
+		_mm256_storeu_ps(&dFL[n], _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sFL[n]), v0), ctr), sl));
+		_mm256_storeu_ps(&dFR[n], _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sFR[n]), v1), ctr), sr));
+		_mm256_storeu_ps(&dRL[n], _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sRL[n]), rlev0), sl));
+		_mm256_storeu_ps(&dRR[n], _mm256_add_ps(
+				_mm256_mul_ps(_mm256_loadu_ps(&sRR[n]), rlev1), sr));
+	}
+	for(; n < n_samples; n++) {
+		const float t = sFC[n] * c + sLFE[n] * l;
+		const float tl = sSL[n] * s0;
+		const float tr = sSR[n] * s1;
+		dFL[n] = sFL[n] * m0 + t + tl;
+		dFR[n] = sFR[n] * m1 + t + tr;
+		dRL[n] = sRL[n] * r0 + tl;
+		dRR[n] = sRR[n] * r1 + tr;
+	}
+}
@@ -0,0 +1,222 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "channelmix-ops.h"
+
+#include <immintrin.h>
+
+/* The channel buffers are only guaranteed to be 16 bytes aligned so we use
+ * unaligned loads and stores. The remaining samples are handled with masked
+ * loads and stores instead of a scalar loop. */
+
+#define TAIL_MASK(n)	((__mmask16)((1u << (n)) - 1))
+
+void channelmix_copy_avx512(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled = n_samples & ~63;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->identity) {
+		for (i = 0; i < n_dst; i++)
+			spa_memcpy(d[i], s[i], n_samples * sizeof(float));
+	}
+	else {
+		for (i = 0; i < n_dst; i++) {
+			float *di = d[i];
+			const float *si = s[i];
+			__m512 t[4];
+			const __m512 vol = _mm512_set1_ps(mix->matrix[i][i]);
+
+			for(n = 0; n < unrolled; n += 64) {
+				t[0] = _mm512_loadu_ps(&si[n]);
+				t[1] = _mm512_loadu_ps(&si[n+16]);
+				t[2] = _mm512_loadu_ps(&si[n+32]);
+				t[3] = _mm512_loadu_ps(&si[n+48]);
+				_mm512_storeu_ps(&di[n], _mm512_mul_ps(t[0], vol));
+				_mm512_storeu_ps(&di[n+16], _mm512_mul_ps(t[1], vol));
+				_mm512_storeu_ps(&di[n+32], _mm512_mul_ps(t[2], vol));
+				_mm512_storeu_ps(&di[n+48], _mm512_mul_ps(t[3], vol));
+			}
+			for(; n < n_samples; n += 16) {
+				__mmask16 m = n_samples - n < 16 ? TAIL_MASK(n_samples - n) : 0xffff;
+				_mm512_mask_storeu_ps(&di[n], m,
+						_mm512_mul_ps(_mm512_maskz_loadu_ps(m, &si[n]), vol));
+			}
+		}
+	}
+}
+
+static inline __m512 mix_n(const float **sj, const float *coef, uint32_t n_coef,
+		uint32_t n, __mmask16 m)
+{
+	uint32_t k;
+	__m512 acc = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sj[0][n]), _mm512_set1_ps(coef[0]));
+	for (k = 1; k < n_coef; k++)
+		acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sj[k][n]),
+					_mm512_set1_ps(coef[k])));
+	return acc;
+}
+
+/* Generic matrix mix, see channelmix_f32_n_m_avx2() */
+void
+channelmix_f32_n_m_avx512(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, j, k, n, n_coef, unrolled = n_samples & ~63;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float *sj[n_src];
+	float coef[n_src];
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		__m512 acc[4], c;
+
+		for (j = 0, n_coef = 0; j < n_src; j++) {
+			if (mix->matrix[i][j] == 0.0f)
+				continue;
+			sj[n_coef] = s[j];
+			coef[n_coef++] = mix->matrix[i][j];
+		}
+		if (n_coef == 0) {
+			memset(di, 0, n_samples * sizeof(float));
+			continue;
+		}
+		if (n_coef == 1 && coef[0] == 1.0f) {
+			spa_memcpy(di, sj[0], n_samples * sizeof(float));
+			continue;
+		}
+
+		for (n = 0; n < unrolled; n += 64) {
+			c = _mm512_set1_ps(coef[0]);
+			acc[0] = _mm512_mul_ps(_mm512_loadu_ps(&sj[0][n]), c);
+			acc[1] = _mm512_mul_ps(_mm512_loadu_ps(&sj[0][n+16]), c);
+			acc[2] = _mm512_mul_ps(_mm512_loadu_ps(&sj[0][n+32]), c);
+			acc[3] = _mm512_mul_ps(_mm512_loadu_ps(&sj[0][n+48]), c);
+			for (k = 1; k < n_coef; k++) {
+				c = _mm512_set1_ps(coef[k]);
+				acc[0] = _mm512_add_ps(acc[0], _mm512_mul_ps(_mm512_loadu_ps(&sj[k][n]), c));
+				acc[1] = _mm512_add_ps(acc[1], _mm512_mul_ps(_mm512_loadu_ps(&sj[k][n+16]), c));
+				acc[2] = _mm512_add_ps(acc[2], _mm512_mul_ps(_mm512_loadu_ps(&sj[k][n+32]), c));
+				acc[3] = _mm512_add_ps(acc[3], _mm512_mul_ps(_mm512_loadu_ps(&sj[k][n+48]), c));
+			}
+			_mm512_storeu_ps(&di[n], acc[0]);
+			_mm512_storeu_ps(&di[n+16], acc[1]);
+			_mm512_storeu_ps(&di[n+32], acc[2]);
+			_mm512_storeu_ps(&di[n+48], acc[3]);
+		}
+		for (; n < n_samples; n += 16) {
+			__mmask16 m = n_samples - n < 16 ? TAIL_MASK(n_samples - n) : 0xffff;
+			_mm512_mask_storeu_ps(&di[n], m, mix_n(sj, coef, n_coef, n, m));
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_avx512(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const __m512 v0 = _mm512_set1_ps(mix->matrix[0][0]);
+	const __m512 v1 = _mm512_set1_ps(mix->matrix[1][1]);
+	const __m512 clev = _mm512_set1_ps(mix->matrix[2][0]);
+	const __m512 llev = _mm512_set1_ps(mix->matrix[3][0]);
+	const __m512 slev0 = _mm512_set1_ps(mix->matrix[4][0]);
+	const __m512 slev1 = _mm512_set1_ps(mix->matrix[4][1]);
+	__m512 in, ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1];
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < n_samples; n += 16) {
+		__mmask16 m = n_samples - n < 16 ? TAIL_MASK(n_samples - n) : 0xffff;
+
+		ctr = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sFC[n]), clev);
+		ctr = _mm512_add_ps(ctr, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sLFE[n]), llev));
+		in = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sFL[n]), v0);
+		in = _mm512_add_ps(in, ctr);
+		in = _mm512_add_ps(in, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sSL[n]), slev0));
+		_mm512_mask_storeu_ps(&dFL[n], m, in);
+		in = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sFR[n]), v1);
+		in = _mm512_add_ps(in, ctr);
+		in = _mm512_add_ps(in, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sSR[n]), slev1));
+		_mm512_mask_storeu_ps(&dFR[n], m, in);
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR */
+void
+channelmix_f32_7p1_2_avx512(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const __m512 v0 = _mm512_set1_ps(mix->matrix[0][0]);
+	const __m512 v1 = _mm512_set1_ps(mix->matrix[1][1]);
+	const __m512 clev = _mm512_set1_ps((mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f);
+	const __m512 llev = _mm512_set1_ps((mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f);
+	const __m512 slev0 = _mm512_set1_ps(mix->matrix[0][4]);
+	const __m512 slev1 = _mm512_set1_ps(mix->matrix[1][5]);
+	const __m512 rlev0 = _mm512_set1_ps(mix->matrix[0][6]);
+	const __m512 rlev1 = _mm512_set1_ps(mix->matrix[1][7]);
+	__m512 in, ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1];
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+		return;
+	}
+	for(n = 0; n < n_samples; n += 16) {
+		__mmask16 m = n_samples - n < 16 ? TAIL_MASK(n_samples - n) : 0xffff;
+
+		ctr = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sFC[n]), clev);
+		ctr = _mm512_add_ps(ctr, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sLFE[n]), llev));
+		in = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sFL[n]), v0);
+		in = _mm512_add_ps(in, ctr);
+		in = _mm512_add_ps(in, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sSL[n]), slev0));
+		in = _mm512_add_ps(in, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sRL[n]), rlev0));
+		_mm512_mask_storeu_ps(&dFL[n], m, in);
+		in = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sFR[n]), v1);
+		in = _mm512_add_ps(in, ctr);
+		in = _mm512_add_ps(in, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sSR[n]), slev1));
+		in = _mm512_add_ps(in, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &sRR[n]), rlev1));
+		_mm512_mask_storeu_ps(&dFR[n], m, in);
+	}
+}
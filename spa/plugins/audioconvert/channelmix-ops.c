@@ -60,6 +60,16 @@ static const struct channelmix_info {
 	uint32_t cpu_flags;
 } channelmix_table[] =
 {
+#if defined (HAVE_AVX512F)
+	{ 2, MASK_MONO, 2, MASK_MONO, channelmix_copy_avx512, SPA_CPU_FLAG_AVX512 },
+	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_avx512, SPA_CPU_FLAG_AVX512 },
+	{ EQ, 0, EQ, 0, channelmix_copy_avx512, SPA_CPU_FLAG_AVX512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ 2, MASK_MONO, 2, MASK_MONO, channelmix_copy_avx2, SPA_CPU_FLAG_AVX2 },
+	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_avx2, SPA_CPU_FLAG_AVX2 },
+	{ EQ, 0, EQ, 0, channelmix_copy_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 #if defined (HAVE_SSE)
 	{ 2, MASK_MONO, 2, MASK_MONO, channelmix_copy_sse, SPA_CPU_FLAG_SSE },
 	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_sse, SPA_CPU_FLAG_SSE },
@@ -73,30 +83,59 @@ static const struct channelmix_info {
 	{ 2, MASK_STEREO, 1, MASK_MONO, channelmix_f32_2_1_c, 0 },
 	{ 4, MASK_QUAD, 1, MASK_MONO, channelmix_f32_4_1_c, 0 },
 	{ 4, MASK_3_1, 1, MASK_MONO, channelmix_f32_3p1_1_c, 0 },
+#if defined (HAVE_AVX2)
+	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 #if defined (HAVE_SSE)
 	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_sse, SPA_CPU_FLAG_SSE },
 #endif
 	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_c, 0 },
 	{ 2, MASK_STEREO, 4, MASK_3_1, channelmix_f32_2_3p1_c, 0 },
 	{ 2, MASK_STEREO, 6, MASK_5_1, channelmix_f32_2_5p1_c, 0 },
+#if defined (HAVE_AVX512F)
+	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_avx512, SPA_CPU_FLAG_AVX512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 #if defined (HAVE_SSE)
 	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_sse, SPA_CPU_FLAG_SSE },
 #endif
 	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_c, 0 },
+#if defined (HAVE_AVX2)
+	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 #if defined (HAVE_SSE)
 	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_sse, SPA_CPU_FLAG_SSE },
 #endif
 	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_c, 0 },
 
+#if defined (HAVE_AVX2)
+	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 #if defined (HAVE_SSE)
 	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_sse, SPA_CPU_FLAG_SSE },
 #endif
 	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_c, 0 },
 
+#if defined (HAVE_AVX512F)
+	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_avx512, SPA_CPU_FLAG_AVX512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_avx2, SPA_CPU_FLAG_AVX2 },
+	{ 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_avx2, SPA_CPU_FLAG_AVX2 },
+	{ 8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_c, 0 },
 	{ 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_c, 0 },
 	{ 8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_c, 0 },
 
+#if defined (HAVE_AVX512F)
+	{ ANY, 0, ANY, 0, channelmix_f32_n_m_avx512, SPA_CPU_FLAG_AVX512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ ANY, 0, ANY, 0, channelmix_f32_n_m_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
 	{ ANY, 0, ANY, 0, channelmix_f32_n_m_c, 0 },
 };
 
@@ -347,32 +386,28 @@ static int make_matrix(struct channelmix *mix)
 	return 0;
 }
 
-static void impl_channelmix_set_volume(struct channelmix *mix, float volume, bool mute,
-		uint32_t n_channel_volumes, float *channel_volumes)
+static void set_matrix(struct channelmix *mix, uint32_t n_volumes, const float *volumes)
 {
-	float volumes[SPA_AUDIO_MAX_CHANNELS];
-	float vol = mute ? 0.0f : volume, sum, t;
+	float sum, t;
 	uint32_t i, j;
 	uint32_t src_chan = mix->src_chan;
 	uint32_t dst_chan = mix->dst_chan;
 
-	/** apply global volume to channels */
 	sum = 0.0;
 	mix->norm = true;
-	for (i = 0; i < n_channel_volumes; i++) {
-		volumes[i] = channel_volumes[i] * vol;
+	for (i = 0; i < n_volumes; i++) {
 		if (volumes[i] != 1.0f)
 			mix->norm = false;
 		sum += volumes[i];
 	}
 
-	if (n_channel_volumes == src_chan) {
+	if (n_volumes == src_chan) {
 		for (i = 0; i < dst_chan; i++) {
 			for (j = 0; j < src_chan; j++) {
 				mix->matrix[i][j] = mix->matrix_orig[i][j] * volumes[j];
 			}
 		}
-	} else if (n_channel_volumes == dst_chan) {
+	} else if (n_volumes == dst_chan) {
 		for (i = 0; i < dst_chan; i++) {
 			for (j = 0; j < src_chan; j++) {
 				mix->matrix[i][j] = mix->matrix_orig[i][j] * volumes[i];
@@ -403,6 +438,98 @@ static void impl_channelmix_set_volume(struct channelmix *mix, float volume, boo
 	spa_log_debug(mix->log, "zero:%d norm:%d identity:%d", mix->zero, mix->norm, mix->identity);
 }
 
+static void impl_channelmix_process_ramp(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	const struct channelmix_info *info = mix->data;
+	struct volume *vol = &mix->volume;
+	uint32_t i, n, len, n_ramp = SPA_MIN(n_samples, vol->ramp.remaining);
+	void *d[SPA_AUDIO_MAX_CHANNELS], *t[SPA_AUDIO_MAX_CHANNELS];
+	const void *s[SPA_AUDIO_MAX_CHANNELS];
+
+	if (vol->n_channels == mix->src_chan) {
+		if (mix->ramp_copy) {
+			volume_process(vol, (void **)dst, (const void **)src, n_ramp);
+		} else {
+			/* apply the gains to the input in small blocks */
+			for (i = 0; i < n_src; i++)
+				t[i] = mix->ramp_tmp[i];
+			for (n = 0; n < n_ramp; n += len) {
+				len = SPA_MIN(n_ramp - n, (uint32_t)CHANNELMIX_RAMP_BLOCK);
+				for (i = 0; i < n_src; i++)
+					s[i] = SPA_MEMBER(src[i], n * sizeof(float), const void);
+				for (i = 0; i < n_dst; i++)
+					d[i] = SPA_MEMBER(dst[i], n * sizeof(float), void);
+				volume_process(vol, t, s, len);
+				info->process(mix, n_dst, d, n_src, (const void **)t, len);
+			}
+		}
+	} else {
+		info->process(mix, n_dst, dst, n_src, src, n_ramp);
+		volume_process(vol, (void **)dst, (const void **)dst, n_ramp);
+	}
+
+	if (vol->ramp.remaining > 0)
+		return;
+
+	/* the ramp is done, put the volumes back in the matrix */
+	set_matrix(mix, vol->n_channels, vol->ramp.target);
+	mix->process = info->process;
+
+	if (n_ramp < n_samples) {
+		for (i = 0; i < n_src; i++)
+			s[i] = SPA_MEMBER(src[i], n_ramp * sizeof(float), const void);
+		for (i = 0; i < n_dst; i++)
+			d[i] = SPA_MEMBER(dst[i], n_ramp * sizeof(float), void);
+		info->process(mix, n_dst, d, n_src, s, n_samples - n_ramp);
+	}
+}
+
+static void impl_channelmix_set_volume(struct channelmix *mix, float volume, bool mute,
+		uint32_t n_channel_volumes, float *channel_volumes)
+{
+	const struct channelmix_info *info = mix->data;
+	struct volume *vol = &mix->volume;
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	float vol_g = mute ? 0.0f : volume;
+	uint32_t i;
+	bool ramp;
+
+	/** apply global volume to channels */
+	for (i = 0; i < n_channel_volumes; i++)
+		volumes[i] = channel_volumes[i] * vol_g;
+
+	ramp = vol->ramp.type != SPA_RAMP_NONE && vol->ramp.duration > 0 &&
+		(n_channel_volumes == mix->src_chan || n_channel_volumes == mix->dst_chan);
+
+	if (!ramp) {
+		set_matrix(mix, n_channel_volumes, volumes);
+		return;
+	}
+
+	/* the first volume is applied right away, changes after that ramp */
+	if (vol->n_channels != n_channel_volumes) {
+		vol->n_channels = n_channel_volumes;
+		mix->have_volume = false;
+	}
+	volume_set_gains(vol, volumes, mix->have_volume);
+	mix->have_volume = true;
+
+	if (vol->ramp.remaining == 0) {
+		set_matrix(mix, n_channel_volumes, volumes);
+		mix->process = info->process;
+		return;
+	}
+
+	for (i = 0; i < n_channel_volumes; i++)
+		volumes[i] = 1.0f;
+	set_matrix(mix, n_channel_volumes, volumes);
+	mix->ramp_copy = mix->identity;
+	/* the ramp needs the process function, also for an identity matrix */
+	mix->identity = false;
+	mix->process = impl_channelmix_process_ramp;
+}
+
 static void impl_channelmix_free(struct channelmix *mix)
 {
 	mix->process = NULL;
@@ -417,9 +544,17 @@ int channelmix_init(struct channelmix *mix)
 	if (info == NULL)
 		return -ENOTSUP;
 
+	/* updated with the number of channel volumes that are set */
+	mix->volume.n_channels = mix->src_chan;
+	mix->volume.cpu_flags = mix->cpu_flags;
+	if (volume_init(&mix->volume) < 0)
+		return -ENOTSUP;
+
 	mix->free = impl_channelmix_free;
 	mix->process = info->process;
 	mix->set_volume = impl_channelmix_set_volume;
 	mix->cpu_flags = info->cpu_flags;
+	mix->data = (void*)info;
+	mix->have_volume = false;
 	return make_matrix(mix);
 }
@@ -28,6 +28,8 @@
 #include <spa/utils/defs.h>
 #include <spa/param/audio/raw.h>
 
+#include "volume-ops.h"
+
 #define VOLUME_MIN 0.0f
 #define VOLUME_NORM 1.0f
 
@@ -39,6 +41,7 @@
 #define MASK_5_1	_M(FL)|_M(FR)|_M(FC)|_M(LFE)|_M(SL)|_M(SR)|_M(RL)|_M(RR)
 #define MASK_7_1	_M(FL)|_M(FR)|_M(FC)|_M(LFE)|_M(SL)|_M(SR)|_M(RL)|_M(RR)
 
+#define CHANNELMIX_RAMP_BLOCK	64
 
 struct channelmix {
 	uint32_t src_chan;
@@ -53,9 +56,16 @@ struct channelmix {
 	unsigned int identity:1;	/* identity matrix */
 	unsigned int norm:1;		/* all normal values */
 	unsigned int equal:1;	/* all values are equal */
+	unsigned int have_volume:1;	/* a volume was set before */
+	unsigned int ramp_copy:1;	/* matrix without volumes is a copy */
 	float matrix_orig[SPA_AUDIO_MAX_CHANNELS][SPA_AUDIO_MAX_CHANNELS];
 	float matrix[SPA_AUDIO_MAX_CHANNELS][SPA_AUDIO_MAX_CHANNELS];
 
+	/* while a volume change ramps, the matrix has no volumes and the
+	 * ramp is applied on the side the volumes belong to */
+	struct volume volume;
+	float ramp_tmp[SPA_AUDIO_MAX_CHANNELS][CHANNELMIX_RAMP_BLOCK];
+
 	void (*process) (struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
 			uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples);
 	void (*set_volume) (struct channelmix *mix, float volume, bool mute,
@@ -101,3 +111,24 @@ DEFINE_FUNCTION(f32_5p1_3p1, sse);
 DEFINE_FUNCTION(f32_5p1_4, sse);
 DEFINE_FUNCTION(f32_7p1_4, sse);
 #endif
+
+#if defined (HAVE_AVX2)
+DEFINE_FUNCTION(copy, avx2);
+DEFINE_FUNCTION(f32_n_m, avx2);
+DEFINE_FUNCTION(f32_2_4, avx2);
+DEFINE_FUNCTION(f32_5p1_2, avx2);
+DEFINE_FUNCTION(f32_5p1_3p1, avx2);
+DEFINE_FUNCTION(f32_5p1_4, avx2);
+DEFINE_FUNCTION(f32_7p1_2, avx2);
+DEFINE_FUNCTION(f32_7p1_3p1, avx2);
+DEFINE_FUNCTION(f32_7p1_4, avx2);
+#endif
+
+#if defined (HAVE_AVX512F)
+DEFINE_FUNCTION(copy, avx512);
+DEFINE_FUNCTION(f32_n_m, avx512);
+DEFINE_FUNCTION(f32_5p1_2, avx512);
+DEFINE_FUNCTION(f32_7p1_2, avx512);
+#endif
+
+#undef DEFINE_FUNCTION
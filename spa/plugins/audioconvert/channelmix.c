@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
@@ -126,6 +127,9 @@ struct impl {
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
 	uint32_t cpu_flags;
+
+	enum spa_ramp_type ramp;
+	uint32_t ramp_time;
 };
 
 #define CHECK_PORT(this,d,id)		(id == 0)
@@ -234,6 +238,8 @@ static int setup_convert(struct impl *this,
 	this->mix.dst_mask = dst_mask;
 	this->mix.cpu_flags = this->cpu_flags;
 	this->mix.log = this->log;
+	this->mix.volume.ramp.type = this->ramp;
+	this->mix.volume.ramp.duration = this->ramp_time * src_info->info.raw.rate / 1000;
 
 	if ((res = channelmix_init(&this->mix)) < 0)
 		return res;
@@ -1004,6 +1010,17 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.n_params = 2;
 	props_reset(&this->props);
 
+	this->ramp = VOLUME_DEFAULT_RAMP;
+	this->ramp_time = VOLUME_DEFAULT_RAMP_TIME;
+	if (info != NULL) {
+		const char *str;
+
+		if ((str = spa_dict_lookup(info, "volume.ramp")) != NULL)
+			this->ramp = spa_ramp_type_from_label(str);
+		if ((str = spa_dict_lookup(info, "volume.ramp-time")) != NULL)
+			this->ramp_time = atoi(str);
+	}
+
 	port = GET_OUT_PORT(this, 0);
 	port->direction = SPA_DIRECTION_OUTPUT;
 	port->id = 0;
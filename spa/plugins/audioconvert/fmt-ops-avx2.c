@@ -931,6 +931,372 @@ conv_f32d_to_s16_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const voi
 		conv_f32d_to_s16_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
 }
 
+static inline void
+dither_load_avx2(__m256i rnd[8], const uint32_t *random)
+{
+	int i;
+	for (i = 0; i < 8; i++)
+		rnd[i] = _mm256_loadu_si256((__m256i*)&random[i * 8]);
+}
+
+static inline void
+dither_store_avx2(uint32_t *random, const __m256i rnd[8])
+{
+	int i;
+	for (i = 0; i < 8; i++)
+		_mm256_storeu_si256((__m256i*)&random[i * 8], rnd[i]);
+}
+
+static inline __m256
+dither_tpdf_avx2(__m256i state[2])
+{
+	__m256i r1 = state[0], r2 = state[1];
+	const __m256 scale = _mm256_set1_ps(DITHER_SCALE);
+
+	r1 = _mm256_xor_si256(r1, _mm256_slli_epi32(r1, 13));
+	r1 = _mm256_xor_si256(r1, _mm256_srli_epi32(r1, 17));
+	r1 = _mm256_xor_si256(r1, _mm256_slli_epi32(r1, 5));
+	r2 = _mm256_xor_si256(r2, _mm256_slli_epi32(r2, 13));
+	r2 = _mm256_xor_si256(r2, _mm256_srli_epi32(r2, 17));
+	r2 = _mm256_xor_si256(r2, _mm256_slli_epi32(r2, 5));
+	state[0] = r1;
+	state[1] = r2;
+
+	return _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(r1), _mm256_cvtepi32_ps(r2)), scale);
+}
+
+static void
+conv_f32d_to_s16_dither_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out, rnd[8];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	dither_load_avx2(rnd, conv->random);
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in = _mm256_add_ps(in, dither_tpdf_avx2(&rnd[0]));
+		in = _mm256_min_ps(int_max, _mm256_max_ps(in, int_min));
+		out = _mm256_cvtps_epi32(in);
+
+		d[0*n_channels] = _mm256_extract_epi32(out, 0);
+		d[1*n_channels] = _mm256_extract_epi32(out, 1);
+		d[2*n_channels] = _mm256_extract_epi32(out, 2);
+		d[3*n_channels] = _mm256_extract_epi32(out, 3);
+		d[4*n_channels] = _mm256_extract_epi32(out, 4);
+		d[5*n_channels] = _mm256_extract_epi32(out, 5);
+		d[6*n_channels] = _mm256_extract_epi32(out, 6);
+		d[7*n_channels] = _mm256_extract_epi32(out, 7);
+		d += 8*n_channels;
+	}
+	dither_store_avx2(conv->random, rnd);
+
+	for(; n < n_samples; n++) {
+		__m128 in;
+		__m128 int_max = _mm_set1_ps(S16_MAX_F);
+	        __m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+		in = _mm_mul_ss(_mm_load_ss(&s0[n]), int_max);
+		in = _mm_add_ss(in, _mm_set_ss(dither_tpdf(&conv->random[0])));
+		in = _mm_min_ss(int_max, _mm_max_ss(in, int_min));
+		*d = _mm_cvtss_si32(in);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_2s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[2];
+	__m256i out[2], t[2], rnd[8];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	dither_load_avx2(rnd, conv->random);
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[0] = _mm256_add_ps(in[0], dither_tpdf_avx2(&rnd[0]));
+		in[1] = _mm256_add_ps(in[1], dither_tpdf_avx2(&rnd[2]));
+		in[0] = _mm256_min_ps(int_max, _mm256_max_ps(in[0], int_min));
+		in[1] = _mm256_min_ps(int_max, _mm256_max_ps(in[1], int_min));
+
+		out[0] = _mm256_cvtps_epi32(in[0]);
+		out[1] = _mm256_cvtps_epi32(in[1]);
+
+		t[0] = _mm256_unpacklo_epi32(out[0], out[1]);
+		t[1] = _mm256_unpackhi_epi32(out[0], out[1]);
+
+		out[0] = _mm256_packs_epi32(t[0], t[1]);
+
+		*((int32_t*)(d + 0*n_channels)) = _mm256_extract_epi32(out[0],0);
+		*((int32_t*)(d + 1*n_channels)) = _mm256_extract_epi32(out[0],1);
+		*((int32_t*)(d + 2*n_channels)) = _mm256_extract_epi32(out[0],2);
+		*((int32_t*)(d + 3*n_channels)) = _mm256_extract_epi32(out[0],3);
+		*((int32_t*)(d + 4*n_channels)) = _mm256_extract_epi32(out[0],4);
+		*((int32_t*)(d + 5*n_channels)) = _mm256_extract_epi32(out[0],5);
+		*((int32_t*)(d + 6*n_channels)) = _mm256_extract_epi32(out[0],6);
+		*((int32_t*)(d + 7*n_channels)) = _mm256_extract_epi32(out[0],7);
+		d += 8*n_channels;
+	}
+	dither_store_avx2(conv->random, rnd);
+
+	for(; n < n_samples; n++) {
+		__m128 in[2];
+		__m128 int_max = _mm_set1_ps(S16_MAX_F);
+	        __m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+		in[0] = _mm_mul_ss(_mm_load_ss(&s0[n]), int_max);
+		in[1] = _mm_mul_ss(_mm_load_ss(&s1[n]), int_max);
+		in[0] = _mm_add_ss(in[0], _mm_set_ss(dither_tpdf(&conv->random[0])));
+		in[1] = _mm_add_ss(in[1], _mm_set_ss(dither_tpdf(&conv->random[0])));
+		in[0] = _mm_min_ss(int_max, _mm_max_ss(in[0], int_min));
+		in[1] = _mm_min_ss(int_max, _mm_max_ss(in[1], int_min));
+		d[0] = _mm_cvtss_si32(in[0]);
+		d[1] = _mm_cvtss_si32(in[1]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i out[4], t[4], rnd[8];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	dither_load_avx2(rnd, conv->random);
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), int_max);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), int_max);
+
+		in[0] = _mm256_add_ps(in[0], dither_tpdf_avx2(&rnd[0]));
+		in[1] = _mm256_add_ps(in[1], dither_tpdf_avx2(&rnd[2]));
+		in[2] = _mm256_add_ps(in[2], dither_tpdf_avx2(&rnd[4]));
+		in[3] = _mm256_add_ps(in[3], dither_tpdf_avx2(&rnd[6]));
+
+		in[0] = _mm256_min_ps(int_max, _mm256_max_ps(in[0], int_min));
+		in[1] = _mm256_min_ps(int_max, _mm256_max_ps(in[1], int_min));
+		in[2] = _mm256_min_ps(int_max, _mm256_max_ps(in[2], int_min));
+		in[3] = _mm256_min_ps(int_max, _mm256_max_ps(in[3], int_min));
+
+		t[0] = _mm256_cvtps_epi32(in[0]);
+		t[1] = _mm256_cvtps_epi32(in[1]);
+		t[2] = _mm256_cvtps_epi32(in[2]);
+		t[3] = _mm256_cvtps_epi32(in[3]);
+
+		t[0] = _mm256_packs_epi32(t[0], t[2]);
+		t[1] = _mm256_packs_epi32(t[1], t[3]);
+
+		out[0] = _mm256_unpacklo_epi16(t[0], t[1]);
+		out[1] = _mm256_unpackhi_epi16(t[0], t[1]);
+		out[2] = _mm256_unpacklo_epi32(out[0], out[1]);
+		out[3] = _mm256_unpackhi_epi32(out[0], out[1]);
+
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), _mm256_castsi256_si128(out[2]));
+		_mm_storel_epi64((__m128i*)(d + 1*n_channels), _mm_srli_si128(_mm256_castsi256_si128(out[2]), 8));
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), _mm256_castsi256_si128(out[3]));
+		_mm_storel_epi64((__m128i*)(d + 3*n_channels), _mm_srli_si128(_mm256_castsi256_si128(out[3]), 8));
+		_mm_storel_epi64((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storel_epi64((__m128i*)(d + 5*n_channels), _mm_srli_si128(_mm256_extracti128_si256(out[2], 1), 8));
+		_mm_storel_epi64((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[3], 1));
+		_mm_storel_epi64((__m128i*)(d + 7*n_channels), _mm_srli_si128(_mm256_extracti128_si256(out[3], 1), 8));
+
+		d += 8*n_channels;
+	}
+	dither_store_avx2(conv->random, rnd);
+
+	for(; n < n_samples; n++) {
+		__m128 in;
+		__m128i out;
+		__m128 int_max = _mm_set1_ps(S16_MAX_F);
+	        __m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+		__m128 noise = _mm_setr_ps(dither_tpdf(&conv->random[0]), dither_tpdf(&conv->random[0]),
+				dither_tpdf(&conv->random[0]), dither_tpdf(&conv->random[0]));
+
+		in = _mm_mul_ps(_mm_setr_ps(s0[n], s1[n], s2[n], s3[n]), int_max);
+		in = _mm_add_ps(in, noise);
+		in = _mm_min_ps(int_max, _mm_max_ps(in, int_min));
+		out = _mm_cvtps_epi32(in);
+		out = _mm_packs_epi32(out, out);
+		_mm_storel_epi64((__m128i*)d, out);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_dither_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_dither_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_dither_2s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_dither_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+/* The error feedback runs from one frame to the next so the noise shaper
+ * works on a frame of up to 8 channels at a time. */
+static inline __m128i
+shape_frame_avx2(__m256 in, __m256 e[NS_ORDER], const __m256 c[NS_ORDER], __m256i *rnd)
+{
+	__m256 v;
+	__m256i q;
+
+	v = _mm256_add_ps(_mm256_mul_ps(c[0], e[0]), _mm256_mul_ps(c[1], e[1]));
+	v = _mm256_add_ps(v, _mm256_mul_ps(c[2], e[2]));
+	v = _mm256_sub_ps(in, v);
+	q = _mm256_cvtps_epi32(_mm256_add_ps(v, dither_tpdf_avx2(rnd)));
+	e[2] = e[1];
+	e[1] = e[0];
+	e[0] = _mm256_sub_ps(_mm256_cvtepi32_ps(q), v);
+	return _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+}
+
+static void
+conv_f32d_to_s16_shaped_8s_avx2(struct convert *conv, uint32_t ch, int16_t *d, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	uint32_t i, n, unrolled;
+	__m128 lo[4], hi[4];
+	__m256 in, e[NS_ORDER], c[NS_ORDER];
+	__m256i rnd[8];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+
+	for (i = 0, unrolled = n_samples & ~3; i < 8; i++) {
+		if (!SPA_IS_ALIGNED(s[i], 16))
+			unrolled = 0;
+	}
+
+	for (n = 0; n < NS_ORDER; n++) {
+		c[n] = _mm256_set1_ps(conv->ns_coef[n]);
+		e[n] = _mm256_loadu_ps(&conv->ns_data[n][ch]);
+	}
+	dither_load_avx2(rnd, conv->random);
+
+	for(n = 0; n < unrolled; n += 4) {
+		for (i = 0; i < 4; i++) {
+			lo[i] = _mm_load_ps(&s[i][n]);
+			hi[i] = _mm_load_ps(&s[i + 4][n]);
+		}
+		_MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);
+		_MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);
+
+		for (i = 0; i < 4; i++) {
+			in = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[i]), hi[i], 1);
+			in = _mm256_mul_ps(in, int_max);
+			_mm_storeu_si128((__m128i*)(d + i*n_channels),
+					shape_frame_avx2(in, e, c, &rnd[i * 2]));
+		}
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		in = _mm256_setr_ps(s[0][n], s[1][n], s[2][n], s[3][n],
+				s[4][n], s[5][n], s[6][n], s[7][n]);
+		in = _mm256_mul_ps(in, int_max);
+		_mm_storeu_si128((__m128i*)d, shape_frame_avx2(in, e, c, &rnd[0]));
+		d += n_channels;
+	}
+
+	for (n = 0; n < NS_ORDER; n++)
+		_mm256_storeu_ps(&conv->ns_data[n][ch], e[n]);
+	dither_store_avx2(conv->random, rnd);
+}
+
+static void
+conv_f32d_to_s16_shaped_ns_avx2(struct convert *conv, uint32_t ch, int16_t *d, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_shaped, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	uint32_t i, n;
+	float t[8] = { 0.0f, }, err[NS_ORDER][8] = { { 0.0f, }, };
+	int16_t o[8];
+	__m256 e[NS_ORDER], c[NS_ORDER];
+	__m256i rnd[8];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+
+	for (n = 0; n < NS_ORDER; n++) {
+		for (i = 0; i < n_shaped; i++)
+			err[n][i] = conv->ns_data[n][ch + i];
+		c[n] = _mm256_set1_ps(conv->ns_coef[n]);
+		e[n] = _mm256_loadu_ps(err[n]);
+	}
+	dither_load_avx2(rnd, conv->random);
+
+	for(n = 0; n < n_samples; n++) {
+		for (i = 0; i < n_shaped; i++)
+			t[i] = s[i][n];
+		_mm_storeu_si128((__m128i*)o, shape_frame_avx2(_mm256_mul_ps(_mm256_loadu_ps(t), int_max), e, c, &rnd[0]));
+		for (i = 0; i < n_shaped; i++)
+			d[i] = o[i];
+		d += n_channels;
+	}
+
+	for (n = 0; n < NS_ORDER; n++) {
+		_mm256_storeu_ps(err[n], e[n]);
+		for (i = 0; i < n_shaped; i++)
+			conv->ns_data[n][ch + i] = err[n][i];
+	}
+	dither_store_avx2(conv->random, rnd);
+}
+
+void
+conv_f32d_to_s16_shaped_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 7 < n_channels; i += 8)
+		conv_f32d_to_s16_shaped_8s_avx2(conv, i, &d[i], &src[i], n_channels, n_samples);
+	if (i < n_channels)
+		conv_f32d_to_s16_shaped_ns_avx2(conv, i, &d[i], &src[i], n_channels,
+				n_channels - i, n_samples);
+}
+
 void
 conv_f32d_to_s16_4_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
 		uint32_t n_samples)
@@ -1052,3 +1418,839 @@ conv_f32d_to_s16_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const v
 		d += 2;
 	}
 }
+
+static inline void
+transpose_4x4_avx2(__m256 v[4])
+{
+	__m256 t[4];
+
+	/* transposes the 4x4 matrix in each 128 bit lane */
+	t[0] = _mm256_unpacklo_ps(v[0], v[1]);
+	t[1] = _mm256_unpackhi_ps(v[0], v[1]);
+	t[2] = _mm256_unpacklo_ps(v[2], v[3]);
+	t[3] = _mm256_unpackhi_ps(v[2], v[3]);
+	v[0] = _mm256_shuffle_ps(t[0], t[2], _MM_SHUFFLE(1, 0, 1, 0));
+	v[1] = _mm256_shuffle_ps(t[0], t[2], _MM_SHUFFLE(3, 2, 3, 2));
+	v[2] = _mm256_shuffle_ps(t[1], t[3], _MM_SHUFFLE(1, 0, 1, 0));
+	v[3] = _mm256_shuffle_ps(t[1], t[3], _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+static inline void
+write_s24x4_avx2(uint8_t *d, __m128i v)
+{
+	_mm_storel_epi64((__m128i*)d, v);
+	*((uint32_t*)(d + 8)) = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+static void
+conv_s16s_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint16_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S16_SCALE);
+	const __m256i mask = _mm256_setr_epi8(-1, -1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12,
+			-1, -1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_setr_epi32(
+			s[0*n_channels],
+			s[1*n_channels],
+			s[2*n_channels],
+			s[3*n_channels],
+			s[4*n_channels],
+			s[5*n_channels],
+			s[6*n_channels],
+			s[7*n_channels]);
+		in = _mm256_shuffle_epi8(in, mask);
+		in = _mm256_srai_epi32(in, 16);
+		out = _mm256_cvtepi32_ps(in);
+		out = _mm256_mul_ps(out, factor);
+		_mm256_store_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16S_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s16s_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint16_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256i in[4];
+	__m256 out[4], factor = _mm256_set1_ps(1.0f / S16_SCALE);
+	const __m256i mask = _mm256_setr_epi8(-1, -1, 1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6,
+			-1, -1, 1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6);
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		in[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadl_epi64((__m128i*)(s + 0*n_channels))),
+				_mm_loadl_epi64((__m128i*)(s + 4*n_channels)), 1);
+		in[1] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadl_epi64((__m128i*)(s + 1*n_channels))),
+				_mm_loadl_epi64((__m128i*)(s + 5*n_channels)), 1);
+		in[2] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadl_epi64((__m128i*)(s + 2*n_channels))),
+				_mm_loadl_epi64((__m128i*)(s + 6*n_channels)), 1);
+		in[3] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadl_epi64((__m128i*)(s + 3*n_channels))),
+				_mm_loadl_epi64((__m128i*)(s + 7*n_channels)), 1);
+		in[0] = _mm256_shuffle_epi8(in[0], mask);
+		in[1] = _mm256_shuffle_epi8(in[1], mask);
+		in[2] = _mm256_shuffle_epi8(in[2], mask);
+		in[3] = _mm256_shuffle_epi8(in[3], mask);
+		in[0] = _mm256_srai_epi32(in[0], 16);
+		in[1] = _mm256_srai_epi32(in[1], 16);
+		in[2] = _mm256_srai_epi32(in[2], 16);
+		in[3] = _mm256_srai_epi32(in[3], 16);
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[1] = _mm256_cvtepi32_ps(in[1]);
+		out[2] = _mm256_cvtepi32_ps(in[2]);
+		out[3] = _mm256_cvtepi32_ps(in[3]);
+		out[0] = _mm256_mul_ps(out[0], factor);
+		out[1] = _mm256_mul_ps(out[1], factor);
+		out[2] = _mm256_mul_ps(out[2], factor);
+		out[3] = _mm256_mul_ps(out[3], factor);
+
+		transpose_4x4_avx2(out);
+
+		_mm256_store_ps(&d0[n], out[0]);
+		_mm256_store_ps(&d1[n], out[1]);
+		_mm256_store_ps(&d2[n], out[2]);
+		_mm256_store_ps(&d3[n], out[3]);
+		s += 8 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16S_TO_F32(s[0]);
+		d1[n] = S16S_TO_F32(s[1]);
+		d2[n] = S16S_TO_F32(s[2]);
+		d3[n] = S16S_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16s_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s16s_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s16s_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_s24s_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S24_SCALE);
+	const __m256i mask = _mm256_setr_epi8(-1, 2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12,
+			-1, 2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    n_samples > 0) {
+		unrolled = n_samples & ~7;
+		if ((n_samples & 7) == 0)
+			unrolled -= 8;
+	}
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_setr_epi32(
+			*((uint32_t*)&s[0 * n_channels]),
+			*((uint32_t*)&s[3 * n_channels]),
+			*((uint32_t*)&s[6 * n_channels]),
+			*((uint32_t*)&s[9 * n_channels]),
+			*((uint32_t*)&s[12 * n_channels]),
+			*((uint32_t*)&s[15 * n_channels]),
+			*((uint32_t*)&s[18 * n_channels]),
+			*((uint32_t*)&s[21 * n_channels]));
+		in = _mm256_shuffle_epi8(in, mask);
+		in = _mm256_srai_epi32(in, 8);
+		out = _mm256_cvtepi32_ps(in);
+		out = _mm256_mul_ps(out, factor);
+		_mm256_store_ps(&d0[n], out);
+		s += 24 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24s(s));
+		s += 3 * n_channels;
+	}
+}
+
+static void
+conv_s24s_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256i in[4];
+	__m256 out[4], factor = _mm256_set1_ps(1.0f / S24_SCALE);
+	const __m256i mask = _mm256_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+			-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32) &&
+	    n_samples > 0) {
+		unrolled = n_samples & ~7;
+		if ((n_samples & 7) == 0)
+			unrolled -= 8;
+	}
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		in[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 0*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 12*n_channels)), 1);
+		in[1] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 3*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 15*n_channels)), 1);
+		in[2] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 6*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 18*n_channels)), 1);
+		in[3] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 9*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 21*n_channels)), 1);
+		in[0] = _mm256_shuffle_epi8(in[0], mask);
+		in[1] = _mm256_shuffle_epi8(in[1], mask);
+		in[2] = _mm256_shuffle_epi8(in[2], mask);
+		in[3] = _mm256_shuffle_epi8(in[3], mask);
+		in[0] = _mm256_srai_epi32(in[0], 8);
+		in[1] = _mm256_srai_epi32(in[1], 8);
+		in[2] = _mm256_srai_epi32(in[2], 8);
+		in[3] = _mm256_srai_epi32(in[3], 8);
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[1] = _mm256_cvtepi32_ps(in[1]);
+		out[2] = _mm256_cvtepi32_ps(in[2]);
+		out[3] = _mm256_cvtepi32_ps(in[3]);
+		out[0] = _mm256_mul_ps(out[0], factor);
+		out[1] = _mm256_mul_ps(out[1], factor);
+		out[2] = _mm256_mul_ps(out[2], factor);
+		out[3] = _mm256_mul_ps(out[3], factor);
+
+		transpose_4x4_avx2(out);
+
+		_mm256_store_ps(&d0[n], out[0]);
+		_mm256_store_ps(&d1[n], out[1]);
+		_mm256_store_ps(&d2[n], out[2]);
+		_mm256_store_ps(&d3[n], out[3]);
+		s += 24 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24s(s));
+		d1[n] = S24_TO_F32(read_s24s(s+3));
+		d2[n] = S24_TO_F32(read_s24s(s+6));
+		d3[n] = S24_TO_F32(read_s24s(s+9));
+		s += 3 * n_channels;
+	}
+}
+
+void
+conv_s24s_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint8_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24s_to_f32d_4s_avx2(conv, &dst[i], &s[3*i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24s_to_f32d_1s_avx2(conv, &dst[i], &s[3*i], n_channels, n_samples);
+}
+
+static void
+conv_s32s_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S24_SCALE);
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_setr_epi32(
+			s[0*n_channels],
+			s[1*n_channels],
+			s[2*n_channels],
+			s[3*n_channels],
+			s[4*n_channels],
+			s[5*n_channels],
+			s[6*n_channels],
+			s[7*n_channels]);
+		in = _mm256_shuffle_epi8(in, mask);
+		in = _mm256_srai_epi32(in, 8);
+		out = _mm256_cvtepi32_ps(in);
+		out = _mm256_mul_ps(out, factor);
+		_mm256_store_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32S_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32s_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256i in[4];
+	__m256 out[4], factor = _mm256_set1_ps(1.0f / S24_SCALE);
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		in[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 0*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 4*n_channels)), 1);
+		in[1] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 1*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 5*n_channels)), 1);
+		in[2] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 2*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 6*n_channels)), 1);
+		in[3] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128((__m128i*)(s + 3*n_channels))),
+				_mm_loadu_si128((__m128i*)(s + 7*n_channels)), 1);
+		in[0] = _mm256_shuffle_epi8(in[0], mask);
+		in[1] = _mm256_shuffle_epi8(in[1], mask);
+		in[2] = _mm256_shuffle_epi8(in[2], mask);
+		in[3] = _mm256_shuffle_epi8(in[3], mask);
+		in[0] = _mm256_srai_epi32(in[0], 8);
+		in[1] = _mm256_srai_epi32(in[1], 8);
+		in[2] = _mm256_srai_epi32(in[2], 8);
+		in[3] = _mm256_srai_epi32(in[3], 8);
+		out[0] = _mm256_cvtepi32_ps(in[0]);
+		out[1] = _mm256_cvtepi32_ps(in[1]);
+		out[2] = _mm256_cvtepi32_ps(in[2]);
+		out[3] = _mm256_cvtepi32_ps(in[3]);
+		out[0] = _mm256_mul_ps(out[0], factor);
+		out[1] = _mm256_mul_ps(out[1], factor);
+		out[2] = _mm256_mul_ps(out[2], factor);
+		out[3] = _mm256_mul_ps(out[3], factor);
+
+		transpose_4x4_avx2(out);
+
+		_mm256_store_ps(&d0[n], out[0]);
+		_mm256_store_ps(&d1[n], out[1]);
+		_mm256_store_ps(&d2[n], out[2]);
+		_mm256_store_ps(&d3[n], out[3]);
+		s += 8 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32S_TO_F32(s[0]);
+		d1[n] = S32S_TO_F32(s[1]);
+		d2[n] = S32S_TO_F32(s[2]);
+		d3[n] = S32S_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s32s_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32s_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32s_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s16s_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out;
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+	const __m256i mask = _mm256_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+			1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in = _mm256_min_ps(int_max, _mm256_max_ps(in, int_min));
+		out = _mm256_cvttps_epi32(in);
+		out = _mm256_shuffle_epi8(out, mask);
+		d[0*n_channels] = _mm256_extract_epi16(out, 0);
+		d[1*n_channels] = _mm256_extract_epi16(out, 1);
+		d[2*n_channels] = _mm256_extract_epi16(out, 2);
+		d[3*n_channels] = _mm256_extract_epi16(out, 3);
+		d[4*n_channels] = _mm256_extract_epi16(out, 8);
+		d[5*n_channels] = _mm256_extract_epi16(out, 9);
+		d[6*n_channels] = _mm256_extract_epi16(out, 10);
+		d[7*n_channels] = _mm256_extract_epi16(out, 11);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S16S(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16s_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i out[4];
+	__m256 int_max = _mm256_set1_ps(S16_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+	const __m256i mask = _mm256_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+			1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), int_max);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), int_max);
+		in[0] = _mm256_min_ps(int_max, _mm256_max_ps(in[0], int_min));
+		in[1] = _mm256_min_ps(int_max, _mm256_max_ps(in[1], int_min));
+		in[2] = _mm256_min_ps(int_max, _mm256_max_ps(in[2], int_min));
+		in[3] = _mm256_min_ps(int_max, _mm256_max_ps(in[3], int_min));
+
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		transpose_4x4_avx2(in);
+
+		out[0] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[0]), mask);
+		out[1] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[1]), mask);
+		out[2] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[2]), mask);
+		out[3] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[3]), mask);
+
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), _mm256_castsi256_si128(out[0]));
+		_mm_storel_epi64((__m128i*)(d + 1*n_channels), _mm256_castsi256_si128(out[1]));
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), _mm256_castsi256_si128(out[2]));
+		_mm_storel_epi64((__m128i*)(d + 3*n_channels), _mm256_castsi256_si128(out[3]));
+		_mm_storel_epi64((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[0], 1));
+		_mm_storel_epi64((__m128i*)(d + 5*n_channels), _mm256_extracti128_si256(out[1], 1));
+		_mm_storel_epi64((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storel_epi64((__m128i*)(d + 7*n_channels), _mm256_extracti128_si256(out[3], 1));
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16S(s0[n]);
+		d[1] = F32_TO_S16S(s1[n]);
+		d[2] = F32_TO_S16S(s2[n]);
+		d[3] = F32_TO_S16S(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16s_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16s_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16s_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out;
+	__m256 int_max = _mm256_set1_ps(S24_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in = _mm256_min_ps(int_max, _mm256_max_ps(in, int_min));
+		out = _mm256_cvttps_epi32(in);
+		write_s24(d + 0*n_channels, _mm256_extract_epi32(out, 0));
+		write_s24(d + 3*n_channels, _mm256_extract_epi32(out, 1));
+		write_s24(d + 6*n_channels, _mm256_extract_epi32(out, 2));
+		write_s24(d + 9*n_channels, _mm256_extract_epi32(out, 3));
+		write_s24(d + 12*n_channels, _mm256_extract_epi32(out, 4));
+		write_s24(d + 15*n_channels, _mm256_extract_epi32(out, 5));
+		write_s24(d + 18*n_channels, _mm256_extract_epi32(out, 6));
+		write_s24(d + 21*n_channels, _mm256_extract_epi32(out, 7));
+		d += 24*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24(d, F32_TO_S24(s0[n]));
+		d += 3*n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i out[4];
+	__m256 int_max = _mm256_set1_ps(S24_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+	const __m256i mask = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), int_max);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), int_max);
+		in[0] = _mm256_min_ps(int_max, _mm256_max_ps(in[0], int_min));
+		in[1] = _mm256_min_ps(int_max, _mm256_max_ps(in[1], int_min));
+		in[2] = _mm256_min_ps(int_max, _mm256_max_ps(in[2], int_min));
+		in[3] = _mm256_min_ps(int_max, _mm256_max_ps(in[3], int_min));
+
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		transpose_4x4_avx2(in);
+
+		out[0] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[0]), mask);
+		out[1] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[1]), mask);
+		out[2] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[2]), mask);
+		out[3] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[3]), mask);
+
+		write_s24x4_avx2(d + 0*n_channels, _mm256_castsi256_si128(out[0]));
+		write_s24x4_avx2(d + 3*n_channels, _mm256_castsi256_si128(out[1]));
+		write_s24x4_avx2(d + 6*n_channels, _mm256_castsi256_si128(out[2]));
+		write_s24x4_avx2(d + 9*n_channels, _mm256_castsi256_si128(out[3]));
+		write_s24x4_avx2(d + 12*n_channels, _mm256_extracti128_si256(out[0], 1));
+		write_s24x4_avx2(d + 15*n_channels, _mm256_extracti128_si256(out[1], 1));
+		write_s24x4_avx2(d + 18*n_channels, _mm256_extracti128_si256(out[2], 1));
+		write_s24x4_avx2(d + 21*n_channels, _mm256_extracti128_si256(out[3], 1));
+		d += 24*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24(d + 0, F32_TO_S24(s0[n]));
+		write_s24(d + 3, F32_TO_S24(s1[n]));
+		write_s24(d + 6, F32_TO_S24(s2[n]));
+		write_s24(d + 9, F32_TO_S24(s3[n]));
+		d += 3*n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_4s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_1s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24s_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out;
+	__m256 int_max = _mm256_set1_ps(S24_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in = _mm256_min_ps(int_max, _mm256_max_ps(in, int_min));
+		out = _mm256_cvttps_epi32(in);
+		write_s24s(d + 0*n_channels, _mm256_extract_epi32(out, 0));
+		write_s24s(d + 3*n_channels, _mm256_extract_epi32(out, 1));
+		write_s24s(d + 6*n_channels, _mm256_extract_epi32(out, 2));
+		write_s24s(d + 9*n_channels, _mm256_extract_epi32(out, 3));
+		write_s24s(d + 12*n_channels, _mm256_extract_epi32(out, 4));
+		write_s24s(d + 15*n_channels, _mm256_extract_epi32(out, 5));
+		write_s24s(d + 18*n_channels, _mm256_extract_epi32(out, 6));
+		write_s24s(d + 21*n_channels, _mm256_extract_epi32(out, 7));
+		d += 24*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24s(d, F32_TO_S24(s0[n]));
+		d += 3*n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24s_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i out[4];
+	__m256 int_max = _mm256_set1_ps(S24_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+	const __m256i mask = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), int_max);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), int_max);
+		in[0] = _mm256_min_ps(int_max, _mm256_max_ps(in[0], int_min));
+		in[1] = _mm256_min_ps(int_max, _mm256_max_ps(in[1], int_min));
+		in[2] = _mm256_min_ps(int_max, _mm256_max_ps(in[2], int_min));
+		in[3] = _mm256_min_ps(int_max, _mm256_max_ps(in[3], int_min));
+
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		transpose_4x4_avx2(in);
+
+		out[0] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[0]), mask);
+		out[1] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[1]), mask);
+		out[2] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[2]), mask);
+		out[3] = _mm256_shuffle_epi8(_mm256_cvttps_epi32(in[3]), mask);
+
+		write_s24x4_avx2(d + 0*n_channels, _mm256_castsi256_si128(out[0]));
+		write_s24x4_avx2(d + 3*n_channels, _mm256_castsi256_si128(out[1]));
+		write_s24x4_avx2(d + 6*n_channels, _mm256_castsi256_si128(out[2]));
+		write_s24x4_avx2(d + 9*n_channels, _mm256_castsi256_si128(out[3]));
+		write_s24x4_avx2(d + 12*n_channels, _mm256_extracti128_si256(out[0], 1));
+		write_s24x4_avx2(d + 15*n_channels, _mm256_extracti128_si256(out[1], 1));
+		write_s24x4_avx2(d + 18*n_channels, _mm256_extracti128_si256(out[2], 1));
+		write_s24x4_avx2(d + 21*n_channels, _mm256_extracti128_si256(out[3], 1));
+		d += 24*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24s(d + 0, F32_TO_S24(s0[n]));
+		write_s24s(d + 3, F32_TO_S24(s1[n]));
+		write_s24s(d + 6, F32_TO_S24(s2[n]));
+		write_s24s(d + 9, F32_TO_S24(s3[n]));
+		d += 3*n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24s_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24s_4s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24s_1s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32s_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out;
+	__m256 int_max = _mm256_set1_ps(S24_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in = _mm256_min_ps(int_max, _mm256_max_ps(in, int_min));
+		out = _mm256_slli_epi32(_mm256_cvttps_epi32(in), 8);
+		out = _mm256_shuffle_epi8(out, mask);
+		d[0*n_channels] = _mm256_extract_epi32(out, 0);
+		d[1*n_channels] = _mm256_extract_epi32(out, 1);
+		d[2*n_channels] = _mm256_extract_epi32(out, 2);
+		d[3*n_channels] = _mm256_extract_epi32(out, 3);
+		d[4*n_channels] = _mm256_extract_epi32(out, 4);
+		d[5*n_channels] = _mm256_extract_epi32(out, 5);
+		d[6*n_channels] = _mm256_extract_epi32(out, 6);
+		d[7*n_channels] = _mm256_extract_epi32(out, 7);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S32S(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32s_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256i out[4];
+	__m256 int_max = _mm256_set1_ps(S24_MAX_F);
+	__m256 int_min = _mm256_sub_ps(_mm256_setzero_ps(), int_max);
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_mul_ps(_mm256_load_ps(&s0[n]), int_max);
+		in[1] = _mm256_mul_ps(_mm256_load_ps(&s1[n]), int_max);
+		in[2] = _mm256_mul_ps(_mm256_load_ps(&s2[n]), int_max);
+		in[3] = _mm256_mul_ps(_mm256_load_ps(&s3[n]), int_max);
+		in[0] = _mm256_min_ps(int_max, _mm256_max_ps(in[0], int_min));
+		in[1] = _mm256_min_ps(int_max, _mm256_max_ps(in[1], int_min));
+		in[2] = _mm256_min_ps(int_max, _mm256_max_ps(in[2], int_min));
+		in[3] = _mm256_min_ps(int_max, _mm256_max_ps(in[3], int_min));
+
+		/* frame n+i in the low lane, frame n+i+4 in the high lane */
+		transpose_4x4_avx2(in);
+
+		out[0] = _mm256_shuffle_epi8(_mm256_slli_epi32(_mm256_cvttps_epi32(in[0]), 8), mask);
+		out[1] = _mm256_shuffle_epi8(_mm256_slli_epi32(_mm256_cvttps_epi32(in[1]), 8), mask);
+		out[2] = _mm256_shuffle_epi8(_mm256_slli_epi32(_mm256_cvttps_epi32(in[2]), 8), mask);
+		out[3] = _mm256_shuffle_epi8(_mm256_slli_epi32(_mm256_cvttps_epi32(in[3]), 8), mask);
+
+		_mm_storeu_si128((__m128i*)(d + 0*n_channels), _mm256_castsi256_si128(out[0]));
+		_mm_storeu_si128((__m128i*)(d + 1*n_channels), _mm256_castsi256_si128(out[1]));
+		_mm_storeu_si128((__m128i*)(d + 2*n_channels), _mm256_castsi256_si128(out[2]));
+		_mm_storeu_si128((__m128i*)(d + 3*n_channels), _mm256_castsi256_si128(out[3]));
+		_mm_storeu_si128((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[0], 1));
+		_mm_storeu_si128((__m128i*)(d + 5*n_channels), _mm256_extracti128_si256(out[1], 1));
+		_mm_storeu_si128((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storeu_si128((__m128i*)(d + 7*n_channels), _mm256_extracti128_si256(out[3], 1));
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32S(s0[n]);
+		d[1] = F32_TO_S32S(s1[n]);
+		d[2] = F32_TO_S32S(s2[n]);
+		d[3] = F32_TO_S32S(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32s_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32s_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32s_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
@@ -763,3 +763,352 @@ conv_f32d_to_s16_2_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const v
 		d += 2;
 	}
 }
+
+static inline void
+dither_load_sse2(__m128i rnd[8], const uint32_t *random)
+{
+	int i;
+	for (i = 0; i < 8; i++)
+		rnd[i] = _mm_loadu_si128((__m128i*)&random[i * 4]);
+}
+
+static inline void
+dither_store_sse2(uint32_t *random, const __m128i rnd[8])
+{
+	int i;
+	for (i = 0; i < 8; i++)
+		_mm_storeu_si128((__m128i*)&random[i * 4], rnd[i]);
+}
+
+static inline __m128
+dither_tpdf_sse2(__m128i state[2])
+{
+	__m128i r1 = state[0], r2 = state[1];
+	const __m128 scale = _mm_set1_ps(DITHER_SCALE);
+
+	r1 = _mm_xor_si128(r1, _mm_slli_epi32(r1, 13));
+	r1 = _mm_xor_si128(r1, _mm_srli_epi32(r1, 17));
+	r1 = _mm_xor_si128(r1, _mm_slli_epi32(r1, 5));
+	r2 = _mm_xor_si128(r2, _mm_slli_epi32(r2, 13));
+	r2 = _mm_xor_si128(r2, _mm_srli_epi32(r2, 17));
+	r2 = _mm_xor_si128(r2, _mm_slli_epi32(r2, 5));
+	state[0] = r1;
+	state[1] = r2;
+
+	return _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(r1), _mm_cvtepi32_ps(r2)), scale);
+}
+
+static void
+conv_f32d_to_s16_dither_1s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[2];
+	__m128i out[2], rnd[8];
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+        __m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 16))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	dither_load_sse2(rnd, conv->random);
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s0[n+4]), int_max);
+		in[0] = _mm_add_ps(in[0], dither_tpdf_sse2(&rnd[0]));
+		in[1] = _mm_add_ps(in[1], dither_tpdf_sse2(&rnd[2]));
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+		out[0] = _mm_cvtps_epi32(in[0]);
+		out[1] = _mm_cvtps_epi32(in[1]);
+		out[0] = _mm_packs_epi32(out[0], out[1]);
+
+		d[0*n_channels] = _mm_extract_epi16(out[0], 0);
+		d[1*n_channels] = _mm_extract_epi16(out[0], 1);
+		d[2*n_channels] = _mm_extract_epi16(out[0], 2);
+		d[3*n_channels] = _mm_extract_epi16(out[0], 3);
+		d[4*n_channels] = _mm_extract_epi16(out[0], 4);
+		d[5*n_channels] = _mm_extract_epi16(out[0], 5);
+		d[6*n_channels] = _mm_extract_epi16(out[0], 6);
+		d[7*n_channels] = _mm_extract_epi16(out[0], 7);
+		d += 8*n_channels;
+	}
+	dither_store_sse2(conv->random, rnd);
+
+	for(; n < n_samples; n++) {
+		in[0] = _mm_mul_ss(_mm_load_ss(&s0[n]), int_max);
+		in[0] = _mm_add_ss(in[0], _mm_set_ss(dither_tpdf(&conv->random[0])));
+		in[0] = _mm_min_ss(int_max, _mm_max_ss(in[0], int_min));
+		*d = _mm_cvtss_si32(in[0]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_2s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[2];
+	__m128i out[4], t[2], rnd[8];
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+        __m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	dither_load_sse2(rnd, conv->random);
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[0] = _mm_add_ps(in[0], dither_tpdf_sse2(&rnd[0]));
+		in[1] = _mm_add_ps(in[1], dither_tpdf_sse2(&rnd[2]));
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+
+		t[0] = _mm_cvtps_epi32(in[0]);
+		t[1] = _mm_cvtps_epi32(in[1]);
+
+		t[0] = _mm_packs_epi32(t[0], t[0]);
+		t[1] = _mm_packs_epi32(t[1], t[1]);
+
+		out[0] = _mm_unpacklo_epi16(t[0], t[1]);
+		out[1] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(0, 3, 2, 1));
+		out[2] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(1, 0, 3, 2));
+		out[3] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(2, 1, 0, 3));
+
+		*((int32_t*)(d + 0*n_channels)) = _mm_cvtsi128_si32(out[0]);
+		*((int32_t*)(d + 1*n_channels)) = _mm_cvtsi128_si32(out[1]);
+		*((int32_t*)(d + 2*n_channels)) = _mm_cvtsi128_si32(out[2]);
+		*((int32_t*)(d + 3*n_channels)) = _mm_cvtsi128_si32(out[3]);
+		d += 4*n_channels;
+	}
+	dither_store_sse2(conv->random, rnd);
+
+	for(; n < n_samples; n++) {
+		in[0] = _mm_mul_ss(_mm_load_ss(&s0[n]), int_max);
+		in[1] = _mm_mul_ss(_mm_load_ss(&s1[n]), int_max);
+		in[0] = _mm_add_ss(in[0], _mm_set_ss(dither_tpdf(&conv->random[0])));
+		in[1] = _mm_add_ss(in[1], _mm_set_ss(dither_tpdf(&conv->random[0])));
+		in[0] = _mm_min_ss(int_max, _mm_max_ss(in[0], int_min));
+		in[1] = _mm_min_ss(int_max, _mm_max_ss(in[1], int_min));
+		d[0] = _mm_cvtss_si32(in[0]);
+		d[1] = _mm_cvtss_si32(in[1]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_4s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128i out[4], t[4], rnd[8];
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+        __m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	dither_load_sse2(rnd, conv->random);
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s2[n]), int_max);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s3[n]), int_max);
+
+		in[0] = _mm_add_ps(in[0], dither_tpdf_sse2(&rnd[0]));
+		in[1] = _mm_add_ps(in[1], dither_tpdf_sse2(&rnd[2]));
+		in[2] = _mm_add_ps(in[2], dither_tpdf_sse2(&rnd[4]));
+		in[3] = _mm_add_ps(in[3], dither_tpdf_sse2(&rnd[6]));
+
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+		in[2] = _mm_min_ps(int_max, _mm_max_ps(in[2], int_min));
+		in[3] = _mm_min_ps(int_max, _mm_max_ps(in[3], int_min));
+
+		t[0] = _mm_cvtps_epi32(in[0]);
+		t[1] = _mm_cvtps_epi32(in[1]);
+		t[2] = _mm_cvtps_epi32(in[2]);
+		t[3] = _mm_cvtps_epi32(in[3]);
+
+		t[0] = _mm_packs_epi32(t[0], t[2]);
+		t[1] = _mm_packs_epi32(t[1], t[3]);
+
+		out[0] = _mm_unpacklo_epi16(t[0], t[1]);
+		out[1] = _mm_unpackhi_epi16(t[0], t[1]);
+		out[2] = _mm_unpacklo_epi32(out[0], out[1]);
+		out[3] = _mm_unpackhi_epi32(out[0], out[1]);
+
+		_mm_storel_pi((__m64*)(d + 0*n_channels), (__m128)out[2]);
+		_mm_storeh_pi((__m64*)(d + 1*n_channels), (__m128)out[2]);
+		_mm_storel_pi((__m64*)(d + 2*n_channels), (__m128)out[3]);
+		_mm_storeh_pi((__m64*)(d + 3*n_channels), (__m128)out[3]);
+
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		in[0] = _mm_setr_ps(s0[n], s1[n], s2[n], s3[n]);
+		in[0] = _mm_mul_ps(in[0], int_max);
+		in[0] = _mm_add_ps(in[0], dither_tpdf_sse2(&rnd[0]));
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		t[0] = _mm_cvtps_epi32(in[0]);
+		t[0] = _mm_packs_epi32(t[0], t[0]);
+		_mm_storel_epi64((__m128i*)d, t[0]);
+		d += n_channels;
+	}
+	dither_store_sse2(conv->random, rnd);
+}
+
+void
+conv_f32d_to_s16_dither_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_dither_4s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_dither_2s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_dither_1s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+/* The error feedback runs from one frame to the next so the noise shaper
+ * works on a frame of up to 4 channels at a time. */
+static inline __m128i
+shape_frame_sse2(__m128 in, __m128 e[NS_ORDER], const __m128 c[NS_ORDER], __m128i *rnd)
+{
+	__m128 v;
+	__m128i q;
+
+	v = _mm_add_ps(_mm_mul_ps(c[0], e[0]), _mm_mul_ps(c[1], e[1]));
+	v = _mm_add_ps(v, _mm_mul_ps(c[2], e[2]));
+	v = _mm_sub_ps(in, v);
+	q = _mm_cvtps_epi32(_mm_add_ps(v, dither_tpdf_sse2(rnd)));
+	e[2] = e[1];
+	e[1] = e[0];
+	e[0] = _mm_sub_ps(_mm_cvtepi32_ps(q), v);
+	return _mm_packs_epi32(q, q);
+}
+
+static void
+conv_f32d_to_s16_shaped_4s_sse2(struct convert *conv, uint32_t ch, int16_t *d, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint32_t n, unrolled;
+	__m128 in[4], e[NS_ORDER], c[NS_ORDER];
+	__m128i rnd[8];
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < NS_ORDER; n++) {
+		c[n] = _mm_set1_ps(conv->ns_coef[n]);
+		e[n] = _mm_loadu_ps(&conv->ns_data[n][ch]);
+	}
+	dither_load_sse2(rnd, conv->random);
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s2[n]), int_max);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s3[n]), int_max);
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), shape_frame_sse2(in[0], e, c, &rnd[0]));
+		_mm_storel_epi64((__m128i*)(d + 1*n_channels), shape_frame_sse2(in[1], e, c, &rnd[2]));
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), shape_frame_sse2(in[2], e, c, &rnd[4]));
+		_mm_storel_epi64((__m128i*)(d + 3*n_channels), shape_frame_sse2(in[3], e, c, &rnd[6]));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		in[0] = _mm_mul_ps(_mm_setr_ps(s0[n], s1[n], s2[n], s3[n]), int_max);
+		_mm_storel_epi64((__m128i*)d, shape_frame_sse2(in[0], e, c, &rnd[0]));
+		d += n_channels;
+	}
+
+	for (n = 0; n < NS_ORDER; n++)
+		_mm_storeu_ps(&conv->ns_data[n][ch], e[n]);
+	dither_store_sse2(conv->random, rnd);
+}
+
+static void
+conv_f32d_to_s16_shaped_ns_sse2(struct convert *conv, uint32_t ch, int16_t *d, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_shaped, uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	uint32_t i, n;
+	float t[4] = { 0.0f, }, err[NS_ORDER][4] = { { 0.0f, }, };
+	int16_t o[8];
+	__m128 e[NS_ORDER], c[NS_ORDER];
+	__m128i rnd[8];
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+
+	for (n = 0; n < NS_ORDER; n++) {
+		for (i = 0; i < n_shaped; i++)
+			err[n][i] = conv->ns_data[n][ch + i];
+		c[n] = _mm_set1_ps(conv->ns_coef[n]);
+		e[n] = _mm_loadu_ps(err[n]);
+	}
+	dither_load_sse2(rnd, conv->random);
+
+	for(n = 0; n < n_samples; n++) {
+		for (i = 0; i < n_shaped; i++)
+			t[i] = s[i][n];
+		_mm_storeu_si128((__m128i*)o, shape_frame_sse2(_mm_mul_ps(_mm_loadu_ps(t), int_max), e, c, &rnd[0]));
+		for (i = 0; i < n_shaped; i++)
+			d[i] = o[i];
+		d += n_channels;
+	}
+
+	for (n = 0; n < NS_ORDER; n++) {
+		_mm_storeu_ps(err[n], e[n]);
+		for (i = 0; i < n_shaped; i++)
+			conv->ns_data[n][ch + i] = err[n][i];
+	}
+	dither_store_sse2(conv->random, rnd);
+}
+
+void
+conv_f32d_to_s16_shaped_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_shaped_4s_sse2(conv, i, &d[i], &src[i], n_channels, n_samples);
+	if (i < n_channels)
+		conv_f32d_to_s16_shaped_ns_sse2(conv, i, &d[i], &src[i], n_channels,
+				n_channels - i, n_samples);
+}
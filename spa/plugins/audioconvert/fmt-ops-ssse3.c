@@ -36,13 +36,18 @@ conv_s24_to_f32d_4s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SP
 	__m128i in[4];
 	__m128 out[4], factor = _mm_set1_ps(1.0f / S24_SCALE);
 	const __m128i mask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
-	//const __m128i mask = _mm_set_epi8(15, 14, 13, -1, 12, 11, 10, -1, 9, 8, 7, -1, 6, 5, 4, -1);
 
+	/* the loads read 4 bytes past the frame, leave the last frame
+	 * to the scalar loop */
 	if (SPA_IS_ALIGNED(d0, 16) &&
 	    SPA_IS_ALIGNED(d1, 16) &&
 	    SPA_IS_ALIGNED(d2, 16) &&
-	    SPA_IS_ALIGNED(d3, 16))
+	    SPA_IS_ALIGNED(d3, 16) &&
+	    n_samples > 0) {
 		unrolled = n_samples & ~3;
+		if ((n_samples & 3) == 0)
+			unrolled -= 4;
+	}
 	else
 		unrolled = 0;
 
@@ -109,3 +114,737 @@ conv_s24_to_f32d_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const vo
 	for(; i < n_channels; i++)
 		conv_s24_to_f32d_1s_sse2(conv, &dst[i], &s[3*i], n_channels, n_samples);
 }
+
+static void
+conv_s16s_to_f32d_1s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint16_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m128i in;
+	__m128 out, factor = _mm_set1_ps(1.0f / S16_SCALE);
+	const __m128i mask = _mm_setr_epi8(-1, -1, 1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_setr_epi32(s[0*n_channels],
+				    s[1*n_channels],
+				    s[2*n_channels],
+				    s[3*n_channels]);
+		in = _mm_shuffle_epi8(in, mask);
+		in = _mm_srai_epi32(in, 16);
+		out = _mm_cvtepi32_ps(in);
+		out = _mm_mul_ps(out, factor);
+		_mm_store_ps(&d0[n], out);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16S_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s16s_to_f32d_4s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint16_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m128i in[4];
+	__m128 out[4], factor = _mm_set1_ps(1.0f / S16_SCALE);
+	const __m128i mask = _mm_setr_epi8(-1, -1, 1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6);
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16) &&
+	    SPA_IS_ALIGNED(d2, 16) &&
+	    SPA_IS_ALIGNED(d3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_loadl_epi64((__m128i*)(s + 0*n_channels));
+		in[1] = _mm_loadl_epi64((__m128i*)(s + 1*n_channels));
+		in[2] = _mm_loadl_epi64((__m128i*)(s + 2*n_channels));
+		in[3] = _mm_loadl_epi64((__m128i*)(s + 3*n_channels));
+		in[0] = _mm_shuffle_epi8(in[0], mask);
+		in[1] = _mm_shuffle_epi8(in[1], mask);
+		in[2] = _mm_shuffle_epi8(in[2], mask);
+		in[3] = _mm_shuffle_epi8(in[3], mask);
+		in[0] = _mm_srai_epi32(in[0], 16);
+		in[1] = _mm_srai_epi32(in[1], 16);
+		in[2] = _mm_srai_epi32(in[2], 16);
+		in[3] = _mm_srai_epi32(in[3], 16);
+		out[0] = _mm_cvtepi32_ps(in[0]);
+		out[1] = _mm_cvtepi32_ps(in[1]);
+		out[2] = _mm_cvtepi32_ps(in[2]);
+		out[3] = _mm_cvtepi32_ps(in[3]);
+		out[0] = _mm_mul_ps(out[0], factor);
+		out[1] = _mm_mul_ps(out[1], factor);
+		out[2] = _mm_mul_ps(out[2], factor);
+		out[3] = _mm_mul_ps(out[3], factor);
+
+		_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+
+		_mm_store_ps(&d0[n], out[0]);
+		_mm_store_ps(&d1[n], out[1]);
+		_mm_store_ps(&d2[n], out[2]);
+		_mm_store_ps(&d3[n], out[3]);
+		s += 4 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16S_TO_F32(s[0]);
+		d1[n] = S16S_TO_F32(s[1]);
+		d2[n] = S16S_TO_F32(s[2]);
+		d3[n] = S16S_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16s_to_f32d_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s16s_to_f32d_4s_ssse3(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s16s_to_f32d_1s_ssse3(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_s24s_to_f32d_1s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m128i in;
+	__m128 out, factor = _mm_set1_ps(1.0f / S24_SCALE);
+	const __m128i mask = _mm_setr_epi8(-1, 2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 16) && n_samples > 0) {
+		unrolled = n_samples & ~3;
+		if ((n_samples & 3) == 0)
+			unrolled -= 4;
+	}
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_setr_epi32(
+			*((uint32_t*)&s[0 * n_channels]),
+			*((uint32_t*)&s[3 * n_channels]),
+			*((uint32_t*)&s[6 * n_channels]),
+			*((uint32_t*)&s[9 * n_channels]));
+		in = _mm_shuffle_epi8(in, mask);
+		in = _mm_srai_epi32(in, 8);
+		out = _mm_cvtepi32_ps(in);
+		out = _mm_mul_ps(out, factor);
+		_mm_store_ps(&d0[n], out);
+		s += 12 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24s(s));
+		s += 3 * n_channels;
+	}
+}
+
+static void
+conv_s24s_to_f32d_4s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m128i in[4];
+	__m128 out[4], factor = _mm_set1_ps(1.0f / S24_SCALE);
+	const __m128i mask = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16) &&
+	    SPA_IS_ALIGNED(d2, 16) &&
+	    SPA_IS_ALIGNED(d3, 16) &&
+	    n_samples > 0) {
+		unrolled = n_samples & ~3;
+		if ((n_samples & 3) == 0)
+			unrolled -= 4;
+	}
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_loadu_si128((__m128i*)(s + 0*n_channels));
+		in[1] = _mm_loadu_si128((__m128i*)(s + 3*n_channels));
+		in[2] = _mm_loadu_si128((__m128i*)(s + 6*n_channels));
+		in[3] = _mm_loadu_si128((__m128i*)(s + 9*n_channels));
+		in[0] = _mm_shuffle_epi8(in[0], mask);
+		in[1] = _mm_shuffle_epi8(in[1], mask);
+		in[2] = _mm_shuffle_epi8(in[2], mask);
+		in[3] = _mm_shuffle_epi8(in[3], mask);
+		in[0] = _mm_srai_epi32(in[0], 8);
+		in[1] = _mm_srai_epi32(in[1], 8);
+		in[2] = _mm_srai_epi32(in[2], 8);
+		in[3] = _mm_srai_epi32(in[3], 8);
+		out[0] = _mm_cvtepi32_ps(in[0]);
+		out[1] = _mm_cvtepi32_ps(in[1]);
+		out[2] = _mm_cvtepi32_ps(in[2]);
+		out[3] = _mm_cvtepi32_ps(in[3]);
+		out[0] = _mm_mul_ps(out[0], factor);
+		out[1] = _mm_mul_ps(out[1], factor);
+		out[2] = _mm_mul_ps(out[2], factor);
+		out[3] = _mm_mul_ps(out[3], factor);
+
+		_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+
+		_mm_store_ps(&d0[n], out[0]);
+		_mm_store_ps(&d1[n], out[1]);
+		_mm_store_ps(&d2[n], out[2]);
+		_mm_store_ps(&d3[n], out[3]);
+		s += 12 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24s(s));
+		d1[n] = S24_TO_F32(read_s24s(s+3));
+		d2[n] = S24_TO_F32(read_s24s(s+6));
+		d3[n] = S24_TO_F32(read_s24s(s+9));
+		s += 3 * n_channels;
+	}
+}
+
+void
+conv_s24s_to_f32d_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint8_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24s_to_f32d_4s_ssse3(conv, &dst[i], &s[3*i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24s_to_f32d_1s_ssse3(conv, &dst[i], &s[3*i], n_channels, n_samples);
+}
+
+static void
+conv_s32s_to_f32d_1s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m128i in;
+	__m128 out, factor = _mm_set1_ps(1.0f / S24_SCALE);
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_setr_epi32(s[0*n_channels],
+				    s[1*n_channels],
+				    s[2*n_channels],
+				    s[3*n_channels]);
+		in = _mm_shuffle_epi8(in, mask);
+		in = _mm_srai_epi32(in, 8);
+		out = _mm_cvtepi32_ps(in);
+		out = _mm_mul_ps(out, factor);
+		_mm_store_ps(&d0[n], out);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32S_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32s_to_f32d_4s_ssse3(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m128i in[4];
+	__m128 out[4], factor = _mm_set1_ps(1.0f / S24_SCALE);
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16) &&
+	    SPA_IS_ALIGNED(d2, 16) &&
+	    SPA_IS_ALIGNED(d3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_loadu_si128((__m128i*)(s + 0*n_channels));
+		in[1] = _mm_loadu_si128((__m128i*)(s + 1*n_channels));
+		in[2] = _mm_loadu_si128((__m128i*)(s + 2*n_channels));
+		in[3] = _mm_loadu_si128((__m128i*)(s + 3*n_channels));
+		in[0] = _mm_shuffle_epi8(in[0], mask);
+		in[1] = _mm_shuffle_epi8(in[1], mask);
+		in[2] = _mm_shuffle_epi8(in[2], mask);
+		in[3] = _mm_shuffle_epi8(in[3], mask);
+		in[0] = _mm_srai_epi32(in[0], 8);
+		in[1] = _mm_srai_epi32(in[1], 8);
+		in[2] = _mm_srai_epi32(in[2], 8);
+		in[3] = _mm_srai_epi32(in[3], 8);
+		out[0] = _mm_cvtepi32_ps(in[0]);
+		out[1] = _mm_cvtepi32_ps(in[1]);
+		out[2] = _mm_cvtepi32_ps(in[2]);
+		out[3] = _mm_cvtepi32_ps(in[3]);
+		out[0] = _mm_mul_ps(out[0], factor);
+		out[1] = _mm_mul_ps(out[1], factor);
+		out[2] = _mm_mul_ps(out[2], factor);
+		out[3] = _mm_mul_ps(out[3], factor);
+
+		_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+
+		_mm_store_ps(&d0[n], out[0]);
+		_mm_store_ps(&d1[n], out[1]);
+		_mm_store_ps(&d2[n], out[2]);
+		_mm_store_ps(&d3[n], out[3]);
+		s += 4 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32S_TO_F32(s[0]);
+		d1[n] = S32S_TO_F32(s[1]);
+		d2[n] = S32S_TO_F32(s[2]);
+		d3[n] = S32S_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s32s_to_f32d_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const uint32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32s_to_f32d_4s_ssse3(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32s_to_f32d_1s_ssse3(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s16s_1s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint16_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in;
+	__m128i out;
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+	const __m128i mask = _mm_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in = _mm_min_ps(int_max, _mm_max_ps(in, int_min));
+		out = _mm_cvttps_epi32(in);
+		out = _mm_shuffle_epi8(out, mask);
+		d[0*n_channels] = _mm_extract_epi16(out, 0);
+		d[1*n_channels] = _mm_extract_epi16(out, 1);
+		d[2*n_channels] = _mm_extract_epi16(out, 2);
+		d[3*n_channels] = _mm_extract_epi16(out, 3);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S16S(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16s_4s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint16_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128i out[4];
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+	const __m128i mask = _mm_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s2[n]), int_max);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s3[n]), int_max);
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+		in[2] = _mm_min_ps(int_max, _mm_max_ps(in[2], int_min));
+		in[3] = _mm_min_ps(int_max, _mm_max_ps(in[3], int_min));
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		out[0] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[0]), mask);
+		out[1] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[1]), mask);
+		out[2] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[2]), mask);
+		out[3] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[3]), mask);
+
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), out[0]);
+		_mm_storel_epi64((__m128i*)(d + 1*n_channels), out[1]);
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), out[2]);
+		_mm_storel_epi64((__m128i*)(d + 3*n_channels), out[3]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16S(s0[n]);
+		d[1] = F32_TO_S16S(s1[n]);
+		d[2] = F32_TO_S16S(s2[n]);
+		d[3] = F32_TO_S16S(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16s_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16s_4s_ssse3(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16s_1s_ssse3(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static inline void
+write_s24x4_ssse3(uint8_t *d, __m128i v)
+{
+	_mm_storel_epi64((__m128i*)d, v);
+	*((uint32_t*)(d + 8)) = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+static void
+conv_f32d_to_s24_1s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in;
+	__m128i out;
+	__m128 int_max = _mm_set1_ps(S24_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in = _mm_min_ps(int_max, _mm_max_ps(in, int_min));
+		out = _mm_cvttps_epi32(in);
+		write_s24(d + 0*n_channels, _mm_cvtsi128_si32(out));
+		write_s24(d + 3*n_channels, _mm_cvtsi128_si32(_mm_srli_si128(out, 4)));
+		write_s24(d + 6*n_channels, _mm_cvtsi128_si32(_mm_srli_si128(out, 8)));
+		write_s24(d + 9*n_channels, _mm_cvtsi128_si32(_mm_srli_si128(out, 12)));
+		d += 12*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24(d, F32_TO_S24(s0[n]));
+		d += 3*n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_4s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128i out[4];
+	__m128 int_max = _mm_set1_ps(S24_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s2[n]), int_max);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s3[n]), int_max);
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+		in[2] = _mm_min_ps(int_max, _mm_max_ps(in[2], int_min));
+		in[3] = _mm_min_ps(int_max, _mm_max_ps(in[3], int_min));
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		out[0] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[0]), mask);
+		out[1] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[1]), mask);
+		out[2] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[2]), mask);
+		out[3] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[3]), mask);
+
+		write_s24x4_ssse3(d + 0*n_channels, out[0]);
+		write_s24x4_ssse3(d + 3*n_channels, out[1]);
+		write_s24x4_ssse3(d + 6*n_channels, out[2]);
+		write_s24x4_ssse3(d + 9*n_channels, out[3]);
+		d += 12*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24(d + 0, F32_TO_S24(s0[n]));
+		write_s24(d + 3, F32_TO_S24(s1[n]));
+		write_s24(d + 6, F32_TO_S24(s2[n]));
+		write_s24(d + 9, F32_TO_S24(s3[n]));
+		d += 3*n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_4s_ssse3(conv, &d[3*i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_1s_ssse3(conv, &d[3*i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24s_1s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in;
+	__m128i out;
+	__m128 int_max = _mm_set1_ps(S24_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+	if (SPA_IS_ALIGNED(s0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in = _mm_min_ps(int_max, _mm_max_ps(in, int_min));
+		out = _mm_cvttps_epi32(in);
+		write_s24s(d + 0*n_channels, _mm_cvtsi128_si32(out));
+		write_s24s(d + 3*n_channels, _mm_cvtsi128_si32(_mm_srli_si128(out, 4)));
+		write_s24s(d + 6*n_channels, _mm_cvtsi128_si32(_mm_srli_si128(out, 8)));
+		write_s24s(d + 9*n_channels, _mm_cvtsi128_si32(_mm_srli_si128(out, 12)));
+		d += 12*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24s(d, F32_TO_S24(s0[n]));
+		d += 3*n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24s_4s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128i out[4];
+	__m128 int_max = _mm_set1_ps(S24_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s2[n]), int_max);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s3[n]), int_max);
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+		in[2] = _mm_min_ps(int_max, _mm_max_ps(in[2], int_min));
+		in[3] = _mm_min_ps(int_max, _mm_max_ps(in[3], int_min));
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		out[0] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[0]), mask);
+		out[1] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[1]), mask);
+		out[2] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[2]), mask);
+		out[3] = _mm_shuffle_epi8(_mm_cvttps_epi32(in[3]), mask);
+
+		write_s24x4_ssse3(d + 0*n_channels, out[0]);
+		write_s24x4_ssse3(d + 3*n_channels, out[1]);
+		write_s24x4_ssse3(d + 6*n_channels, out[2]);
+		write_s24x4_ssse3(d + 9*n_channels, out[3]);
+		d += 12*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		write_s24s(d + 0, F32_TO_S24(s0[n]));
+		write_s24s(d + 3, F32_TO_S24(s1[n]));
+		write_s24s(d + 6, F32_TO_S24(s2[n]));
+		write_s24s(d + 9, F32_TO_S24(s3[n]));
+		d += 3*n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24s_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24s_4s_ssse3(conv, &d[3*i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24s_1s_ssse3(conv, &d[3*i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32s_1s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint32_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in;
+	__m128i out;
+	__m128 int_max = _mm_set1_ps(S24_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(s0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in = _mm_min_ps(int_max, _mm_max_ps(in, int_min));
+		out = _mm_slli_epi32(_mm_cvttps_epi32(in), 8);
+		out = _mm_shuffle_epi8(out, mask);
+		d[0*n_channels] = _mm_cvtsi128_si32(out);
+		d[1*n_channels] = _mm_cvtsi128_si32(_mm_srli_si128(out, 4));
+		d[2*n_channels] = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+		d[3*n_channels] = _mm_cvtsi128_si32(_mm_srli_si128(out, 12));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S32S(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32s_4s_ssse3(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint32_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128i out[4];
+	__m128 int_max = _mm_set1_ps(S24_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s0[n]), int_max);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s1[n]), int_max);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s2[n]), int_max);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s3[n]), int_max);
+		in[0] = _mm_min_ps(int_max, _mm_max_ps(in[0], int_min));
+		in[1] = _mm_min_ps(int_max, _mm_max_ps(in[1], int_min));
+		in[2] = _mm_min_ps(int_max, _mm_max_ps(in[2], int_min));
+		in[3] = _mm_min_ps(int_max, _mm_max_ps(in[3], int_min));
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		out[0] = _mm_slli_epi32(_mm_cvttps_epi32(in[0]), 8);
+		out[1] = _mm_slli_epi32(_mm_cvttps_epi32(in[1]), 8);
+		out[2] = _mm_slli_epi32(_mm_cvttps_epi32(in[2]), 8);
+		out[3] = _mm_slli_epi32(_mm_cvttps_epi32(in[3]), 8);
+		out[0] = _mm_shuffle_epi8(out[0], mask);
+		out[1] = _mm_shuffle_epi8(out[1], mask);
+		out[2] = _mm_shuffle_epi8(out[2], mask);
+		out[3] = _mm_shuffle_epi8(out[3], mask);
+
+		_mm_storeu_si128((__m128i*)(d + 0*n_channels), out[0]);
+		_mm_storeu_si128((__m128i*)(d + 1*n_channels), out[1]);
+		_mm_storeu_si128((__m128i*)(d + 2*n_channels), out[2]);
+		_mm_storeu_si128((__m128i*)(d + 3*n_channels), out[3]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32S(s0[n]);
+		d[1] = F32_TO_S32S(s1[n]);
+		d[2] = F32_TO_S32S(s2[n]);
+		d[3] = F32_TO_S32S(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32s_ssse3(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32s_4s_ssse3(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32s_1s_ssse3(conv, &d[i], &src[i], n_channels, n_samples);
+}
@@ -69,6 +69,14 @@ static struct conv_info conv_table[] =
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s16_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_S16P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s16d_to_f32_c },
 
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S16_OE, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s16s_to_f32d_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_S16_OE, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSSE3, conv_s16s_to_f32d_ssse3 },
+#endif
+	{ SPA_AUDIO_FORMAT_S16_OE, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s16s_to_f32d_c },
+
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_copy32d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_deinterleave_32_c },
@@ -85,23 +93,37 @@ static struct conv_info conv_table[] =
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s32_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s32d_to_f32_c },
 
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S32_OE, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s32s_to_f32d_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_S32_OE, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSSE3, conv_s32s_to_f32d_ssse3 },
+#endif
+	{ SPA_AUDIO_FORMAT_S32_OE, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s32s_to_f32d_c },
+
 	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s24_to_f32_c },
 	{ SPA_AUDIO_FORMAT_S24P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s24d_to_f32d_c },
 #if defined (HAVE_AVX2)
 	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s24_to_f32d_avx2 },
 #endif
-#if defined (HAVE_SSSE3)
-//	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSSE3, conv_s24_to_f32d_ssse3 },
-#endif
 #if defined (HAVE_SSE41)
 	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE41, conv_s24_to_f32d_sse41 },
 #endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSSE3, conv_s24_to_f32d_ssse3 },
+#endif
 #if defined (HAVE_SSE2)
 	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE2, conv_s24_to_f32d_sse2 },
 #endif
 	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s24_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_S24P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s24d_to_f32_c },
 
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S24_OE, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s24s_to_f32d_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_S24_OE, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSSE3, conv_s24s_to_f32d_ssse3 },
+#endif
 	{ SPA_AUDIO_FORMAT_S24_OE, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s24s_to_f32d_c },
 
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s24_32_to_f32_c },
@@ -132,6 +154,14 @@ static struct conv_info conv_table[] =
 #endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, 0, conv_f32d_to_s16_c },
 
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16_OE, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16s_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16_OE, 0, SPA_CPU_FLAG_SSSE3, conv_f32d_to_s16s_ssse3 },
+#endif
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16_OE, 0, 0, conv_f32d_to_s16s_c },
+
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S32, 0, 0, conv_f32_to_s32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_f32d_to_s32d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_f32_to_s32d_c },
@@ -143,11 +173,33 @@ static struct conv_info conv_table[] =
 #endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, 0, conv_f32d_to_s32_c },
 
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32_OE, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s32s_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32_OE, 0, SPA_CPU_FLAG_SSSE3, conv_f32d_to_s32s_ssse3 },
+#endif
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32_OE, 0, 0, conv_f32d_to_s32s_c },
+
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24, 0, 0, conv_f32_to_s24_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24P, 0, 0, conv_f32d_to_s24d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24P, 0, 0, conv_f32_to_s24d_c },
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s24_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, SPA_CPU_FLAG_SSSE3, conv_f32d_to_s24_ssse3 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, 0, conv_f32d_to_s24_c },
 
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_OE, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s24s_avx2 },
+#endif
+#if defined (HAVE_SSSE3)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_OE, 0, SPA_CPU_FLAG_SSSE3, conv_f32d_to_s24s_ssse3 },
+#endif
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_OE, 0, 0, conv_f32d_to_s24s_c },
+
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_f32_to_s24_32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_f32d_to_s24_32d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_f32_to_s24_32d_c },
@@ -184,6 +236,33 @@ static struct conv_info conv_table[] =
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_interleave_32_c },
 };
 
+struct dither_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t method;
+	uint32_t cpu_flags;
+
+	convert_func_t process;
+};
+
+static struct dither_info dither_table[] =
+{
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, DITHER_METHOD_TRIANGULAR, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_dither_avx2 },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, DITHER_METHOD_SHAPED, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_shaped_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, DITHER_METHOD_TRIANGULAR, SPA_CPU_FLAG_SSE2, conv_f32d_to_s16_dither_sse2 },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, DITHER_METHOD_SHAPED, SPA_CPU_FLAG_SSE2, conv_f32d_to_s16_shaped_sse2 },
+#endif
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, DITHER_METHOD_TRIANGULAR, 0, conv_f32d_to_s16_dither_c },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, DITHER_METHOD_SHAPED, 0, conv_f32d_to_s16_shaped_c },
+};
+
+/* 3 tap error feedback filter (Wannamaker), moves the quantization noise
+ * to the high frequencies where the ear is least sensitive */
+static const float ns_wannamaker3[NS_ORDER] = { 1.662f, -1.263f, 0.4827f };
+
 #define MATCH_CHAN(a,b)		((a) == 0 || (a) == (b))
 #define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
 
@@ -202,6 +281,21 @@ static const struct conv_info *find_conv_info(uint32_t src_fmt, uint32_t dst_fmt
 	return NULL;
 }
 
+static const struct dither_info *find_dither_info(uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t method, uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(dither_table); i++) {
+		if (dither_table[i].src_fmt == src_fmt &&
+		    dither_table[i].dst_fmt == dst_fmt &&
+		    dither_table[i].method == method &&
+		    MATCH_CPU_FLAGS(dither_table[i].cpu_flags, cpu_flags))
+			return &dither_table[i];
+	}
+	return NULL;
+}
+
 static void impl_convert_free(struct convert *conv)
 {
 	conv->process = NULL;
@@ -210,15 +304,38 @@ static void impl_convert_free(struct convert *conv)
 int convert_init(struct convert *conv)
 {
 	const struct conv_info *info;
+	const struct dither_info *dinfo = NULL;
+	uint32_t i;
+
+	conv->free = impl_convert_free;
+	conv->is_passthrough = conv->src_fmt == conv->dst_fmt;
+
+	if (conv->dither_method == DITHER_METHOD_SHAPED && conv->n_channels > MAX_NS)
+		conv->dither_method = DITHER_METHOD_TRIANGULAR;
+
+	if (conv->dither_method != DITHER_METHOD_NONE)
+		dinfo = find_dither_info(conv->src_fmt, conv->dst_fmt,
+				conv->dither_method, conv->cpu_flags);
+	if (dinfo != NULL) {
+		for (i = 0; i < MAX_RANDOM; i++)
+			conv->random[i] = 0x9e3779b9u * (i + 1);
+		for (i = 0; i < NS_ORDER; i++)
+			conv->ns_coef[i] = ns_wannamaker3[i];
+		memset(conv->ns_data, 0, sizeof(conv->ns_data));
+		conv->cpu_flags = dinfo->cpu_flags;
+		conv->process = dinfo->process;
+		return 0;
+	}
+
+	/* no dither for this conversion */
+	conv->dither_method = DITHER_METHOD_NONE;
 
 	info = find_conv_info(conv->src_fmt, conv->dst_fmt, conv->n_channels, conv->cpu_flags);
 	if (info == NULL)
 		return -ENOTSUP;
 
-	conv->is_passthrough = conv->src_fmt == conv->dst_fmt;
 	conv->cpu_flags = info->cpu_flags;
 	conv->process = info->process;
-	conv->free = impl_convert_free;
 
 	return 0;
 }
@@ -23,6 +23,7 @@
  */
 
 #include <math.h>
+#include <byteswap.h>
 
 #include <spa/utils/defs.h>
 
@@ -53,6 +54,11 @@
 #define S32_TO_F32(v)	S24_TO_F32((v) >> 8)
 #define F32_TO_S32(v)	(F32_TO_S24(v) << 8)
 
+#define S16S_TO_F32(v)	S16_TO_F32(bswap_16(v))
+#define F32_TO_S16S(v)	bswap_16(F32_TO_S16(v))
+#define S32S_TO_F32(v)	S32_TO_F32((int32_t)bswap_32(v))
+#define F32_TO_S32S(v)	bswap_32(F32_TO_S32(v))
+
 static inline int32_t read_s24(const void *src)
 {
 	const int8_t *s = src;
@@ -101,18 +107,46 @@ static inline void write_s24s(void *dst, int32_t val)
 #endif
 }
 
-#define MAX_NS	64
+#define DITHER_SCALE	(1.0f / 4294967296.0f)
+
+static inline uint32_t xorshift32(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* triangular noise in the range (-1.0, 1.0) LSB */
+static inline float dither_tpdf(uint32_t *state)
+{
+	float r1 = (int32_t)xorshift32(state);
+	float r2 = (int32_t)xorshift32(state);
+	return (r1 + r2) * DITHER_SCALE;
+}
+
+enum dither_method {
+	DITHER_METHOD_NONE,
+	DITHER_METHOD_TRIANGULAR,	/**< triangular (TPDF) dither */
+	DITHER_METHOD_SHAPED,		/**< TPDF dither with error feedback noise shaping */
+};
+
+#define MAX_NS		64
+#define NS_ORDER	3
+#define MAX_RANDOM	64
 
 struct convert {
 	uint32_t src_fmt;
 	uint32_t dst_fmt;
 	uint32_t n_channels;
 	uint32_t cpu_flags;
+	uint32_t dither_method;
 
 	unsigned int is_passthrough:1;
-	float ns_data[MAX_NS];
-	uint32_t ns_idx;
-	uint32_t ns_size;
+	uint32_t random[MAX_RANDOM];
+	float ns_coef[NS_ORDER];
+	float ns_data[NS_ORDER][MAX_NS];
 
 	void (*process) (struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
 			uint32_t n_samples);
@@ -143,10 +177,12 @@ DEFINE_FUNCTION(u8d_to_f32, c);
 DEFINE_FUNCTION(s16d_to_f32d, c);
 DEFINE_FUNCTION(s16_to_f32, c);
 DEFINE_FUNCTION(s16_to_f32d, c);
+DEFINE_FUNCTION(s16s_to_f32d, c);
 DEFINE_FUNCTION(s16d_to_f32, c);
 DEFINE_FUNCTION(s32d_to_f32d, c);
 DEFINE_FUNCTION(s32_to_f32, c);
 DEFINE_FUNCTION(s32_to_f32d, c);
+DEFINE_FUNCTION(s32s_to_f32d, c);
 DEFINE_FUNCTION(s32d_to_f32, c);
 DEFINE_FUNCTION(s24d_to_f32d, c);
 DEFINE_FUNCTION(s24_to_f32, c);
@@ -165,14 +201,19 @@ DEFINE_FUNCTION(f32d_to_s16d, c);
 DEFINE_FUNCTION(f32_to_s16, c);
 DEFINE_FUNCTION(f32_to_s16d, c);
 DEFINE_FUNCTION(f32d_to_s16, c);
+DEFINE_FUNCTION(f32d_to_s16s, c);
+DEFINE_FUNCTION(f32d_to_s16_dither, c);
+DEFINE_FUNCTION(f32d_to_s16_shaped, c);
 DEFINE_FUNCTION(f32d_to_s32d, c);
 DEFINE_FUNCTION(f32_to_s32, c);
 DEFINE_FUNCTION(f32_to_s32d, c);
 DEFINE_FUNCTION(f32d_to_s32, c);
+DEFINE_FUNCTION(f32d_to_s32s, c);
 DEFINE_FUNCTION(f32d_to_s24d, c);
 DEFINE_FUNCTION(f32_to_s24, c);
 DEFINE_FUNCTION(f32_to_s24d, c);
 DEFINE_FUNCTION(f32d_to_s24, c);
+DEFINE_FUNCTION(f32d_to_s24s, c);
 DEFINE_FUNCTION(f32d_to_s24_32d, c);
 DEFINE_FUNCTION(f32_to_s24_32, c);
 DEFINE_FUNCTION(f32_to_s24_32d, c);
@@ -198,9 +239,18 @@ DEFINE_FUNCTION(s32_to_f32d, sse2);
 DEFINE_FUNCTION(f32d_to_s32, sse2);
 DEFINE_FUNCTION(f32d_to_s16_2, sse2);
 DEFINE_FUNCTION(f32d_to_s16, sse2);
+DEFINE_FUNCTION(f32d_to_s16_dither, sse2);
+DEFINE_FUNCTION(f32d_to_s16_shaped, sse2);
 #endif
 #if defined(HAVE_SSSE3)
+DEFINE_FUNCTION(s16s_to_f32d, ssse3);
 DEFINE_FUNCTION(s24_to_f32d, ssse3);
+DEFINE_FUNCTION(s24s_to_f32d, ssse3);
+DEFINE_FUNCTION(s32s_to_f32d, ssse3);
+DEFINE_FUNCTION(f32d_to_s16s, ssse3);
+DEFINE_FUNCTION(f32d_to_s24, ssse3);
+DEFINE_FUNCTION(f32d_to_s24s, ssse3);
+DEFINE_FUNCTION(f32d_to_s32s, ssse3);
 #endif
 #if defined(HAVE_SSE41)
 DEFINE_FUNCTION(s24_to_f32d, sse41);
@@ -208,10 +258,21 @@ DEFINE_FUNCTION(s24_to_f32d, sse41);
 #if defined(HAVE_AVX2)
 DEFINE_FUNCTION(s16_to_f32d_2, avx2);
 DEFINE_FUNCTION(s16_to_f32d, avx2);
+DEFINE_FUNCTION(s16s_to_f32d, avx2);
 DEFINE_FUNCTION(s24_to_f32d, avx2);
+DEFINE_FUNCTION(s24s_to_f32d, avx2);
 DEFINE_FUNCTION(s32_to_f32d, avx2);
+DEFINE_FUNCTION(s32s_to_f32d, avx2);
 DEFINE_FUNCTION(f32d_to_s32, avx2);
+DEFINE_FUNCTION(f32d_to_s32s, avx2);
+DEFINE_FUNCTION(f32d_to_s24, avx2);
+DEFINE_FUNCTION(f32d_to_s24s, avx2);
 DEFINE_FUNCTION(f32d_to_s16_4, avx2);
 DEFINE_FUNCTION(f32d_to_s16_2, avx2);
 DEFINE_FUNCTION(f32d_to_s16, avx2);
+DEFINE_FUNCTION(f32d_to_s16_dither, avx2);
+DEFINE_FUNCTION(f32d_to_s16_shaped, avx2);
+DEFINE_FUNCTION(f32d_to_s16s, avx2);
 #endif
+
+#undef DEFINE_FUNCTION
@@ -55,7 +55,7 @@
 #define MAX_PORTS	128
 
 #define PROP_DEFAULT_TRUNCATE	false
-#define PROP_DEFAULT_DITHER	0
+#define PROP_DEFAULT_DITHER	DITHER_METHOD_NONE
 
 struct impl;
 
@@ -64,6 +64,15 @@ struct props {
 	uint32_t dither;
 };
 
+static uint32_t dither_method_from_label(const char *label)
+{
+	if (strcmp(label, "triangular") == 0)
+		return DITHER_METHOD_TRIANGULAR;
+	else if (strcmp(label, "shaped") == 0)
+		return DITHER_METHOD_SHAPED;
+	return DITHER_METHOD_NONE;
+}
+
 static void props_reset(struct props *props)
 {
 	props->truncate = PROP_DEFAULT_TRUNCATE;
@@ -190,12 +199,13 @@ static int setup_convert(struct impl *this)
 	this->conv.dst_fmt = dst_fmt;
 	this->conv.n_channels = outformat.info.raw.channels;
 	this->conv.cpu_flags = this->cpu_flags;
+	this->conv.dither_method = this->props.dither;
 
 	if ((res = convert_init(&this->conv)) < 0)
 		return res;
 
-	spa_log_debug(this->log, NAME " %p: got converter features %08x:%08x", this,
-			this->cpu_flags, this->conv.cpu_flags);
+	spa_log_debug(this->log, NAME " %p: got converter features %08x:%08x dither %d", this,
+			this->cpu_flags, this->conv.cpu_flags, this->conv.dither_method);
 
 	this->is_passthrough = this->conv.is_passthrough;
 
@@ -206,13 +216,134 @@ static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
 {
-	return -ENOTSUP;
+	struct impl *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_PropInfo:
+	{
+		struct props *p = &this->props;
+		struct spa_pod_frame f[2];
+
+		switch (result.index) {
+		case 0:
+			spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_PropInfo, id);
+			spa_pod_builder_add(&b,
+				SPA_PROP_INFO_id,   SPA_POD_Id(SPA_PROP_ditherType),
+				SPA_PROP_INFO_name, SPA_POD_String("Dither method"),
+				SPA_PROP_INFO_type, SPA_POD_CHOICE_ENUM_Id(4, p->dither,
+							DITHER_METHOD_NONE,
+							DITHER_METHOD_TRIANGULAR,
+							DITHER_METHOD_SHAPED),
+				0);
+			spa_pod_builder_prop(&b, SPA_PROP_INFO_labels, 0);
+			spa_pod_builder_push_struct(&b, &f[1]);
+			spa_pod_builder_id(&b, DITHER_METHOD_NONE);
+			spa_pod_builder_string(&b, "none");
+			spa_pod_builder_id(&b, DITHER_METHOD_TRIANGULAR);
+			spa_pod_builder_string(&b, "triangular");
+			spa_pod_builder_id(&b, DITHER_METHOD_SHAPED);
+			spa_pod_builder_string(&b, "shaped");
+			spa_pod_builder_pop(&b, &f[1]);
+			param = spa_pod_builder_pop(&b, &f[0]);
+			break;
+		default:
+			return 0;
+		}
+		break;
+	}
+	case SPA_PARAM_Props:
+	{
+		struct props *p = &this->props;
+
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Props, id,
+				SPA_PROP_ditherType,	SPA_POD_Id(p->dither));
+			break;
+		default:
+			return 0;
+		}
+		break;
+	}
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static void emit_params_changed(struct impl *this);
+
+static int apply_props(struct impl *this, const struct spa_pod *param)
+{
+	struct spa_pod_prop *prop;
+	struct spa_pod_object *obj = (struct spa_pod_object *) param;
+	struct props *p = &this->props;
+	uint32_t dither;
+	int changed = 0;
+
+	SPA_POD_OBJECT_FOREACH(obj, prop) {
+		switch (prop->key) {
+		case SPA_PROP_ditherType:
+			if (spa_pod_get_id(&prop->value, &dither) == 0 &&
+			    dither <= DITHER_METHOD_SHAPED && dither != p->dither) {
+				p->dither = dither;
+				changed++;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	/* switch the kernel of a running conversion */
+	if (changed && this->conv.process) {
+		this->conv.cpu_flags = this->cpu_flags;
+		this->conv.dither_method = p->dither;
+		convert_init(&this->conv);
+	}
+	return changed;
 }
 
 static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 			       const struct spa_pod *param)
 {
-	return -ENOTSUP;
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	switch (id) {
+	case SPA_PARAM_Props:
+		if (apply_props(this, param) > 0)
+			emit_params_changed(this);
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
 }
 
 static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
@@ -263,6 +394,13 @@ static void emit_info(struct impl *this, bool full)
 	}
 }
 
+static void emit_params_changed(struct impl *this)
+{
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_PARAMS;
+	this->params[1].flags ^= SPA_PARAM_INFO_SERIAL;
+	emit_info(this, false);
+}
+
 static void emit_port_info(struct impl *this, struct port *port, bool full)
 {
 	if (full)
@@ -999,13 +1137,23 @@ impl_init(const struct spa_handle_factory *factory,
 			&impl_node, this);
 	spa_hook_list_init(&this->hooks);
 
-	this->info_all = SPA_PORT_CHANGE_MASK_FLAGS;
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS |
+			SPA_NODE_CHANGE_MASK_PARAMS;
 	this->info = SPA_NODE_INFO_INIT();
 	this->info.flags = SPA_NODE_FLAG_RT;
+	this->params[0] = SPA_PARAM_INFO(SPA_PARAM_PropInfo, SPA_PARAM_INFO_READ);
+	this->params[1] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
 	this->info.params = this->params;
-	this->info.n_params = 0;
+	this->info.n_params = 2;
 	props_reset(&this->props);
 
+	if (info != NULL) {
+		const char *str;
+
+		if ((str = spa_dict_lookup(info, "dither.method")) != NULL)
+			this->props.dither = dither_method_from_label(str);
+	}
+
 	init_port(this, SPA_DIRECTION_OUTPUT, 0);
 	init_port(this, SPA_DIRECTION_INPUT, 0);
 
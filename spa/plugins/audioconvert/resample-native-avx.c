@@ -27,68 +27,148 @@
 #include <assert.h>
 #include <immintrin.h>
 
-static void inner_product_avx(float *d, const float * SPA_RESTRICT s,
+static inline void inner_product_batch_avx(float *d[], const float *s[], uint32_t n,
 		const float * SPA_RESTRICT taps, uint32_t n_taps)
 {
-	__m256 sy[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() }, ty;
-	__m128 sx[2], tx;
-	uint32_t i = 0;
+	__m256 sy[RESAMPLE_BATCH][2], ty;
+	__m128 sx[RESAMPLE_BATCH][2], tx;
+	uint32_t i = 0, k;
 	uint32_t n_taps4 = n_taps & ~0xf;
 
+	for (k = 0; k < n; k++)
+		sy[k][0] = sy[k][1] = _mm256_setzero_ps();
+
 	for (; i < n_taps4; i += 16) {
-		ty = (__m256)_mm256_lddqu_si256((__m256i*)(s + i + 0));
-		sy[0] = _mm256_fmadd_ps(ty, _mm256_load_ps(taps + i + 0), sy[0]);
-		ty = (__m256)_mm256_lddqu_si256((__m256i*)(s + i + 8));
-		sy[1] = _mm256_fmadd_ps(ty, _mm256_load_ps(taps + i + 8), sy[1]);
+		ty = _mm256_load_ps(taps + i + 0);
+		for (k = 0; k < n; k++)
+			sy[k][0] = _mm256_fmadd_ps((__m256)_mm256_lddqu_si256((__m256i*)(s[k] + i + 0)),
+					ty, sy[k][0]);
+		ty = _mm256_load_ps(taps + i + 8);
+		for (k = 0; k < n; k++)
+			sy[k][1] = _mm256_fmadd_ps((__m256)_mm256_lddqu_si256((__m256i*)(s[k] + i + 8)),
+					ty, sy[k][1]);
+	}
+	for (k = 0; k < n; k++) {
+		sy[k][0] = _mm256_add_ps(sy[k][1], sy[k][0]);
+		sx[k][1] = _mm256_extractf128_ps(sy[k][0], 1);
+		sx[k][0] = _mm256_extractf128_ps(sy[k][0], 0);
 	}
-	sy[0] = _mm256_add_ps(sy[1], sy[0]);
-	sx[1] = _mm256_extractf128_ps(sy[0], 1);
-	sx[0] = _mm256_extractf128_ps(sy[0], 0);
 	for (; i < n_taps; i += 8) {
-		tx = (__m128)_mm_lddqu_si128((__m128i*)(s + i + 0));
-		sx[0] = _mm_fmadd_ps(tx, _mm_load_ps(taps + i + 0), sx[0]);
-		tx = (__m128)_mm_lddqu_si128((__m128i*)(s + i + 4));
-		sx[1] = _mm_fmadd_ps(tx, _mm_load_ps(taps + i + 4), sx[1]);
+		tx = _mm_load_ps(taps + i + 0);
+		for (k = 0; k < n; k++)
+			sx[k][0] = _mm_fmadd_ps((__m128)_mm_lddqu_si128((__m128i*)(s[k] + i + 0)),
+					tx, sx[k][0]);
+		tx = _mm_load_ps(taps + i + 4);
+		for (k = 0; k < n; k++)
+			sx[k][1] = _mm_fmadd_ps((__m128)_mm_lddqu_si128((__m128i*)(s[k] + i + 4)),
+					tx, sx[k][1]);
+	}
+	for (k = 0; k < n; k++) {
+		sx[k][0] = _mm_add_ps(sx[k][0], sx[k][1]);
+		sx[k][0] = _mm_hadd_ps(sx[k][0], sx[k][0]);
+		sx[k][0] = _mm_hadd_ps(sx[k][0], sx[k][0]);
+		_mm_store_ss(d[k], sx[k][0]);
 	}
-	sx[0] = _mm_add_ps(sx[0], sx[1]);
-	sx[0] = _mm_hadd_ps(sx[0], sx[0]);
-	sx[0] = _mm_hadd_ps(sx[0], sx[0]);
-	_mm_store_ss(d, sx[0]);
 }
 
-static void inner_product_ip_avx(float *d, const float * SPA_RESTRICT s,
+static inline void inner_product_ip_batch_avx(float *d[], const float *s[], uint32_t n,
 	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
 	uint32_t n_taps)
 {
-	__m256 sy[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() }, ty;
-	__m128 sx[2], tx;
-	uint32_t i, n_taps4 = n_taps & ~0xf;
+	__m256 sy[RESAMPLE_BATCH][2], ty0, ty1, ty;
+	__m128 sx[RESAMPLE_BATCH][2], tx0, tx1, tx;
+	uint32_t i, k, n_taps4 = n_taps & ~0xf;
+
+	for (k = 0; k < n; k++)
+		sy[k][0] = sy[k][1] = _mm256_setzero_ps();
 
 	for (i = 0; i < n_taps4; i += 16) {
-		ty = (__m256)_mm256_lddqu_si256((__m256i*)(s + i + 0));
-		sy[0] = _mm256_fmadd_ps(ty, _mm256_load_ps(t0 + i + 0), sy[0]);
-		sy[1] = _mm256_fmadd_ps(ty, _mm256_load_ps(t1 + i + 0), sy[1]);
-		ty = (__m256)_mm256_lddqu_si256((__m256i*)(s + i + 8));
-		sy[0] = _mm256_fmadd_ps(ty, _mm256_load_ps(t0 + i + 8), sy[0]);
-		sy[1] = _mm256_fmadd_ps(ty, _mm256_load_ps(t1 + i + 8), sy[1]);
+		ty0 = _mm256_load_ps(t0 + i + 0);
+		ty1 = _mm256_load_ps(t1 + i + 0);
+		for (k = 0; k < n; k++) {
+			ty = (__m256)_mm256_lddqu_si256((__m256i*)(s[k] + i + 0));
+			sy[k][0] = _mm256_fmadd_ps(ty, ty0, sy[k][0]);
+			sy[k][1] = _mm256_fmadd_ps(ty, ty1, sy[k][1]);
+		}
+		ty0 = _mm256_load_ps(t0 + i + 8);
+		ty1 = _mm256_load_ps(t1 + i + 8);
+		for (k = 0; k < n; k++) {
+			ty = (__m256)_mm256_lddqu_si256((__m256i*)(s[k] + i + 8));
+			sy[k][0] = _mm256_fmadd_ps(ty, ty0, sy[k][0]);
+			sy[k][1] = _mm256_fmadd_ps(ty, ty1, sy[k][1]);
+		}
+	}
+	for (k = 0; k < n; k++) {
+		sx[k][0] = _mm_add_ps(_mm256_extractf128_ps(sy[k][0], 0), _mm256_extractf128_ps(sy[k][0], 1));
+		sx[k][1] = _mm_add_ps(_mm256_extractf128_ps(sy[k][1], 0), _mm256_extractf128_ps(sy[k][1], 1));
 	}
-	sx[0] = _mm_add_ps(_mm256_extractf128_ps(sy[0], 0), _mm256_extractf128_ps(sy[0], 1));
-	sx[1] = _mm_add_ps(_mm256_extractf128_ps(sy[1], 0), _mm256_extractf128_ps(sy[1], 1));
-
 	for (; i < n_taps; i += 8) {
-		tx = (__m128)_mm_lddqu_si128((__m128i*)(s + i + 0));
-		sx[0] = _mm_fmadd_ps(tx, _mm_load_ps(t0 + i + 0), sx[0]);
-		sx[1] = _mm_fmadd_ps(tx, _mm_load_ps(t1 + i + 0), sx[1]);
-		tx = (__m128)_mm_lddqu_si128((__m128i*)(s + i + 4));
-		sx[0] = _mm_fmadd_ps(tx, _mm_load_ps(t0 + i + 4), sx[0]);
-		sx[1] = _mm_fmadd_ps(tx, _mm_load_ps(t1 + i + 4), sx[1]);
+		tx0 = _mm_load_ps(t0 + i + 0);
+		tx1 = _mm_load_ps(t1 + i + 0);
+		for (k = 0; k < n; k++) {
+			tx = (__m128)_mm_lddqu_si128((__m128i*)(s[k] + i + 0));
+			sx[k][0] = _mm_fmadd_ps(tx, tx0, sx[k][0]);
+			sx[k][1] = _mm_fmadd_ps(tx, tx1, sx[k][1]);
+		}
+		tx0 = _mm_load_ps(t0 + i + 4);
+		tx1 = _mm_load_ps(t1 + i + 4);
+		for (k = 0; k < n; k++) {
+			tx = (__m128)_mm_lddqu_si128((__m128i*)(s[k] + i + 4));
+			sx[k][0] = _mm_fmadd_ps(tx, tx0, sx[k][0]);
+			sx[k][1] = _mm_fmadd_ps(tx, tx1, sx[k][1]);
+		}
+	}
+	for (k = 0; k < n; k++) {
+		sx[k][1] = _mm_mul_ps(_mm_sub_ps(sx[k][1], sx[k][0]), _mm_load1_ps(&x));
+		sx[k][0] = _mm_add_ps(sx[k][0], sx[k][1]);
+		sx[k][0] = _mm_hadd_ps(sx[k][0], sx[k][0]);
+		sx[k][0] = _mm_hadd_ps(sx[k][0], sx[k][0]);
+		_mm_store_ss(d[k], sx[k][0]);
 	}
-	sx[1] = _mm_mul_ps(_mm_sub_ps(sx[1], sx[0]), _mm_load1_ps(&x));
-	sx[0] = _mm_add_ps(sx[0], sx[1]);
-	sx[0] = _mm_hadd_ps(sx[0], sx[0]);
-	sx[0] = _mm_hadd_ps(sx[0], sx[0]);
-	_mm_store_ss(d, sx[0]);
 }
 
-MAKE_RESAMPLER_FULL(avx);
-MAKE_RESAMPLER_INTER(avx);
+MAKE_RESAMPLER_FULL_BATCH(avx);
+MAKE_RESAMPLER_INTER_BATCH(avx);
+
+DEFINE_HALFBAND(avx)
+{
+	const __m256 half = _mm256_set1_ps(0.5f);
+	__m256 sum[2], t;
+	uint32_t n, j;
+
+	odd += n_taps - 1;
+	even += n_taps - 1;
+
+	for (n = 0; n + 16 <= n_out; n += 16) {
+		const float *l = &even[n], *h = &even[n + 1];
+
+		sum[0] = _mm256_mul_ps(_mm256_loadu_ps(&odd[n + 0]), half);
+		sum[1] = _mm256_mul_ps(_mm256_loadu_ps(&odd[n + 8]), half);
+		for (j = 0; j < n_taps; j++) {
+			t = _mm256_broadcast_ss(&taps[j]);
+			sum[0] = _mm256_fmadd_ps(t, _mm256_add_ps(
+				_mm256_loadu_ps(l - j + 0), _mm256_loadu_ps(h + j + 0)), sum[0]);
+			sum[1] = _mm256_fmadd_ps(t, _mm256_add_ps(
+				_mm256_loadu_ps(l - j + 8), _mm256_loadu_ps(h + j + 8)), sum[1]);
+		}
+		_mm256_storeu_ps(&d[n + 0], sum[0]);
+		_mm256_storeu_ps(&d[n + 8], sum[1]);
+	}
+	for (; n + 8 <= n_out; n += 8) {
+		const float *l = &even[n], *h = &even[n + 1];
+
+		sum[0] = _mm256_mul_ps(_mm256_loadu_ps(&odd[n]), half);
+		for (j = 0; j < n_taps; j++) {
+			sum[0] = _mm256_fmadd_ps(_mm256_broadcast_ss(&taps[j]), _mm256_add_ps(
+				_mm256_loadu_ps(l - j), _mm256_loadu_ps(h + j)), sum[0]);
+		}
+		_mm256_storeu_ps(&d[n], sum[0]);
+	}
+	for (; n < n_out; n++) {
+		const float *l = &even[n], *h = &even[n + 1];
+		float s = 0.5f * odd[n];
+		for (j = 0; j < n_taps; j++)
+			s += taps[j] * (*(l - j) + h[j]);
+		d[n] = s;
+	}
+}
@@ -0,0 +1,128 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "resample-native-impl.h"
+
+#include <immintrin.h>
+
+/* The filter rows are 64 bytes aligned and padded to a multiple of 16 taps,
+ * n_taps is a multiple of 8 so the last block is done with a half mask. */
+
+static inline void inner_product_batch_avx512(float *d[], const float *s[], uint32_t n,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	__m512 sum[RESAMPLE_BATCH], t;
+	uint32_t i, k;
+
+	for (k = 0; k < n; k++)
+		sum[k] = _mm512_setzero_ps();
+
+	for (i = 0; i + 16 <= n_taps; i += 16) {
+		t = _mm512_load_ps(taps + i);
+		for (k = 0; k < n; k++)
+			sum[k] = _mm512_fmadd_ps(_mm512_loadu_ps(s[k] + i), t, sum[k]);
+	}
+	if (i < n_taps) {
+		t = _mm512_maskz_load_ps(0x00ff, taps + i);
+		for (k = 0; k < n; k++)
+			sum[k] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(0x00ff, s[k] + i), t, sum[k]);
+	}
+	for (k = 0; k < n; k++)
+		*d[k] = _mm512_reduce_add_ps(sum[k]);
+}
+
+static inline void inner_product_ip_batch_avx512(float *d[], const float *s[], uint32_t n,
+	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
+	uint32_t n_taps)
+{
+	__m512 sum0[RESAMPLE_BATCH], sum1[RESAMPLE_BATCH], ta, tb, v;
+	const __m512 vx = _mm512_set1_ps(x);
+	uint32_t i, k;
+
+	for (k = 0; k < n; k++)
+		sum0[k] = sum1[k] = _mm512_setzero_ps();
+
+	for (i = 0; i + 16 <= n_taps; i += 16) {
+		ta = _mm512_load_ps(t0 + i);
+		tb = _mm512_load_ps(t1 + i);
+		for (k = 0; k < n; k++) {
+			v = _mm512_loadu_ps(s[k] + i);
+			sum0[k] = _mm512_fmadd_ps(v, ta, sum0[k]);
+			sum1[k] = _mm512_fmadd_ps(v, tb, sum1[k]);
+		}
+	}
+	if (i < n_taps) {
+		ta = _mm512_maskz_load_ps(0x00ff, t0 + i);
+		tb = _mm512_maskz_load_ps(0x00ff, t1 + i);
+		for (k = 0; k < n; k++) {
+			v = _mm512_maskz_loadu_ps(0x00ff, s[k] + i);
+			sum0[k] = _mm512_fmadd_ps(v, ta, sum0[k]);
+			sum1[k] = _mm512_fmadd_ps(v, tb, sum1[k]);
+		}
+	}
+	for (k = 0; k < n; k++)
+		*d[k] = _mm512_reduce_add_ps(_mm512_fmadd_ps(
+				_mm512_sub_ps(sum1[k], sum0[k]), vx, sum0[k]));
+}
+
+MAKE_RESAMPLER_FULL_BATCH(avx512);
+MAKE_RESAMPLER_INTER_BATCH(avx512);
+
+DEFINE_HALFBAND(avx512)
+{
+	const __m512 half = _mm512_set1_ps(0.5f);
+	__m512 sum[2], t;
+	__mmask16 m;
+	uint32_t n, j;
+
+	odd += n_taps - 1;
+	even += n_taps - 1;
+
+	for (n = 0; n + 32 <= n_out; n += 32) {
+		const float *l = &even[n], *h = &even[n + 1];
+
+		sum[0] = _mm512_mul_ps(_mm512_loadu_ps(&odd[n + 0]), half);
+		sum[1] = _mm512_mul_ps(_mm512_loadu_ps(&odd[n + 16]), half);
+		for (j = 0; j < n_taps; j++) {
+			t = _mm512_set1_ps(taps[j]);
+			sum[0] = _mm512_fmadd_ps(t, _mm512_add_ps(
+				_mm512_loadu_ps(l - j + 0), _mm512_loadu_ps(h + j + 0)), sum[0]);
+			sum[1] = _mm512_fmadd_ps(t, _mm512_add_ps(
+				_mm512_loadu_ps(l - j + 16), _mm512_loadu_ps(h + j + 16)), sum[1]);
+		}
+		_mm512_storeu_ps(&d[n + 0], sum[0]);
+		_mm512_storeu_ps(&d[n + 16], sum[1]);
+	}
+	for (; n < n_out; n += 16) {
+		const float *l = &even[n], *h = &even[n + 1];
+
+		m = n_out - n < 16 ? (__mmask16)((1u << (n_out - n)) - 1) : 0xffff;
+		sum[0] = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, &odd[n]), half);
+		for (j = 0; j < n_taps; j++) {
+			sum[0] = _mm512_fmadd_ps(_mm512_set1_ps(taps[j]), _mm512_add_ps(
+				_mm512_maskz_loadu_ps(m, l - j), _mm512_maskz_loadu_ps(m, h + j)), sum[0]);
+		}
+		_mm512_mask_storeu_ps(&d[n], m, sum[0]);
+	}
+}
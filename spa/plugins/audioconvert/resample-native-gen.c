@@ -0,0 +1,97 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/* Generates resample-native-precomp.h with the filters for the given rates and
+ * qualities so that they don't need to be calculated at runtime.
+ *
+ * usage: resample-native-gen <in_rate>,<out_rate>,<quality> ...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "resample-native.c"
+
+static int print_filter(FILE *f, uint32_t i_rate, uint32_t o_rate, int quality, uint32_t index)
+{
+	struct resample_filter key;
+	float *taps;
+	uint32_t i, n_taps;
+
+	spa_zero(key);
+	filter_params(&key, i_rate, o_rate, quality);
+
+	n_taps = key.stride * (key.n_phases + 1);
+	if ((taps = calloc(n_taps, sizeof(float))) == NULL)
+		return -errno;
+
+	build_filter(taps, key.stride, key.n_taps, key.n_phases, key.cutoff);
+
+	fprintf(f, "/* %u -> %u, quality %d */\n", i_rate, o_rate, quality);
+	fprintf(f, "static const float precomp_taps_%u[] SPA_ALIGNED(64) = {", index);
+	for (i = 0; i < n_taps; i++)
+		fprintf(f, "%s%af,", i % 8 ? " " : "\n\t", taps[i]);
+	fprintf(f, "\n};\n\n");
+
+	free(taps);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, quality, res;
+	uint32_t i_rate, o_rate;
+	struct resample_filter key;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <in_rate>,<out_rate>,<quality> ...\n", argv[0]);
+		return -1;
+	}
+
+	printf("/* generated by resample-native-gen, do not edit */\n\n");
+
+	for (i = 1; i < argc; i++) {
+		if (sscanf(argv[i], "%u,%u,%d", &i_rate, &o_rate, &quality) != 3 ||
+		    i_rate == 0 || o_rate == 0 || quality < 0 ||
+		    quality >= (int)SPA_N_ELEMENTS(blackman_qualities)) {
+			fprintf(stderr, "invalid tuple '%s'\n", argv[i]);
+			return -1;
+		}
+		if ((res = print_filter(stdout, i_rate, o_rate, quality, i)) < 0) {
+			fprintf(stderr, "can't make filter: %s\n", strerror(-res));
+			return -1;
+		}
+	}
+
+	printf("static const struct resample_precomp precomp_filters[] = {\n");
+	for (i = 1; i < argc; i++) {
+		sscanf(argv[i], "%u,%u,%d", &i_rate, &o_rate, &quality);
+		spa_zero(key);
+		filter_params(&key, i_rate, o_rate, quality);
+		printf("\t{ %u, %u, %u, %u, %a, precomp_taps_%d },\n",
+				key.in_rate, key.out_rate, key.n_taps, key.n_phases,
+				key.cutoff, i);
+	}
+	printf("};\n");
+
+	return 0;
+}
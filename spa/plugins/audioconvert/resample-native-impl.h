@@ -32,14 +32,21 @@ typedef void (*resample_func_t)(struct resample *r,
         const void * SPA_RESTRICT src[], uint32_t ioffs, uint32_t *in_len,
         void * SPA_RESTRICT dst[], uint32_t ooffs, uint32_t *out_len);
 
+typedef void (*halfband_func_t)(float * SPA_RESTRICT d,
+	const float * SPA_RESTRICT even, const float * SPA_RESTRICT odd,
+	const float * SPA_RESTRICT taps, uint32_t n_taps, uint32_t n_out);
+
 struct resample_info {
 	uint32_t format;
 	uint32_t cpu_flags;
 	resample_func_t process_copy;
 	resample_func_t process_full;
 	resample_func_t process_inter;
+	halfband_func_t process_halfband;
 };
 
+struct resample_filter;
+
 struct native_data {
 	double rate;
 	uint32_t n_taps;
@@ -54,7 +61,8 @@ struct native_data {
 	uint32_t hist;
 	float **history;
 	resample_func_t func;
-	float *filter;
+	struct resample_filter *filter_bank;
+	const float *filter;
 	float *hist_mem;
 	const struct resample_info *info;
 };
@@ -64,6 +72,18 @@ void do_resample_##type##_##arch(struct resample *r,				\
 	const void * SPA_RESTRICT src[], uint32_t ioffs, uint32_t *in_len,	\
 	void * SPA_RESTRICT dst[], uint32_t ooffs, uint32_t *out_len)
 
+/* decimate by 2 with a half-band filter. The input is split in even and
+ * odd samples, only the odd input has a center tap of 0.5, the even input
+ * is filtered with n_taps symmetric coefficients:
+ *
+ *  d[n] = 0.5 * odd[n + n_taps - 1] +
+ *         sum(taps[j] * (even[n + n_taps - 1 - j] + even[n + n_taps + j]))
+ */
+#define DEFINE_HALFBAND(arch)							\
+void do_halfband_##arch(float * SPA_RESTRICT d,					\
+	const float * SPA_RESTRICT even, const float * SPA_RESTRICT odd,	\
+	const float * SPA_RESTRICT taps, uint32_t n_taps, uint32_t n_out)
+
 #define MAKE_RESAMPLER_COPY(arch)						\
 DEFINE_RESAMPLER(copy,arch)							\
 {										\
@@ -176,9 +196,119 @@ DEFINE_RESAMPLER(inter,arch)							\
 }
 
 
+/* The batched resamplers process up to RESAMPLE_BATCH channels for each
+ * output sample so that the filter taps are loaded once for all of them.
+ * The channels are kept planar, only the kernel loops over them. The group
+ * size is passed as a constant so that the kernels can unroll the channel
+ * loop. */
+#define RESAMPLE_BATCH	4
+
+#define CALL_BATCH(func,n,...)							\
+	switch (n) {								\
+	case 4: func(d, s, 4, __VA_ARGS__); break;				\
+	case 3: func(d, s, 3, __VA_ARGS__); break;				\
+	case 2: func(d, s, 2, __VA_ARGS__); break;				\
+	default: func(d, s, 1, __VA_ARGS__); break;				\
+	}
+
+#define MAKE_RESAMPLER_FULL_BATCH(arch)						\
+DEFINE_RESAMPLER(full,arch)							\
+{										\
+	struct native_data *data = r->data;					\
+	uint32_t n_taps = data->n_taps, stride = data->filter_stride_os;	\
+	uint32_t index, phase, n_phases = data->out_rate;			\
+	uint32_t c, k, n, o, olen = *out_len, ilen = *in_len;			\
+	uint32_t inc = data->inc, frac = data->frac;				\
+	const float *s[RESAMPLE_BATCH];						\
+	float *d[RESAMPLE_BATCH];						\
+										\
+	if (r->channels == 0)							\
+		return;								\
+										\
+	for (c = 0; c < r->channels; c += n) {					\
+		n = SPA_MIN(r->channels - c, (uint32_t)RESAMPLE_BATCH);	\
+										\
+		index = ioffs;							\
+		phase = data->phase;						\
+										\
+		for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {	\
+			const float *taps;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				s[k] = (const float*)src[c + k] + index;	\
+				d[k] = (float*)dst[c + k] + o;			\
+			}							\
+			taps = &data->filter[phase * stride];			\
+			index += inc;						\
+			phase += frac;						\
+			if (phase >= n_phases) {				\
+				phase -= n_phases;				\
+				index += 1;					\
+			}							\
+			CALL_BATCH(inner_product_batch_##arch, n,		\
+					taps, n_taps);				\
+		}								\
+	}									\
+	*in_len = index;							\
+	*out_len = o;								\
+	data->phase = phase;							\
+}
+
+#define MAKE_RESAMPLER_INTER_BATCH(arch)					\
+DEFINE_RESAMPLER(inter,arch)							\
+{										\
+	struct native_data *data = r->data;					\
+	uint32_t index, phase, stride = data->filter_stride;			\
+	uint32_t n_phases = data->n_phases, out_rate = data->out_rate;		\
+	uint32_t n_taps = data->n_taps;						\
+	uint32_t c, k, n, o, olen = *out_len, ilen = *in_len;			\
+	uint32_t inc = data->inc, frac = data->frac;				\
+	const float *s[RESAMPLE_BATCH];						\
+	float *d[RESAMPLE_BATCH];						\
+										\
+	if (r->channels == 0)							\
+		return;								\
+										\
+	for (c = 0; c < r->channels; c += n) {					\
+		n = SPA_MIN(r->channels - c, (uint32_t)RESAMPLE_BATCH);	\
+										\
+		index = ioffs;							\
+		phase = data->phase;						\
+										\
+		for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {	\
+			const float *t0, *t1;					\
+			float ph, x;						\
+			uint32_t offset;					\
+										\
+			for (k = 0; k < n; k++) {				\
+				s[k] = (const float*)src[c + k] + index;	\
+				d[k] = (float*)dst[c + k] + o;			\
+			}							\
+			ph = (float)phase * n_phases / out_rate;		\
+			offset = floor(ph);					\
+			x = ph - (float)offset;					\
+										\
+			t0 = &data->filter[(offset + 0) * stride];		\
+			t1 = &data->filter[(offset + 1) * stride];		\
+			index += inc;						\
+			phase += frac;						\
+			if (phase >= out_rate) {				\
+				phase -= out_rate;				\
+				index += 1;					\
+			}							\
+			CALL_BATCH(inner_product_ip_batch_##arch, n,		\
+					t0, t1, x, n_taps);			\
+		}								\
+	}									\
+	*in_len = index;							\
+	*out_len = o;								\
+	data->phase = phase;							\
+}
+
 DEFINE_RESAMPLER(copy,c);
 DEFINE_RESAMPLER(full,c);
 DEFINE_RESAMPLER(inter,c);
+DEFINE_HALFBAND(c);
 
 #if defined (HAVE_NEON)
 DEFINE_RESAMPLER(full,neon);
@@ -187,6 +317,7 @@ DEFINE_RESAMPLER(inter,neon);
 #if defined (HAVE_SSE)
 DEFINE_RESAMPLER(full,sse);
 DEFINE_RESAMPLER(inter,sse);
+DEFINE_HALFBAND(sse);
 #endif
 #if defined (HAVE_SSSE3)
 DEFINE_RESAMPLER(full,ssse3);
@@ -195,4 +326,10 @@ DEFINE_RESAMPLER(inter,ssse3);
 #if defined (HAVE_AVX) && defined(HAVE_FMA)
 DEFINE_RESAMPLER(full,avx);
 DEFINE_RESAMPLER(inter,avx);
+DEFINE_HALFBAND(avx);
+#endif
+#if defined (HAVE_AVX512F)
+DEFINE_RESAMPLER(full,avx512);
+DEFINE_RESAMPLER(inter,avx512);
+DEFINE_HALFBAND(avx512);
 #endif
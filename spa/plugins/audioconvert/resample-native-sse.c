@@ -26,69 +26,97 @@
 
 #include <xmmintrin.h>
 
-static void inner_product_sse(float *d, const float * SPA_RESTRICT s,
+static inline void inner_product_batch_sse(float *d[], const float *s[], uint32_t n,
 		const float * SPA_RESTRICT taps, uint32_t n_taps)
 {
-	__m128 sum = _mm_setzero_ps();
-	uint32_t i = 0;
-#if 0
-	uint32_t unrolled = n_taps & ~15;
+	__m128 sum[RESAMPLE_BATCH], t;
+	uint32_t i, k;
 
-	for (i = 0; i < unrolled; i += 16) {
-		sum = _mm_add_ps(sum,
-			_mm_mul_ps(
-				_mm_loadu_ps(s + i + 0),
-				_mm_load_ps(taps + i + 0)));
-		sum = _mm_add_ps(sum,
-			_mm_mul_ps(
-				_mm_loadu_ps(s + i + 4),
-				_mm_load_ps(taps + i + 4)));
-		sum = _mm_add_ps(sum,
-			_mm_mul_ps(
-				_mm_loadu_ps(s + i + 8),
-				_mm_load_ps(taps + i + 8)));
-		sum = _mm_add_ps(sum,
-			_mm_mul_ps(
-				_mm_loadu_ps(s + i + 12),
-				_mm_load_ps(taps + i + 12)));
+	for (k = 0; k < n; k++)
+		sum[k] = _mm_setzero_ps();
+
+	for (i = 0; i < n_taps; i += 8) {
+		t = _mm_load_ps(taps + i + 0);
+		for (k = 0; k < n; k++)
+			sum[k] = _mm_add_ps(sum[k], _mm_mul_ps(_mm_loadu_ps(s[k] + i + 0), t));
+		t = _mm_load_ps(taps + i + 4);
+		for (k = 0; k < n; k++)
+			sum[k] = _mm_add_ps(sum[k], _mm_mul_ps(_mm_loadu_ps(s[k] + i + 4), t));
 	}
-#endif
-	for (; i < n_taps; i += 8) {
-		sum = _mm_add_ps(sum,
-			_mm_mul_ps(
-				_mm_loadu_ps(s + i + 0),
-				_mm_load_ps(taps + i + 0)));
-		sum = _mm_add_ps(sum,
-			_mm_mul_ps(
-				_mm_loadu_ps(s + i + 4),
-				_mm_load_ps(taps + i + 4)));
+	for (k = 0; k < n; k++) {
+		sum[k] = _mm_add_ps(sum[k], _mm_movehl_ps(sum[k], sum[k]));
+		sum[k] = _mm_add_ss(sum[k], _mm_shuffle_ps(sum[k], sum[k], 0x55));
+		_mm_store_ss(d[k], sum[k]);
 	}
-	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
-	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
-	_mm_store_ss(d, sum);
 }
 
-static void inner_product_ip_sse(float *d, const float * SPA_RESTRICT s,
+static inline void inner_product_ip_batch_sse(float *d[], const float *s[], uint32_t n,
 	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
 	uint32_t n_taps)
 {
-	__m128 sum[2] = { _mm_setzero_ps (), _mm_setzero_ps () }, t;
-	uint32_t i;
+	__m128 sum0[RESAMPLE_BATCH], sum1[RESAMPLE_BATCH], ta, tb, v;
+	uint32_t i, k;
+
+	for (k = 0; k < n; k++)
+		sum0[k] = sum1[k] = _mm_setzero_ps();
 
 	for (i = 0; i < n_taps; i += 8) {
-		t = _mm_loadu_ps(s + i + 0);
-		sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(t, _mm_load_ps(t0 + i + 0)));
-		sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(t, _mm_load_ps(t1 + i + 0)));
-		t = _mm_loadu_ps(s + i + 4);
-		sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(t, _mm_load_ps(t0 + i + 4)));
-		sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(t, _mm_load_ps(t1 + i + 4)));
+		ta = _mm_load_ps(t0 + i + 0);
+		tb = _mm_load_ps(t1 + i + 0);
+		for (k = 0; k < n; k++) {
+			v = _mm_loadu_ps(s[k] + i + 0);
+			sum0[k] = _mm_add_ps(sum0[k], _mm_mul_ps(v, ta));
+			sum1[k] = _mm_add_ps(sum1[k], _mm_mul_ps(v, tb));
+		}
+		ta = _mm_load_ps(t0 + i + 4);
+		tb = _mm_load_ps(t1 + i + 4);
+		for (k = 0; k < n; k++) {
+			v = _mm_loadu_ps(s[k] + i + 4);
+			sum0[k] = _mm_add_ps(sum0[k], _mm_mul_ps(v, ta));
+			sum1[k] = _mm_add_ps(sum1[k], _mm_mul_ps(v, tb));
+		}
+	}
+	for (k = 0; k < n; k++) {
+		sum1[k] = _mm_mul_ps(_mm_sub_ps(sum1[k], sum0[k]), _mm_load1_ps(&x));
+		sum0[k] = _mm_add_ps(sum0[k], sum1[k]);
+		sum0[k] = _mm_add_ps(sum0[k], _mm_movehl_ps(sum0[k], sum0[k]));
+		sum0[k] = _mm_add_ss(sum0[k], _mm_shuffle_ps(sum0[k], sum0[k], 0x55));
+		_mm_store_ss(d[k], sum0[k]);
 	}
-	sum[1] = _mm_mul_ps(_mm_sub_ps(sum[1], sum[0]), _mm_load1_ps(&x));
-	sum[0] = _mm_add_ps(sum[0], sum[1]);
-	sum[0] = _mm_add_ps(sum[0], _mm_movehl_ps(sum[0], sum[0]));
-	sum[0] = _mm_add_ss(sum[0], _mm_shuffle_ps(sum[0], sum[0], 0x55));
-	_mm_store_ss(d, sum[0]);
 }
 
-MAKE_RESAMPLER_FULL(sse);
-MAKE_RESAMPLER_INTER(sse);
+MAKE_RESAMPLER_FULL_BATCH(sse);
+MAKE_RESAMPLER_INTER_BATCH(sse);
+
+DEFINE_HALFBAND(sse)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128 sum[2], t;
+	uint32_t n, j;
+
+	odd += n_taps - 1;
+	even += n_taps - 1;
+
+	for (n = 0; n + 8 <= n_out; n += 8) {
+		const float *l = &even[n], *h = &even[n + 1];
+
+		sum[0] = _mm_mul_ps(_mm_loadu_ps(&odd[n + 0]), half);
+		sum[1] = _mm_mul_ps(_mm_loadu_ps(&odd[n + 4]), half);
+		for (j = 0; j < n_taps; j++) {
+			t = _mm_load1_ps(&taps[j]);
+			sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(t,
+				_mm_add_ps(_mm_loadu_ps(l - j + 0), _mm_loadu_ps(h + j + 0))));
+			sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(t,
+				_mm_add_ps(_mm_loadu_ps(l - j + 4), _mm_loadu_ps(h + j + 4))));
+		}
+		_mm_storeu_ps(&d[n + 0], sum[0]);
+		_mm_storeu_ps(&d[n + 4], sum[1]);
+	}
+	for (; n < n_out; n++) {
+		const float *l = &even[n], *h = &even[n + 1];
+		float s = 0.5f * odd[n];
+		for (j = 0; j < n_taps; j++)
+			s += taps[j] * (*(l - j) + h[j]);
+		d[n] = s;
+	}
+}
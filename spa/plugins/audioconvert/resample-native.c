@@ -23,8 +23,10 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
 
 #include <spa/param/audio/format.h>
+#include <spa/utils/list.h>
 
 #include "resample-native-impl.h"
 
@@ -65,6 +67,35 @@ static inline double blackman(double x, double n_taps)
 		0.1365995 * cos(2 * w) - 0.0106411 * cos(3 * w);
 }
 
+struct resample_filter {
+	struct spa_list link;
+	int ref;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	double cutoff;
+	uint32_t stride;		/* in floats */
+	const float *taps;
+};
+
+#ifdef HAVE_RESAMPLE_PRECOMP
+struct resample_precomp {
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	double cutoff;
+	const float *taps;
+};
+#include "resample-native-precomp.h"
+#endif
+
+/* filters are immutable and shared between all resamplers in the process
+ * with the same parameters */
+static pthread_mutex_t filter_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct spa_list filter_cache = { &filter_cache, &filter_cache };
+
 static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t n_phases, double cutoff)
 {
 	uint32_t i, j, n_taps12 = n_taps/2;
@@ -81,55 +112,197 @@ static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t
 	return 0;
 }
 
-static void inner_product_c(float *d, const float * SPA_RESTRICT s,
+static inline void inner_product_batch_c(float *d[], const float *s[], uint32_t n,
 		const float * SPA_RESTRICT taps, uint32_t n_taps)
 {
-	float sum = 0.0f;
-	uint32_t i;
+	float sum[RESAMPLE_BATCH];
+	uint32_t i, k;
 
-	for (i = 0; i < n_taps; i++)
-		sum += s[i] * taps[i];
-	*d = sum;
+	for (k = 0; k < n; k++)
+		sum[k] = 0.0f;
+	for (i = 0; i < n_taps; i++) {
+		float t = taps[i];
+		for (k = 0; k < n; k++)
+			sum[k] += s[k][i] * t;
+	}
+	for (k = 0; k < n; k++)
+		*d[k] = sum[k];
 }
 
-static void inner_product_ip_c(float *d, const float * SPA_RESTRICT s,
+static inline void inner_product_ip_batch_c(float *d[], const float *s[], uint32_t n,
 	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
 	uint32_t n_taps)
 {
-	float sum[2] = { 0.0f, 0.0f };
-	uint32_t i;
+	float sum0[RESAMPLE_BATCH], sum1[RESAMPLE_BATCH];
+	uint32_t i, k;
 
+	for (k = 0; k < n; k++)
+		sum0[k] = sum1[k] = 0.0f;
 	for (i = 0; i < n_taps; i++) {
-		sum[0] += s[i] * t0[i];
-		sum[1] += s[i] * t1[i];
+		float ta = t0[i], tb = t1[i];
+		for (k = 0; k < n; k++) {
+			sum0[k] += s[k][i] * ta;
+			sum1[k] += s[k][i] * tb;
+		}
+	}
+	for (k = 0; k < n; k++)
+		*d[k] = (sum1[k] - sum0[k]) * x + sum0[k];
+}
+
+DEFINE_HALFBAND(c)
+{
+	uint32_t n, j;
+
+	odd += n_taps - 1;
+	even += n_taps - 1;
+
+	for (n = 0; n < n_out; n++) {
+		const float *l = &even[n], *h = &even[n + 1];
+		float sum = 0.5f * odd[n];
+
+		for (j = 0; j < n_taps; j++)
+			sum += taps[j] * (*(l - j) + h[j]);
+		d[n] = sum;
+	}
+}
+
+static inline uint32_t calc_gcd(uint32_t a, uint32_t b)
+{
+	while (b != 0) {
+		uint32_t temp = a;
+		a = b;
+		b = temp % b;
 	}
-	*d = (sum[1] - sum[0]) * x + sum[0];
+	return a;
 }
 
-MAKE_RESAMPLER_COPY(c);
-MAKE_RESAMPLER_FULL(c);
-MAKE_RESAMPLER_INTER(c);
+/* calculate the filter parameters for the given rates and quality, the
+ * rates are reduced with their gcd. */
+static void filter_params(struct resample_filter *f, uint32_t i_rate, uint32_t o_rate,
+		int quality)
+{
+	const struct quality *q = &blackman_qualities[quality];
+	uint32_t gcd, oversample;
+
+	gcd = calc_gcd(i_rate, o_rate);
+	f->in_rate = i_rate / gcd;
+	f->out_rate = o_rate / gcd;
+
+	f->cutoff = SPA_MIN(q->cutoff * f->out_rate / f->in_rate, 1.0);
+	/* multiple of 8 taps to ease simd optimizations */
+	f->n_taps = SPA_ROUND_UP_N((uint32_t)ceil(q->n_taps / f->cutoff), 8);
+
+	/* try to get at least 256 phases so that interpolation is
+	 * accurate enough when activated */
+	oversample = (255 + f->out_rate) / f->out_rate;
+	f->n_phases = f->out_rate * oversample;
+
+	f->stride = SPA_ROUND_UP_N(f->n_taps * sizeof(float), 64) / sizeof(float);
+}
+
+static inline bool filter_equal(const struct resample_filter *a, const struct resample_filter *b)
+{
+	return a->in_rate == b->in_rate &&
+		a->out_rate == b->out_rate &&
+		a->n_taps == b->n_taps &&
+		a->n_phases == b->n_phases &&
+		a->cutoff == b->cutoff;
+}
+
+static struct resample_filter *filter_ref(const struct resample_filter *key)
+{
+	struct resample_filter *f;
+	size_t size;
+	float *taps;
+#ifdef HAVE_RESAMPLE_PRECOMP
+	size_t i;
+#endif
+
+	pthread_mutex_lock(&filter_lock);
+	spa_list_for_each(f, &filter_cache, link) {
+		if (filter_equal(f, key)) {
+			f->ref++;
+			goto done;
+		}
+	}
+
+#ifdef HAVE_RESAMPLE_PRECOMP
+	for (i = 0; i < SPA_N_ELEMENTS(precomp_filters); i++) {
+		const struct resample_precomp *p = &precomp_filters[i];
+		if (p->in_rate == key->in_rate && p->out_rate == key->out_rate &&
+		    p->n_taps == key->n_taps && p->n_phases == key->n_phases &&
+		    p->cutoff == key->cutoff) {
+			if ((f = calloc(1, sizeof(*f))) == NULL)
+				goto done;
+			*f = *key;
+			f->taps = p->taps;
+			goto add;
+		}
+	}
+#endif
+
+	size = key->stride * (key->n_phases + 1) * sizeof(float);
+	if ((f = calloc(1, sizeof(*f) + size + 64)) == NULL)
+		goto done;
+
+	*f = *key;
+	taps = SPA_MEMBER_ALIGN(f, sizeof(*f), 64, float);
+	build_filter(taps, f->stride, f->n_taps, f->n_phases, f->cutoff);
+	f->taps = taps;
+#ifdef HAVE_RESAMPLE_PRECOMP
+add:
+#endif
+	f->ref = 1;
+	spa_list_append(&filter_cache, &f->link);
+done:
+	pthread_mutex_unlock(&filter_lock);
+	return f;
+}
+
+static void filter_unref(struct resample_filter *f)
+{
+	pthread_mutex_lock(&filter_lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		free(f);
+	}
+	pthread_mutex_unlock(&filter_lock);
+}
+
+MAKE_RESAMPLER_COPY(c)
+MAKE_RESAMPLER_FULL_BATCH(c)
+MAKE_RESAMPLER_INTER_BATCH(c)
 
 static struct resample_info resample_table[] =
 {
 #if defined (HAVE_NEON)
 	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_NEON,
-		do_resample_copy_c, do_resample_full_neon, do_resample_inter_neon },
+		do_resample_copy_c, do_resample_full_neon, do_resample_inter_neon,
+		do_halfband_c },
+#endif
+#if defined (HAVE_AVX512F)
+	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_AVX512,
+		do_resample_copy_c, do_resample_full_avx512, do_resample_inter_avx512,
+		do_halfband_avx512 },
 #endif
 #if defined(HAVE_AVX) && defined(HAVE_FMA)
 	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3,
-		do_resample_copy_c, do_resample_full_avx, do_resample_inter_avx },
+		do_resample_copy_c, do_resample_full_avx, do_resample_inter_avx,
+		do_halfband_avx },
 #endif
 #if defined (HAVE_SSSE3)
 	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_SSSE3 | SPA_CPU_FLAG_SLOW_UNALIGNED,
-		do_resample_copy_c, do_resample_full_ssse3, do_resample_inter_ssse3 },
+		do_resample_copy_c, do_resample_full_ssse3, do_resample_inter_ssse3,
+		do_halfband_sse },
 #endif
 #if defined (HAVE_SSE)
 	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_SSE,
-		do_resample_copy_c, do_resample_full_sse, do_resample_inter_sse },
+		do_resample_copy_c, do_resample_full_sse, do_resample_inter_sse,
+		do_halfband_sse },
 #endif
 	{ SPA_AUDIO_FORMAT_F32, 0,
-		do_resample_copy_c, do_resample_full_c, do_resample_inter_c },
+		do_resample_copy_c, do_resample_full_c, do_resample_inter_c,
+		do_halfband_c },
 };
 
 #define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
@@ -146,18 +319,14 @@ static const struct resample_info *find_resample_info(uint32_t format, uint32_t
 
 static void impl_native_free(struct resample *r)
 {
-	free(r->data);
-	r->data = NULL;
-}
+	struct native_data *d = r->data;
 
-static inline uint32_t calc_gcd(uint32_t a, uint32_t b)
-{
-	while (b != 0) {
-		uint32_t temp = a;
-		a = b;
-		b = temp % b;
-	}
-	return a;
+	if (d == NULL)
+		return;
+	if (d->filter_bank)
+		filter_unref(d->filter_bank);
+	free(d);
+	r->data = NULL;
 }
 
 static void impl_native_update_rate(struct resample *r, double rate)
@@ -192,7 +361,7 @@ static void impl_native_update_rate(struct resample *r, double rate)
 	else
 		data->func = data->info->process_inter;
 
-	spa_log_trace_fp(r->log, "native %p: rate:%f in:%d out:%d phase:%d inc:%d frac:%d", r,
+	spa_log_trace_fp(r->log, "native %p: rate:%f in:%d out:%d phase:%d inc:%d frac:%d", (void*)r,
 			rate, data->in_rate, data->out_rate, data->phase, data->inc, data->frac);
 
 }
@@ -205,7 +374,7 @@ static uint32_t impl_native_in_len(struct resample *r, uint32_t out_len)
 	in_len = (data->phase + out_len * data->frac) / data->out_rate;
 	in_len += out_len * data->inc +	(data->n_taps - data->hist);
 
-	spa_log_trace_fp(r->log, "native %p: hist:%d %d->%d", r, data->hist, out_len, in_len);
+	spa_log_trace_fp(r->log, "native %p: hist:%d %d->%d", (void*)r, data->hist, out_len, in_len);
 
 	return in_len;
 }
@@ -248,7 +417,7 @@ static void impl_native_process(struct resample *r,
 		out = *out_len;
 		data->func(r, (const void**)history, 0, &in, dst, 0, &out);
 		spa_log_trace_fp(r->log, "native %p: in:%d/%d out %d/%d hist:%d",
-				r, hist + refill, in, *out_len, out, hist);
+				(void*)r, hist + refill, in, *out_len, out, hist);
 	} else {
 		out = in = 0;
 	}
@@ -261,7 +430,7 @@ static void impl_native_process(struct resample *r,
 		data->func(r, src, skip, &in, dst, out, out_len);
 
 		spa_log_trace_fp(r->log, "native %p: in:%d/%d out %d/%d",
-				r, *in_len, in, *out_len, out);
+				(void*)r, *in_len, in, *out_len, out);
 
 		remain = *in_len - in;
 		if (remain > 0 && remain < n_taps) {
@@ -294,7 +463,7 @@ static void impl_native_process(struct resample *r,
 			for (c = 0; c < r->channels; c++)
 				spa_memmove(history[c], &history[c][in], remain * sizeof(float));
 		}
-		spa_log_trace_fp(r->log, "native %p: in:%d remain:%d", r, in, remain);
+		spa_log_trace_fp(r->log, "native %p: in:%d remain:%d", (void*)r, in, remain);
 
 	}
 	data->hist = remain;
@@ -315,15 +484,12 @@ static uint32_t impl_native_delay (struct resample *r)
 	return d->n_taps / 2;
 }
 
-int resample_native_init(struct resample *r)
+static int native_init(struct resample *r)
 {
 	struct native_data *d;
-	const struct quality *q;
-	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
-	uint32_t history_stride, history_size, oversample;
+	struct resample_filter key, *filter;
+	uint32_t c, history_stride, history_size;
 
-	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(blackman_qualities) - 1);
 	r->free = impl_native_free;
 	r->update_rate = impl_native_update_rate;
 	r->in_len = impl_native_in_len;
@@ -331,30 +497,13 @@ int resample_native_init(struct resample *r)
 	r->reset = impl_native_reset;
 	r->delay = impl_native_delay;
 
-	q = &blackman_qualities[r->quality];
-
-	gcd = calc_gcd(r->i_rate, r->o_rate);
-
-	in_rate = r->i_rate / gcd;
-	out_rate = r->o_rate / gcd;
-
-	scale = SPA_MIN(q->cutoff * out_rate / in_rate, 1.0);
-	/* multiple of 8 taps to ease simd optimizations */
-	n_taps = SPA_ROUND_UP_N((uint32_t)ceil(q->n_taps / scale), 8);
-
-	/* try to get at least 256 phases so that interpolation is
-	 * accurate enough when activated */
-	n_phases = out_rate;
-	oversample = (255 + n_phases) / n_phases;
-	n_phases *= oversample;
+	spa_zero(key);
+	filter_params(&key, r->i_rate, r->o_rate, r->quality);
 
-	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
-	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
+	history_stride = SPA_ROUND_UP_N(2 * key.n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
 
 	d = calloc(1, sizeof(struct native_data) +
-			filter_size +
 			history_size +
 			(r->channels * sizeof(float*)) +
 			64);
@@ -362,26 +511,30 @@ int resample_native_init(struct resample *r)
 	if (d == NULL)
 		return -errno;
 
+	if ((filter = filter_ref(&key)) == NULL) {
+		free(d);
+		return -errno;
+	}
+
 	r->data = d;
-	d->n_taps = n_taps;
-	d->n_phases = n_phases;
-	d->in_rate = in_rate;
-	d->out_rate = out_rate;
-	d->filter = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_MEMBER_ALIGN(d->filter, filter_size, 64, float);
+	d->n_taps = filter->n_taps;
+	d->n_phases = filter->n_phases;
+	d->in_rate = filter->in_rate;
+	d->out_rate = filter->out_rate;
+	d->filter_bank = filter;
+	d->filter = filter->taps;
+	d->hist_mem = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
 	d->history = SPA_MEMBER(d->hist_mem, history_size, float*);
-	d->filter_stride = filter_stride / sizeof(float);
-	d->filter_stride_os = d->filter_stride * oversample;
+	d->filter_stride = filter->stride;
+	d->filter_stride_os = d->filter_stride * (filter->n_phases / filter->out_rate);
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_MEMBER(d->hist_mem, c * history_stride, float);
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
-
 	d->info = find_resample_info(SPA_AUDIO_FORMAT_F32, r->cpu_flags);
 
-	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d n_taps:%d n_phases:%d features:%08x:%08x",
-			r, r->quality, in_rate, out_rate, n_taps, n_phases,
-			r->cpu_flags, d->info->cpu_flags);
+	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d n_taps:%d n_phases:%d filter:%p features:%08x:%08x",
+			(void*)r, r->quality, d->in_rate, d->out_rate, d->n_taps, d->n_phases,
+			(void*)filter, r->cpu_flags, d->info->cpu_flags);
 
 	r->cpu_flags = d->info->cpu_flags;
 
@@ -390,3 +543,370 @@ int resample_native_init(struct resample *r)
 
 	return 0;
 }
+
+/* Large downsampling ratios are done with a cascade of half-band decimators
+ * followed by a smaller polyphase stage. The half-band filters only need to
+ * reject what would alias below the stopband of the final stage so they are
+ * short. Half of the half-band taps are zero and the others are symmetric,
+ * which makes a stage a lot cheaper than the polyphase filter it replaces. */
+#define MAX_HALFBAND	4
+#define HALFBAND_BLOCK	1024
+#define CASCADE_QUEUE	(4 * HALFBAND_BLOCK)
+
+struct halfband {
+	uint32_t n_taps;		/* number of symmetric tap pairs */
+	uint32_t n_even;
+	uint32_t n_odd;
+	float *taps;
+	float **even;
+	float **odd;
+};
+
+struct cascade_data {
+	uint32_t n_stages;
+	struct halfband stages[MAX_HALFBAND];
+	struct resample native;		/* final fractional stage */
+	uint32_t n_queue;
+	float **queue;			/* output of the half-band stages */
+	float **tmp;
+	float **src;
+	float **ptr;
+	halfband_func_t halfband;
+};
+
+/* number of tap pairs of a stage from rate to rate / 2. The final stage
+ * removes everything above its stopband so only what would fold back
+ * below it needs to be rejected. Returns 0 when that is not possible. */
+static uint32_t halfband_taps(uint32_t rate, uint32_t o_rate, const struct quality *q)
+{
+	/* the transition band of the window is about 8 / length */
+	double stop = (q->cutoff + 8.0 / q->n_taps) * o_rate / 2.0;
+	double width = 0.5 - 2.0 * stop / rate;
+
+	if (width <= 0.0)
+		return 0;
+	return (uint32_t)ceil((8.0 / width + 1.0) / 4.0);
+}
+
+static void build_halfband(float *taps, uint32_t n_taps)
+{
+	uint32_t j;
+	double t, sum = 0.0;
+
+	for (j = 0; j < n_taps; j++) {
+		t = 2.0 * j + 1.0;
+		taps[j] = 0.5 * sinc(t * 0.5) * blackman(t, 4.0 * n_taps);
+		sum += taps[j];
+	}
+	/* the center tap is 0.5, make the pairs sum up to unity gain */
+	for (j = 0; j < n_taps; j++)
+		taps[j] *= 0.25 / sum;
+}
+
+/* find the number of half-band stages that gives the cheapest filter,
+ * returns 0 when a single polyphase filter is better */
+static uint32_t cascade_stages(struct resample *r, uint32_t *n_taps)
+{
+	const struct quality *q = &blackman_qualities[r->quality];
+	struct resample_filter f;
+	uint32_t i, rate = r->i_rate, n_stages = 0;
+	double cost = 0.0, best;
+
+	filter_params(&f, r->i_rate, r->o_rate, r->quality);
+	best = f.n_taps;
+
+	for (i = 0; i < MAX_HALFBAND && rate % 2 == 0; i++) {
+		if ((n_taps[i] = halfband_taps(rate, r->o_rate, q)) == 0)
+			break;
+		cost += (n_taps[i] + 1) * (rate / 2.0) / r->o_rate;
+		rate /= 2;
+
+		filter_params(&f, rate, r->o_rate, r->quality);
+		if (cost + f.n_taps < best) {
+			best = cost + f.n_taps;
+			n_stages = i + 1;
+		}
+	}
+	return n_stages;
+}
+
+static void halfband_reset(struct halfband *h, uint32_t channels)
+{
+	uint32_t c;
+
+	/* prefill with zeros so that output n is centered on input 2n */
+	h->n_even = h->n_taps;
+	h->n_odd = h->n_taps - 1;
+	for (c = 0; c < channels; c++) {
+		memset(h->even[c], 0, h->n_even * sizeof(float));
+		memset(h->odd[c], 0, h->n_odd * sizeof(float));
+	}
+}
+
+static void halfband_push(struct halfband *h, uint32_t channels,
+		float **src, uint32_t n_samples)
+{
+	uint32_t c, total = h->n_even + h->n_odd + n_samples;
+
+	for (c = 0; c < channels; c++) {
+		const float *s = src[c];
+		float *e = &h->even[c][h->n_even], *o = &h->odd[c][h->n_odd];
+		uint32_t i = 0;
+
+		if (h->n_even > h->n_odd && n_samples > 0)
+			*o++ = s[i++];
+		for (; i + 1 < n_samples; i += 2) {
+			*e++ = s[i];
+			*o++ = s[i + 1];
+		}
+		if (i < n_samples)
+			*e++ = s[i];
+	}
+	h->n_even = (total + 1) / 2;
+	h->n_odd = total / 2;
+}
+
+static uint32_t halfband_pull(struct halfband *h, uint32_t channels,
+		float **dst, halfband_func_t func)
+{
+	uint32_t c, len = 2 * h->n_taps - 1, n_out;
+
+	if (h->n_even <= len)
+		return 0;
+
+	n_out = h->n_even - len;
+	for (c = 0; c < channels; c++) {
+		func(dst[c], h->even[c], h->odd[c], h->taps, h->n_taps, n_out);
+		memmove(h->even[c], &h->even[c][n_out], (h->n_even - n_out) * sizeof(float));
+		memmove(h->odd[c], &h->odd[c][n_out], (h->n_odd - n_out) * sizeof(float));
+	}
+	h->n_even -= n_out;
+	h->n_odd -= n_out;
+	return n_out;
+}
+
+static void cascade_feed(struct resample *r, float **src, uint32_t n_samples)
+{
+	struct cascade_data *d = r->data;
+	uint32_t i, c;
+
+	for (i = 0; i < d->n_stages; i++) {
+		struct halfband *h = &d->stages[i];
+		float **dst = d->tmp;
+
+		if (i + 1 == d->n_stages) {
+			for (c = 0; c < r->channels; c++)
+				d->ptr[c] = &d->queue[c][d->n_queue];
+			dst = d->ptr;
+		}
+		halfband_push(h, r->channels, src, n_samples);
+		n_samples = halfband_pull(h, r->channels, dst, d->halfband);
+		src = d->tmp;
+	}
+	d->n_queue += n_samples;
+}
+
+static void impl_cascade_free(struct resample *r)
+{
+	struct cascade_data *d = r->data;
+
+	if (d == NULL)
+		return;
+	resample_free(&d->native);
+	free(d);
+	r->data = NULL;
+}
+
+static void impl_cascade_update_rate(struct resample *r, double rate)
+{
+	struct cascade_data *d = r->data;
+	resample_update_rate(&d->native, rate);
+}
+
+static uint32_t impl_cascade_in_len(struct resample *r, uint32_t out_len)
+{
+	struct cascade_data *d = r->data;
+	uint32_t i, have, need;
+
+	need = resample_in_len(&d->native, out_len);
+	need = need > d->n_queue ? need - d->n_queue : 0;
+
+	for (i = d->n_stages; i > 0 && need > 0; i--) {
+		struct halfband *h = &d->stages[i - 1];
+		/* need + 2 * n_taps - 1 even samples, the last one without
+		 * its odd sample */
+		need = 2 * (need + 2 * h->n_taps - 1) - 1;
+		have = h->n_even + h->n_odd;
+		need = need > have ? need - have : 0;
+	}
+	return need;
+}
+
+static void impl_cascade_process(struct resample *r,
+		const void * SPA_RESTRICT src[], uint32_t *in_len,
+		void * SPA_RESTRICT dst[], uint32_t *out_len)
+{
+	struct cascade_data *d = r->data;
+	uint32_t c, in, out, chunk, consumed = 0, produced = 0;
+
+	while (true) {
+		/* run as much input as fits in the queue through the
+		 * half-band stages */
+		while (consumed < *in_len) {
+			chunk = SPA_MIN(*in_len - consumed, (uint32_t)HALFBAND_BLOCK);
+			if (d->n_queue + (chunk >> d->n_stages) + 2 > CASCADE_QUEUE)
+				break;
+			for (c = 0; c < r->channels; c++)
+				d->src[c] = (float*)src[c] + consumed;
+			cascade_feed(r, d->src, chunk);
+			consumed += chunk;
+		}
+
+		/* and let the final stage consume the queue */
+		in = d->n_queue;
+		out = *out_len - produced;
+		for (c = 0; c < r->channels; c++)
+			d->ptr[c] = (float*)dst[c] + produced;
+		resample_process(&d->native, (const void**)d->queue, &in, (void**)d->ptr, &out);
+
+		if (in > 0 && in < d->n_queue) {
+			for (c = 0; c < r->channels; c++)
+				memmove(d->queue[c], &d->queue[c][in],
+						(d->n_queue - in) * sizeof(float));
+		}
+		d->n_queue -= in;
+		produced += out;
+
+		spa_log_trace_fp(r->log, "native %p: cascade in:%d/%d out:%d/%d queue:%d",
+				(void*)r, consumed, *in_len, produced, *out_len, d->n_queue);
+
+		if (produced == *out_len || (in == 0 && out == 0))
+			break;
+		if (consumed == *in_len && d->n_queue == 0)
+			break;
+	}
+	*in_len = consumed;
+	*out_len = produced;
+}
+
+static void impl_cascade_reset (struct resample *r)
+{
+	struct cascade_data *d = r->data;
+	uint32_t i;
+
+	for (i = 0; i < d->n_stages; i++)
+		halfband_reset(&d->stages[i], r->channels);
+	d->n_queue = 0;
+	resample_reset(&d->native);
+}
+
+static uint32_t impl_cascade_delay (struct resample *r)
+{
+	struct cascade_data *d = r->data;
+	uint32_t i, delay = 0;
+
+	for (i = 0; i < d->n_stages; i++)
+		delay += (2 * d->stages[i].n_taps - 1) << i;
+
+	return delay + (resample_delay(&d->native) << d->n_stages);
+}
+
+static int cascade_init(struct resample *r, uint32_t n_stages, const uint32_t *n_taps)
+{
+	struct cascade_data *d;
+	struct native_data *nd;
+	uint32_t i, c, channels = r->channels;
+	size_t size, taps_size, stage_stride[MAX_HALFBAND], queue_stride, tmp_stride;
+	float *p;
+	float **ptrs;
+	int res;
+
+	size = 0;
+	for (i = 0; i < n_stages; i++) {
+		taps_size = SPA_ROUND_UP_N(n_taps[i] * sizeof(float), 64);
+		stage_stride[i] = SPA_ROUND_UP_N((2 * n_taps[i] + HALFBAND_BLOCK / 2 + 2) *
+				sizeof(float), 64);
+		size += taps_size + 2 * channels * stage_stride[i];
+	}
+	queue_stride = CASCADE_QUEUE * sizeof(float);
+	tmp_stride = SPA_ROUND_UP_N((HALFBAND_BLOCK / 2 + 2) * sizeof(float), 64);
+	size += channels * (queue_stride + tmp_stride);
+
+	d = calloc(1, sizeof(struct cascade_data) + size +
+			(2 * n_stages + 4) * channels * sizeof(float*) + 64);
+	if (d == NULL)
+		return -errno;
+
+	p = SPA_MEMBER_ALIGN(d, sizeof(struct cascade_data), 64, float);
+	ptrs = SPA_MEMBER(p, size, float*);
+
+	d->n_stages = n_stages;
+	for (i = 0; i < n_stages; i++) {
+		struct halfband *h = &d->stages[i];
+
+		h->n_taps = n_taps[i];
+		h->taps = p;
+		build_halfband(h->taps, h->n_taps);
+		p = SPA_MEMBER(p, SPA_ROUND_UP_N(n_taps[i] * sizeof(float), 64), float);
+
+		h->even = ptrs;
+		h->odd = ptrs + channels;
+		ptrs += 2 * channels;
+		for (c = 0; c < channels; c++) {
+			h->even[c] = p;
+			h->odd[c] = SPA_MEMBER(p, stage_stride[i], float);
+			p = SPA_MEMBER(p, 2 * stage_stride[i], float);
+		}
+	}
+	d->queue = ptrs;
+	d->tmp = ptrs + channels;
+	d->src = ptrs + 2 * channels;
+	d->ptr = ptrs + 3 * channels;
+	for (c = 0; c < channels; c++) {
+		d->queue[c] = p;
+		d->tmp[c] = SPA_MEMBER(p, queue_stride, float);
+		p = SPA_MEMBER(p, queue_stride + tmp_stride, float);
+	}
+
+	d->native.log = r->log;
+	d->native.cpu_flags = r->cpu_flags;
+	d->native.channels = channels;
+	d->native.i_rate = r->i_rate >> n_stages;
+	d->native.o_rate = r->o_rate;
+	d->native.quality = r->quality;
+	if ((res = native_init(&d->native)) < 0) {
+		free(d);
+		return res;
+	}
+	nd = d->native.data;
+	d->halfband = nd->info->process_halfband;
+
+	r->free = impl_cascade_free;
+	r->update_rate = impl_cascade_update_rate;
+	r->in_len = impl_cascade_in_len;
+	r->process = impl_cascade_process;
+	r->reset = impl_cascade_reset;
+	r->delay = impl_cascade_delay;
+	r->data = d;
+	r->cpu_flags = d->native.cpu_flags;
+
+	for (i = 0; i < n_stages; i++)
+		spa_log_debug(r->log, "native %p: half-band stage %d: in:%d n_taps:%d",
+				(void*)r, i, r->i_rate >> i, 4 * d->stages[i].n_taps - 1);
+
+	impl_cascade_reset(r);
+
+	return 0;
+}
+
+int resample_native_init(struct resample *r)
+{
+	uint32_t n_stages, n_taps[MAX_HALFBAND];
+
+	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(blackman_qualities) - 1);
+
+	if ((n_stages = cascade_stages(r, n_taps)) > 0)
+		return cascade_init(r, n_stages, n_taps);
+
+	return native_init(r);
+}
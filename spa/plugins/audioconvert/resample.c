@@ -47,6 +47,7 @@
 
 #define MAX_SAMPLES	8192
 #define MAX_BUFFERS	32
+#define MAX_DATAS	SPA_AUDIO_MAX_CHANNELS
 
 struct impl;
 
@@ -68,6 +69,7 @@ struct buffer {
 	struct spa_list link;
 	struct spa_buffer *outbuf;
 	struct spa_meta_header *h;
+	void *datas[MAX_DATAS];
 };
 
 struct port {
@@ -119,6 +121,8 @@ struct impl {
 	unsigned int started:1;
 	unsigned int peaks:1;
 	unsigned int drained:1;
+	unsigned int is_passthrough:1;
+	unsigned int passthrough:1;
 
 	struct resample resample;
 };
@@ -128,6 +132,28 @@ struct impl {
 #define GET_OUT_PORT(this,id)		(&this->out_port)
 #define GET_PORT(this,d,id)		(d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,id) : GET_OUT_PORT(this,id))
 
+/* the output buffers can reference the input data when the rates are
+ * the same and the data of all output buffers is dynamic */
+static void update_passthrough(struct impl *this)
+{
+	struct port *port = GET_OUT_PORT(this, 0);
+	bool passthrough;
+	uint32_t i, j;
+
+	passthrough = !this->peaks &&
+		this->resample.i_rate == this->resample.o_rate;
+
+	for (i = 0; passthrough && i < port->n_buffers; i++) {
+		struct spa_buffer *b = port->buffers[i].outbuf;
+
+		for (j = 0; j < b->n_datas; j++) {
+			if (!SPA_FLAG_IS_SET(b->datas[j].flags, SPA_DATA_FLAG_DYNAMIC))
+				passthrough = false;
+		}
+	}
+	this->is_passthrough = passthrough;
+}
+
 static int setup_convert(struct impl *this,
 		enum spa_direction direction,
 		const struct spa_audio_info *info)
@@ -168,6 +194,9 @@ static int setup_convert(struct impl *this,
 	else
 		err = resample_native_init(&this->resample);
 
+	update_passthrough(this);
+	this->passthrough = false;
+
 	return err;
 }
 
@@ -622,6 +651,7 @@ impl_node_port_use_buffers(void *object,
 					      buffers[i]);
 				return -EINVAL;
 			}
+			b->datas[j] = d[j].data;
 		}
 
 		if (direction == SPA_DIRECTION_OUTPUT)
@@ -634,6 +664,9 @@ impl_node_port_use_buffers(void *object,
 	port->n_buffers = n_buffers;
 	port->size = size;
 
+	if (direction == SPA_DIRECTION_OUTPUT)
+		update_passthrough(this);
+
 	return 0;
 }
 
@@ -725,6 +758,7 @@ static int impl_node_process(void *object)
 	bool flush_out = false;
 	bool flush_in = false;
 	bool draining = false;
+	bool is_passthrough;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -785,6 +819,19 @@ static int impl_node_process(void *object)
 		flush_out = true;
 		break;
 	}
+	/* the quantum got smaller than the pending output, send that out
+	 * first and keep the input for the next cycle */
+	if (SPA_UNLIKELY(outport->offset > 0 && outport->offset >= maxsize)) {
+		for (i = 0; i < db->n_datas; i++) {
+			db->datas[i].chunk->size = outport->offset;
+			db->datas[i].chunk->offset = 0;
+		}
+		outio->status = SPA_STATUS_HAVE_DATA;
+		outio->buffer_id = dbuf->id;
+		dequeue_buffer(this, dbuf);
+		outport->offset = 0;
+		return SPA_STATUS_HAVE_DATA;
+	}
 	if (size == 0) {
 		size = sb->datas[0].maxsize;
 		memset(sb->datas[0].data, 0, size);
@@ -800,23 +847,45 @@ static int impl_node_process(void *object)
 		}
 	}
 
+	/* when the rates are the same and there is no rate adjustment, hand
+	 * the complete input buffer to the output without copying */
+	is_passthrough = this->is_passthrough && !draining &&
+		inport->offset == 0 && outport->offset == 0 &&
+		size <= maxsize &&
+		(this->io_rate_match ?
+		 !SPA_FLAG_IS_SET(this->io_rate_match->flags, SPA_IO_RATE_MATCH_FLAG_ACTIVE) :
+		 this->props.rate == 1.0);
+
 	in_len = (size - inport->offset) / sizeof(float);
 	out_len = (maxsize - outport->offset) / sizeof(float);
 
-	src_datas = alloca(sizeof(void*) * this->resample.channels);
-	dst_datas = alloca(sizeof(void*) * this->resample.channels);
-
-	for (i = 0; i < sb->n_datas; i++)
-		src_datas[i] = SPA_MEMBER(sb->datas[i].data, inport->offset, void);
-	for (i = 0; i < db->n_datas; i++)
-		dst_datas[i] = SPA_MEMBER(db->datas[i].data, outport->offset, void);
-
 #ifndef FASTPATH
 	pin_len = in_len;
 	pout_len = out_len;
 #endif
 
-	resample_process(&this->resample, src_datas, &in_len, dst_datas, &out_len);
+	if (is_passthrough) {
+		for (i = 0; i < db->n_datas; i++)
+			db->datas[i].data = sb->datas[i].data;
+		out_len = in_len;
+		flush_out = true;
+		this->passthrough = true;
+	} else {
+		src_datas = alloca(sizeof(void*) * this->resample.channels);
+		dst_datas = alloca(sizeof(void*) * this->resample.channels);
+
+		for (i = 0; i < sb->n_datas; i++)
+			src_datas[i] = SPA_MEMBER(sb->datas[i].data, inport->offset, void);
+		for (i = 0; i < db->n_datas; i++) {
+			db->datas[i].data = dbuf->datas[i];
+			dst_datas[i] = SPA_MEMBER(db->datas[i].data, outport->offset, void);
+		}
+		if (this->passthrough) {
+			resample_reset(&this->resample);
+			this->passthrough = false;
+		}
+		resample_process(&this->resample, src_datas, &in_len, dst_datas, &out_len);
+	}
 
 #ifndef FASTPATH
 	spa_log_trace_fp(this->log, NAME " %p: in %d/%d %zd %d out %d/%d %zd %d max:%d",
@@ -856,8 +925,13 @@ static int impl_node_process(void *object)
 	}
 
 	if (this->io_rate_match) {
-		this->io_rate_match->delay = resample_delay(&this->resample);
-		this->io_rate_match->size = resample_in_len(&this->resample, max);
+		if (is_passthrough) {
+			this->io_rate_match->delay = 0;
+			this->io_rate_match->size = max;
+		} else {
+			this->io_rate_match->delay = resample_delay(&this->resample);
+			this->io_rate_match->size = resample_in_len(&this->resample, max);
+		}
 	}
 	return res;
 }
@@ -28,13 +28,17 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 
 #include <spa/utils/names.h>
 #include <spa/support/plugin.h>
 #include <spa/param/param.h>
+#include <spa/param/props.h>
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/alloc.h>
 #include <spa/debug/mem.h>
 #include <spa/support/log-impl.h>
 
@@ -509,6 +513,319 @@ static int test_set_in_format2(struct context *ctx)
 	return 0;
 }
 
+static void set_port_config(struct context *ctx, enum spa_direction direction,
+		enum spa_param_port_config_mode mode)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_ParamPortConfig, SPA_PARAM_PortConfig,
+		SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(direction),
+		SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(mode));
+
+	res = spa_node_set_param(ctx->convert_node, SPA_PARAM_PortConfig, 0, param);
+	spa_assert(res == 0);
+}
+
+static void set_port_format(struct context *ctx, enum spa_direction direction,
+		struct spa_audio_info_raw *info)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, info);
+
+	res = spa_node_port_set_param(ctx->convert_node, direction, 0,
+			SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+}
+
+static void set_volume(struct context *ctx, float volume)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+		SPA_PROP_volume,	SPA_POD_Float(volume));
+
+	res = spa_node_set_param(ctx->convert_node, SPA_PARAM_Props, 0, param);
+	spa_assert(res == 0);
+}
+
+#define PROCESS_SAMPLES	1024
+#define PROCESS_CYCLES	32
+
+static float process_sine(struct context *ctx, struct spa_io_buffers *inio,
+		struct spa_io_buffers *outio, struct spa_buffer *inbuf,
+		struct spa_buffer **outbufs, float *out, uint32_t *n_out)
+{
+	uint32_t i, j, n, size;
+	int16_t *in = inbuf->datas[0].data;
+	double sum = 0.0;
+	int res;
+
+	*n_out = 0;
+	for (i = 0; i < PROCESS_CYCLES;) {
+		if (inio->status != SPA_STATUS_HAVE_DATA) {
+			for (j = 0; j < PROCESS_SAMPLES; j++) {
+				int16_t v = 16384 * sin(2.0 * M_PI * 1000.0 *
+						(i * PROCESS_SAMPLES + j) / 44100.0);
+				in[j * 2 + 0] = v;
+				in[j * 2 + 1] = v;
+			}
+			inbuf->datas[0].chunk->offset = 0;
+			inbuf->datas[0].chunk->size = PROCESS_SAMPLES * 2 * sizeof(int16_t);
+			inio->status = SPA_STATUS_HAVE_DATA;
+			inio->buffer_id = 0;
+			i++;
+		}
+
+		res = spa_node_process(ctx->convert_node);
+		spa_assert(res >= 0);
+
+		if (outio->status != SPA_STATUS_HAVE_DATA)
+			continue;
+
+		spa_assert(outio->buffer_id < 2);
+		size = outbufs[outio->buffer_id]->datas[0].chunk->size;
+		n = size / sizeof(float);
+		spa_assert(*n_out + n <= PROCESS_SAMPLES * PROCESS_CYCLES * 2);
+		memcpy(&out[*n_out], outbufs[outio->buffer_id]->datas[0].data, size);
+		*n_out += n;
+		outio->status = SPA_STATUS_NEED_DATA;
+	}
+	/* skip the resampler startup */
+	for (i = *n_out / 2; i < *n_out; i++)
+		sum += out[i] * out[i];
+
+	return sqrt(sum / (*n_out - *n_out / 2));
+}
+
+static int test_process(void)
+{
+	struct context ctx;
+	struct spa_audio_info_raw info;
+	struct spa_io_buffers inio = SPA_IO_BUFFERS_INIT, outio = SPA_IO_BUFFERS_INIT;
+	struct spa_io_position position;
+	struct spa_io_rate_match rate_match;
+	struct spa_buffer **inbufs, **outbufs;
+	struct spa_data datas[1];
+	uint32_t aligns[1], expected, n_out;
+	float rms, *out;
+	int res;
+
+	spa_zero(ctx);
+	setup_context(&ctx);
+	logger.log.level = SPA_LOG_LEVEL_INFO;
+
+	/* S16 stereo at 44100 to F32 mono at 48000 */
+	set_port_config(&ctx, SPA_DIRECTION_INPUT, SPA_PARAM_PORT_CONFIG_MODE_convert);
+	set_port_config(&ctx, SPA_DIRECTION_OUTPUT, SPA_PARAM_PORT_CONFIG_MODE_convert);
+
+	info = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_S16,
+		.rate = 44100,
+		.channels = 2,
+		.position = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, }
+	};
+	set_port_format(&ctx, SPA_DIRECTION_INPUT, &info);
+
+	info = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = 1,
+		.position = { SPA_AUDIO_CHANNEL_MONO, }
+	};
+	set_port_format(&ctx, SPA_DIRECTION_OUTPUT, &info);
+
+	spa_zero(datas);
+	datas[0].type = SPA_DATA_MemPtr;
+	datas[0].maxsize = PROCESS_SAMPLES * 2 * sizeof(int16_t);
+	aligns[0] = 16;
+	inbufs = spa_buffer_alloc_array(1, 0, 0, NULL, 1, datas, aligns);
+	spa_assert(inbufs != NULL);
+
+	datas[0].maxsize = 8192 * sizeof(float);
+	outbufs = spa_buffer_alloc_array(2, 0, 0, NULL, 1, datas, aligns);
+	spa_assert(outbufs != NULL);
+
+	res = spa_node_port_use_buffers(ctx.convert_node, SPA_DIRECTION_INPUT, 0,
+			0, inbufs, 1);
+	spa_assert(res == 0);
+	res = spa_node_port_use_buffers(ctx.convert_node, SPA_DIRECTION_OUTPUT, 0,
+			0, outbufs, 2);
+	spa_assert(res == 0);
+
+	res = spa_node_port_set_io(ctx.convert_node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_Buffers, &inio, sizeof(inio));
+	spa_assert(res == 0);
+	res = spa_node_port_set_io(ctx.convert_node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_IO_Buffers, &outio, sizeof(outio));
+	spa_assert(res == 0);
+
+	res = spa_node_send_command(ctx.convert_node,
+			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+	spa_assert(res == 0);
+
+	out = calloc(PROCESS_SAMPLES * PROCESS_CYCLES * 2, sizeof(float));
+	spa_assert(out != NULL);
+
+	/* the stereo sine is mixed to mono and resampled */
+	rms = process_sine(&ctx, &inio, &outio, inbufs[0], outbufs, out, &n_out);
+	expected = PROCESS_SAMPLES * PROCESS_CYCLES * 48000 / 44100;
+	fprintf(stderr, "process: %d samples (max %d) rms %f\n", n_out, expected, rms);
+	spa_assert(n_out > 0 && n_out <= expected);
+	spa_assert(fabs(rms - 0.5) < 0.01);
+
+	/* volume changes are picked up */
+	set_volume(&ctx, 0.5f);
+	rms = process_sine(&ctx, &inio, &outio, inbufs[0], outbufs, out, &n_out);
+	fprintf(stderr, "process: %d samples rms %f\n", n_out, rms);
+	spa_assert(fabs(rms - 0.25) < 0.01);
+
+	/* with rate matching, one quantum is produced per cycle */
+	spa_zero(position);
+	position.clock.duration = PROCESS_SAMPLES;
+	res = spa_node_set_io(ctx.convert_node, SPA_IO_Position,
+			&position, sizeof(position));
+	spa_assert(res == 0);
+
+	spa_zero(rate_match);
+	rate_match.rate = 1.0;
+	rate_match.flags = SPA_IO_RATE_MATCH_FLAG_ACTIVE;
+	res = spa_node_port_set_io(ctx.convert_node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_RateMatch, &rate_match, sizeof(rate_match));
+	spa_assert(res == 0);
+
+	/* the first run also flushes the samples queued without rate matching */
+	process_sine(&ctx, &inio, &outio, inbufs[0], outbufs, out, &n_out);
+	rms = process_sine(&ctx, &inio, &outio, inbufs[0], outbufs, out, &n_out);
+	fprintf(stderr, "process: %d samples rms %f size %d\n", n_out, rms, rate_match.size);
+	spa_assert(n_out == PROCESS_SAMPLES * PROCESS_CYCLES);
+	spa_assert(fabs(rms - 0.25) < 0.01);
+
+	free(out);
+	free(inbufs);
+	free(outbufs);
+
+	clean_context(&ctx);
+
+	return 0;
+}
+
+static int test_passthrough(void)
+{
+	struct context ctx;
+	struct spa_audio_info_raw info;
+	struct spa_io_buffers inio = SPA_IO_BUFFERS_INIT, outio = SPA_IO_BUFFERS_INIT;
+	struct spa_io_rate_match rate_match;
+	struct spa_buffer **inbufs, **outbufs;
+	struct spa_data datas[1];
+	uint32_t i, aligns[1];
+	struct spa_data *d;
+	int res;
+
+	spa_zero(ctx);
+	setup_context(&ctx);
+	logger.log.level = SPA_LOG_LEVEL_INFO;
+
+	/* F32P mono at 48000 on both sides */
+	set_port_config(&ctx, SPA_DIRECTION_INPUT, SPA_PARAM_PORT_CONFIG_MODE_convert);
+	set_port_config(&ctx, SPA_DIRECTION_OUTPUT, SPA_PARAM_PORT_CONFIG_MODE_convert);
+
+	info = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_F32P,
+		.rate = 48000,
+		.channels = 1,
+		.position = { SPA_AUDIO_CHANNEL_MONO, }
+	};
+	set_port_format(&ctx, SPA_DIRECTION_INPUT, &info);
+	set_port_format(&ctx, SPA_DIRECTION_OUTPUT, &info);
+
+	spa_zero(datas);
+	datas[0].type = SPA_DATA_MemPtr;
+	datas[0].maxsize = 8192 * sizeof(float);
+	aligns[0] = 16;
+	inbufs = spa_buffer_alloc_array(1, 0, 0, NULL, 1, datas, aligns);
+	spa_assert(inbufs != NULL);
+
+	datas[0].flags = SPA_DATA_FLAG_DYNAMIC;
+	outbufs = spa_buffer_alloc_array(2, 0, 0, NULL, 1, datas, aligns);
+	spa_assert(outbufs != NULL);
+
+	res = spa_node_port_use_buffers(ctx.convert_node, SPA_DIRECTION_INPUT, 0,
+			0, inbufs, 1);
+	spa_assert(res == 0);
+	res = spa_node_port_use_buffers(ctx.convert_node, SPA_DIRECTION_OUTPUT, 0,
+			0, outbufs, 2);
+	spa_assert(res == 0);
+
+	res = spa_node_port_set_io(ctx.convert_node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_Buffers, &inio, sizeof(inio));
+	spa_assert(res == 0);
+	res = spa_node_port_set_io(ctx.convert_node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_IO_Buffers, &outio, sizeof(outio));
+	spa_assert(res == 0);
+
+	spa_zero(rate_match);
+	rate_match.rate = 1.0;
+	res = spa_node_port_set_io(ctx.convert_node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_RateMatch, &rate_match, sizeof(rate_match));
+	spa_assert(res == 0);
+
+	res = spa_node_send_command(ctx.convert_node,
+			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+	spa_assert(res == 0);
+
+	d = &inbufs[0]->datas[0];
+	for (i = 0; i < 4; i++) {
+		d->chunk->offset = 0;
+		d->chunk->size = PROCESS_SAMPLES * sizeof(float);
+		inio.status = SPA_STATUS_HAVE_DATA;
+		inio.buffer_id = 0;
+		outio.status = SPA_STATUS_NEED_DATA;
+
+		/* the input memory is handed out without copying */
+		res = spa_node_process(ctx.convert_node);
+		spa_assert(res >= 0);
+		spa_assert(outio.status == SPA_STATUS_HAVE_DATA);
+		spa_assert(outio.buffer_id < 2);
+		spa_assert(outbufs[outio.buffer_id]->datas[0].data == d->data);
+		spa_assert(outbufs[outio.buffer_id]->datas[0].chunk->size ==
+				PROCESS_SAMPLES * sizeof(float));
+		spa_assert(rate_match.delay == 0);
+	}
+
+	/* with active rate matching, the resampler is used again */
+	rate_match.flags = SPA_IO_RATE_MATCH_FLAG_ACTIVE;
+	inio.status = SPA_STATUS_HAVE_DATA;
+	inio.buffer_id = 0;
+	outio.status = SPA_STATUS_NEED_DATA;
+	res = spa_node_process(ctx.convert_node);
+	spa_assert(res >= 0);
+	spa_assert(outio.status == SPA_STATUS_HAVE_DATA);
+	spa_assert(outbufs[outio.buffer_id]->datas[0].data != d->data);
+	spa_assert(rate_match.delay > 0);
+
+	free(inbufs);
+	free(outbufs);
+
+	clean_context(&ctx);
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	struct context ctx;
@@ -532,5 +849,8 @@ int main(int argc, char *argv[])
 
 	clean_context(&ctx);
 
+	test_process();
+	test_passthrough();
+
 	return 0;
 }
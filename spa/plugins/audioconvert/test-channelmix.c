@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 
 #include <spa/support/log-impl.h>
 #include <spa/debug/mem.h>
@@ -118,6 +119,238 @@ static void test_7p1_N(void)
 	test_mix(8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR), 2, _M(FL)|_M(FR), (float[]) { 0.5, 0.5 });
 }
 
+#define N_SAMPLES	251
+#define N_CHANNELS	16
+
+static float samp_in[N_CHANNELS][N_SAMPLES + 1];
+static float samp_out[N_CHANNELS][N_SAMPLES + 1];
+static float samp_ref[N_CHANNELS][N_SAMPLES + 1];
+
+static void run_process(const char *name, struct channelmix *mix,
+		channelmix_func_t func, channelmix_func_t ref)
+{
+	const void *s[N_CHANNELS];
+	void *d[N_CHANNELS], *r[N_CHANNELS];
+	uint32_t i, n;
+
+	/* odd channels are not aligned to test the unaligned code paths */
+	for (i = 0; i < mix->src_chan; i++)
+		s[i] = &samp_in[i][i & 1];
+	for (i = 0; i < mix->dst_chan; i++) {
+		d[i] = &samp_out[i][i & 1];
+		r[i] = &samp_ref[i][i & 1];
+	}
+	memset(samp_out, 0, sizeof(samp_out));
+	memset(samp_ref, 0, sizeof(samp_ref));
+
+	spa_log_debug(&logger.log, "test %s %d->%d", name, mix->src_chan, mix->dst_chan);
+
+	ref(mix, mix->dst_chan, r, mix->src_chan, s, N_SAMPLES);
+	func(mix, mix->dst_chan, d, mix->src_chan, s, N_SAMPLES);
+
+	for (i = 0; i < mix->dst_chan; i++) {
+		const float *a = d[i], *b = r[i];
+		for (n = 0; n < N_SAMPLES; n++) {
+			if (fabsf(a[n] - b[n]) > 1e-5f) {
+				fprintf(stderr, "%s: channel %d sample %d: %f != %f\n",
+						name, i, n, a[n], b[n]);
+				spa_assert_not_reached();
+			}
+		}
+	}
+}
+
+static void init_mix(struct channelmix *mix, uint32_t src_chan, uint64_t src_mask,
+		uint32_t dst_chan, uint64_t dst_mask)
+{
+	spa_zero(*mix);
+	mix->src_chan = src_chan;
+	mix->dst_chan = dst_chan;
+	mix->src_mask = src_mask;
+	mix->dst_mask = dst_mask;
+	mix->log = &logger.log;
+	spa_assert(channelmix_init(mix) == 0);
+}
+
+static void test_process_mix(const char *name, uint32_t src_chan, uint64_t src_mask,
+		uint32_t dst_chan, uint64_t dst_mask,
+		channelmix_func_t func, channelmix_func_t ref)
+{
+	struct channelmix mix;
+	float volumes[N_CHANNELS];
+	uint32_t i;
+
+	init_mix(&mix, src_chan, src_mask, dst_chan, dst_mask);
+
+	for (i = 0; i < src_chan; i++)
+		volumes[i] = 1.0f;
+	mix.set_volume(&mix, 1.0f, false, src_chan, volumes);
+	run_process(name, &mix, func, ref);
+
+	for (i = 0; i < src_chan; i++)
+		volumes[i] = 0.25f + 0.1f * i;
+	mix.set_volume(&mix, 0.8f, false, src_chan, volumes);
+	run_process(name, &mix, func, ref);
+
+	mix.set_volume(&mix, 1.0f, true, src_chan, volumes);
+	run_process(name, &mix, func, ref);
+}
+
+static void test_process_matrix(const char *name, uint32_t src_chan, uint32_t dst_chan,
+		channelmix_func_t func)
+{
+	struct channelmix mix;
+	uint32_t i, j;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.dst_chan = dst_chan;
+
+	/* a sparse matrix with some rows that are empty or a plain copy */
+	for (i = 0; i < dst_chan; i++) {
+		for (j = 0; j < src_chan; j++) {
+			if (i == 1)
+				mix.matrix[i][j] = 0.0f;
+			else if (i == 2)
+				mix.matrix[i][j] = j == 3 ? 1.0f : 0.0f;
+			else if ((i + j) % 3 == 0)
+				mix.matrix[i][j] = (drand48() - 0.5) * 2.0;
+		}
+	}
+	run_process(name, &mix, func, channelmix_f32_n_m_c);
+}
+
+#define MASK_16	(MASK_7_1|_M(FLC)|_M(FRC)|_M(RC)|_M(TC)|_M(TFL)|_M(TFC)|_M(TFR)|_M(TRL))
+
+#define RAMP_SAMPLES	200
+
+static void test_process_ramp(const char *name, uint32_t src_chan, uint64_t src_mask,
+		uint32_t dst_chan, uint64_t dst_mask)
+{
+	struct channelmix mix;
+	float v0[N_CHANNELS], v1[N_CHANNELS], g[N_CHANNELS];
+	const void *s[N_CHANNELS];
+	void *d[N_CHANNELS];
+	uint32_t i, j, n, split = 77, n_vol = SPA_MAX(src_chan, dst_chan);
+
+	init_mix(&mix, src_chan, src_mask, dst_chan, dst_mask);
+	mix.volume.ramp.type = SPA_RAMP_LINEAR;
+	mix.volume.ramp.duration = RAMP_SAMPLES;
+
+	for (i = 0; i < n_vol; i++) {
+		v0[i] = 1.0f;
+		v1[i] = 0.25f + 0.1f * i;
+	}
+	/* the first volume is applied right away */
+	mix.set_volume(&mix, 1.0f, false, n_vol, v0);
+	spa_assert(mix.process != impl_channelmix_process_ramp);
+
+	mix.set_volume(&mix, 0.8f, false, n_vol, v1);
+	spa_assert(mix.process == impl_channelmix_process_ramp);
+	spa_assert(!mix.identity);
+
+	memset(samp_out, 0, sizeof(samp_out));
+	for (i = 0; i < src_chan; i++)
+		s[i] = samp_in[i];
+	for (i = 0; i < dst_chan; i++)
+		d[i] = samp_out[i];
+	channelmix_process(&mix, dst_chan, d, src_chan, s, split);
+	for (i = 0; i < src_chan; i++)
+		s[i] = &samp_in[i][split];
+	for (i = 0; i < dst_chan; i++)
+		d[i] = &samp_out[i][split];
+	channelmix_process(&mix, dst_chan, d, src_chan, s, N_SAMPLES - split);
+
+	/* the volumes are back in the matrix after the ramp */
+	spa_assert(mix.process != impl_channelmix_process_ramp);
+	spa_assert(mix.volume.ramp.remaining == 0);
+
+	for (n = 0; n < N_SAMPLES; n++) {
+		for (i = 0; i < n_vol; i++)
+			g[i] = v0[i] + (v1[i] * 0.8f - v0[i]) *
+				SPA_MIN(n, (uint32_t)RAMP_SAMPLES) / RAMP_SAMPLES;
+		for (i = 0; i < dst_chan; i++) {
+			float ref = 0.0f;
+			for (j = 0; j < src_chan; j++)
+				ref += mix.matrix_orig[i][j] * samp_in[j][n] *
+					(n_vol == src_chan ? g[j] : g[i]);
+			if (fabsf(samp_out[i][n] - ref) > 1e-4f) {
+				fprintf(stderr, "%s: channel %d sample %d: %f != %f\n",
+						name, i, n, samp_out[i][n], ref);
+				spa_assert_not_reached();
+			}
+		}
+	}
+}
+
+static void test_process_arch(const char *arch, bool supported,
+		channelmix_func_t copy, channelmix_func_t f32_n_m,
+		channelmix_func_t f32_2_4,
+		channelmix_func_t f32_5p1_2, channelmix_func_t f32_5p1_3p1, channelmix_func_t f32_5p1_4,
+		channelmix_func_t f32_7p1_2, channelmix_func_t f32_7p1_3p1, channelmix_func_t f32_7p1_4)
+{
+	if (!supported) {
+		fprintf(stderr, "skipping %s tests, not supported by the CPU\n", arch);
+		return;
+	}
+	if (copy) {
+		test_process_mix("copy", 2, MASK_STEREO, 2, MASK_STEREO, copy, channelmix_copy_c);
+		test_process_mix("copy", 8, MASK_7_1, 8, MASK_7_1, copy, channelmix_copy_c);
+	}
+	if (f32_2_4)
+		test_process_mix("f32_2_4", 2, MASK_STEREO, 4, MASK_QUAD, f32_2_4, channelmix_f32_2_4_c);
+	if (f32_5p1_2)
+		test_process_mix("f32_5p1_2", 6, MASK_5_1, 2, MASK_STEREO, f32_5p1_2, channelmix_f32_5p1_2_c);
+	if (f32_5p1_3p1)
+		test_process_mix("f32_5p1_3p1", 6, MASK_5_1, 4, MASK_3_1, f32_5p1_3p1, channelmix_f32_5p1_3p1_c);
+	if (f32_5p1_4)
+		test_process_mix("f32_5p1_4", 6, MASK_5_1, 4, MASK_QUAD, f32_5p1_4, channelmix_f32_5p1_4_c);
+	if (f32_7p1_2)
+		test_process_mix("f32_7p1_2", 8, MASK_7_1, 2, MASK_STEREO, f32_7p1_2, channelmix_f32_7p1_2_c);
+	if (f32_7p1_3p1)
+		test_process_mix("f32_7p1_3p1", 8, MASK_7_1, 4, MASK_3_1, f32_7p1_3p1, channelmix_f32_7p1_3p1_c);
+	if (f32_7p1_4)
+		test_process_mix("f32_7p1_4", 8, MASK_7_1, 4, MASK_QUAD, f32_7p1_4, channelmix_f32_7p1_4_c);
+	if (f32_n_m) {
+		test_process_mix("f32_n_m", 8, MASK_7_1, 2, MASK_STEREO, f32_n_m, channelmix_f32_n_m_c);
+		test_process_mix("f32_n_m", 16, MASK_16, 2, MASK_STEREO, f32_n_m, channelmix_f32_n_m_c);
+		test_process_mix("f32_n_m", 16, MASK_16, 6, MASK_5_1, f32_n_m, channelmix_f32_n_m_c);
+		test_process_matrix("f32_n_m", 16, 5, f32_n_m);
+		test_process_matrix("f32_n_m", 3, 16, f32_n_m);
+	}
+}
+
+static void test_process(void)
+{
+	uint32_t i, n;
+
+	for (i = 0; i < N_CHANNELS; i++)
+		for (n = 0; n < N_SAMPLES + 1; n++)
+			samp_in[i][n] = (drand48() - 0.5) * 2.0;
+
+#if defined (HAVE_SSE)
+	test_process_arch("sse", __builtin_cpu_supports("sse"),
+			channelmix_copy_sse, NULL,
+			NULL,
+			NULL, NULL, NULL,
+			NULL, NULL, NULL);
+#endif
+#if defined (HAVE_AVX2)
+	test_process_arch("avx2", __builtin_cpu_supports("avx2"),
+			channelmix_copy_avx2, channelmix_f32_n_m_avx2,
+			channelmix_f32_2_4_avx2,
+			channelmix_f32_5p1_2_avx2, channelmix_f32_5p1_3p1_avx2, channelmix_f32_5p1_4_avx2,
+			channelmix_f32_7p1_2_avx2, channelmix_f32_7p1_3p1_avx2, channelmix_f32_7p1_4_avx2);
+#endif
+#if defined (HAVE_AVX512F)
+	test_process_arch("avx512", __builtin_cpu_supports("avx512f"),
+			channelmix_copy_avx512, channelmix_f32_n_m_avx512,
+			NULL,
+			channelmix_f32_5p1_2_avx512, NULL, NULL,
+			channelmix_f32_7p1_2_avx512, NULL, NULL);
+#endif
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
@@ -129,5 +362,11 @@ int main(int argc, char *argv[])
 	test_5p1_N();
 	test_7p1_N();
 
+	test_process();
+
+	test_process_ramp("ramp copy", 2, MASK_STEREO, 2, MASK_STEREO);
+	test_process_ramp("ramp n_m", 16, MASK_16, 6, MASK_5_1);
+	test_process_ramp("ramp n_m up", 2, MASK_STEREO, 16, MASK_16);
+
 	return 0;
 }
@@ -40,21 +40,55 @@ static uint8_t samp_in[N_SAMPLES * 4];
 static uint8_t samp_out[N_SAMPLES * 4];
 static uint8_t temp_in[N_SAMPLES * N_CHANNELS * 4];
 static uint8_t temp_out[N_SAMPLES * N_CHANNELS * 4];
+static float dither_in[N_SAMPLES] SPA_ALIGNED(32);
 
-static void compare_mem(int i, int j, const void *m1, const void *m2, size_t size)
+static int64_t sample_value(const uint8_t *p, size_t size)
 {
+	int16_t v16;
+	int32_t v32;
+
+	switch (size) {
+	case 1:
+		return p[0];
+	case 2:
+		memcpy(&v16, p, sizeof(v16));
+		return v16;
+	case 3:
+		return ((int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24)) >> 8;
+	default:
+		memcpy(&v32, p, sizeof(v32));
+		return v32;
+	}
+}
+
+/* the samples are equal or differ at most tolerance */
+static void compare_mem(int i, int j, const void *m1, const void *m2, size_t size,
+		size_t sample_size, int64_t tolerance)
+{
+	const uint8_t *s1 = m1, *s2 = m2;
 	int res = memcmp(m1, m2, size);
+	size_t k;
+
+	if (res != 0 && tolerance > 0) {
+		res = 0;
+		for (k = 0; k + sample_size <= size; k += sample_size) {
+			int64_t diff = sample_value(&s1[k], sample_size) -
+				sample_value(&s2[k], sample_size);
+			if (diff < -tolerance || diff > tolerance)
+				res = 1;
+		}
+	}
 	if (res != 0) {
 		fprintf(stderr, "%d %d:\n", i, j);
 		spa_debug_mem(0, m1, size);
 		spa_debug_mem(0, m2, size);
 	}
-//	spa_assert(res == 0);
+	spa_assert(res == 0);
 }
 
-static void run_test(const char *name,
+static void run_test_tolerance(const char *name,
 		const void *in, size_t in_size, const void *out, size_t out_size, size_t n_samples,
-		bool in_packed, bool out_packed, convert_func_t func)
+		bool in_packed, bool out_packed, convert_func_t func, int64_t tolerance)
 {
 	const void *ip[N_CHANNELS];
 	void *tp[N_CHANNELS];
@@ -105,18 +139,26 @@ static void run_test(const char *name,
 		const uint8_t *d = tp[0], *s = samp_out;
 		for (i = 0; i < N_SAMPLES; i++) {
 			for (j = 0; j < N_CHANNELS; j++) {
-				compare_mem(i, j, d, s, out_size);
+				compare_mem(i, j, d, s, out_size, out_size, tolerance);
 				d += out_size;
 			}
 			s += out_size;
 		}
 	} else {
 		for (j = 0; j < N_CHANNELS; j++) {
-			compare_mem(0, j, tp[j], samp_out, N_SAMPLES * out_size);
+			compare_mem(0, j, tp[j], samp_out, N_SAMPLES * out_size, out_size, tolerance);
 		}
 	}
 }
 
+static void run_test(const char *name,
+		const void *in, size_t in_size, const void *out, size_t out_size, size_t n_samples,
+		bool in_packed, bool out_packed, convert_func_t func)
+{
+	run_test_tolerance(name, in, in_size, out, out_size, n_samples,
+			in_packed, out_packed, func, 0);
+}
+
 static void test_f32_u8(void)
 {
 	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
@@ -161,8 +203,9 @@ static void test_f32_s16(void)
 	run_test("test_f32d_s16d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_s16d_c);
 #if defined(HAVE_SSE2)
-	run_test("test_f32d_s16_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
-			false, true, conv_f32d_to_s16_sse2);
+	/* rounds to the nearest even value, the C version truncates */
+	run_test_tolerance("test_f32d_s16_sse2", in, sizeof(in[0]), out, sizeof(out[0]),
+			SPA_N_ELEMENTS(out), false, true, conv_f32d_to_s16_sse2, 1);
 #endif
 }
 
@@ -200,8 +243,9 @@ static void test_f32_s32(void)
 	run_test("test_f32d_s32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_s32d_c);
 #if defined(HAVE_SSE2)
-	run_test("test_f32d_s32_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
-			false, true, conv_f32d_to_s32_sse2);
+	/* converts with 32 bits of precision, the C version with 24 bits */
+	run_test_tolerance("test_f32d_s32_sse2", in, sizeof(in[0]), out, sizeof(out[0]),
+			SPA_N_ELEMENTS(out), false, true, conv_f32d_to_s32_sse2, 0x100);
 #endif
 }
 
@@ -243,6 +287,14 @@ static void test_f32_s24(void)
 			true, false, conv_f32_to_s24d_c);
 	run_test("test_f32d_s24d", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
 			false, false, conv_f32d_to_s24d_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_f32d_s24_ssse3", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_f32d_s24_avx2", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24_avx2);
+#endif
 }
 
 static void test_s24_f32(void)
@@ -278,6 +330,195 @@ static void test_s24_f32(void)
 #endif
 }
 
+static void test_f32_s16s(void)
+{
+	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
+	const uint16_t out[] = { 0, bswap_16(32767), bswap_16(-32767), bswap_16(16383),
+		bswap_16(-16383), bswap_16(32767), bswap_16(-32767) };
+
+	run_test("test_f32d_s16s", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s16s_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_f32d_s16s_ssse3", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s16s_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_f32d_s16s_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s16s_avx2);
+#endif
+}
+
+static void test_s16s_f32(void)
+{
+	const uint16_t in[] = { 0, bswap_16(32767), bswap_16(-32767), bswap_16(16383),
+		bswap_16(-16383), };
+	const float out[] = { 0.0f, 1.0f, -1.0f, 0.4999847412f, -0.4999847412f };
+
+	run_test("test_s16s_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s16s_to_f32d_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_s16s_f32d_ssse3", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s16s_to_f32d_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_s16s_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s16s_to_f32d_avx2);
+#endif
+}
+
+static void test_f32_s32s(void)
+{
+	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
+	const uint32_t out[] = { 0, bswap_32(0x7fffff00), bswap_32(0x80000100),
+		bswap_32(0x3fffff00), bswap_32(0xc0000100), bswap_32(0x7fffff00),
+		bswap_32(0x80000100) };
+
+	run_test("test_f32d_s32s", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s32s_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_f32d_s32s_ssse3", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s32s_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_f32d_s32s_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s32s_avx2);
+#endif
+}
+
+static void test_s32s_f32(void)
+{
+	const uint32_t in[] = { 0, bswap_32(0x7fffff00), bswap_32(0x80000100),
+		bswap_32(0x3fffff00), bswap_32(0xc0000100) };
+	const float out[] = { 0.0f, 1.0f, -1.0f, 0.4999999404f, -0.4999999404f, };
+
+	run_test("test_s32s_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s32s_to_f32d_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_s32s_f32d_ssse3", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s32s_to_f32d_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_s32s_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s32s_to_f32d_avx2);
+#endif
+}
+
+static void test_f32_s24s(void)
+{
+	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	const uint8_t out[] = { 0x00, 0x00, 0x00, 0x7f, 0xff, 0xff, 0x80, 0x00, 0x01,
+		0x3f, 0xff, 0xff, 0xc0, 0x00, 0x01, 0x7f, 0xff, 0xff, 0x80, 0x00, 0x01 };
+#else
+	const uint8_t out[] = { 0x00, 0x00, 0x00, 0xff, 0xff, 0x7f, 0x01, 0x00, 0x80,
+		0xff, 0xff, 0x3f, 0x01, 0x00, 0xc0, 0xff, 0xff, 0x7f, 0x01, 0x00, 0x80 };
+#endif
+
+	run_test("test_f32d_s24s", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24s_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_f32d_s24s_ssse3", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24s_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_f32d_s24s_avx2", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+			false, true, conv_f32d_to_s24s_avx2);
+#endif
+}
+
+static void test_s24s_f32(void)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	const uint8_t in[] = { 0x00, 0x00, 0x00, 0x7f, 0xff, 0xff, 0x80, 0x00, 0x01,
+		0x3f, 0xff, 0xff, 0xc0, 0x00, 0x01,  };
+#else
+	const uint8_t in[] = { 0x00, 0x00, 0x00, 0xff, 0xff, 0x7f, 0x01, 0x00, 0x80,
+		0xff, 0xff, 0x3f, 0x01, 0x00, 0xc0,  };
+#endif
+	const float out[] = { 0.0f, 1.0f, -1.0f, 0.4999999404f, -0.4999999404f, };
+
+	run_test("test_s24s_f32d", in, 3, out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24s_to_f32d_c);
+#if defined(HAVE_SSSE3)
+	run_test("test_s24s_f32d_ssse3", in, 3, out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24s_to_f32d_ssse3);
+#endif
+#if defined(HAVE_AVX2)
+	run_test("test_s24s_f32d_avx2", in, 3, out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24s_to_f32d_avx2);
+#endif
+}
+
+static void run_test_dither(const char *name, uint32_t method, uint32_t cpu_flags,
+		convert_func_t func, int max_error)
+{
+	const float values[] = { 0.0f, 0.5f, -0.25f, 0.00001f, 0.99f };
+	const void *ip[N_CHANNELS];
+	void *op[1];
+	float *in = dither_in;
+	int16_t *out = (int16_t *) temp_out;
+	struct convert conv;
+	uint32_t i, j, k, n_zero;
+	double sum, expected, diff;
+
+	spa_zero(conv);
+	conv.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	conv.dst_fmt = SPA_AUDIO_FORMAT_S16;
+	conv.n_channels = N_CHANNELS;
+	conv.cpu_flags = cpu_flags;
+	conv.dither_method = method;
+	spa_assert(convert_init(&conv) == 0);
+	spa_assert(conv.dither_method == method);
+	conv.process = func;
+
+	fprintf(stderr, "test %s:\n", name);
+
+	for (k = 0; k < SPA_N_ELEMENTS(values); k++) {
+		for (i = 0; i < N_SAMPLES; i++)
+			in[i] = values[k];
+		for (j = 0; j < N_CHANNELS; j++)
+			ip[j] = in;
+		op[0] = out;
+
+		convert_process(&conv, op, ip, N_SAMPLES);
+
+		expected = values[k] * S16_SCALE;
+		sum = 0.0;
+		n_zero = 0;
+		for (i = 0; i < N_SAMPLES * N_CHANNELS; i++) {
+			diff = out[i] - expected;
+			spa_assert(diff >= -max_error && diff <= max_error);
+			sum += out[i];
+			if (out[i] == 0)
+				n_zero++;
+		}
+		/* dither has no DC offset */
+		spa_assert(fabs(sum / (N_SAMPLES * N_CHANNELS) - expected) < 0.1);
+		/* digital silence is not kept */
+		spa_assert(n_zero < N_SAMPLES * N_CHANNELS);
+	}
+}
+
+static void test_f32_s16_dither(void)
+{
+	run_test_dither("test_f32d_s16_dither", DITHER_METHOD_TRIANGULAR, 0,
+			conv_f32d_to_s16_dither_c, 2);
+	run_test_dither("test_f32d_s16_shaped", DITHER_METHOD_SHAPED, 0,
+			conv_f32d_to_s16_shaped_c, 8);
+#if defined(HAVE_SSE2)
+	run_test_dither("test_f32d_s16_dither_sse2", DITHER_METHOD_TRIANGULAR, SPA_CPU_FLAG_SSE2,
+			conv_f32d_to_s16_dither_sse2, 2);
+	run_test_dither("test_f32d_s16_shaped_sse2", DITHER_METHOD_SHAPED, SPA_CPU_FLAG_SSE2,
+			conv_f32d_to_s16_shaped_sse2, 8);
+#endif
+#if defined(HAVE_AVX2)
+	run_test_dither("test_f32d_s16_dither_avx2", DITHER_METHOD_TRIANGULAR, SPA_CPU_FLAG_AVX2,
+			conv_f32d_to_s16_dither_avx2, 2);
+	run_test_dither("test_f32d_s16_shaped_avx2", DITHER_METHOD_SHAPED, SPA_CPU_FLAG_AVX2,
+			conv_f32d_to_s16_shaped_avx2, 8);
+#endif
+}
+
 static void test_f32_s24_32(void)
 {
 	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
@@ -320,6 +561,13 @@ int main(int argc, char *argv[])
 	test_s32_f32();
 	test_f32_s24();
 	test_s24_f32();
+	test_f32_s16s();
+	test_s16s_f32();
+	test_f32_s32s();
+	test_s32s_f32();
+	test_f32_s24s();
+	test_s24s_f32();
+	test_f32_s16_dither();
 	test_f32_s24_32();
 	test_s24_32_f32();
 	return 0;
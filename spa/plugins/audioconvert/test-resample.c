@@ -35,6 +35,7 @@
 SPA_LOG_IMPL(logger);
 
 #include "resample.h"
+#include "resample-native-impl.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -150,12 +151,270 @@ static void test_in_len(void)
 	pull_blocks(&r, 1024);
 }
 
+static void init_native(struct resample *r, uint32_t channels, uint32_t i_rate, uint32_t o_rate)
+{
+	spa_zero(*r);
+	r->log = &logger.log;
+	r->channels = channels;
+	r->i_rate = i_rate;
+	r->o_rate = o_rate;
+	r->quality = RESAMPLE_DEFAULT_QUALITY;
+	spa_assert(resample_native_init(r) == 0);
+}
+
+static void test_shared_filter(void)
+{
+	struct resample r1, r2, r3, r4;
+	struct native_data *d1, *d2, *d3, *d4;
+
+	init_native(&r1, 2, 44100, 48000);
+	init_native(&r2, 1, 88200, 96000);
+	init_native(&r3, 1, 48000, 44100);
+	d1 = r1.data;
+	d2 = r2.data;
+	d3 = r3.data;
+
+	/* same ratio and quality share the filter */
+	spa_assert(d1->filter_bank == d2->filter_bank);
+	spa_assert(d1->filter == d2->filter);
+	spa_assert(d1->filter != d3->filter);
+
+	/* the filter stays around as long as it is used */
+	resample_free(&r1);
+	pull_blocks(&r2, 1024);
+
+	init_native(&r4, 1, 44100, 48000);
+	d4 = r4.data;
+	spa_assert(d4->filter == d2->filter);
+
+	resample_free(&r2);
+	resample_free(&r3);
+	resample_free(&r4);
+}
+
+static void pull_cascade(struct resample *r, uint32_t size)
+{
+	uint32_t i;
+	float in[size * 8 + 1024];
+	float out[size];
+	const void *src[1];
+	void *dst[1];
+	uint32_t in_len, out_len;
+	uint32_t pin_len, pout_len;
+
+	src[0] = in;
+	dst[0] = out;
+
+	for (i = 0; i < 500; i++) {
+		pout_len = out_len = size;
+		pin_len = in_len = resample_in_len(r, out_len);
+		spa_assert(in_len <= size * 8 + 1024);
+
+		resample_process(r, src, &pin_len, dst, &pout_len);
+
+		spa_assert(in_len == pin_len);
+		spa_assert(out_len == pout_len);
+	}
+}
+
+static double sine_rms(struct resample *r, double freq)
+{
+	uint32_t i, j, in_len, out_len, n_out = 0;
+	float in[1024], out[1024];
+	const void *src[1] = { in };
+	void *dst[1] = { out };
+	double sum = 0.0;
+	uint64_t t = 0;
+
+	for (i = 0; i < 200; i++) {
+		for (j = 0; j < 1024; j++, t++)
+			in[j] = sin(2.0 * M_PI * freq * t / r->i_rate);
+
+		in_len = 1024;
+		out_len = 1024;
+		resample_process(r, src, &in_len, dst, &out_len);
+		spa_assert(in_len == 1024);
+
+		/* skip the filter settling */
+		if (i < 20)
+			continue;
+		for (j = 0; j < out_len; j++)
+			sum += out[j] * out[j];
+		n_out += out_len;
+	}
+	spa_assert(n_out > 0);
+	return sqrt(sum / n_out);
+}
+
+static void test_cascade(void)
+{
+	struct resample r;
+	double rms;
+
+	/* large ratios use half-band stages, the delay includes them */
+	init_native(&r, 1, 192000, 48000);
+	spa_assert(resample_delay(&r) > 24);
+	pull_cascade(&r, 1024);
+	resample_free(&r);
+
+	init_native(&r, 1, 384000, 48000);
+	pull_cascade(&r, 256);
+	resample_free(&r);
+
+	init_native(&r, 1, 176400, 44100);
+	pull_cascade(&r, 1024);
+	resample_free(&r);
+
+	/* passband is untouched */
+	init_native(&r, 1, 192000, 48000);
+	rms = sine_rms(&r, 1000.0);
+	fprintf(stderr, "192000->48000 1000Hz rms:%f\n", rms);
+	spa_assert(fabs(rms - M_SQRT1_2) < 0.001);
+	resample_free(&r);
+
+	/* and what would alias is removed */
+	init_native(&r, 1, 192000, 48000);
+	rms = sine_rms(&r, 30000.0);
+	fprintf(stderr, "192000->48000 30000Hz rms:%f\n", rms);
+	spa_assert(rms < 0.001);
+	resample_free(&r);
+
+	init_native(&r, 1, 384000, 44100);
+	rms = sine_rms(&r, 28000.0);
+	fprintf(stderr, "384000->44100 28000Hz rms:%f\n", rms);
+	spa_assert(rms < 0.001);
+	resample_free(&r);
+}
+
+static void compare_arch(uint32_t channels, uint32_t i_rate, uint32_t o_rate,
+		double rate, uint32_t cpu_flags)
+{
+	struct resample r1, r2;
+	uint32_t i, j, c, in_len, out_len, out_len2;
+	float in[channels][1024], out1[channels][1024], out2[channels][1024];
+	const void *src[channels];
+	void *dst1[channels], *dst2[channels];
+
+	for (c = 0; c < channels; c++) {
+		src[c] = in[c];
+		dst1[c] = out1[c];
+		dst2[c] = out2[c];
+	}
+
+	init_native(&r1, channels, i_rate, o_rate);
+	spa_zero(r2);
+	r2.log = &logger.log;
+	r2.channels = channels;
+	r2.i_rate = i_rate;
+	r2.o_rate = o_rate;
+	r2.quality = RESAMPLE_DEFAULT_QUALITY;
+	r2.cpu_flags = cpu_flags;
+	spa_assert(resample_native_init(&r2) == 0);
+	spa_assert(r2.cpu_flags == cpu_flags);
+
+	resample_update_rate(&r1, rate);
+	resample_update_rate(&r2, rate);
+
+	for (i = 0; i < 50; i++) {
+		for (c = 0; c < channels; c++)
+			for (j = 0; j < 1024; j++)
+				in[c][j] = drand48() * 2.0 - 1.0;
+
+		in_len = 1024;
+		out_len = 1024;
+		resample_process(&r1, src, &in_len, dst1, &out_len);
+		in_len = 1024;
+		out_len2 = 1024;
+		resample_process(&r2, src, &in_len, dst2, &out_len2);
+
+		spa_assert(out_len == out_len2);
+		for (c = 0; c < channels; c++)
+			for (j = 0; j < out_len; j++)
+				spa_assert(fabs(out1[c][j] - out2[c][j]) < 1e-5);
+	}
+	resample_free(&r1);
+	resample_free(&r2);
+}
+
+static void test_native_arch(const char *name, uint32_t cpu_flags)
+{
+	uint32_t c;
+
+	fprintf(stderr, "test native %s:\n", name);
+
+	for (c = 1; c <= 6; c++) {
+		compare_arch(c, 44100, 48000, 1.0, cpu_flags);
+		compare_arch(c, 48000, 44100, 1.0, cpu_flags);
+		compare_arch(c, 44100, 48000, 1.001, cpu_flags);
+	}
+}
+
+static void test_cascade_arch(const char *name, uint32_t cpu_flags)
+{
+	struct resample r1, r2;
+	uint32_t i, j, in_len, out_len, out_len2;
+	float in[1024], out1[512], out2[512];
+	const void *src[1] = { in };
+	void *dst1[1] = { out1 }, *dst2[1] = { out2 };
+
+	fprintf(stderr, "test cascade %s:\n", name);
+
+	init_native(&r1, 1, 192000, 44100);
+	spa_zero(r2);
+	r2.log = &logger.log;
+	r2.channels = 1;
+	r2.i_rate = 192000;
+	r2.o_rate = 44100;
+	r2.quality = RESAMPLE_DEFAULT_QUALITY;
+	r2.cpu_flags = cpu_flags;
+	spa_assert(resample_native_init(&r2) == 0);
+	spa_assert(r2.cpu_flags == cpu_flags);
+
+	for (i = 0; i < 50; i++) {
+		for (j = 0; j < 1024; j++)
+			in[j] = drand48() * 2.0 - 1.0;
+
+		in_len = 1024;
+		out_len = 512;
+		resample_process(&r1, src, &in_len, dst1, &out_len);
+		in_len = 1024;
+		out_len2 = 512;
+		resample_process(&r2, src, &in_len, dst2, &out_len2);
+
+		spa_assert(out_len == out_len2);
+		for (j = 0; j < out_len; j++)
+			spa_assert(fabs(out1[j] - out2[j]) < 1e-5);
+	}
+	resample_free(&r1);
+	resample_free(&r2);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
 	test_native();
 	test_in_len();
+	test_shared_filter();
+	test_cascade();
+#if defined (HAVE_SSE)
+	if (__builtin_cpu_supports("sse")) {
+		test_native_arch("sse", SPA_CPU_FLAG_SSE);
+		test_cascade_arch("sse", SPA_CPU_FLAG_SSE);
+	}
+#endif
+#if defined (HAVE_AVX) && defined(HAVE_FMA)
+	if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma")) {
+		test_native_arch("avx", SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3);
+		test_cascade_arch("avx", SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3);
+	}
+#endif
+#if defined (HAVE_AVX512F)
+	if (__builtin_cpu_supports("avx512f")) {
+		test_native_arch("avx512", SPA_CPU_FLAG_AVX512);
+		test_cascade_arch("avx512", SPA_CPU_FLAG_AVX512);
+	}
+#endif
 
 	return 0;
 }
@@ -0,0 +1,190 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+
+#include "volume-ops.c"
+
+#define N_SAMPLES	509
+#define N_CHANNELS	5
+#define RAMP_SAMPLES	300
+
+static float samp_in[N_CHANNELS][N_SAMPLES + 1] SPA_ALIGNED(32);
+static float samp_out[N_CHANNELS][N_SAMPLES + 1] SPA_ALIGNED(32);
+
+static const uint32_t chunk_sizes[] = { 1, 7, 32, 64, 100, N_SAMPLES };
+
+static void init_volume(struct volume *vol, uint32_t cpu_flags, enum spa_ramp_type ramp,
+		const float *gains)
+{
+	spa_zero(*vol);
+	vol->n_channels = N_CHANNELS;
+	vol->cpu_flags = cpu_flags;
+	vol->ramp.type = ramp;
+	vol->ramp.duration = RAMP_SAMPLES;
+	spa_assert(volume_init(vol) == 0);
+	spa_assert(vol->cpu_flags == cpu_flags);
+	volume_set_gains(vol, gains, false);
+	spa_assert(vol->ramp.remaining == 0);
+}
+
+/* the gain of sample n when ramping from g0 to g1 */
+static float ramp_gain(enum spa_ramp_type ramp, float g0, float g1, uint32_t n)
+{
+	if (n >= RAMP_SAMPLES)
+		return g1;
+	if (g0 == g1)
+		return g0;
+	if (ramp == SPA_RAMP_EXPONENTIAL) {
+		g0 = SPA_MAX(g0, SPA_RAMP_FLOOR);
+		g1 = SPA_MAX(g1, SPA_RAMP_FLOOR);
+		return g0 * powf(g1 / g0, (float)n / RAMP_SAMPLES);
+	}
+	return g0 + (g1 - g0) * n / RAMP_SAMPLES;
+}
+
+static void run_test(const char *arch, uint32_t cpu_flags, enum spa_ramp_type ramp,
+		uint32_t chunk, bool in_place, uint32_t offset)
+{
+	static const float g0[N_CHANNELS] = { 1.0f, 0.0f, 0.5f, 2.0f, 0.25f };
+	static const float g1[N_CHANNELS] = { 0.5f, 1.0f, 0.5f, 0.0f, 1.0f };
+	struct volume vol;
+	void *d[N_CHANNELS];
+	const void *s[N_CHANNELS];
+	uint32_t i, n, len;
+
+	init_volume(&vol, cpu_flags, ramp, g0);
+	volume_set_gains(&vol, g1, true);
+	spa_assert(vol.ramp.remaining == (ramp == SPA_RAMP_NONE ? 0 : RAMP_SAMPLES));
+
+	for (i = 0; i < N_CHANNELS; i++)
+		for (n = 0; n < N_SAMPLES + 1; n++)
+			samp_out[i][n] = in_place ? samp_in[i][n] : 0.0f;
+
+	for (n = 0; n < N_SAMPLES; n += len) {
+		len = SPA_MIN(chunk, N_SAMPLES - n);
+		for (i = 0; i < N_CHANNELS; i++) {
+			d[i] = &samp_out[i][n + offset];
+			s[i] = in_place ? d[i] : &samp_in[i][n + offset];
+		}
+		volume_process(&vol, d, s, len);
+	}
+	spa_assert(vol.ramp.remaining == 0);
+
+	for (i = 0; i < N_CHANNELS; i++) {
+		for (n = 0; n < N_SAMPLES; n++) {
+			float g = ramp == SPA_RAMP_NONE ? g1[i] :
+				ramp_gain(ramp, g0[i], g1[i], n);
+			float in = samp_in[i][n + offset], out = samp_out[i][n + offset];
+
+			if (fabsf(out - in * g) > 1e-4f) {
+				fprintf(stderr, "%s ramp:%d chunk:%d: channel %d sample %d: %f != %f\n",
+						arch, ramp, chunk, i, n, out, in * g);
+				spa_assert_not_reached();
+			}
+			/* after the ramp the target gain is exact */
+			if (n >= RAMP_SAMPLES)
+				spa_assert(out == in * g1[i]);
+		}
+	}
+}
+
+static void test_arch(const char *arch, uint32_t cpu_flags, bool supported)
+{
+	uint32_t i;
+
+	if (!supported) {
+		fprintf(stderr, "skipping %s tests, not supported by the CPU\n", arch);
+		return;
+	}
+	for (i = 0; i < SPA_N_ELEMENTS(chunk_sizes); i++) {
+		run_test(arch, cpu_flags, SPA_RAMP_NONE, chunk_sizes[i], false, 0);
+		run_test(arch, cpu_flags, SPA_RAMP_LINEAR, chunk_sizes[i], false, 0);
+		run_test(arch, cpu_flags, SPA_RAMP_LINEAR, chunk_sizes[i], true, 0);
+		run_test(arch, cpu_flags, SPA_RAMP_LINEAR, chunk_sizes[i], false, 1);
+		run_test(arch, cpu_flags, SPA_RAMP_EXPONENTIAL, chunk_sizes[i], false, 0);
+		run_test(arch, cpu_flags, SPA_RAMP_EXPONENTIAL, chunk_sizes[i], true, 1);
+	}
+}
+
+static void test_restart(void)
+{
+	static const float g0[N_CHANNELS] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	static const float g1[N_CHANNELS] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+	struct volume vol;
+	void *d[N_CHANNELS];
+	const void *s[N_CHANNELS];
+	uint32_t i;
+	float mid;
+
+	init_volume(&vol, 0, SPA_RAMP_LINEAR, g0);
+
+	/* the same gains don't start a ramp */
+	volume_set_gains(&vol, g0, true);
+	spa_assert(vol.ramp.remaining == 0);
+
+	for (i = 0; i < N_CHANNELS; i++) {
+		d[i] = samp_out[i];
+		s[i] = samp_in[i];
+	}
+	volume_set_gains(&vol, g1, true);
+	volume_process(&vol, d, s, RAMP_SAMPLES / 2);
+	mid = vol.ramp.gain[0];
+	spa_assert(fabsf(mid - 0.5f) < 1e-5f);
+
+	/* a new target ramps on from the current gain, without a jump */
+	volume_set_gains(&vol, g0, true);
+	spa_assert(vol.ramp.remaining == RAMP_SAMPLES);
+	spa_assert(vol.ramp.gain[0] == mid);
+	volume_process(&vol, d, s, RAMP_SAMPLES);
+	spa_assert(vol.ramp.remaining == 0);
+	spa_assert(vol.ramp.gain[0] == 0.0f);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, n;
+
+	for (i = 0; i < N_CHANNELS; i++)
+		for (n = 0; n < N_SAMPLES + 1; n++)
+			samp_in[i][n] = (drand48() - 0.5) * 2.0;
+
+	test_arch("c", 0, true);
+#if defined (HAVE_SSE)
+	test_arch("sse", SPA_CPU_FLAG_SSE, __builtin_cpu_supports("sse"));
+#endif
+#if defined (HAVE_AVX2)
+	test_arch("avx2", SPA_CPU_FLAG_AVX2, __builtin_cpu_supports("avx2"));
+#endif
+	test_restart();
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#include <immintrin.h>
+
+static void volume_f32_avx2(float *d, const float *s, float gain, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m256 t[4];
+	const __m256 g = _mm256_set1_ps(gain);
+
+	if (gain == 0.0f) {
+		memset(d, 0, n_samples * sizeof(float));
+		return;
+	}
+	if (gain == 1.0f) {
+		if (d != s)
+			spa_memcpy(d, s, n_samples * sizeof(float));
+		return;
+	}
+
+	if (SPA_IS_ALIGNED(d, 32) &&
+	    SPA_IS_ALIGNED(s, 32))
+		unrolled = n_samples & ~31;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 32) {
+		t[0] = _mm256_load_ps(&s[n]);
+		t[1] = _mm256_load_ps(&s[n+8]);
+		t[2] = _mm256_load_ps(&s[n+16]);
+		t[3] = _mm256_load_ps(&s[n+24]);
+		_mm256_store_ps(&d[n], _mm256_mul_ps(t[0], g));
+		_mm256_store_ps(&d[n+8], _mm256_mul_ps(t[1], g));
+		_mm256_store_ps(&d[n+16], _mm256_mul_ps(t[2], g));
+		_mm256_store_ps(&d[n+24], _mm256_mul_ps(t[3], g));
+	}
+	for(; n < n_samples; n++)
+		d[n] = s[n] * gain;
+}
+
+static float volume_f32_linear_avx2(float *d, const float *s, float gain, float step,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m256 t[4], g[4];
+	const __m256 inc = _mm256_set1_ps(step * 32.0f);
+
+	if (SPA_IS_ALIGNED(d, 32) &&
+	    SPA_IS_ALIGNED(s, 32))
+		unrolled = n_samples & ~31;
+	else
+		unrolled = 0;
+
+	g[0] = _mm256_add_ps(_mm256_set1_ps(gain),
+			_mm256_mul_ps(_mm256_set1_ps(step),
+				_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)));
+	g[1] = _mm256_add_ps(g[0], _mm256_set1_ps(step * 8.0f));
+	g[2] = _mm256_add_ps(g[0], _mm256_set1_ps(step * 16.0f));
+	g[3] = _mm256_add_ps(g[0], _mm256_set1_ps(step * 24.0f));
+
+	for (n = 0; n < unrolled; n += 32) {
+		t[0] = _mm256_load_ps(&s[n]);
+		t[1] = _mm256_load_ps(&s[n+8]);
+		t[2] = _mm256_load_ps(&s[n+16]);
+		t[3] = _mm256_load_ps(&s[n+24]);
+		_mm256_store_ps(&d[n], _mm256_mul_ps(t[0], g[0]));
+		_mm256_store_ps(&d[n+8], _mm256_mul_ps(t[1], g[1]));
+		_mm256_store_ps(&d[n+16], _mm256_mul_ps(t[2], g[2]));
+		_mm256_store_ps(&d[n+24], _mm256_mul_ps(t[3], g[3]));
+		g[0] = _mm256_add_ps(g[0], inc);
+		g[1] = _mm256_add_ps(g[1], inc);
+		g[2] = _mm256_add_ps(g[2], inc);
+		g[3] = _mm256_add_ps(g[3], inc);
+	}
+	gain = _mm256_cvtss_f32(g[0]);
+	for(; n < n_samples; n++) {
+		d[n] = s[n] * gain;
+		gain += step;
+	}
+	return gain;
+}
+
+static float volume_f32_exp_avx2(float *d, const float *s, float gain, float step,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m256 t[4], g[4], inc;
+	float p[8], step2 = step * step, step4 = step2 * step2;
+
+	if (SPA_IS_ALIGNED(d, 32) &&
+	    SPA_IS_ALIGNED(s, 32))
+		unrolled = n_samples & ~31;
+	else
+		unrolled = 0;
+
+	p[0] = gain;
+	for (n = 1; n < 8; n++)
+		p[n] = p[n-1] * step;
+	g[0] = _mm256_loadu_ps(p);
+	inc = _mm256_set1_ps(step4 * step4);
+	g[1] = _mm256_mul_ps(g[0], inc);
+	g[2] = _mm256_mul_ps(g[1], inc);
+	g[3] = _mm256_mul_ps(g[2], inc);
+	inc = _mm256_mul_ps(inc, inc);
+	inc = _mm256_mul_ps(inc, inc);
+
+	for (n = 0; n < unrolled; n += 32) {
+		t[0] = _mm256_load_ps(&s[n]);
+		t[1] = _mm256_load_ps(&s[n+8]);
+		t[2] = _mm256_load_ps(&s[n+16]);
+		t[3] = _mm256_load_ps(&s[n+24]);
+		_mm256_store_ps(&d[n], _mm256_mul_ps(t[0], g[0]));
+		_mm256_store_ps(&d[n+8], _mm256_mul_ps(t[1], g[1]));
+		_mm256_store_ps(&d[n+16], _mm256_mul_ps(t[2], g[2]));
+		_mm256_store_ps(&d[n+24], _mm256_mul_ps(t[3], g[3]));
+		g[0] = _mm256_mul_ps(g[0], inc);
+		g[1] = _mm256_mul_ps(g[1], inc);
+		g[2] = _mm256_mul_ps(g[2], inc);
+		g[3] = _mm256_mul_ps(g[3], inc);
+	}
+	gain = _mm256_cvtss_f32(g[0]);
+	for(; n < n_samples; n++) {
+		d[n] = s[n] * gain;
+		gain *= step;
+	}
+	return gain;
+}
+
+void volume_f32d_avx2(struct volume *vol, void *dst[], const void *src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < vol->n_channels; i++)
+		volume_f32_avx2(dst[i], src[i], vol->ramp.gain[i], n_samples);
+}
+
+void volume_f32d_ramp_avx2(struct volume *vol, void *dst[], const void *src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < vol->n_channels; i++) {
+		float *gain = &vol->ramp.gain[i], step = vol->ramp.step[i];
+
+		if (spa_ramp_is_flat(vol->ramp.type, step))
+			volume_f32_avx2(dst[i], src[i], *gain, n_samples);
+		else if (vol->ramp.type == SPA_RAMP_EXPONENTIAL)
+			*gain = volume_f32_exp_avx2(dst[i], src[i], *gain, step, n_samples);
+		else
+			*gain = volume_f32_linear_avx2(dst[i], src[i], *gain, step, n_samples);
+	}
+}
@@ -0,0 +1,97 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+static void volume_f32_c(float *d, const float *s, float gain, uint32_t n_samples)
+{
+	uint32_t n;
+
+	if (gain == 0.0f) {
+		memset(d, 0, n_samples * sizeof(float));
+	}
+	else if (gain == 1.0f) {
+		if (d != s)
+			spa_memcpy(d, s, n_samples * sizeof(float));
+	}
+	else {
+		for (n = 0; n < n_samples; n++)
+			d[n] = s[n] * gain;
+	}
+}
+
+static float volume_f32_linear_c(float *d, const float *s, float gain, float step,
+		uint32_t n_samples)
+{
+	uint32_t n;
+
+	for (n = 0; n < n_samples; n++) {
+		d[n] = s[n] * gain;
+		gain += step;
+	}
+	return gain;
+}
+
+static float volume_f32_exp_c(float *d, const float *s, float gain, float step,
+		uint32_t n_samples)
+{
+	uint32_t n;
+
+	for (n = 0; n < n_samples; n++) {
+		d[n] = s[n] * gain;
+		gain *= step;
+	}
+	return gain;
+}
+
+void volume_f32d_c(struct volume *vol, void *dst[], const void *src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < vol->n_channels; i++)
+		volume_f32_c(dst[i], src[i], vol->ramp.gain[i], n_samples);
+}
+
+void volume_f32d_ramp_c(struct volume *vol, void *dst[], const void *src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < vol->n_channels; i++) {
+		float *gain = &vol->ramp.gain[i], step = vol->ramp.step[i];
+
+		if (spa_ramp_is_flat(vol->ramp.type, step))
+			volume_f32_c(dst[i], src[i], *gain, n_samples);
+		else if (vol->ramp.type == SPA_RAMP_EXPONENTIAL)
+			*gain = volume_f32_exp_c(dst[i], src[i], *gain, step, n_samples);
+		else
+			*gain = volume_f32_linear_c(dst[i], src[i], *gain, step, n_samples);
+	}
+}
@@ -0,0 +1,177 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#include <xmmintrin.h>
+
+static void volume_f32_sse(float *d, const float *s, float gain, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m128 t[4];
+	const __m128 g = _mm_set1_ps(gain);
+
+	if (gain == 0.0f) {
+		memset(d, 0, n_samples * sizeof(float));
+		return;
+	}
+	if (gain == 1.0f) {
+		if (d != s)
+			spa_memcpy(d, s, n_samples * sizeof(float));
+		return;
+	}
+
+	if (SPA_IS_ALIGNED(d, 16) &&
+	    SPA_IS_ALIGNED(s, 16))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 16) {
+		t[0] = _mm_load_ps(&s[n]);
+		t[1] = _mm_load_ps(&s[n+4]);
+		t[2] = _mm_load_ps(&s[n+8]);
+		t[3] = _mm_load_ps(&s[n+12]);
+		_mm_store_ps(&d[n], _mm_mul_ps(t[0], g));
+		_mm_store_ps(&d[n+4], _mm_mul_ps(t[1], g));
+		_mm_store_ps(&d[n+8], _mm_mul_ps(t[2], g));
+		_mm_store_ps(&d[n+12], _mm_mul_ps(t[3], g));
+	}
+	for(; n < n_samples; n++)
+		_mm_store_ss(&d[n], _mm_mul_ss(_mm_load_ss(&s[n]), g));
+}
+
+static float volume_f32_linear_sse(float *d, const float *s, float gain, float step,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m128 t[4], g[4];
+	const __m128 inc = _mm_set1_ps(step * 16.0f);
+
+	if (SPA_IS_ALIGNED(d, 16) &&
+	    SPA_IS_ALIGNED(s, 16))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	g[0] = _mm_setr_ps(gain, gain + step, gain + 2.0f * step, gain + 3.0f * step);
+	g[1] = _mm_add_ps(g[0], _mm_set1_ps(step * 4.0f));
+	g[2] = _mm_add_ps(g[0], _mm_set1_ps(step * 8.0f));
+	g[3] = _mm_add_ps(g[0], _mm_set1_ps(step * 12.0f));
+
+	for (n = 0; n < unrolled; n += 16) {
+		t[0] = _mm_load_ps(&s[n]);
+		t[1] = _mm_load_ps(&s[n+4]);
+		t[2] = _mm_load_ps(&s[n+8]);
+		t[3] = _mm_load_ps(&s[n+12]);
+		_mm_store_ps(&d[n], _mm_mul_ps(t[0], g[0]));
+		_mm_store_ps(&d[n+4], _mm_mul_ps(t[1], g[1]));
+		_mm_store_ps(&d[n+8], _mm_mul_ps(t[2], g[2]));
+		_mm_store_ps(&d[n+12], _mm_mul_ps(t[3], g[3]));
+		g[0] = _mm_add_ps(g[0], inc);
+		g[1] = _mm_add_ps(g[1], inc);
+		g[2] = _mm_add_ps(g[2], inc);
+		g[3] = _mm_add_ps(g[3], inc);
+	}
+	gain = _mm_cvtss_f32(g[0]);
+	for(; n < n_samples; n++) {
+		d[n] = s[n] * gain;
+		gain += step;
+	}
+	return gain;
+}
+
+static float volume_f32_exp_sse(float *d, const float *s, float gain, float step,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m128 t[4], g[4], inc;
+	float step2 = step * step, step4 = step2 * step2;
+
+	if (SPA_IS_ALIGNED(d, 16) &&
+	    SPA_IS_ALIGNED(s, 16))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	g[0] = _mm_setr_ps(gain, gain * step, gain * step2, gain * step2 * step);
+	inc = _mm_set1_ps(step4);
+	g[1] = _mm_mul_ps(g[0], inc);
+	g[2] = _mm_mul_ps(g[1], inc);
+	g[3] = _mm_mul_ps(g[2], inc);
+	inc = _mm_mul_ps(inc, inc);
+	inc = _mm_mul_ps(inc, inc);
+
+	for (n = 0; n < unrolled; n += 16) {
+		t[0] = _mm_load_ps(&s[n]);
+		t[1] = _mm_load_ps(&s[n+4]);
+		t[2] = _mm_load_ps(&s[n+8]);
+		t[3] = _mm_load_ps(&s[n+12]);
+		_mm_store_ps(&d[n], _mm_mul_ps(t[0], g[0]));
+		_mm_store_ps(&d[n+4], _mm_mul_ps(t[1], g[1]));
+		_mm_store_ps(&d[n+8], _mm_mul_ps(t[2], g[2]));
+		_mm_store_ps(&d[n+12], _mm_mul_ps(t[3], g[3]));
+		g[0] = _mm_mul_ps(g[0], inc);
+		g[1] = _mm_mul_ps(g[1], inc);
+		g[2] = _mm_mul_ps(g[2], inc);
+		g[3] = _mm_mul_ps(g[3], inc);
+	}
+	gain = _mm_cvtss_f32(g[0]);
+	for(; n < n_samples; n++) {
+		d[n] = s[n] * gain;
+		gain *= step;
+	}
+	return gain;
+}
+
+void volume_f32d_sse(struct volume *vol, void *dst[], const void *src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < vol->n_channels; i++)
+		volume_f32_sse(dst[i], src[i], vol->ramp.gain[i], n_samples);
+}
+
+void volume_f32d_ramp_sse(struct volume *vol, void *dst[], const void *src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < vol->n_channels; i++) {
+		float *gain = &vol->ramp.gain[i], step = vol->ramp.step[i];
+
+		if (spa_ramp_is_flat(vol->ramp.type, step))
+			volume_f32_sse(dst[i], src[i], *gain, n_samples);
+		else if (vol->ramp.type == SPA_RAMP_EXPONENTIAL)
+			*gain = volume_f32_exp_sse(dst[i], src[i], *gain, step, n_samples);
+		else
+			*gain = volume_f32_linear_sse(dst[i], src[i], *gain, step, n_samples);
+	}
+}
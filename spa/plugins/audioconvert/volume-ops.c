@@ -0,0 +1,126 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <math.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+typedef void (*volume_func_t) (struct volume *vol, void *dst[],
+		const void *src[], uint32_t n_samples);
+
+static const struct volume_info {
+	volume_func_t process;		/* constant gains */
+	volume_func_t ramp;		/* gains moving to the target */
+	uint32_t cpu_flags;
+} volume_table[] =
+{
+#if defined (HAVE_AVX2)
+	{ volume_f32d_avx2, volume_f32d_ramp_avx2, SPA_CPU_FLAG_AVX2 },
+#endif
+#if defined (HAVE_SSE)
+	{ volume_f32d_sse, volume_f32d_ramp_sse, SPA_CPU_FLAG_SSE },
+#endif
+	{ volume_f32d_c, volume_f32d_ramp_c, 0 },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct volume_info *find_volume_info(uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(volume_table); i++) {
+		if (MATCH_CPU_FLAGS(volume_table[i].cpu_flags, cpu_flags))
+			return &volume_table[i];
+	}
+	return NULL;
+}
+
+static void impl_volume_process_ramp(struct volume *vol, void *dst[],
+		const void *src[], uint32_t n_samples)
+{
+	const struct volume_info *info = vol->priv;
+	void *d[SPA_AUDIO_MAX_CHANNELS];
+	const void *s[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i, n = SPA_MIN(n_samples, vol->ramp.remaining);
+
+	info->ramp(vol, dst, src, n);
+
+	if (!spa_ramp_advance(&vol->ramp, vol->n_channels, n))
+		return;
+
+	/* the ramp is done, the rest uses the exact target */
+	vol->process = info->process;
+
+	if (n < n_samples) {
+		for (i = 0; i < vol->n_channels; i++) {
+			d[i] = SPA_MEMBER(dst[i], n * sizeof(float), void);
+			s[i] = SPA_MEMBER(src[i], n * sizeof(float), const void);
+		}
+		info->process(vol, d, s, n_samples - n);
+	}
+}
+
+void volume_set_gains(struct volume *vol, const float *gains, bool ramp)
+{
+	const struct volume_info *info = vol->priv;
+
+	if (!spa_ramp_set_gains(&vol->ramp, vol->n_channels, gains, ramp))
+		return;
+
+	vol->process = vol->ramp.remaining > 0 ?
+		impl_volume_process_ramp : info->process;
+}
+
+static void impl_volume_free(struct volume *vol)
+{
+	vol->process = NULL;
+}
+
+int volume_init(struct volume *vol)
+{
+	const struct volume_info *info;
+
+	if (vol->n_channels == 0 || vol->n_channels > SPA_AUDIO_MAX_CHANNELS)
+		return -EINVAL;
+
+	info = find_volume_info(vol->cpu_flags);
+	if (info == NULL)
+		return -ENOTSUP;
+
+	spa_ramp_reset(&vol->ramp);
+
+	vol->priv = info;
+	vol->cpu_flags = info->cpu_flags;
+	vol->process = info->process;
+	vol->free = impl_volume_free;
+	return 0;
+}
@@ -0,0 +1,79 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef VOLUME_OPS_H
+#define VOLUME_OPS_H
+
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/ramp.h>
+#include <spa/param/audio/raw.h>
+
+#define VOLUME_DEFAULT_RAMP		SPA_RAMP_LINEAR
+#define VOLUME_DEFAULT_RAMP_TIME	10	/* msec */
+
+struct volume {
+	uint32_t n_channels;
+	uint32_t cpu_flags;
+	struct spa_ramp ramp;
+
+	/* dst and src can be the same */
+	void (*process) (struct volume *vol, void *dst[],
+			const void *src[], uint32_t n_samples);
+	void (*free) (struct volume *vol);
+
+	const void *priv;
+};
+
+int volume_init(struct volume *vol);
+
+/* move to new gains, with a ramp when one is configured and @ramp is true */
+void volume_set_gains(struct volume *vol, const float *gains, bool ramp);
+
+#define volume_process(vol,...)		(vol)->process(vol, __VA_ARGS__)
+#define volume_free(vol)		(vol)->free(vol)
+
+#define DEFINE_FUNCTION(name,arch)					\
+void volume_##name##_##arch(struct volume *vol,				\
+		void *dst[], const void *src[], uint32_t n_samples);
+
+DEFINE_FUNCTION(f32d, c);
+DEFINE_FUNCTION(f32d_ramp, c);
+
+#if defined (HAVE_SSE)
+DEFINE_FUNCTION(f32d, sse);
+DEFINE_FUNCTION(f32d_ramp, sse);
+#endif
+#if defined (HAVE_AVX2)
+DEFINE_FUNCTION(f32d, avx2);
+DEFINE_FUNCTION(f32d_ramp, avx2);
+#endif
+
+#undef DEFINE_FUNCTION
+
+#endif /* VOLUME_OPS_H */
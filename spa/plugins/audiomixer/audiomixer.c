@@ -895,6 +895,7 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info = SPA_NODE_INFO_INIT();
 	this->info.max_input_ports = MAX_PORTS;
 	this->info.max_output_ports = 1;
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS;
 	this->info.change_mask |= SPA_NODE_CHANGE_MASK_FLAGS;
 	this->info.flags = SPA_NODE_FLAG_IN_DYNAMIC_PORTS |
 				SPA_NODE_FLAG_RT;
@@ -904,6 +905,8 @@ impl_init(const struct spa_handle_factory *factory,
 	port->valid = true;
 	port->direction = SPA_DIRECTION_OUTPUT;
 	port->id = 0;
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
+			SPA_PORT_CHANGE_MASK_PARAMS;
 	port->info = SPA_PORT_INFO_INIT();
 	port->info.change_mask |= SPA_PORT_CHANGE_MASK_FLAGS;
 	port->info.flags = SPA_PORT_FLAG_NO_REF;
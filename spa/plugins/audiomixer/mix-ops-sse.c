@@ -32,43 +32,51 @@
 
 #include <xmmintrin.h>
 
-static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n_samples)
+static inline void mix_n(float * dst, const void * SPA_RESTRICT src[], uint32_t n_src,
+		bool add, uint32_t n_samples)
 {
-	uint32_t n, unrolled;
-	__m128 in1[4], in2[4];
+	uint32_t n, i, unrolled;
+	__m128 in[4];
+	const float *s;
 
-	if (SPA_LIKELY(SPA_IS_ALIGNED(src, 16) &&
-	    SPA_IS_ALIGNED(dst, 16)))
+	if (SPA_IS_ALIGNED(dst, 16))
 		unrolled = n_samples & ~15;
 	else
 		unrolled = 0;
 
-	for (n = 0; n < unrolled; n += 16) {
-		in1[0] = _mm_load_ps(&dst[n+ 0]);
-		in1[1] = _mm_load_ps(&dst[n+ 4]);
-		in1[2] = _mm_load_ps(&dst[n+ 8]);
-		in1[3] = _mm_load_ps(&dst[n+12]);
+	for (i = 0; i < n_src && unrolled > 0; i++) {
+		if (!SPA_IS_ALIGNED(src[i], 16))
+			unrolled = 0;
+	}
 
-		in2[0] = _mm_load_ps(&src[n+ 0]);
-		in2[1] = _mm_load_ps(&src[n+ 4]);
-		in2[2] = _mm_load_ps(&src[n+ 8]);
-		in2[3] = _mm_load_ps(&src[n+12]);
+	for (n = 0; n < unrolled; n += 16) {
+		s = add ? dst : src[0];
+		in[0] = _mm_load_ps(&s[n+ 0]);
+		in[1] = _mm_load_ps(&s[n+ 4]);
+		in[2] = _mm_load_ps(&s[n+ 8]);
+		in[3] = _mm_load_ps(&s[n+12]);
 
-		in1[0] = _mm_add_ps(in1[0], in2[0]);
-		in1[1] = _mm_add_ps(in1[1], in2[1]);
-		in1[2] = _mm_add_ps(in1[2], in2[2]);
-		in1[3] = _mm_add_ps(in1[3], in2[3]);
+		for (i = add ? 0 : 1; i < n_src; i++) {
+			s = src[i];
+			in[0] = _mm_add_ps(in[0], _mm_load_ps(&s[n+ 0]));
+			in[1] = _mm_add_ps(in[1], _mm_load_ps(&s[n+ 4]));
+			in[2] = _mm_add_ps(in[2], _mm_load_ps(&s[n+ 8]));
+			in[3] = _mm_add_ps(in[3], _mm_load_ps(&s[n+12]));
+		}
 
-		_mm_store_ps(&dst[n+ 0], in1[0]);
-		_mm_store_ps(&dst[n+ 4], in1[1]);
-		_mm_store_ps(&dst[n+ 8], in1[2]);
-		_mm_store_ps(&dst[n+12], in1[3]);
+		_mm_store_ps(&dst[n+ 0], in[0]);
+		_mm_store_ps(&dst[n+ 4], in[1]);
+		_mm_store_ps(&dst[n+ 8], in[2]);
+		_mm_store_ps(&dst[n+12], in[3]);
 	}
 	for (; n < n_samples; n++) {
-		in1[0] = _mm_load_ss(&dst[n]),
-		in2[0] = _mm_load_ss(&src[n]),
-		in1[0] = _mm_add_ss(in1[0], in2[0]);
-		_mm_store_ss(&dst[n], in1[0]);
+		s = add ? dst : src[0];
+		in[0] = _mm_load_ss(&s[n]);
+		for (i = add ? 0 : 1; i < n_src; i++) {
+			s = src[i];
+			in[0] = _mm_add_ss(in[0], _mm_load_ss(&s[n]));
+		}
+		_mm_store_ss(&dst[n], in[0]);
 	}
 }
 
@@ -80,10 +88,13 @@ mix_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 
 	if (n_src == 0)
 		memset(dst, 0, n_samples * sizeof(float));
-	else if (dst != src[0])
-		memcpy(dst, src[0], n_samples * sizeof(float));
-
-	for (i = 1; i < n_src; i++) {
-		mix_2(dst, src[i], n_samples);
+	else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(float));
+	}
+	else {
+		for (i = 0; i < n_src; i += MIX_OPS_MAX_PASS)
+			mix_n(dst, &src[i], SPA_MIN(n_src - i, MIX_OPS_MAX_PASS),
+					i > 0, n_samples);
 	}
 }
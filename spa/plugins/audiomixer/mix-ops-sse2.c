@@ -32,43 +32,51 @@
 
 #include <emmintrin.h>
 
-static inline void mix_2(double * dst, const double * SPA_RESTRICT src, uint32_t n_samples)
+static inline void mix_n(double * dst, const void * SPA_RESTRICT src[], uint32_t n_src,
+		bool add, uint32_t n_samples)
 {
-	uint32_t n, unrolled;
-	__m128d in1[4], in2[4];
+	uint32_t n, i, unrolled;
+	__m128d in[4];
+	const double *s;
 
-	if (SPA_IS_ALIGNED(src, 16) &&
-	    SPA_IS_ALIGNED(dst, 16))
+	if (SPA_IS_ALIGNED(dst, 16))
 		unrolled = n_samples & ~7;
 	else
 		unrolled = 0;
 
-	for (n = 0; n < unrolled; n += 8) {
-		in1[0] = _mm_load_pd(&dst[n+ 0]);
-		in1[1] = _mm_load_pd(&dst[n+ 2]);
-		in1[2] = _mm_load_pd(&dst[n+ 4]);
-		in1[3] = _mm_load_pd(&dst[n+ 6]);
+	for (i = 0; i < n_src && unrolled > 0; i++) {
+		if (!SPA_IS_ALIGNED(src[i], 16))
+			unrolled = 0;
+	}
 
-		in2[0] = _mm_load_pd(&src[n+ 0]);
-		in2[1] = _mm_load_pd(&src[n+ 2]);
-		in2[2] = _mm_load_pd(&src[n+ 4]);
-		in2[3] = _mm_load_pd(&src[n+ 6]);
+	for (n = 0; n < unrolled; n += 8) {
+		s = add ? dst : src[0];
+		in[0] = _mm_load_pd(&s[n+ 0]);
+		in[1] = _mm_load_pd(&s[n+ 2]);
+		in[2] = _mm_load_pd(&s[n+ 4]);
+		in[3] = _mm_load_pd(&s[n+ 6]);
 
-		in1[0] = _mm_add_pd(in1[0], in2[0]);
-		in1[1] = _mm_add_pd(in1[1], in2[1]);
-		in1[2] = _mm_add_pd(in1[2], in2[2]);
-		in1[3] = _mm_add_pd(in1[3], in2[3]);
+		for (i = add ? 0 : 1; i < n_src; i++) {
+			s = src[i];
+			in[0] = _mm_add_pd(in[0], _mm_load_pd(&s[n+ 0]));
+			in[1] = _mm_add_pd(in[1], _mm_load_pd(&s[n+ 2]));
+			in[2] = _mm_add_pd(in[2], _mm_load_pd(&s[n+ 4]));
+			in[3] = _mm_add_pd(in[3], _mm_load_pd(&s[n+ 6]));
+		}
 
-		_mm_store_pd(&dst[n+ 0], in1[0]);
-		_mm_store_pd(&dst[n+ 2], in1[1]);
-		_mm_store_pd(&dst[n+ 4], in1[2]);
-		_mm_store_pd(&dst[n+ 6], in1[3]);
+		_mm_store_pd(&dst[n+ 0], in[0]);
+		_mm_store_pd(&dst[n+ 2], in[1]);
+		_mm_store_pd(&dst[n+ 4], in[2]);
+		_mm_store_pd(&dst[n+ 6], in[3]);
 	}
 	for (; n < n_samples; n++) {
-		in1[0] = _mm_load_sd(&dst[n]),
-		in2[0] = _mm_load_sd(&src[n]),
-		in1[0] = _mm_add_sd(in1[0], in2[0]);
-		_mm_store_sd(&dst[n], in1[0]);
+		s = add ? dst : src[0];
+		in[0] = _mm_load_sd(&s[n]);
+		for (i = add ? 0 : 1; i < n_src; i++) {
+			s = src[i];
+			in[0] = _mm_add_sd(in[0], _mm_load_sd(&s[n]));
+		}
+		_mm_store_sd(&dst[n], in[0]);
 	}
 }
 
@@ -80,10 +88,13 @@ mix_f64_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_REST
 
 	if (n_src == 0)
 		memset(dst, 0, n_samples * sizeof(double));
-	else if (dst != src[0])
-		memcpy(dst, src[0], n_samples * sizeof(double));
-
-	for (i = 1; i < n_src; i++) {
-		mix_2(dst, src[i], n_samples);
+	else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(double));
+	}
+	else {
+		for (i = 0; i < n_src; i += MIX_OPS_MAX_PASS)
+			mix_n(dst, &src[i], SPA_MIN(n_src - i, MIX_OPS_MAX_PASS),
+					i > 0, n_samples);
 	}
 }
@@ -22,8 +22,14 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdbool.h>
+
 #include <spa/utils/defs.h>
 
+/* the SIMD kernels keep the output in registers and add up to this many
+ * sources to it before storing, more sources take more passes */
+#define MIX_OPS_MAX_PASS	8u
+
 struct mix_ops {
 	uint32_t fmt;
 	uint32_t n_channels;
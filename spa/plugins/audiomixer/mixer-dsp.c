@@ -123,6 +123,7 @@ struct impl {
 
 	unsigned int have_format:1;
 	unsigned int started:1;
+	unsigned int zeroed:1;
 
 	float empty[MAX_SAMPLES + MAX_ALIGN];
 };
@@ -730,7 +731,14 @@ static int impl_node_process(void *object)
 		outb->datas[0].chunk->size = n_samples * sizeof(float);
 		outb->datas[0].chunk->stride = sizeof(float);
 
-		mix_ops_process(&this->ops, outb->datas[0].data, datas, n_buffers, n_samples);
+		if (n_buffers > 0) {
+			mix_ops_process(&this->ops, outb->datas[0].data, datas, n_buffers, n_samples);
+			this->zeroed = false;
+		} else if (!this->zeroed) {
+			/* no inputs, clear once and keep sending the silence */
+			mix_ops_clear(&this->ops, outb->datas[0].data, MAX_SAMPLES);
+			this->zeroed = true;
+		}
 	}
 
 	outio->buffer_id = outb->id;
@@ -819,6 +827,7 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info = SPA_NODE_INFO_INIT();
 	this->info.max_input_ports = MAX_PORTS;
 	this->info.max_output_ports = 1;
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS;
 	this->info.change_mask |= SPA_NODE_CHANGE_MASK_FLAGS;
 	this->info.flags = SPA_NODE_FLAG_RT | SPA_NODE_FLAG_IN_DYNAMIC_PORTS;
 
@@ -826,6 +835,8 @@ impl_init(const struct spa_handle_factory *factory,
 	port->valid = true;
 	port->direction = SPA_DIRECTION_OUTPUT;
 	port->id = 0;
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
+			SPA_PORT_CHANGE_MASK_PARAMS;
 	port->info = SPA_PORT_INFO_INIT();
 	port->info.change_mask |= SPA_PORT_CHANGE_MASK_FLAGS;
 	port->info.flags = SPA_PORT_FLAG_DYNAMIC_DATA;
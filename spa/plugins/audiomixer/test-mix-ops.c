@@ -0,0 +1,132 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <spa/debug/mem.h>
+
+#include "mix-ops.h"
+
+typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
+
+#define MAX_SAMPLES	1032
+#define MAX_SRC		19
+
+/* odd sizes and sizes around the unrolled block sizes */
+static const uint32_t sample_sizes[] = { 0, 1, 3, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1023, 1024 };
+/* offsets in samples from an aligned address */
+static const uint32_t offsets[] = { 0, 1, 3 };
+
+static double samp_in[MAX_SRC][MAX_SAMPLES] SPA_ALIGNED(32);
+static double samp_out[MAX_SAMPLES] SPA_ALIGNED(32);
+static double samp_ref[MAX_SAMPLES] SPA_ALIGNED(32);
+
+static void run_test(const char *name, size_t sample_size,
+		mix_func_t ref, mix_func_t func)
+{
+	const void *ip[MAX_SRC];
+	struct mix_ops ops;
+	uint32_t i, j, k, n_src, n_samples, offs;
+	size_t size;
+
+	spa_zero(ops);
+
+	fprintf(stderr, "test %s:\n", name);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		n_samples = sample_sizes[i];
+		size = n_samples * sample_size;
+
+		for (j = 0; j < SPA_N_ELEMENTS(offsets); j++) {
+			offs = offsets[j] * sample_size;
+
+			/* the even sources stay aligned, the odd ones move */
+			for (k = 0; k < MAX_SRC; k++)
+				ip[k] = SPA_MEMBER(samp_in[k], k & 1 ? offs : 0, void);
+
+			for (n_src = 0; n_src <= MAX_SRC; n_src++) {
+				uint8_t *out = SPA_MEMBER(samp_out, offs, uint8_t);
+
+				ref(&ops, samp_ref, ip, n_src, n_samples);
+				memset(samp_out, 0xff, sizeof(samp_out));
+				func(&ops, out, ip, n_src, n_samples);
+
+				if (memcmp(samp_ref, out, size) != 0) {
+					fprintf(stderr, "%d samples, offset %d, %d sources:\n",
+							n_samples, offsets[j], n_src);
+					spa_debug_mem(0, samp_ref, size);
+					spa_debug_mem(0, out, size);
+				}
+				spa_assert(memcmp(samp_ref, out, size) == 0);
+				/* nothing is written past the end */
+				spa_assert(out[size] == 0xff);
+			}
+		}
+	}
+}
+
+static void init_samples(size_t sample_size)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < MAX_SRC; i++) {
+		for (j = 0; j < MAX_SAMPLES; j++) {
+			if (sample_size == sizeof(float))
+				((float*)samp_in[i])[j] = drand48() - 0.5;
+			else
+				samp_in[i][j] = drand48() - 0.5;
+		}
+	}
+}
+
+static void test_f32(void)
+{
+	init_samples(sizeof(float));
+#if defined(HAVE_SSE)
+	run_test("mix_f32_sse", sizeof(float), mix_f32_c, mix_f32_sse);
+#endif
+#if defined(HAVE_AVX)
+	run_test("mix_f32_avx", sizeof(float), mix_f32_c, mix_f32_avx);
+#endif
+}
+
+static void test_f64(void)
+{
+	init_samples(sizeof(double));
+#if defined(HAVE_SSE2)
+	run_test("mix_f64_sse2", sizeof(double), mix_f64_c, mix_f64_sse2);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	srand48(0);
+
+	test_f32();
+	test_f64();
+	return 0;
+}
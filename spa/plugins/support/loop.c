@@ -38,16 +38,51 @@
 #include <spa/utils/names.h>
 #include <spa/utils/result.h>
 #include <spa/utils/type.h>
-#include <spa/utils/ringbuffer.h>
 
 #define NAME "loop"
 
-#define DATAS_SIZE (4096 * 8)
+#define ITEM_SIZE	256
+#define N_ITEMS		128	/* items in the first chunk */
+#define N_ACKS		4	/* acks in the first chunk */
+#define POOL_MAX_CHUNKS	20
 
 /** \cond */
 
+/* the first member of the elements of a pool */
+struct pool_link {
+	uint32_t next;			/* index + 1 of the next free element */
+	uint32_t index;			/* index of this element */
+};
+
+/* lock-free stack of free elements. Any thread can push elements and the
+ * producers pop them. When the stack is empty, a producer adds a chunk
+ * that is twice as big as the previous one, the loop itself never
+ * allocates. Elements are linked with their index and the head has a tag
+ * to avoid ABA, chunks are only freed with the pool. */
+struct pool {
+	size_t elem_size;
+	uint32_t chunk_size;		/* elements in the first chunk */
+	uint64_t head;			/* tag << 32 | index + 1 of the top */
+	uint32_t n_chunks;
+	void *chunks[POOL_MAX_CHUNKS];
+	pthread_mutex_t lock;		/* only taken to add a chunk */
+	void (*init_elem) (void *elem);
+};
+
+struct ack {
+	struct pool_link link;
+	int fd;
+};
+
+/* data of a non-blocking invoke that does not fit in an item. The loop
+ * links them in a list and the producers free them. */
+struct large {
+	struct large *next;
+};
+
 struct invoke_item {
-	size_t item_size;
+	struct pool_link link;
+	struct invoke_item *next;
 	spa_invoke_func_t func;
 	uint32_t seq;
 	void *data;
@@ -55,8 +90,12 @@ struct invoke_item {
 	bool block;
 	void *user_data;
 	int res;
+	struct large *large;		/* large data buffer */
+	struct ack *ack;		/* signaled when a blocking item is done */
 };
 
+#define ITEM_DATA_SIZE	(ITEM_SIZE - sizeof(struct invoke_item))
+
 static int loop_signal_event(void *object, struct spa_source *source);
 
 struct impl {
@@ -76,10 +115,18 @@ struct impl {
 	pthread_t thread;
 
 	struct spa_source *wakeup;
-	int ack_fd;
 
-	struct spa_ringbuffer buffer;
-	uint8_t buffer_data[DATAS_SIZE];
+	/* queued items, any thread can push, the loop pops */
+	struct invoke_item *head;
+	struct invoke_item *tail;
+	struct invoke_item stub;
+	uint32_t idle;				/* the loop needs a wakeup for new items */
+
+	struct pool free_items;
+	struct pool free_acks;
+	struct large *free_large;		/* large data the loop is done with */
+
+	struct spa_loop_stats stats;
 };
 
 struct source_impl {
@@ -121,29 +168,283 @@ static int loop_remove_source(void *object, struct spa_source *source)
 	return spa_system_pollfd_del(impl->system, impl->poll_fd, source->fd);
 }
 
-static void flush_items(struct impl *impl, bool async)
+static inline struct pool_link *pool_elem(struct pool *pool, uint32_t index)
+{
+	uint32_t k = 31 - __builtin_clz(index / pool->chunk_size + 1);
+	uint32_t first = pool->chunk_size * ((1u << k) - 1);
+	void *chunk = __atomic_load_n(&pool->chunks[k], __ATOMIC_ACQUIRE);
+
+	return SPA_MEMBER(chunk, (index - first) * pool->elem_size, struct pool_link);
+}
+
+static void pool_push_chain(struct pool *pool, struct pool_link *first, struct pool_link *last)
+{
+	uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED), next;
+
+	do {
+		__atomic_store_n(&last->next, (uint32_t) head, __ATOMIC_RELAXED);
+		next = (((head >> 32) + 1) << 32) | (first->index + 1);
+	} while (!__atomic_compare_exchange_n(&pool->head, &head, next,
+				true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static inline void pool_push(struct pool *pool, struct pool_link *link)
+{
+	pool_push_chain(pool, link, link);
+}
+
+static struct pool_link *pool_pop(struct pool *pool)
+{
+	uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE), next;
+	struct pool_link *link;
+
+	do {
+		if ((uint32_t) head == 0)
+			return NULL;
+		link = pool_elem(pool, (uint32_t) head - 1);
+		next = (((head >> 32) + 1) << 32) |
+			__atomic_load_n(&link->next, __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&pool->head, &head, next,
+				true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+	return link;
+}
+
+static int pool_grow(struct pool *pool)
+{
+	struct pool_link *link = NULL;
+	uint32_t i, n, first;
+	void *chunk;
+	int res = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	/* another producer added a chunk while we waited */
+	if ((uint32_t) __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE) != 0)
+		goto done;
+
+	if (pool->n_chunks == POOL_MAX_CHUNKS) {
+		res = -ENOSPC;
+		goto done;
+	}
+	n = pool->chunk_size << pool->n_chunks;
+	first = pool->chunk_size * ((1u << pool->n_chunks) - 1);
+	if ((chunk = calloc(n, pool->elem_size)) == NULL) {
+		res = -ENOMEM;
+		goto done;
+	}
+	for (i = 0; i < n; i++) {
+		link = SPA_MEMBER(chunk, i * pool->elem_size, struct pool_link);
+		link->index = first + i;
+		link->next = first + i + 2;
+		if (pool->init_elem)
+			pool->init_elem(link);
+	}
+	__atomic_store_n(&pool->chunks[pool->n_chunks], chunk, __ATOMIC_RELEASE);
+	pool->n_chunks++;
+	pool_push_chain(pool, chunk, link);
+done:
+	pthread_mutex_unlock(&pool->lock);
+	return res;
+}
+
+/* only called from the producers */
+static int pool_get(struct pool *pool, struct pool_link **result)
 {
-	uint32_t index;
 	int res;
 
-	while (spa_ringbuffer_get_read_index(&impl->buffer, &index) > 0) {
-		struct invoke_item *item;
-		bool block;
+	while ((*result = pool_pop(pool)) == NULL) {
+		if ((res = pool_grow(pool)) < 0)
+			return res;
+	}
+	return 0;
+}
+
+static int pool_init(struct pool *pool, size_t elem_size, uint32_t chunk_size,
+		void (*init_elem) (void *elem))
+{
+	spa_zero(*pool);
+	pool->elem_size = elem_size;
+	pool->chunk_size = chunk_size;
+	pool->init_elem = init_elem;
+	pthread_mutex_init(&pool->lock, NULL);
+	return pool_grow(pool);
+}
 
-		item = SPA_MEMBER(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
-		block = item->block;
+static void pool_clear(struct pool *pool, void (*clear_elem) (void *data, void *elem),
+		void *data)
+{
+	uint32_t k, i, n;
 
-		item->res = item->func ? item->func(&impl->loop,
-				true, item->seq, item->data, item->size,
-			   item->user_data) : 0;
+	for (k = 0; k < pool->n_chunks; k++) {
+		n = pool->chunk_size << k;
+		for (i = 0; clear_elem && i < n; i++)
+			clear_elem(data, SPA_MEMBER(pool->chunks[k], i * pool->elem_size, void));
+		free(pool->chunks[k]);
+	}
+	pthread_mutex_destroy(&pool->lock);
+}
 
-		spa_ringbuffer_read_update(&impl->buffer, index + item->item_size);
+static void init_ack(void *elem)
+{
+	struct ack *ack = elem;
+	ack->fd = -1;
+}
 
-		if (block && async) {
-			if ((res = spa_system_eventfd_write(impl->system, impl->ack_fd, 1)) < 0)
-				spa_log_warn(impl->log, NAME " %p: failed to write event fd: %s",
-						impl, spa_strerror(res));
+/* called from the loop, the data is freed by the producers */
+static void release_large(struct impl *impl, struct large *large)
+{
+	struct large *head = __atomic_load_n(&impl->free_large, __ATOMIC_RELAXED);
+
+	do {
+		large->next = head;
+	} while (!__atomic_compare_exchange_n(&impl->free_large, &head, large,
+				true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void free_large(struct impl *impl)
+{
+	struct large *large, *next;
+
+	if (__atomic_load_n(&impl->free_large, __ATOMIC_RELAXED) == NULL)
+		return;
+
+	large = __atomic_exchange_n(&impl->free_large, NULL, __ATOMIC_ACQUIRE);
+	for (; large; large = next) {
+		next = large->next;
+		free(large);
+	}
+}
+
+static void release_item(struct impl *impl, struct invoke_item *item)
+{
+	if (item->large)
+		release_large(impl, item->large);
+	if (item->ack)
+		pool_push(&impl->free_acks, &item->ack->link);
+	item->large = NULL;
+	item->ack = NULL;
+	pool_push(&impl->free_items, &item->link);
+}
+
+/* get a free item and the resources it needs, the pools grow when they
+ * are empty. Blocking invokes use the data of the caller, who waits for
+ * the item to complete. */
+static int get_item(struct impl *impl, size_t size, bool block,
+		struct invoke_item **result)
+{
+	struct invoke_item *item;
+	struct pool_link *link;
+	struct ack *ack;
+	int res;
+
+	if ((res = pool_get(&impl->free_items, &link)) < 0)
+		return res;
+	item = SPA_CONTAINER_OF(link, struct invoke_item, link);
+
+	if (block) {
+		if ((res = pool_get(&impl->free_acks, &link)) < 0)
+			goto error;
+		item->ack = ack = SPA_CONTAINER_OF(link, struct ack, link);
+		if (ack->fd < 0) {
+			/* the first ack is made when the loop is created,
+			 * the others only with concurrent blocking invokes */
+			if ((res = spa_system_eventfd_create(impl->system,
+					SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0)
+				goto error;
+			ack->fd = res;
+		}
+	} else if (size > ITEM_DATA_SIZE) {
+		free_large(impl);
+		if ((item->large = malloc(sizeof(struct large) + size)) == NULL) {
+			res = -ENOMEM;
+			goto error;
 		}
+		item->data = SPA_MEMBER(item->large, sizeof(struct large), void);
+	} else {
+		item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
+	}
+	*result = item;
+	return 0;
+
+error:
+	release_item(impl, item);
+	return res;
+}
+
+static void queue_push(struct impl *impl, struct invoke_item *item)
+{
+	struct invoke_item *prev;
+
+	__atomic_store_n(&item->next, NULL, __ATOMIC_RELAXED);
+	prev = __atomic_exchange_n(&impl->head, item, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&prev->next, item, __ATOMIC_SEQ_CST);
+}
+
+/* only called from the loop. Returns NULL when the queue is empty or
+ * when the next item is still being pushed */
+static struct invoke_item *queue_pop(struct impl *impl)
+{
+	struct invoke_item *tail = impl->tail, *next;
+
+	next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+	if (tail == &impl->stub) {
+		if (next == NULL)
+			return NULL;
+		impl->tail = tail = next;
+		next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+	}
+	if (next != NULL) {
+		impl->tail = next;
+		return tail;
+	}
+	if (tail != __atomic_load_n(&impl->head, __ATOMIC_SEQ_CST))
+		return NULL;
+
+	queue_push(impl, &impl->stub);
+
+	next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+	if (next != NULL) {
+		impl->tail = next;
+		return tail;
+	}
+	return NULL;
+}
+
+static void process_item(struct impl *impl, struct invoke_item *item)
+{
+	int res;
+
+	item->res = item->func ? item->func(&impl->loop,
+			true, item->seq, item->data, item->size,
+		   item->user_data) : 0;
+
+	__atomic_sub_fetch(&impl->stats.queued, 1, __ATOMIC_RELAXED);
+
+	if (item->block) {
+		/* the invoking thread releases the item */
+		if ((res = spa_system_eventfd_write(impl->system, item->ack->fd, 1)) < 0)
+			spa_log_warn(impl->log, NAME " %p: failed to write event fd: %s",
+					impl, spa_strerror(res));
+	} else {
+		release_item(impl, item);
+	}
+}
+
+static void flush_items(struct impl *impl)
+{
+	struct invoke_item *item;
+
+	while (true) {
+		while ((item = queue_pop(impl)) != NULL)
+			process_item(impl, item);
+
+		/* after this, new items will wake us up again. Check for items
+		 * that were pushed before that */
+		__atomic_store_n(&impl->idle, 1, __ATOMIC_SEQ_CST);
+		if ((item = queue_pop(impl)) == NULL)
+			break;
+
+		__atomic_store_n(&impl->idle, 0, __ATOMIC_SEQ_CST);
+		process_item(impl, item);
 	}
 }
 
@@ -159,65 +460,59 @@ loop_invoke(void *object,
 	struct impl *impl = object;
 	bool in_thread = pthread_equal(impl->thread, pthread_self());
 	struct invoke_item *item;
+	uint32_t queued, max_queued;
 	int res;
 
 	if (in_thread) {
-		flush_items(impl, false);
+		flush_items(impl);
 		res = func ? func(&impl->loop, false, seq, data, size, user_data) : 0;
 	} else {
-		int32_t filled;
-		uint32_t avail, idx, offset, l0;
-
-		filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
-		if (filled < 0 || filled > DATAS_SIZE) {
-			spa_log_warn(impl->log, NAME " %p: queue xrun %d", impl, filled);
-			return -EPIPE;
+		if ((res = get_item(impl, size, block, &item)) < 0) {
+			__atomic_add_fetch(&impl->stats.failed, 1, __ATOMIC_RELAXED);
+			spa_log_warn(impl->log, NAME " %p: can't queue item of size %zd: %s",
+					impl, size, spa_strerror(res));
+			return res;
 		}
-		avail = DATAS_SIZE - filled;
-		if (avail < sizeof(struct invoke_item)) {
-			spa_log_warn(impl->log, NAME " %p: queue full %d", impl, avail);
-			return -EPIPE;
-		}
-		offset = idx & (DATAS_SIZE - 1);
-
-		l0 = DATAS_SIZE - offset;
-
-		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
 		item->func = func;
 		item->seq = seq;
 		item->size = size;
 		item->block = block;
 		item->user_data = user_data;
-
-		spa_log_trace(impl->log, NAME " %p: add item %p filled:%d", impl, item, filled);
-
-		if (l0 > sizeof(struct invoke_item) + size) {
-			item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
-			item->item_size = sizeof(struct invoke_item) + size;
-			if (l0 < sizeof(struct invoke_item) + item->item_size)
-				item->item_size = l0;
-		} else {
-			item->data = impl->buffer_data;
-			item->item_size = l0 + size;
+		if (block)
+			item->data = (void *) data;
+		else
+			memcpy(item->data, data, size);
+
+		spa_log_trace(impl->log, NAME " %p: add item %p", impl, item);
+
+		queue_push(impl, item);
+
+		queued = __atomic_add_fetch(&impl->stats.queued, 1, __ATOMIC_RELAXED);
+		max_queued = __atomic_load_n(&impl->stats.max_queued, __ATOMIC_RELAXED);
+		while (queued > max_queued &&
+		    !__atomic_compare_exchange_n(&impl->stats.max_queued, &max_queued, queued,
+				    true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+		__atomic_add_fetch(&impl->stats.invoked, 1, __ATOMIC_RELAXED);
+
+		/* items are batched until the loop has processed the queue */
+		if (__atomic_exchange_n(&impl->idle, 0, __ATOMIC_SEQ_CST)) {
+			__atomic_add_fetch(&impl->stats.wakeups, 1, __ATOMIC_RELAXED);
+			loop_signal_event(impl, impl->wakeup);
 		}
-		memcpy(item->data, data, size);
-
-		spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
-
-		loop_signal_event(impl, impl->wakeup);
 
 		if (block) {
 			uint64_t count = 1;
 
 			spa_loop_control_hook_before(&impl->hooks_list);
 
-			if ((res = spa_system_eventfd_read(impl->system, impl->ack_fd, &count)) < 0)
+			if ((res = spa_system_eventfd_read(impl->system, item->ack->fd, &count)) < 0)
 				spa_log_warn(impl->log, NAME " %p: failed to read event fd: %s",
 						impl, spa_strerror(res));
 
 			spa_loop_control_hook_after(&impl->hooks_list);
 
 			res = item->res;
+			release_item(impl, item);
 		}
 		else {
 			if (seq != SPA_ID_INVALID)
@@ -232,7 +527,7 @@ loop_invoke(void *object,
 static void wakeup_func(void *data, uint64_t count)
 {
 	struct impl *impl = data;
-	flush_items(impl, true);
+	flush_items(impl);
 }
 
 static int loop_get_fd(void *object)
@@ -251,6 +546,18 @@ loop_add_hook(void *object,
 	spa_hook_list_append(&impl->hooks_list, hook, hooks, data);
 }
 
+static int loop_get_stats(void *object, struct spa_loop_stats *stats)
+{
+	struct impl *impl = object;
+
+	stats->queued = __atomic_load_n(&impl->stats.queued, __ATOMIC_RELAXED);
+	stats->max_queued = __atomic_load_n(&impl->stats.max_queued, __ATOMIC_RELAXED);
+	stats->failed = __atomic_load_n(&impl->stats.failed, __ATOMIC_RELAXED);
+	stats->invoked = __atomic_load_n(&impl->stats.invoked, __ATOMIC_RELAXED);
+	stats->wakeups = __atomic_load_n(&impl->stats.wakeups, __ATOMIC_RELAXED);
+	return 0;
+}
+
 static void loop_enter(void *object)
 {
 	struct impl *impl = object;
@@ -675,6 +982,7 @@ static const struct spa_loop_control_methods impl_loop_control = {
 	.enter = loop_enter,
 	.leave = loop_leave,
 	.iterate = loop_iterate,
+	.get_stats = loop_get_stats,
 };
 
 static const struct spa_loop_utils_methods impl_loop_utils = {
@@ -712,6 +1020,15 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 	return 0;
 }
 
+static void clear_ack(void *data, void *elem)
+{
+	struct impl *impl = data;
+	struct ack *ack = elem;
+
+	if (ack->fd >= 0)
+		spa_system_close(impl->system, ack->fd);
+}
+
 static int impl_clear(struct spa_handle *handle)
 {
 	struct impl *impl;
@@ -726,7 +1043,9 @@ static int impl_clear(struct spa_handle *handle)
 
 	process_destroy(impl);
 
-	spa_system_close(impl->system, impl->ack_fd);
+	free_large(impl);
+	pool_clear(&impl->free_items, NULL, NULL);
+	pool_clear(&impl->free_acks, clear_ack, impl);
 	spa_system_close(impl->system, impl->poll_fd);
 
 	return 0;
@@ -747,6 +1066,8 @@ impl_init(const struct spa_handle_factory *factory,
 	  uint32_t n_support)
 {
 	struct impl *impl;
+	struct pool_link *link;
+	struct ack *ack;
 	int res;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
@@ -789,13 +1110,24 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_list_init(&impl->destroy_list);
 	spa_hook_list_init(&impl->hooks_list);
 
-	spa_ringbuffer_init(&impl->buffer);
+	impl->head = impl->tail = &impl->stub;
+	impl->idle = 1;
+	if ((res = pool_init(&impl->free_items, ITEM_SIZE, N_ITEMS, NULL)) < 0) {
+		spa_log_error(impl->log, NAME " %p: can't allocate items: %s",
+				impl, spa_strerror(res));
+		goto error_exit_free_items;
+	}
+	if ((res = pool_init(&impl->free_acks, sizeof(struct ack), N_ACKS, init_ack)) < 0) {
+		spa_log_error(impl->log, NAME " %p: can't allocate acks: %s",
+				impl, spa_strerror(res));
+		goto error_exit_free_pools;
+	}
 
 	impl->wakeup = loop_add_event(impl, wakeup_func, impl);
 	if (impl->wakeup == NULL) {
 		res = -errno;
 		spa_log_error(impl->log, NAME " %p: can't create wakeup event: %m", impl);
-		goto error_exit_free_poll;
+		goto error_exit_free_pools;
 	}
 	if ((res = spa_system_eventfd_create(impl->system,
 			SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
@@ -803,7 +1135,10 @@ impl_init(const struct spa_handle_factory *factory,
 				impl, spa_strerror(res));
 		goto error_exit_free_wakeup;
 	}
-	impl->ack_fd = res;
+	pool_get(&impl->free_acks, &link);
+	ack = SPA_CONTAINER_OF(link, struct ack, link);
+	ack->fd = res;
+	pool_push(&impl->free_acks, link);
 
 	spa_log_debug(impl->log, NAME " %p: initialized", impl);
 
@@ -811,7 +1146,10 @@ impl_init(const struct spa_handle_factory *factory,
 
 error_exit_free_wakeup:
 	loop_destroy_source(impl, impl->wakeup);
-error_exit_free_poll:
+error_exit_free_pools:
+	pool_clear(&impl->free_acks, clear_ack, impl);
+error_exit_free_items:
+	pool_clear(&impl->free_items, NULL, NULL);
 	spa_system_close(impl->system, impl->poll_fd);
 error_exit:
 	return res;
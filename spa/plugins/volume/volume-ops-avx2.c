@@ -0,0 +1,111 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#include <immintrin.h>
+
+/* 16 frames of interleaved samples are a whole number of vectors for any
+ * number of channels, see volume-ops-sse2.c */
+#define BLOCK_FRAMES	16
+
+static void volume_s16_block_avx2(struct volume_ops *ops, int16_t *d, const int16_t *s,
+		uint32_t n_frames, bool ramp)
+{
+	uint32_t n, i, f, c, n_channels = ops->n_channels;
+	uint32_t n_block = n_channels * BLOCK_FRAMES;
+	uint32_t unrolled = n_frames - (n_frames % BLOCK_FRAMES);
+	float gain[SPA_AUDIO_MAX_CHANNELS * BLOCK_FRAMES] SPA_ALIGNED(32);
+	float inc[SPA_AUDIO_MAX_CHANNELS * BLOCK_FRAMES] SPA_ALIGNED(32);
+	bool exponential = ops->ramp.type == SPA_RAMP_EXPONENTIAL;
+	__m256i in, out;
+	__m256 lo, hi;
+
+	for (c = 0; c < n_channels; c++) {
+		float g = ops->ramp.gain[c], step = ops->ramp.step[c], total = exponential ? 1.0f : 0.0f;
+
+		for (f = 0; f < BLOCK_FRAMES; f++) {
+			gain[f * n_channels + c] = g;
+			if (!ramp)
+				continue;
+			g = spa_ramp_next(ops->ramp.type, g, step);
+			total = spa_ramp_next(ops->ramp.type, total, step);
+		}
+		for (f = 0; f < BLOCK_FRAMES; f++)
+			inc[f * n_channels + c] = total;
+	}
+
+	for (n = 0; n < unrolled; n += BLOCK_FRAMES) {
+		for (i = 0; i < n_block; i += 16) {
+			in = _mm256_loadu_si256((__m256i*)&s[i]);
+			lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(in)));
+			hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(in, 1)));
+			lo = _mm256_mul_ps(lo, _mm256_load_ps(&gain[i]));
+			hi = _mm256_mul_ps(hi, _mm256_load_ps(&gain[i+8]));
+			out = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+			out = _mm256_permute4x64_epi64(out, _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256((__m256i*)&d[i], out);
+		}
+		if (ramp) {
+			for (i = 0; i < n_block; i += 8) {
+				if (exponential)
+					_mm256_store_ps(&gain[i], _mm256_mul_ps(_mm256_load_ps(&gain[i]),
+								_mm256_load_ps(&inc[i])));
+				else
+					_mm256_store_ps(&gain[i], _mm256_add_ps(_mm256_load_ps(&gain[i]),
+								_mm256_load_ps(&inc[i])));
+			}
+		}
+		s += n_block;
+		d += n_block;
+	}
+	for (f = 0; n < n_frames; n++, f++) {
+		for (c = 0; c < n_channels; c++)
+			d[c] = volume_s16(s[c], gain[f * n_channels + c]);
+		s += n_channels;
+		d += n_channels;
+	}
+	/* the gain of the next frame */
+	if (ramp) {
+		for (c = 0; c < n_channels; c++)
+			ops->ramp.gain[c] = gain[f * n_channels + c];
+	}
+}
+
+void volume_s16_avx2(struct volume_ops *ops, void *dst, const void *src, uint32_t n_frames)
+{
+	volume_s16_block_avx2(ops, dst, src, n_frames, false);
+}
+
+void volume_s16_ramp_avx2(struct volume_ops *ops, void *dst, const void *src, uint32_t n_frames)
+{
+	volume_s16_block_avx2(ops, dst, src, n_frames, true);
+}
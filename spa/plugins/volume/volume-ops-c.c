@@ -0,0 +1,63 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+void volume_s16_c(struct volume_ops *ops, void *dst, const void *src, uint32_t n_frames)
+{
+	uint32_t n, c, n_channels = ops->n_channels;
+	int16_t *d = dst;
+	const int16_t *s = src;
+
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++)
+			d[c] = volume_s16(s[c], ops->ramp.gain[c]);
+		d += n_channels;
+		s += n_channels;
+	}
+}
+
+void volume_s16_ramp_c(struct volume_ops *ops, void *dst, const void *src, uint32_t n_frames)
+{
+	uint32_t n, c, n_channels = ops->n_channels;
+	int16_t *d = dst;
+	const int16_t *s = src;
+	float *gain = ops->ramp.gain, *step = ops->ramp.step;
+
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++) {
+			d[c] = volume_s16(s[c], gain[c]);
+			gain[c] = spa_ramp_next(ops->ramp.type, gain[c], step[c]);
+		}
+		d += n_channels;
+		s += n_channels;
+	}
+}
@@ -0,0 +1,111 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#include <emmintrin.h>
+
+/* 8 frames of interleaved samples are a whole number of vectors for any
+ * number of channels. The gains of those frames are laid out in the same
+ * order as the samples and, when ramping, advanced by 8 frames per block. */
+#define BLOCK_FRAMES	8
+
+static void volume_s16_block_sse2(struct volume_ops *ops, int16_t *d, const int16_t *s,
+		uint32_t n_frames, bool ramp)
+{
+	uint32_t n, i, f, c, n_channels = ops->n_channels;
+	uint32_t n_block = n_channels * BLOCK_FRAMES;
+	uint32_t unrolled = n_frames - (n_frames % BLOCK_FRAMES);
+	float gain[SPA_AUDIO_MAX_CHANNELS * BLOCK_FRAMES] SPA_ALIGNED(16);
+	float inc[SPA_AUDIO_MAX_CHANNELS * BLOCK_FRAMES] SPA_ALIGNED(16);
+	bool exponential = ops->ramp.type == SPA_RAMP_EXPONENTIAL;
+	__m128i in, out;
+	__m128 lo, hi;
+
+	for (c = 0; c < n_channels; c++) {
+		float g = ops->ramp.gain[c], step = ops->ramp.step[c], total = exponential ? 1.0f : 0.0f;
+
+		for (f = 0; f < BLOCK_FRAMES; f++) {
+			gain[f * n_channels + c] = g;
+			if (!ramp)
+				continue;
+			g = spa_ramp_next(ops->ramp.type, g, step);
+			total = spa_ramp_next(ops->ramp.type, total, step);
+		}
+		for (f = 0; f < BLOCK_FRAMES; f++)
+			inc[f * n_channels + c] = total;
+	}
+
+	for (n = 0; n < unrolled; n += BLOCK_FRAMES) {
+		for (i = 0; i < n_block; i += 8) {
+			in = _mm_loadu_si128((__m128i*)&s[i]);
+			lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16));
+			hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16));
+			lo = _mm_mul_ps(lo, _mm_load_ps(&gain[i]));
+			hi = _mm_mul_ps(hi, _mm_load_ps(&gain[i+4]));
+			out = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+			_mm_storeu_si128((__m128i*)&d[i], out);
+		}
+		if (ramp) {
+			for (i = 0; i < n_block; i += 4) {
+				if (exponential)
+					_mm_store_ps(&gain[i], _mm_mul_ps(_mm_load_ps(&gain[i]),
+								_mm_load_ps(&inc[i])));
+				else
+					_mm_store_ps(&gain[i], _mm_add_ps(_mm_load_ps(&gain[i]),
+								_mm_load_ps(&inc[i])));
+			}
+		}
+		s += n_block;
+		d += n_block;
+	}
+	for (f = 0; n < n_frames; n++, f++) {
+		for (c = 0; c < n_channels; c++)
+			d[c] = volume_s16(s[c], gain[f * n_channels + c]);
+		s += n_channels;
+		d += n_channels;
+	}
+	/* the gain of the next frame */
+	if (ramp) {
+		for (c = 0; c < n_channels; c++)
+			ops->ramp.gain[c] = gain[f * n_channels + c];
+	}
+}
+
+void volume_s16_sse2(struct volume_ops *ops, void *dst, const void *src, uint32_t n_frames)
+{
+	volume_s16_block_sse2(ops, dst, src, n_frames, false);
+}
+
+void volume_s16_ramp_sse2(struct volume_ops *ops, void *dst, const void *src, uint32_t n_frames)
+{
+	volume_s16_block_sse2(ops, dst, src, n_frames, true);
+}
@@ -0,0 +1,160 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <math.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+#include <spa/param/audio/format-utils.h>
+
+#include "volume-ops.h"
+
+typedef void (*volume_func_t) (struct volume_ops *ops, void *dst,
+		const void *src, uint32_t n_frames);
+
+struct volume_info {
+	uint32_t fmt;
+	uint32_t cpu_flags;
+	uint32_t stride;
+	volume_func_t process;		/* constant gains */
+	volume_func_t ramp;		/* gains moving to the target */
+};
+
+static struct volume_info volume_table[] =
+{
+#if defined(HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S16, SPA_CPU_FLAG_AVX2, 2, volume_s16_avx2, volume_s16_ramp_avx2 },
+#endif
+#if defined(HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S16, SPA_CPU_FLAG_SSE2, 2, volume_s16_sse2, volume_s16_ramp_sse2 },
+#endif
+	{ SPA_AUDIO_FORMAT_S16, 0, 2, volume_s16_c, volume_s16_ramp_c },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct volume_info *find_volume_info(uint32_t fmt, uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(volume_table); i++) {
+		if (volume_table[i].fmt == fmt &&
+		    MATCH_CPU_FLAGS(volume_table[i].cpu_flags, cpu_flags))
+			return &volume_table[i];
+	}
+	return NULL;
+}
+
+static void impl_volume_ops_copy(struct volume_ops *ops, void *dst,
+		const void *src, uint32_t n_frames)
+{
+	const struct volume_info *info = ops->priv;
+	if (dst != src)
+		spa_memcpy(dst, src, n_frames * ops->n_channels * info->stride);
+}
+
+static void impl_volume_ops_clear(struct volume_ops *ops, void *dst,
+		const void *src, uint32_t n_frames)
+{
+	const struct volume_info *info = ops->priv;
+	memset(dst, 0, n_frames * ops->n_channels * info->stride);
+}
+
+static volume_func_t constant_func(struct volume_ops *ops)
+{
+	const struct volume_info *info = ops->priv;
+	bool unity = true, zero = true;
+	uint32_t i;
+
+	for (i = 0; i < ops->n_channels; i++) {
+		if (ops->ramp.gain[i] != 1.0f)
+			unity = false;
+		if (ops->ramp.gain[i] != 0.0f)
+			zero = false;
+	}
+	if (unity)
+		return impl_volume_ops_copy;
+	if (zero)
+		return impl_volume_ops_clear;
+	return info->process;
+}
+
+static void impl_volume_ops_ramp(struct volume_ops *ops, void *dst,
+		const void *src, uint32_t n_frames)
+{
+	const struct volume_info *info = ops->priv;
+	uint32_t n = SPA_MIN(n_frames, ops->ramp.remaining);
+	uint32_t offs = n * ops->n_channels * info->stride;
+
+	info->ramp(ops, dst, src, n);
+
+	if (!spa_ramp_advance(&ops->ramp, ops->n_channels, n))
+		return;
+
+	/* the ramp is done, the rest uses the exact target */
+	ops->process = constant_func(ops);
+
+	if (n < n_frames)
+		ops->process(ops, SPA_MEMBER(dst, offs, void),
+				SPA_MEMBER(src, offs, const void), n_frames - n);
+}
+
+void volume_ops_set_gains(struct volume_ops *ops, const float *gains, bool ramp)
+{
+	if (!spa_ramp_set_gains(&ops->ramp, ops->n_channels, gains, ramp))
+		return;
+
+	ops->process = ops->ramp.remaining > 0 ?
+		impl_volume_ops_ramp : constant_func(ops);
+}
+
+static void impl_volume_ops_free(struct volume_ops *ops)
+{
+	spa_zero(*ops);
+}
+
+int volume_ops_init(struct volume_ops *ops)
+{
+	const struct volume_info *info;
+
+	if (ops->n_channels == 0 || ops->n_channels > SPA_AUDIO_MAX_CHANNELS)
+		return -EINVAL;
+
+	info = find_volume_info(ops->fmt, ops->cpu_flags);
+	if (info == NULL)
+		return -ENOTSUP;
+
+	spa_ramp_reset(&ops->ramp);
+
+	ops->priv = info;
+	ops->cpu_flags = info->cpu_flags;
+	ops->process = impl_volume_ops_copy;
+	ops->free = impl_volume_ops_free;
+
+	return 0;
+}
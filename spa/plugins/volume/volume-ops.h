@@ -0,0 +1,79 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/ramp.h>
+#include <spa/param/audio/raw.h>
+
+#define VOLUME_DEFAULT_RAMP		SPA_RAMP_LINEAR
+#define VOLUME_DEFAULT_RAMP_TIME	10	/* msec */
+
+struct volume_ops {
+	uint32_t fmt;
+	uint32_t n_channels;
+	uint32_t cpu_flags;
+	struct spa_ramp ramp;
+
+	/* interleaved samples, dst and src can be the same */
+	void (*process) (struct volume_ops *ops, void *dst, const void *src,
+			uint32_t n_frames);
+	void (*free) (struct volume_ops *ops);
+
+	const void *priv;
+};
+
+int volume_ops_init(struct volume_ops *ops);
+
+/* move to new gains, with a ramp when one is configured and @ramp is true */
+void volume_ops_set_gains(struct volume_ops *ops, const float *gains, bool ramp);
+
+#define volume_ops_process(ops,...)	(ops)->process(ops, __VA_ARGS__)
+#define volume_ops_free(ops)		(ops)->free(ops)
+
+static inline int16_t volume_s16(int16_t s, float gain)
+{
+	return SPA_CLAMP(lrintf(s * gain), INT16_MIN, INT16_MAX);
+}
+
+#define DEFINE_FUNCTION(name,arch) \
+void volume_##name##_##arch(struct volume_ops *ops, void *dst,		\
+		const void *src, uint32_t n_frames)
+
+DEFINE_FUNCTION(s16, c);
+DEFINE_FUNCTION(s16_ramp, c);
+
+#if defined(HAVE_SSE2)
+DEFINE_FUNCTION(s16, sse2);
+DEFINE_FUNCTION(s16_ramp, sse2);
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(s16, avx2);
+DEFINE_FUNCTION(s16_ramp, avx2);
+#endif
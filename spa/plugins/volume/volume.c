@@ -25,9 +25,11 @@
 #include <errno.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
+#include <spa/support/cpu.h>
 #include <spa/utils/list.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
@@ -36,20 +38,29 @@
 #include <spa/param/param.h>
 #include <spa/pod/filter.h>
 
+#include "volume-ops.h"
+
 #define NAME "volume"
 
 #define DEFAULT_VOLUME 1.0
 #define DEFAULT_MUTE false
 
 struct props {
-	double volume;
+	float volume;
 	bool mute;
+	uint32_t n_channel_volumes;
+	float channel_volumes[SPA_AUDIO_MAX_CHANNELS];
 };
 
 static void reset_props(struct props *props)
 {
+	uint32_t i;
+
 	props->volume = DEFAULT_VOLUME;
 	props->mute = DEFAULT_MUTE;
+	props->n_channel_volumes = 0;
+	for (i = 0; i < SPA_AUDIO_MAX_CHANNELS; i++)
+		props->channel_volumes[i] = DEFAULT_VOLUME;
 }
 
 #define MAX_SAMPLES     8192
@@ -89,6 +100,11 @@ struct impl {
 	struct spa_node node;
 
 	struct spa_log *log;
+	struct spa_cpu *cpu;
+
+	uint32_t cpu_flags;
+	enum spa_ramp_type ramp;
+	uint32_t ramp_time;
 
 	uint64_t info_all;
 	struct spa_node_info info;
@@ -99,6 +115,7 @@ struct impl {
 
 	struct spa_audio_info current_format;
 	int bpf;
+	struct volume_ops ops;
 
 	struct port in_ports[1];
 	struct port out_ports[1];
@@ -154,6 +171,13 @@ static int impl_node_enum_params(void *object, int seq,
 				SPA_PROP_INFO_name, SPA_POD_String("Mute"),
 				SPA_PROP_INFO_type, SPA_POD_Bool(p->mute));
 			break;
+		case 2:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_PropInfo, id,
+				SPA_PROP_INFO_id,   SPA_POD_Id(SPA_PROP_channelVolumes),
+				SPA_PROP_INFO_name, SPA_POD_String("Channel Volumes"),
+				SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Float(p->volume, 0.0, 10.0));
+			break;
 		default:
 			return 0;
 		}
@@ -163,8 +187,12 @@ static int impl_node_enum_params(void *object, int seq,
 		case 0:
 			param = spa_pod_builder_add_object(&b,
 				SPA_TYPE_OBJECT_Props, id,
-				SPA_PROP_volume, SPA_POD_Float(p->volume),
-				SPA_PROP_mute,   SPA_POD_Bool(p->mute));
+				SPA_PROP_volume,		SPA_POD_Float(p->volume),
+				SPA_PROP_mute,			SPA_POD_Bool(p->mute),
+				SPA_PROP_channelVolumes,	SPA_POD_Array(sizeof(float),
+									SPA_TYPE_Float,
+									p->n_channel_volumes,
+									p->channel_volumes));
 			break;
 		default:
 			return 0;
@@ -190,6 +218,21 @@ static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
 	return -ENOTSUP;
 }
 
+static void update_volume(struct impl *this, bool ramp)
+{
+	struct props *p = &this->props;
+	float gains[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i;
+
+	for (i = 0; i < this->ops.n_channels; i++) {
+		float vol = p->mute ? 0.0f : p->volume;
+		if (i < p->n_channel_volumes)
+			vol *= p->channel_volumes[i];
+		gains[i] = vol;
+	}
+	volume_ops_set_gains(&this->ops, gains, ramp);
+}
+
 static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 			       const struct spa_pod *param)
 {
@@ -201,15 +244,25 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	case SPA_PARAM_Props:
 	{
 		struct props *p = &this->props;
+		struct spa_pod *channel_volumes = NULL;
+		int n;
 
 		if (param == NULL) {
 			reset_props(p);
-			return 0;
+		} else {
+			spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_Props, NULL,
+				SPA_PROP_volume,		SPA_POD_OPT_Float(&p->volume),
+				SPA_PROP_mute,			SPA_POD_OPT_Bool(&p->mute),
+				SPA_PROP_channelVolumes,	SPA_POD_OPT_Pod(&channel_volumes));
+
+			if (channel_volumes != NULL &&
+			    (n = spa_pod_copy_array(channel_volumes, SPA_TYPE_Float,
+					p->channel_volumes, SPA_AUDIO_MAX_CHANNELS)) > 0)
+				p->n_channel_volumes = n;
 		}
-		spa_pod_parse_object(param,
-			SPA_TYPE_OBJECT_Props, NULL,
-			SPA_PROP_volume, SPA_POD_OPT_Float(&p->volume),
-			SPA_PROP_mute,   SPA_POD_OPT_Bool(&p->mute));
+		if (GET_IN_PORT(this, 0)->have_format)
+			update_volume(this, true);
 		break;
 	}
 	default:
@@ -315,10 +368,7 @@ static int port_enum_formats(void *object,
 			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
 			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-			SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(3,
-							SPA_AUDIO_FORMAT_S16,
-							SPA_AUDIO_FORMAT_S16,
-							SPA_AUDIO_FORMAT_S32),
+			SPA_FORMAT_AUDIO_format,   SPA_POD_Id(SPA_AUDIO_FORMAT_S16),
 			SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(44100, 1, INT32_MAX),
 			SPA_FORMAT_AUDIO_channels, SPA_POD_CHOICE_RANGE_Int(2, 1, INT32_MAX));
 		break;
@@ -465,9 +515,20 @@ static int port_set_format(void *object,
 		if (spa_format_audio_raw_parse(format, &info.info.raw) < 0)
 			return -EINVAL;
 
+		this->ops.fmt = info.info.raw.format;
+		this->ops.n_channels = info.info.raw.channels;
+		this->ops.cpu_flags = this->cpu_flags;
+		this->ops.ramp.type = this->ramp;
+		this->ops.ramp.duration = this->ramp_time * info.info.raw.rate / 1000;
+
+		if ((res = volume_ops_init(&this->ops)) < 0)
+			return res;
+
 		this->bpf = 2 * info.info.raw.channels;
 		this->current_format = info;
 		port->have_format = true;
+
+		update_volume(this, false);
 	}
 
 	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
@@ -623,15 +684,12 @@ static struct buffer *find_free_buffer(struct impl *this, struct port *port)
 
 static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buffer *sbuf)
 {
-	uint32_t i, n_samples, n_bytes;
+	uint32_t n_bytes;
 	struct spa_data *sd, *dd;
 	int16_t *src, *dst;
-	double volume;
 	uint32_t written, towrite, savail, davail;
 	uint32_t sindex, dindex;
 
-	volume = this->props.volume;
-
 	sd = sbuf->datas;
 	dd = dbuf->datas;
 
@@ -654,9 +712,7 @@ static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buf
 		n_bytes = SPA_MIN(towrite, sd[0].maxsize - soffset);
 		n_bytes = SPA_MIN(n_bytes, dd[0].maxsize - doffset);
 
-		n_samples = n_bytes / sizeof(int16_t);
-		for (i = 0; i < n_samples; i++)
-			dst[i] = src[i] * volume;
+		volume_ops_process(&this->ops, dst, src, n_bytes / this->bpf);
 
 		sindex += n_bytes;
 		dindex += n_bytes;
@@ -785,6 +841,10 @@ impl_init(const struct spa_handle_factory *factory,
 	this = (struct impl *) handle;
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 
 	spa_hook_list_init(&this->hooks);
 
@@ -804,6 +864,17 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.n_params = 2;
 	reset_props(&this->props);
 
+	this->ramp = VOLUME_DEFAULT_RAMP;
+	this->ramp_time = VOLUME_DEFAULT_RAMP_TIME;
+	if (info != NULL) {
+		const char *str;
+
+		if ((str = spa_dict_lookup(info, "volume.ramp")) != NULL)
+			this->ramp = spa_ramp_type_from_label(str);
+		if ((str = spa_dict_lookup(info, "volume.ramp-time")) != NULL)
+			this->ramp_time = atoi(str);
+	}
+
 	port = GET_IN_PORT(this, 0);
 	port->direction = SPA_DIRECTION_INPUT;
 	port->id = 0;
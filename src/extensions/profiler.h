@@ -33,20 +33,31 @@ extern "C" {
 
 #define PW_TYPE_INTERFACE_Profiler		PW_TYPE_INFO_INTERFACE_BASE "Profiler"
 
-#define PW_VERSION_PROFILER			3
+#define PW_VERSION_PROFILER			4
 struct pw_profiler;
 
 #define PW_EXTENSION_MODULE_PROFILER		PIPEWIRE_MODULE_PREFIX "module-profiler"
 
 #define PW_PROFILER_EVENT_PROFILE		0
-#define PW_PROFILER_EVENT_NUM			1
+#define PW_PROFILER_EVENT_SHM			1
+#define PW_PROFILER_EVENT_NUM			2
 
 /** \ref pw_profiler events */
 struct pw_profiler_events {
-#define PW_VERSION_PROFILER_EVENTS		0
+#define PW_VERSION_PROFILER_EVENTS		1
 	uint32_t version;
 
 	void (*profile) (void *object, const struct spa_pod *pod);
+	/**
+	 * Notify the shared memory ring of the profiler
+	 *
+	 * Sent after binding to a profiler that was loaded with
+	 * profiler.shm=true. Since version 4.
+	 *
+	 * \param fd the fd of the ring, owned by the receiver
+	 * \param size the size of the ring
+	 */
+	void (*shm) (void *object, int fd, uint32_t size);
 };
 
 #define PW_PROFILER_METHOD_ADD_LISTENER		0
@@ -75,6 +86,55 @@ struct pw_profiler_methods {
 #define pw_profiler_add_listener(c,...)		pw_profiler_method(c,add_listener,0,__VA_ARGS__)
 
 #define PW_KEY_PROFILER_NAME		"profiler.name"
+#define PW_KEY_PROFILER_SHM		"profiler.shm"		/**< write all cycles to a shared
+								  *  memory ring */
+#define PW_KEY_PROFILER_SHM_BLOCKS	"profiler.shm.blocks"	/**< number of blocks in the ring */
+
+#define PW_PROFILER_SHM_MAGIC		0x52505750	/* "PWPR" */
+#define PW_PROFILER_SHM_VERSION		0
+
+/** The shared memory profiler ring starts with this header and is followed
+ * by n_blocks blocks of block_size bytes. The fd of the ring is sent with
+ * the shm event to the clients that bind the profiler.
+ *
+ * The ring is written by the data threads. Each block is written at
+ * position write_seq, which is incremented for each block. A block is
+ * complete when its seq is (position + 1) * 2, readers should check the
+ * seq again after copying the block to detect overwrites. */
+struct pw_profiler_shm_header {
+	uint32_t magic;			/**< PW_PROFILER_SHM_MAGIC */
+	uint32_t version;		/**< PW_PROFILER_SHM_VERSION */
+	uint32_t n_blocks;		/**< number of blocks, power of 2 */
+	uint32_t block_size;		/**< size of one block */
+	uint64_t write_seq;		/**< position of the next block */
+	uint64_t padding[5];
+};
+
+#define PW_PROFILER_SHM_FLAG_DRIVER	(1 << 0)	/**< block of the driver */
+
+/** One node in one cycle of a driver. The driver block is written first,
+ * followed by the blocks of its followers. */
+struct pw_profiler_shm_block {
+	uint64_t seq;			/**< odd while writing */
+	uint64_t clock_position;	/**< clock position of the driver, the same
+					  *  for all blocks of a cycle */
+	uint32_t id;			/**< id of the node */
+	uint32_t driver_id;		/**< id of the driver node */
+	uint32_t flags;			/**< PW_PROFILER_SHM_FLAG_* */
+	int32_t status;			/**< activation status */
+	int64_t prev_signal_time;	/**< previous signal time of the driver */
+	int64_t signal_time;
+	int64_t awake_time;
+	int64_t finish_time;
+	/* clock of the driver, only in driver blocks */
+	int64_t clock_nsec;
+	int64_t clock_duration;
+	int64_t clock_delay;
+	uint32_t clock_rate;		/**< rate denominator */
+	float cpu_load[3];
+	double clock_rate_diff;
+	char name[64];			/**< node name, can be truncated */
+};
 
 #ifdef __cplusplus
 }  /* extern "C" */
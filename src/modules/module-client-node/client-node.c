@@ -792,7 +792,7 @@ do_port_use_buffers(struct impl *impl,
 
 		mb[i].buffer = &b->buffer;
 		mb[i].mem_id = m->id;
-		mb[i].offset = SPA_PTRDIFF(baseptr, SPA_MEMBER(mem->map->ptr, 0, void));
+		mb[i].offset = mem->map->offset + SPA_PTRDIFF(baseptr, mem->map->ptr);
 		mb[i].size = data_size;
 		spa_log_debug(this->log, NAME" %p: buffer %d %d %d %d", this, i, mb[i].mem_id,
 				mb[i].offset, mb[i].size);
@@ -889,7 +889,8 @@ static int impl_node_process(void *object)
 	n->rt.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	n->rt.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
-	if (SPA_UNLIKELY(spa_system_eventfd_write(this->data_system, this->writefd, 1) < 0))
+	if (pw_node_activation_wakeup(n->rt.activation) &&
+	    SPA_UNLIKELY(spa_system_eventfd_write(this->data_system, this->writefd, 1) < 0))
 		spa_log_warn(this->log, NAME" %p: error %m", this);
 
 	return SPA_STATUS_OK;
@@ -1241,7 +1242,7 @@ void pw_impl_client_node_registered(struct pw_impl_client_node *this, struct pw_
 					  impl->other_fds[0],
 					  impl->other_fds[1],
 					  m->id,
-					  0,
+					  node->activation->map->offset,
 					  sizeof(struct pw_node_activation));
 
 	if (impl->bind_node_id) {
@@ -1271,11 +1272,13 @@ static void node_initialized(void *data)
 
 	size = sizeof(struct spa_io_buffers) * MAX_AREAS;
 
-	impl->io_areas = pw_mempool_alloc(impl->context->pool,
+	/* only this client sees the io areas */
+	impl->io_areas = pw_mempool_alloc_owned(impl->context->pool,
 			PW_MEMBLOCK_FLAG_READWRITE |
 			PW_MEMBLOCK_FLAG_MAP |
-			PW_MEMBLOCK_FLAG_SEAL,
-			SPA_DATA_MemFd, size);
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_SLAB,
+			SPA_DATA_MemFd, size, node->client);
 	if (impl->io_areas == NULL)
                 return;
 
@@ -1547,7 +1550,7 @@ static void node_peer_added(void *data, struct pw_impl_node *peer)
 					  peer->info.id,
 					  peer->source.fd,
 					  m->id,
-					  0,
+					  peer->activation->map->offset,
 					  sizeof(struct pw_node_activation));
 }
 
@@ -801,7 +801,8 @@ static int link_signal_func(void *user_data)
 	link->target.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	link->target.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
-	if (write(link->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd))
+	if (pw_node_activation_wakeup(link->target.activation) &&
+	    write(link->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd))
 		pw_log_warn("link %p: write failed %m", link);
 
 	return 0;
@@ -43,10 +43,22 @@
 
 #define NAME "profiler"
 
+#ifndef F_ADD_SEALS
+#define F_LINUX_SPECIFIC_BASE	1024
+#define F_ADD_SEALS		(F_LINUX_SPECIFIC_BASE + 9)
+#define F_SEAL_SEAL		0x0001
+#define F_SEAL_SHRINK		0x0002
+#define F_SEAL_GROW		0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE	0x0010
+#endif
+
 #define MAX_BUFFER		(8 * 1024 * 1024)
 #define MIN_FLUSH		(16 * 1024)
 #define DEFAULT_IDLE		5
 #define DEFAULT_INTERVAL	1
+#define DEFAULT_SHM_BLOCKS	16384
 
 int pw_protocol_native_ext_profiler_init(struct pw_context *context);
 
@@ -55,6 +67,8 @@ int pw_protocol_native_ext_profiler_init(struct pw_context *context);
 
 #define pw_profiler_resource_profile(r,...)        \
         pw_profiler_resource(r,profile,0,__VA_ARGS__)
+#define pw_profiler_resource_shm(r,...)        \
+        pw_profiler_resource(r,shm,1,__VA_ARGS__)
 
 static const struct spa_dict_item module_props[] = {
 	{ PW_KEY_MODULE_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
@@ -68,6 +82,7 @@ struct impl {
 
 	struct spa_hook context_listener;
 	struct spa_hook module_listener;
+	struct spa_hook shm_listener;
 
 	struct pw_global *global;
 
@@ -78,6 +93,12 @@ struct impl {
 	unsigned int flushing:1;
 	unsigned int listening:1;
 
+	struct pw_memblock *shm;
+	struct pw_profiler_shm_header *shm_header;
+	struct pw_profiler_shm_block *shm_blocks;
+	uint32_t shm_mask;
+	uint64_t shm_seq;
+
 	struct spa_ringbuffer buffer;
 	uint8_t data[MAX_BUFFER];
 };
@@ -194,7 +215,8 @@ static void context_start(void *data, struct pw_impl_node *node)
 			SPA_POD_Long(a->signal_time),
 			SPA_POD_Long(a->awake_time),
 			SPA_POD_Long(a->finish_time),
-			SPA_POD_Int(a->status));
+			SPA_POD_Int(a->status),
+			SPA_POD_Int(a->xrun_count));
 
 	spa_list_for_each(t, &node->rt.target_list, link) {
 		struct pw_impl_node *n = t->node;
@@ -212,7 +234,8 @@ static void context_start(void *data, struct pw_impl_node *node)
 			SPA_POD_Long(na->signal_time),
 			SPA_POD_Long(na->awake_time),
 			SPA_POD_Long(na->finish_time),
-			SPA_POD_Int(na->status));
+			SPA_POD_Int(na->status),
+			SPA_POD_Int(na->xrun_count));
 	}
 	spa_pod_builder_pop(&b, &f[0]);
 
@@ -243,19 +266,143 @@ static const struct pw_context_driver_events context_events = {
 	.start = context_start,
 };
 
-static int do_stop(struct spa_loop *loop,
-		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+static struct pw_profiler_shm_block *shm_begin(struct impl *impl,
+		struct pw_impl_node *node, uint64_t position, uint32_t driver_id)
+{
+	struct pw_profiler_shm_block *b;
+	uint64_t pos;
+
+	/* keep our own position and size, only publish the position in
+	 * the header */
+	pos = __atomic_fetch_add(&impl->shm_seq, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&impl->shm_header->write_seq, 1, __ATOMIC_RELAXED);
+	b = &impl->shm_blocks[pos & impl->shm_mask];
+
+	__atomic_store_n(&b->seq, pos * 2 + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	b->clock_position = position;
+	b->id = node->info.id;
+	b->driver_id = driver_id;
+	strncpy(b->name, node->name, sizeof(b->name) - 1);
+	b->name[sizeof(b->name) - 1] = '\0';
+	return b;
+}
+
+static void shm_end(struct impl *impl, struct pw_profiler_shm_block *b)
+{
+	__atomic_store_n(&b->seq, b->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* called from the data threads for each cycle of a driver */
+static void shm_start(void *data, struct pw_impl_node *node)
 {
-	struct impl *impl = user_data;
-	spa_hook_remove(&impl->context_listener);
+	struct impl *impl = data;
+	struct pw_node_activation *a = node->rt.activation;
+	struct spa_io_position *pos = &a->position;
+	struct pw_profiler_shm_block *b;
+	struct pw_node_target *t;
+
+	b = shm_begin(impl, node, pos->clock.position, node->info.id);
+	b->flags = PW_PROFILER_SHM_FLAG_DRIVER;
+	b->status = a->status;
+	b->prev_signal_time = a->prev_signal_time;
+	b->signal_time = a->signal_time;
+	b->awake_time = a->awake_time;
+	b->finish_time = a->finish_time;
+	b->clock_nsec = pos->clock.nsec;
+	b->clock_duration = pos->clock.duration;
+	b->clock_delay = pos->clock.delay;
+	b->clock_rate = pos->clock.rate.denom;
+	b->clock_rate_diff = pos->clock.rate_diff;
+	b->cpu_load[0] = a->cpu_load[0];
+	b->cpu_load[1] = a->cpu_load[1];
+	b->cpu_load[2] = a->cpu_load[2];
+	shm_end(impl, b);
+
+	spa_list_for_each(t, &node->rt.target_list, link) {
+		struct pw_impl_node *n = t->node;
+		struct pw_node_activation *na;
+
+		if (n == NULL || n == node)
+			continue;
+
+		na = n->rt.activation;
+		b = shm_begin(impl, n, pos->clock.position, node->info.id);
+		b->flags = 0;
+		b->status = na->status;
+		b->prev_signal_time = a->signal_time;
+		b->signal_time = na->signal_time;
+		b->awake_time = na->awake_time;
+		b->finish_time = na->finish_time;
+		b->clock_nsec = 0;
+		b->clock_duration = 0;
+		b->clock_delay = 0;
+		b->clock_rate = 0;
+		b->clock_rate_diff = 0.0;
+		spa_zero(b->cpu_load);
+		shm_end(impl, b);
+	}
+}
+
+static const struct pw_context_driver_events shm_events = {
+	PW_VERSION_CONTEXT_DRIVER_EVENTS,
+	.start = shm_start,
+};
+
+static int make_shm(struct impl *impl, uint32_t n_blocks)
+{
+	struct pw_profiler_shm_header *h;
+	size_t size;
+	int res;
+
+	n_blocks = SPA_MAX(n_blocks, 16u);
+	/* round down to a power of 2 */
+	while (n_blocks & (n_blocks - 1))
+		n_blocks &= n_blocks - 1;
+
+	size = sizeof(struct pw_profiler_shm_header) +
+		n_blocks * sizeof(struct pw_profiler_shm_block);
+
+	impl->shm = pw_mempool_alloc(impl->context->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, size);
+	if (impl->shm == NULL)
+		return -errno;
+
+	/* the fd is sent to the clients, after this only our mapping can
+	 * write to the ring */
+	if (fcntl(impl->shm->fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK |
+				F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) < 0) {
+		res = -errno;
+		pw_log_error(NAME" %p: can't seal the ring: %m", impl);
+		pw_memblock_unref(impl->shm);
+		impl->shm = NULL;
+		return res;
+	}
+
+	h = impl->shm_header = impl->shm->map->ptr;
+	impl->shm_blocks = SPA_MEMBER(h, sizeof(*h), struct pw_profiler_shm_block);
+
+	memset(h, 0, size);
+	h->magic = PW_PROFILER_SHM_MAGIC;
+	h->version = PW_PROFILER_SHM_VERSION;
+	h->n_blocks = n_blocks;
+	h->block_size = sizeof(struct pw_profiler_shm_block);
+	impl->shm_mask = n_blocks - 1;
+
+	pw_log_info(NAME" %p: shm ring of %u blocks, %zd bytes", impl, n_blocks, size);
+
+	pw_context_driver_add_listener(impl->context,
+			&impl->shm_listener, &shm_events, impl);
 	return 0;
 }
 
 static void stop_listener(struct impl *impl)
 {
 	if (impl->listening) {
-		pw_loop_invoke(impl->context->data_loop,
-                       do_stop, SPA_ID_INVALID, NULL, 0, true, impl);
+		pw_context_driver_remove_listener(impl->context, &impl->context_listener);
 		impl->listening = false;
 	}
 }
@@ -274,16 +421,6 @@ static const struct pw_resource_events resource_events = {
 	.destroy = resource_destroy,
 };
 
-static int
-do_start(struct spa_loop *loop,
-		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
-{
-	struct impl *impl = user_data;
-	spa_hook_list_append(&impl->context->driver_listener_list,
-			&impl->context_listener,
-			&context_events, impl);
-	return 0;
-}
 static int
 global_bind(void *_data, struct pw_impl_client *client, uint32_t permissions,
             uint32_t version, uint32_t id)
@@ -306,10 +443,13 @@ global_bind(void *_data, struct pw_impl_client *client, uint32_t permissions,
 	pw_resource_add_listener(resource, &data->resource_listener,
 			&resource_events, impl);
 
+	if (impl->shm != NULL && version >= 4)
+		pw_profiler_resource_shm(resource, impl->shm->fd, impl->shm->size);
+
 	if (++impl->busy == 1) {
 		pw_log_info(NAME" %p: starting profiler", impl);
-		pw_loop_invoke(impl->context->data_loop,
-                       do_start, SPA_ID_INVALID, NULL, 0, false, impl);
+		pw_context_driver_add_listener(impl->context,
+				&impl->context_listener, &context_events, impl);
 		impl->listening = true;
 	}
 	return 0;
@@ -323,6 +463,11 @@ static void module_destroy(void *data)
 
 	spa_hook_remove(&impl->module_listener);
 
+	if (impl->shm) {
+		pw_context_driver_remove_listener(impl->context, &impl->shm_listener);
+		pw_memblock_unref(impl->shm);
+	}
+
 	if (impl->properties)
 		pw_properties_free(impl->properties);
 
@@ -341,6 +486,8 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	struct pw_properties *props;
 	struct impl *impl;
 	struct pw_loop *main_loop = pw_context_get_main_loop(context);
+	const char *str;
+	int res;
 
 	impl = calloc(1, sizeof(struct impl));
 	if (impl == NULL)
@@ -360,6 +507,21 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	spa_ringbuffer_init(&impl->buffer);
 
+	if ((str = pw_properties_get(props, PW_KEY_PROFILER_SHM)) != NULL &&
+	    pw_properties_parse_bool(str)) {
+		uint32_t n_blocks = DEFAULT_SHM_BLOCKS;
+
+		if ((str = pw_properties_get(props, PW_KEY_PROFILER_SHM_BLOCKS)) != NULL)
+			n_blocks = pw_properties_parse_int(str);
+
+		if ((res = make_shm(impl, n_blocks)) < 0) {
+			pw_log_error(NAME" %p: can't make shm ring: %s", impl, spa_strerror(res));
+			pw_properties_free(props);
+			free(impl);
+			return res;
+		}
+	}
+
 	impl->global = pw_global_new(context,
 			PW_TYPE_INTERFACE_Profiler,
 			PW_VERSION_PROFILER,
@@ -887,6 +887,18 @@ impl_new_client(struct pw_protocol *protocol,
 		goto error_free;
 	}
 
+	/* optionally pass messages through shared memory */
+	if (props)
+		str = spa_dict_lookup(props, "protocol.native.ring-size");
+	if (str == NULL)
+		str = pw_properties_get(pw_context_get_properties(protocol->context),
+				"protocol.native.ring-size");
+	if (str != NULL &&
+	    (res = pw_protocol_native_connection_set_ring_size(impl->connection,
+				pw_properties_parse_int(str))) < 0)
+		pw_log_warn(NAME" %p: can't make ring: %s", protocol, spa_strerror(res));
+	str = NULL;
+
 	if (props) {
 		str = spa_dict_lookup(props, PW_KEY_REMOTE_INTENTION);
 		if (str == NULL &&
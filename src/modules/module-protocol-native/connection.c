@@ -28,12 +28,17 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <spa/utils/result.h>
+#include <spa/utils/ringbuffer.h>
 #include <spa/pod/builder.h>
 
 #include <pipewire/pipewire.h>
+#include <pipewire/mem.h>
 
 #define spa_debug pw_log_debug
 #include <spa/debug/pod.h>
@@ -41,11 +46,29 @@
 #include "connection.h"
 
 #define MAX_BUFFER_SIZE (1024 * 32)
+#define MAX_READ_SIZE (1024 * 1024)
 #define MAX_FDS 1024
 #define MAX_FDS_MSG 28
+#define MAX_IOV 64
+#define MAX_FREE_CHUNKS 4
 
 #define HDR_SIZE	16
 
+/* messages on the socket with this id tell the peer to read the given
+ * number of bytes from the ring */
+#define RING_ID		SPA_ID_INVALID
+#define RING_HDR_SIZE	4096
+#define MIN_RING_SIZE	(1024u * 16u)
+#define MAX_RING_SIZE	(1024u * 1024u * 16u)
+
+#ifndef F_LINUX_SPECIFIC_BASE
+#define F_LINUX_SPECIFIC_BASE 1024
+#endif
+#ifndef F_GET_SEALS
+#define F_GET_SEALS (F_LINUX_SPECIFIC_BASE + 10)
+#define F_SEAL_SHRINK   0x0002
+#endif
+
 static bool debug_messages = 0;
 
 struct buffer {
@@ -58,9 +81,48 @@ struct buffer {
 	uint32_t seq;
 	size_t offset;
 	size_t fds_offset;
+	size_t read_size;
 	struct pw_protocol_native_message msg;
 };
 
+/* outgoing messages are built in place in a list of chunks, a complete
+ * message is never moved and all chunks are written with one sendmsg */
+struct chunk {
+	struct spa_list link;
+	uint8_t *data;
+	size_t size;		/**< size of the complete messages */
+	size_t maxsize;
+	size_t offset;		/**< bytes already sent */
+};
+
+/* layout of the start of the shared ring memory, the two rings follow
+ * after RING_HDR_SIZE bytes */
+struct ring_header {
+	struct spa_ringbuffer rb[2];	/**< client to server, server to client */
+	uint32_t size;			/**< size of one ring, power of 2 */
+};
+
+/* optional shared memory transport for the message payload. Messages are
+ * copied into the ring and the socket is only used for a small message
+ * with RING_ID that wakes up the peer and carries the fds. The receiver
+ * copies the data out of the ring before parsing it so that the peer can't
+ * change it while it is being parsed. */
+struct ring {
+	struct pw_mempool *pool;	/**< client side, owns the memory */
+	struct pw_memblock *mem;
+	void *map;			/**< server side mapping */
+	size_t map_size;
+
+	struct spa_ringbuffer *in_rb, *out_rb;
+	void *in_data, *out_data;
+	uint32_t size;
+
+	uint32_t pending;		/**< bytes in out ring not announced yet */
+	uint32_t pending_fds;
+	unsigned int offer:1;		/**< offer the ring with the hello message */
+	unsigned int active:1;		/**< send messages through the ring */
+};
+
 struct impl {
 	struct pw_protocol_native_connection this;
 	struct pw_context *context;
@@ -68,6 +130,14 @@ struct impl {
 	struct buffer in, out;
 	struct spa_pod_builder builder;
 
+	struct ring ring;
+	struct buffer rin;		/**< messages read from the ring */
+	struct buffer *cur;		/**< buffer of the last message */
+
+	struct spa_list chunks;
+	struct spa_list free_chunks;
+	uint32_t n_free_chunks;
+
 	uint32_t version;
 	size_t hdr_size;
 };
@@ -85,7 +155,7 @@ struct impl {
 int pw_protocol_native_connection_get_fd(struct pw_protocol_native_connection *conn, uint32_t index)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
-	struct buffer *buf = &impl->in;
+	struct buffer *buf = impl->cur;
 
 	if (index == SPA_ID_INVALID)
 		return -1;
@@ -131,20 +201,22 @@ uint32_t pw_protocol_native_connection_add_fd(struct pw_protocol_native_connecti
 	return index;
 }
 
-static void *connection_ensure_size(struct pw_protocol_native_connection *conn, struct buffer *buf, size_t size)
+static void connection_error(struct pw_protocol_native_connection *conn, int res)
 {
-	int res;
+	spa_hook_list_call(&conn->listener_list,
+			struct pw_protocol_native_connection_events,
+			error, 0, -res);
+	errno = -res;
+}
 
+static void *connection_ensure_size(struct pw_protocol_native_connection *conn, struct buffer *buf, size_t size)
+{
 	if (buf->buffer_size + size > buf->buffer_maxsize) {
 		buf->buffer_maxsize = SPA_ROUND_UP_N(buf->buffer_size + size, MAX_BUFFER_SIZE);
 		buf->buffer_data = realloc(buf->buffer_data, buf->buffer_maxsize);
 		if (buf->buffer_data == NULL) {
-			res = -errno;
 			buf->buffer_maxsize = 0;
-			spa_hook_list_call(&conn->listener_list,
-					struct pw_protocol_native_connection_events,
-					error, 0, -res);
-			errno = -res;
+			connection_error(conn, -errno);
 			return NULL;
 		}
 		pw_log_debug("connection %p: resize buffer to %zd %zd %zd",
@@ -153,6 +225,251 @@ static void *connection_ensure_size(struct pw_protocol_native_connection *conn,
 	return (uint8_t *) buf->buffer_data + buf->buffer_size;
 }
 
+/* move the unread data to the start of the buffer */
+static void compact_buffer(struct buffer *buf)
+{
+	size_t size = buf->buffer_size - buf->offset;
+	uint32_t n_fds = buf->n_fds - buf->fds_offset;
+
+	if (size > 0)
+		memmove(buf->buffer_data, buf->buffer_data + buf->offset, size);
+	buf->buffer_size = size;
+	buf->offset = 0;
+	if (n_fds > 0)
+		memmove(buf->fds, &buf->fds[buf->fds_offset], n_fds * sizeof(int));
+	buf->n_fds = n_fds;
+	buf->fds_offset = 0;
+}
+
+static struct chunk *chunk_new(struct impl *impl, size_t size)
+{
+	struct chunk *c;
+
+	if (size <= MAX_BUFFER_SIZE && !spa_list_is_empty(&impl->free_chunks)) {
+		c = spa_list_first(&impl->free_chunks, struct chunk, link);
+		spa_list_remove(&c->link);
+		impl->n_free_chunks--;
+	} else {
+		if ((c = malloc(sizeof(struct chunk))) == NULL)
+			return NULL;
+		c->maxsize = SPA_ROUND_UP_N(size, MAX_BUFFER_SIZE);
+		if ((c->data = malloc(c->maxsize)) == NULL) {
+			free(c);
+			return NULL;
+		}
+	}
+	c->size = 0;
+	c->offset = 0;
+	spa_list_append(&impl->chunks, &c->link);
+	return c;
+}
+
+static void chunk_free(struct impl *impl, struct chunk *c)
+{
+	spa_list_remove(&c->link);
+	if (c->maxsize == MAX_BUFFER_SIZE && impl->n_free_chunks < MAX_FREE_CHUNKS) {
+		spa_list_append(&impl->free_chunks, &c->link);
+		impl->n_free_chunks++;
+	} else {
+		free(c->data);
+		free(c);
+	}
+}
+
+static void clear_chunks(struct impl *impl)
+{
+	struct chunk *c;
+
+	spa_list_consume(c, &impl->chunks, link)
+		chunk_free(impl, c);
+}
+
+/* get room for size bytes after the queued messages, the first keep bytes
+ * of the message that is being built are copied when it needs to move to
+ * a new chunk */
+static void *connection_ensure_out(struct pw_protocol_native_connection *conn,
+		size_t size, size_t keep)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct chunk *c = NULL, *nc;
+
+	if (!spa_list_is_empty(&impl->chunks)) {
+		c = spa_list_last(&impl->chunks, struct chunk, link);
+		if (c->size + size <= c->maxsize)
+			return c->data + c->size;
+	}
+
+	if ((nc = chunk_new(impl, size)) == NULL) {
+		connection_error(conn, -errno);
+		return NULL;
+	}
+	if (c != NULL) {
+		keep = SPA_MIN(keep, c->maxsize - c->size);
+		memcpy(nc->data, c->data + c->size, keep);
+		if (c->size == 0)
+			chunk_free(impl, c);
+	}
+	pw_log_debug("connection %p: new chunk %p of %zd for %zd", conn,
+			nc, nc->maxsize, size);
+
+	return nc->data;
+}
+
+static void ring_setup(struct ring *ring, void *ptr, uint32_t size, bool server)
+{
+	struct ring_header *hdr = ptr;
+	void *data = SPA_MEMBER(ptr, RING_HDR_SIZE, void);
+
+	ring->size = size;
+	ring->in_rb = &hdr->rb[server ? 0 : 1];
+	ring->out_rb = &hdr->rb[server ? 1 : 0];
+	ring->in_data = SPA_MEMBER(data, server ? 0 : size, void);
+	ring->out_data = SPA_MEMBER(data, server ? size : 0, void);
+}
+
+static void ring_clear(struct ring *ring)
+{
+	if (ring->pool)
+		pw_mempool_destroy(ring->pool);
+	if (ring->map)
+		munmap(ring->map, ring->map_size);
+	spa_zero(*ring);
+}
+
+/* server side, map the ring that the client sent with the hello message */
+static int ring_accept(struct impl *impl, int fd)
+{
+	struct ring *ring = &impl->ring;
+	struct ring_header *hdr;
+	struct stat st;
+	uint32_t size;
+	void *ptr;
+	int seals, res;
+
+	/* the client must not be able to shrink the memory under us */
+	seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || !(seals & F_SEAL_SHRINK)) {
+		res = -EPERM;
+		goto error;
+	}
+	if (fstat(fd, &st) < 0) {
+		res = -errno;
+		goto error;
+	}
+	if (st.st_size <= RING_HDR_SIZE || st.st_size > RING_HDR_SIZE + 2 * MAX_RING_SIZE) {
+		res = -EINVAL;
+		goto error;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		res = -errno;
+		goto error;
+	}
+	hdr = ptr;
+	size = hdr->size;
+	if (size < MIN_RING_SIZE || (size & (size - 1)) != 0 ||
+	    (off_t)(RING_HDR_SIZE + 2 * (size_t)size) != st.st_size) {
+		munmap(ptr, st.st_size);
+		res = -EINVAL;
+		goto error;
+	}
+	ring->map = ptr;
+	ring->map_size = st.st_size;
+	ring_setup(ring, ptr, size, true);
+	ring->active = true;
+	close(fd);
+
+	pw_log_debug("connection %p: using ring of %u bytes", impl, size);
+	return 0;
+
+error:
+	pw_log_warn("connection %p: can't use ring from client: %s", impl,
+			spa_strerror(res));
+	close(fd);
+	return res;
+}
+
+/* copy a complete message into the ring, it is announced to the peer with
+ * the next ring message on the socket */
+static int ring_write(struct impl *impl, const void *data, uint32_t size)
+{
+	struct ring *ring = &impl->ring;
+	uint32_t index;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_write_index(ring->out_rb, &index);
+	if (filled < 0 || (uint32_t)filled > ring->size ||
+	    ring->size - (uint32_t)filled < size)
+		return -ENOSPC;
+
+	spa_ringbuffer_write_data(ring->out_rb, ring->out_data, ring->size,
+			index & (ring->size - 1), data, size);
+	spa_ringbuffer_write_update(ring->out_rb, index + size);
+	ring->pending += size;
+	return 0;
+}
+
+/* queue the message that tells the peer to read the pending ring data */
+static int ring_announce(struct impl *impl)
+{
+	struct ring *ring = &impl->ring;
+	struct chunk *c;
+	uint32_t *p, size = sizeof(uint32_t);
+
+	if ((p = connection_ensure_out(&impl->this, impl->hdr_size + size, 0)) == NULL)
+		return -errno;
+
+	p[0] = RING_ID;
+	p[1] = size;
+	p[2] = 0;
+	p[3] = ring->pending_fds;
+	p[4] = ring->pending;
+
+	c = spa_list_last(&impl->chunks, struct chunk, link);
+	c->size += impl->hdr_size + size;
+
+	ring->pending = 0;
+	ring->pending_fds = 0;
+	return 0;
+}
+
+/* the peer wrote messages in the ring, copy them to the ring buffer
+ * together with the fds that came with the announcement */
+static int ring_read(struct impl *impl, const struct pw_protocol_native_message *msg)
+{
+	struct ring *ring = &impl->ring;
+	struct buffer *buf = &impl->rin;
+	uint32_t size, index;
+	int32_t avail;
+	void *data;
+
+	if (ring->in_rb == NULL || msg->size < sizeof(uint32_t))
+		return -EPROTO;
+
+	size = *(uint32_t*)msg->data;
+	avail = spa_ringbuffer_get_read_index(ring->in_rb, &index);
+	if (avail < 0 || (uint32_t)avail > ring->size || size > (uint32_t)avail)
+		return -EPROTO;
+	if (buf->n_fds + msg->n_fds > MAX_FDS)
+		return -EPROTO;
+
+	if ((data = connection_ensure_size(&impl->this, buf, size)) == NULL)
+		return -errno;
+
+	spa_ringbuffer_read_data(ring->in_rb, ring->in_data, ring->size,
+			index & (ring->size - 1), data, size);
+	spa_ringbuffer_read_update(ring->in_rb, index + size);
+	buf->buffer_size += size;
+
+	memcpy(&buf->fds[buf->n_fds], msg->fds, msg->n_fds * sizeof(int));
+	buf->n_fds += msg->n_fds;
+
+	/* the server accepted our ring, use it from now on */
+	ring->active = true;
+
+	return 0;
+}
+
 static int refill_buffer(struct pw_protocol_native_connection *conn, struct buffer *buf)
 {
 	ssize_t len;
@@ -189,6 +506,12 @@ static int refill_buffer(struct pw_protocol_native_connection *conn, struct buff
 
 	buf->buffer_size += len;
 
+	/* read more at once when the socket keeps filling the buffer */
+	if ((size_t)len == avail && buf->read_size < MAX_READ_SIZE)
+		buf->read_size *= 2;
+	else if ((size_t)len < buf->read_size / 4 && buf->read_size > MAX_BUFFER_SIZE)
+		buf->read_size /= 2;
+
 	/* handle control messages */
 	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
 		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
@@ -247,19 +570,20 @@ struct pw_protocol_native_connection *pw_protocol_native_connection_new(struct p
 	impl->hdr_size = HDR_SIZE;
 	impl->version = 3;
 
-	impl->out.buffer_data = calloc(1, MAX_BUFFER_SIZE);
-	impl->out.buffer_maxsize = MAX_BUFFER_SIZE;
+	spa_list_init(&impl->chunks);
+	spa_list_init(&impl->free_chunks);
+	impl->cur = &impl->in;
+
 	impl->in.buffer_data = calloc(1, MAX_BUFFER_SIZE);
 	impl->in.buffer_maxsize = MAX_BUFFER_SIZE;
+	impl->in.read_size = MAX_BUFFER_SIZE;
 
-	if (impl->out.buffer_data == NULL || impl->in.buffer_data == NULL)
+	if (impl->in.buffer_data == NULL)
 		goto no_mem;
 
 	return this;
 
 no_mem:
-	free(impl->out.buffer_data);
-	free(impl->in.buffer_data);
 	free(impl);
 	return NULL;
 }
@@ -270,6 +594,59 @@ int pw_protocol_native_connection_set_fd(struct pw_protocol_native_connection *c
 	return 0;
 }
 
+/** Offer a shared memory ring to the server
+ *
+ * \param conn the connection
+ * \param size the size of the ring in each direction
+ * \return 0 on success, < 0 on error
+ *
+ * The ring is sent along with the hello message. Messages are sent
+ * through the ring once the server has accepted it, before that and with
+ * older servers the socket is used.
+ *
+ * \memberof pw_protocol_native_connection
+ */
+int pw_protocol_native_connection_set_ring_size(struct pw_protocol_native_connection *conn,
+		uint32_t size)
+{
+	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct ring *ring = &impl->ring;
+	struct ring_header *hdr;
+	int res;
+
+	ring_clear(ring);
+	if (size == 0)
+		return 0;
+
+	size = SPA_CLAMP(size, MIN_RING_SIZE, MAX_RING_SIZE);
+	while (size & (size - 1))
+		size += size & -size;
+
+	if ((ring->pool = pw_mempool_new(NULL)) == NULL)
+		return -errno;
+
+	ring->mem = pw_mempool_alloc(ring->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, RING_HDR_SIZE + 2 * (size_t)size);
+	if (ring->mem == NULL) {
+		res = -errno;
+		ring_clear(ring);
+		return res;
+	}
+
+	hdr = ring->mem->map->ptr;
+	spa_ringbuffer_init(&hdr->rb[0]);
+	spa_ringbuffer_init(&hdr->rb[1]);
+	hdr->size = size;
+	ring_setup(ring, hdr, size, false);
+	ring->offer = true;
+
+	pw_log_debug("connection %p: offer ring of %u bytes", conn, size);
+	return 0;
+}
+
 /** Destroy a connection
  *
  * \param conn the connection to destroy
@@ -279,13 +656,21 @@ int pw_protocol_native_connection_set_fd(struct pw_protocol_native_connection *c
 void pw_protocol_native_connection_destroy(struct pw_protocol_native_connection *conn)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
+	struct chunk *c;
 
 	pw_log_debug("connection %p: destroy", conn);
 
 	spa_hook_list_call(&conn->listener_list, struct pw_protocol_native_connection_events, destroy, 0);
 
-	free(impl->out.buffer_data);
+	clear_chunks(impl);
+	spa_list_consume(c, &impl->free_chunks, link) {
+		spa_list_remove(&c->link);
+		free(c->data);
+		free(c);
+	}
+	ring_clear(&impl->ring);
 	free(impl->in.buffer_data);
+	free(impl->rin.buffer_data);
 	free(impl);
 }
 
@@ -373,17 +758,41 @@ pw_protocol_native_connection_get_next(struct pw_protocol_native_connection *con
 	buf = &impl->in;
 
 	while (1) {
+		/* messages from the ring come before the rest of the socket data */
+		if (impl->rin.buffer_size > 0) {
+			if (prepare_packet(conn, &impl->rin) != 0)
+				return -EPROTO;
+			impl->cur = &impl->rin;
+			*msg = &impl->rin.msg;
+			return 1;
+		}
+
 		len = prepare_packet(conn, buf);
 		if (len < 0)
 			return len;
-		if (len == 0)
+		if (len == 0) {
+			if (buf->msg.id == RING_ID) {
+				if ((res = ring_read(impl, &buf->msg)) < 0)
+					return res;
+				continue;
+			}
+			if (buf->msg.id == 0 && buf->msg.opcode == 1 &&
+			    buf->msg.n_fds > 0 && impl->version >= 3 &&
+			    impl->ring.in_rb == NULL && !impl->ring.offer) {
+				/* the last fd of the hello message is the ring */
+				ring_accept(impl, buf->msg.fds[--buf->msg.n_fds]);
+			}
 			break;
+		}
 
-		if (connection_ensure_size(conn, buf, len) == NULL)
+		if (buf->offset > 0)
+			compact_buffer(buf);
+		if (connection_ensure_size(conn, buf, SPA_MAX((size_t)len, buf->read_size)) == NULL)
 			return -errno;
 		if ((res = refill_buffer(conn, buf)) < 0)
 			return res;
 	}
+	impl->cur = buf;
 	*msg = &buf->msg;
 	return 1;
 }
@@ -392,9 +801,9 @@ static inline void *begin_write(struct pw_protocol_native_connection *conn, uint
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
 	uint32_t *p;
-	struct buffer *buf = &impl->out;
 	/* header and size for payload */
-	if ((p = connection_ensure_size(conn, buf, impl->hdr_size + size)) == NULL)
+	if ((p = connection_ensure_out(conn, impl->hdr_size + size,
+				impl->hdr_size + impl->builder.state.offset)) == NULL)
 		return NULL;
 
 	return SPA_MEMBER(p, impl->hdr_size, void);
@@ -449,9 +858,19 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
 	uint32_t *p, size = builder->state.offset;
 	struct buffer *buf = &impl->out;
+	struct ring *ring = &impl->ring;
+	struct chunk *c;
+	void *tmp;
 	int res;
 
-	if ((p = connection_ensure_size(conn, buf, impl->hdr_size + size)) == NULL)
+	/* send the ring fd along with the hello message */
+	if (ring->offer && buf->msg.id == 0 && buf->msg.opcode == 1) {
+		pw_protocol_native_connection_add_fd(conn, ring->mem->fd);
+		ring->offer = false;
+	}
+
+	if ((p = connection_ensure_out(conn, impl->hdr_size + size,
+				impl->hdr_size + size)) == NULL)
 		return -errno;
 
 	p[0] = buf->msg.id;
@@ -461,7 +880,31 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 		p[3] = buf->msg.n_fds;
 	}
 
-	buf->buffer_size += impl->hdr_size + size;
+	if (ring->active) {
+		if (ring_write(impl, p, impl->hdr_size + size) == 0) {
+			ring->pending_fds += buf->msg.n_fds;
+			goto done;
+		}
+		/* no room in the ring, announce what is in it before this
+		 * message goes over the socket */
+		if (ring->pending > 0) {
+			if ((tmp = malloc(impl->hdr_size + size)) == NULL)
+				return -errno;
+			memcpy(tmp, p, impl->hdr_size + size);
+			res = ring_announce(impl);
+			if (res == 0 &&
+			    (p = connection_ensure_out(conn, impl->hdr_size + size, 0)) == NULL)
+				res = -errno;
+			if (res == 0)
+				memcpy(p, tmp, impl->hdr_size + size);
+			free(tmp);
+			if (res < 0)
+				return res;
+		}
+	}
+	c = spa_list_last(&impl->chunks, struct chunk, link);
+	c->size += impl->hdr_size + size;
+done:
 	if (impl->version >= 3)
 		buf->n_fds += buf->msg.n_fds;
 	else
@@ -494,38 +937,50 @@ pw_protocol_native_connection_end(struct pw_protocol_native_connection *conn,
 int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *conn)
 {
 	struct impl *impl = SPA_CONTAINER_OF(conn, struct impl, this);
-	ssize_t sent, outsize;
+	ssize_t sent;
 	struct msghdr msg = { 0 };
-	struct iovec iov[1];
+	struct iovec iov[MAX_IOV];
 	struct cmsghdr *cmsg;
 	char cmsgbuf[CMSG_SPACE(MAX_FDS_MSG * sizeof(int))];
 	int res = 0, *fds;
-	uint32_t fds_len, n_fds, outfds;
+	uint32_t fds_len, n_fds, outfds, n_iov;
 	struct buffer *buf;
-	void *data;
-	size_t size;
+	struct chunk *c, *t;
+	size_t done;
 
 	buf = &impl->out;
-	data = buf->buffer_data;
-	size = buf->buffer_size;
+
+	if (impl->ring.pending > 0 && (res = ring_announce(impl)) < 0)
+		return res;
+
 	fds = buf->fds;
 	n_fds = buf->n_fds;
 
-	while (size > 0) {
+	while (true) {
+		n_iov = 0;
+		spa_list_for_each(c, &impl->chunks, link) {
+			if (c->offset == c->size)
+				continue;
+			iov[n_iov].iov_base = c->data + c->offset;
+			iov[n_iov].iov_len = c->size - c->offset;
+			if (++n_iov == MAX_IOV)
+				break;
+		}
+		if (n_iov == 0)
+			break;
+
 		if (n_fds > MAX_FDS_MSG) {
 			outfds = MAX_FDS_MSG;
-			outsize = SPA_MIN(sizeof(uint32_t), size);
+			iov[0].iov_len = SPA_MIN(sizeof(uint32_t), iov[0].iov_len);
+			n_iov = 1;
 		} else {
 			outfds = n_fds;
-			outsize = size;
 		}
 
 		fds_len = outfds * sizeof(int);
 
-		iov[0].iov_base = data;
-		iov[0].iov_len = outsize;
 		msg.msg_iov = iov;
-		msg.msg_iovlen = 1;
+		msg.msg_iovlen = n_iov;
 
 		if (outfds > 0) {
 			msg.msg_control = cmsgbuf;
@@ -553,11 +1008,23 @@ int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *co
 			}
 			break;
 		}
-		pw_log_trace("connection %p: %d written %zd bytes and %u fds", conn, conn->fd, sent,
-			     outfds);
-
-		size -= sent;
-		data = SPA_MEMBER(data, sent, void);
+		pw_log_trace("connection %p: %d written %zd bytes in %u iov and %u fds",
+				conn, conn->fd, sent, n_iov, outfds);
+
+		/* release the chunks that were sent, the last one is reused */
+		spa_list_for_each_safe(c, t, &impl->chunks, link) {
+			done = SPA_MIN(c->size - c->offset, (size_t)sent);
+			c->offset += done;
+			sent -= done;
+			if (c->offset < c->size)
+				break;
+			if (c->link.next == &impl->chunks) {
+				c->size = 0;
+				c->offset = 0;
+			} else {
+				chunk_free(impl, c);
+			}
+		}
 		n_fds -= outfds;
 		fds += outfds;
 	}
@@ -565,9 +1032,6 @@ int pw_protocol_native_connection_flush(struct pw_protocol_native_connection *co
 	res = 0;
 
 exit:
-	if (size > 0)
-		memmove(buf->buffer_data, data, size);
-	buf->buffer_size = size;
 	if (n_fds > 0)
 		memmove(buf->fds, fds, n_fds * sizeof(int));
 	buf->n_fds = n_fds;
@@ -589,6 +1053,10 @@ int pw_protocol_native_connection_clear(struct pw_protocol_native_connection *co
 
 	clear_buffer(&impl->out);
 	clear_buffer(&impl->in);
+	clear_buffer(&impl->rin);
+	clear_chunks(impl);
+	impl->ring.pending = 0;
+	impl->ring.pending_fds = 0;
 
 	return 0;
 }
@@ -697,6 +697,27 @@ static void registry_marshal_global_remove(void *object, uint32_t id)
 	pw_protocol_native_end_resource(resource, b);
 }
 
+/* the message size is a 24 bits field in the header */
+#define MAX_SNAPSHOT_SIZE	(0xffffffu - 1024u)
+
+static int registry_marshal_snapshot(void *object, uint32_t n_globals,
+		const uint32_t *permissions, const struct spa_pod *globals)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_builder *b;
+
+	if (SPA_POD_SIZE(globals) + n_globals * sizeof(uint32_t) > MAX_SNAPSHOT_SIZE)
+		return -EFBIG;
+
+	b = pw_protocol_native_begin_resource(resource, PW_REGISTRY_EVENT_SNAPSHOT, NULL);
+
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Array(sizeof(uint32_t), SPA_TYPE_Int, n_globals, permissions),
+			SPA_POD_Pod(globals));
+
+	return pw_protocol_native_end_resource(resource, b);
+}
+
 static int registry_demarshal_bind(void *object, const struct pw_protocol_native_message *msg)
 {
 	struct pw_resource *resource = object;
@@ -1889,6 +1910,73 @@ static int registry_demarshal_global_remove(void *object, const struct pw_protoc
 	return pw_proxy_notify(proxy, struct pw_registry_events, global_remove, 0, id);
 }
 
+/* emit a global event for each object in the snapshot */
+static int registry_demarshal_snapshot(void *object, const struct pw_protocol_native_message *msg)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_parser prs;
+	struct spa_pod_frame f[3];
+	struct spa_pod *globals;
+	struct spa_dict props;
+	struct spa_dict_item *items = NULL;
+	uint32_t i, csize, ctype, n_globals, max_items = 0;
+	uint32_t *permissions, id, version;
+	char *type;
+	int res = -EINVAL;
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+			SPA_POD_Array(&csize, &ctype, &n_globals, &permissions),
+			SPA_POD_Pod(&globals)) < 0)
+		return -EINVAL;
+	if (csize != sizeof(uint32_t) || ctype != SPA_TYPE_Int)
+		return -EINVAL;
+
+	spa_pod_parser_pod(&prs, globals);
+	if (spa_pod_parser_push_struct(&prs, &f[0]) < 0)
+		return -EINVAL;
+
+	for (i = 0; i < n_globals; i++) {
+		if (spa_pod_parser_push_struct(&prs, &f[1]) < 0 ||
+		    spa_pod_parser_get(&prs,
+				SPA_POD_Int(&id),
+				SPA_POD_String(&type),
+				SPA_POD_Int(&version), NULL) < 0)
+			goto exit;
+
+		if (spa_pod_parser_push_struct(&prs, &f[2]) < 0 ||
+		    spa_pod_parser_get(&prs,
+				SPA_POD_Int(&props.n_items), NULL) < 0)
+			goto exit;
+
+		if (props.n_items > max_items) {
+			struct spa_dict_item *tmp;
+			if (props.n_items > SPA_POD_BODY_SIZE(globals) / 16)
+				goto exit;
+			if ((tmp = realloc(items, props.n_items * sizeof(*items))) == NULL) {
+				res = -errno;
+				goto exit;
+			}
+			items = tmp;
+			max_items = props.n_items;
+		}
+		props.items = items;
+		if (parse_dict(&prs, &props) < 0)
+			goto exit;
+
+		spa_pod_parser_pop(&prs, &f[2]);
+		spa_pod_parser_pop(&prs, &f[1]);
+
+		pw_proxy_notify(proxy, struct pw_registry_events,
+				global, 0, id, permissions[i], type, version,
+				props.n_items > 0 ? &props : NULL);
+	}
+	res = 0;
+exit:
+	free(items);
+	return res;
+}
+
 static void * registry_marshal_bind(void *object, uint32_t id,
 				  const char *type, uint32_t version, size_t user_data_size)
 {
@@ -2006,13 +2094,15 @@ static const struct pw_registry_events pw_protocol_native_registry_event_marshal
 	PW_VERSION_REGISTRY_EVENTS,
 	.global = &registry_marshal_global,
 	.global_remove = &registry_marshal_global_remove,
+	.snapshot = &registry_marshal_snapshot,
 };
 
 static const struct pw_protocol_native_demarshal
 pw_protocol_native_registry_event_demarshal[PW_REGISTRY_EVENT_NUM] =
 {
 	[PW_REGISTRY_EVENT_GLOBAL] = { &registry_demarshal_global, 0, },
-	[PW_REGISTRY_EVENT_GLOBAL_REMOVE] = { &registry_demarshal_global_remove, 0, }
+	[PW_REGISTRY_EVENT_GLOBAL_REMOVE] = { &registry_demarshal_global_remove, 0, },
+	[PW_REGISTRY_EVENT_SNAPSHOT] = { &registry_demarshal_snapshot, 0, },
 };
 
 const struct pw_protocol_marshal pw_protocol_native_registry_marshal = {
@@ -2027,6 +2117,19 @@ const struct pw_protocol_marshal pw_protocol_native_registry_marshal = {
 	.client_demarshal = pw_protocol_native_registry_event_demarshal,
 };
 
+/* registries of version 3 never get a snapshot */
+static const struct pw_protocol_marshal pw_protocol_native_registry_marshal_v3 = {
+	PW_TYPE_INTERFACE_Registry,
+	3,
+	0,
+	PW_REGISTRY_METHOD_NUM,
+	PW_REGISTRY_EVENT_NUM,
+	.client_marshal = &pw_protocol_native_registry_method_marshal,
+	.server_demarshal = pw_protocol_native_registry_method_demarshal,
+	.server_marshal = &pw_protocol_native_registry_event_marshal,
+	.client_demarshal = pw_protocol_native_registry_event_demarshal,
+};
+
 static const struct pw_module_events pw_protocol_native_module_event_marshal = {
 	PW_VERSION_MODULE_EVENTS,
 	.info = &module_marshal_info,
@@ -2303,6 +2406,7 @@ void pw_protocol_native_init(struct pw_protocol *protocol)
 {
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_core_marshal);
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_registry_marshal);
+	pw_protocol_add_marshal(protocol, &pw_protocol_native_registry_marshal_v3);
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_module_marshal);
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_device_marshal);
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_node_marshal);
@@ -23,6 +23,8 @@
  */
 
 #include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <spa/pod/builder.h>
 #include <spa/pod/parser.h>
@@ -119,6 +121,160 @@ static void test_read_write(struct pw_protocol_native_connection *in,
 	spa_assert(read_message(in) == -1);
 }
 
+static void write_data(struct pw_protocol_native_connection *conn, uint32_t seq, uint32_t size)
+{
+	struct spa_pod_builder *b;
+	struct spa_pod_frame f;
+	uint8_t *data;
+	uint32_t i;
+
+	data = alloca(size);
+	for (i = 0; i < size; i++)
+		data[i] = seq + i;
+
+	b = pw_protocol_native_connection_begin(conn, 2, 6, NULL);
+	spa_assert(b != NULL);
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_int(b, seq);
+	spa_pod_builder_bytes(b, data, size);
+	spa_pod_builder_pop(b, &f);
+	spa_assert(pw_protocol_native_connection_end(conn, b) >= 0);
+}
+
+static int read_data(struct pw_protocol_native_connection *conn, uint32_t seq, uint32_t size)
+{
+	struct spa_pod_parser prs;
+	const struct pw_protocol_native_message *msg;
+	const uint8_t *data;
+	uint32_t v_seq, v_size, i;
+
+	if (pw_protocol_native_connection_get_next(conn, &msg) != 1)
+		return -1;
+
+	spa_assert(msg->opcode == 6);
+	spa_assert(msg->id == 2);
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+			SPA_POD_Int(&v_seq),
+			SPA_POD_Bytes(&data, &v_size)) < 0)
+		spa_assert_not_reached();
+
+	spa_assert(v_seq == seq);
+	spa_assert(v_size == size);
+	for (i = 0; i < size; i++)
+		spa_assert(data[i] == (uint8_t)(seq + i));
+	return 0;
+}
+
+/* more data than the socket can hold, partial writes and messages that
+ * span chunks */
+static inline uint32_t large_size(uint32_t seq)
+{
+	return seq % 500 == 0 ? 100000 : (seq * 97) % 3000;
+}
+
+static void test_large(struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out)
+{
+	uint32_t i, n_read = 0, n_msgs = 2000;
+
+	for (i = 0; i < n_msgs; i++)
+		write_data(out, i, large_size(i));
+
+	while (n_read < n_msgs) {
+		pw_protocol_native_connection_flush(out);
+		while (n_read < n_msgs &&
+		    read_data(in, n_read, large_size(n_read)) == 0)
+			n_read++;
+	}
+	spa_assert(read_message(in) == -1);
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* messages per second over the socketpair */
+static void benchmark_messages(const char *name, struct pw_protocol_native_connection *in,
+		struct pw_protocol_native_connection *out, uint32_t size)
+{
+	const struct pw_protocol_native_message *msg;
+	uint32_t i, n_msgs = 100000, n_read = 0;
+	uint64_t t1, t2;
+
+	t1 = get_time_ns();
+	for (i = 0; i < n_msgs; i++) {
+		write_data(out, i, size);
+		if (i % 256 != 255 && i != n_msgs - 1)
+			continue;
+		pw_protocol_native_connection_flush(out);
+		while (pw_protocol_native_connection_get_next(in, &msg) == 1)
+			n_read++;
+	}
+	while (n_read < n_msgs) {
+		pw_protocol_native_connection_flush(out);
+		while (pw_protocol_native_connection_get_next(in, &msg) == 1)
+			n_read++;
+	}
+	t2 = get_time_ns();
+
+	fprintf(stderr, "%s: %u messages of %u bytes: %f msg/s\n", name, n_msgs, size,
+			n_msgs * (double)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
+static void write_hello(struct pw_protocol_native_connection *conn)
+{
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_connection_begin(conn, 0, 1, NULL);
+	spa_assert(b != NULL);
+	spa_pod_builder_add_struct(b, SPA_POD_Int(3));
+	spa_assert(pw_protocol_native_connection_end(conn, b) >= 0);
+}
+
+static void test_ring(struct pw_context *context)
+{
+	const struct pw_protocol_native_message *msg;
+	struct pw_protocol_native_connection *server, *client;
+	int fds[2];
+
+	spa_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+	server = pw_protocol_native_connection_new(context, fds[0]);
+	client = pw_protocol_native_connection_new(context, fds[1]);
+	spa_assert(server != NULL && client != NULL);
+
+	/* the ring goes with the hello message and is taken by the server */
+	spa_assert(pw_protocol_native_connection_set_ring_size(client, 64 * 1024) == 0);
+	write_hello(client);
+	pw_protocol_native_connection_flush(client);
+	spa_assert(pw_protocol_native_connection_get_next(server, &msg) == 1);
+	spa_assert(msg->id == 0 && msg->opcode == 1);
+	spa_assert(msg->n_fds == 0);
+
+	/* the first message from the server makes the client use the ring */
+	write_data(server, 0, 100);
+	pw_protocol_native_connection_flush(server);
+	spa_assert(read_data(client, 0, 100) == 0);
+
+	/* fds, messages larger than the ring and a full ring */
+	test_read_write(server, client);
+	test_large(server, client);
+	test_large(client, server);
+
+	benchmark_messages("ring", server, client, 16);
+	benchmark_messages("ring", server, client, 1024);
+
+	pw_protocol_native_connection_destroy(server);
+	pw_protocol_native_connection_destroy(client);
+	close(fds[0]);
+	close(fds[1]);
+}
+
 int main(int argc, char *argv[])
 {
 	struct pw_main_loop *loop;
@@ -144,6 +300,11 @@ int main(int argc, char *argv[])
 	test_create(in);
 	test_create(out);
 	test_read_write(in, out);
+	test_large(in, out);
+	test_ring(context);
+
+	benchmark_messages("socket", in, out, 16);
+	benchmark_messages("socket", in, out, 1024);
 
 	return 0;
 }
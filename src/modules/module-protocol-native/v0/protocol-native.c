@@ -1226,7 +1226,7 @@ static const struct pw_protocol_marshal pw_protocol_native_registry_marshal = {
 	PW_TYPE_INTERFACE_Registry,
 	PW_VERSION_REGISTRY_V0,
 	PW_REGISTRY_V0_METHOD_NUM,
-	PW_REGISTRY_EVENT_NUM,
+	PW_REGISTRY_V0_EVENT_NUM,
 	0,
 	NULL,
 	pw_protocol_native_registry_method_demarshal,
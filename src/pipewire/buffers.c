@@ -57,6 +57,8 @@ static int alloc_buffers(struct pw_mempool *pool,
 			 uint32_t *data_aligns,
 			 uint32_t *data_types,
 			 uint32_t flags,
+			 const void *owner,
+			 const void *peer,
 			 struct pw_buffers *allocation)
 {
 	struct spa_buffer **buffers;
@@ -125,12 +127,14 @@ static int alloc_buffers(struct pw_mempool *pool,
 
 	if (SPA_FLAG_IS_SET(flags, PW_BUFFERS_FLAG_SHARED)) {
 		/* pointer to buffer structures */
-		m = pw_mempool_alloc(pool,
+		m = pw_mempool_alloc_shared(pool,
 				PW_MEMBLOCK_FLAG_READWRITE |
 				PW_MEMBLOCK_FLAG_SEAL |
-				PW_MEMBLOCK_FLAG_MAP,
+				PW_MEMBLOCK_FLAG_MAP |
+				PW_MEMBLOCK_FLAG_SLAB,
 				SPA_DATA_MemFd,
-				n_buffers * info.mem_size);
+				n_buffers * info.mem_size,
+				owner, peer);
 		if (m == NULL)
 			return -errno;
 
@@ -230,10 +234,10 @@ static struct spa_pod *find_param(struct spa_pod **params, uint32_t n_params, ui
 	return NULL;
 }
 
-SPA_EXPORT
-int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
+int pw_buffers_negotiate_shared(struct pw_context *context, uint32_t flags,
 		struct spa_node *outnode, uint32_t out_port_id,
 		struct spa_node *innode, uint32_t in_port_id,
+		const void *owner, const void *peer,
 		struct pw_buffers *result)
 {
 	struct spa_pod **params, *param;
@@ -331,6 +335,7 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 				 data_sizes, data_strides,
 				 data_aligns, data_types,
 				 flags,
+				 owner, peer,
 				 result)) < 0) {
 		pw_log_error(NAME" %p: can't alloc buffers: %s", result, spa_strerror(res));
 	}
@@ -338,6 +343,17 @@ int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
 	return res;
 }
 
+SPA_EXPORT
+int pw_buffers_negotiate(struct pw_context *context, uint32_t flags,
+		struct spa_node *outnode, uint32_t out_port_id,
+		struct spa_node *innode, uint32_t in_port_id,
+		struct pw_buffers *result)
+{
+	return pw_buffers_negotiate_shared(context, flags,
+			outnode, out_port_id, innode, in_port_id,
+			NULL, NULL, result);
+}
+
 SPA_EXPORT
 void pw_buffers_clear(struct pw_buffers *buffers)
 {
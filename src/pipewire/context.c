@@ -56,12 +56,42 @@
 #define DEFAULT_VIDEO_RATE_DENOM	1u
 #define DEFAULT_LINK_MAX_BUFFERS	64u
 #define DEFAULT_MEM_ALLOW_MLOCK		true
+#define DEFAULT_MEM_SLAB_SIZE		0
+#define DEFAULT_MEM_HUGEPAGES		false
+#define DEFAULT_DATA_LOOP_WORKERS	0u
+#define DEFAULT_DATA_LOOP_PER_DRIVER	false
 
 /** \cond */
 struct impl {
 	struct pw_context this;
 	struct spa_handle *dbus_handle;
 	unsigned int recalc;
+
+	uint32_t transaction;		/**< nesting level of transactions */
+	struct spa_list invoke_list;	/**< pending invokes in a transaction */
+
+	struct spa_list driver_loops;	/**< separate data loops of drivers */
+};
+
+struct driver_loop {
+	struct spa_list link;
+	char *name;			/**< node.name of the driver */
+	int ref;
+	unsigned int pending:1;		/**< made when loading the plugin, the ref is
+					  *  taken over by the first node */
+	struct pw_data_loop *loop;
+};
+
+static void free_driver_loop(struct impl *impl, struct driver_loop *l);
+
+struct invoke_op {
+	struct spa_list link;
+	struct pw_loop *loop;
+	spa_invoke_func_t func;
+	uint32_t seq;
+	void *user_data;
+	size_t size;
+	/* data follows */
 };
 
 
@@ -174,6 +204,10 @@ static void fill_defaults(struct pw_context *this)
 	this->defaults.video_rate.denom = get_default_int(p, "default.video.rate.denom", DEFAULT_VIDEO_RATE_DENOM);
 	this->defaults.link_max_buffers = get_default_int(p, "link.max-buffers", DEFAULT_LINK_MAX_BUFFERS);
 	this->defaults.mem_allow_mlock = get_default_bool(p, "mem.allow-mlock", DEFAULT_MEM_ALLOW_MLOCK);
+	this->defaults.mem_slab_size = get_default_int(p, "mem.slab-size", DEFAULT_MEM_SLAB_SIZE);
+	this->defaults.mem_hugepages = get_default_bool(p, "mem.hugepages", DEFAULT_MEM_HUGEPAGES);
+	this->defaults.data_loop_workers = get_default_int(p, "context.data-loop.workers", DEFAULT_DATA_LOOP_WORKERS);
+	this->defaults.data_loop_per_driver = get_default_bool(p, "context.data-loop.per-driver", DEFAULT_DATA_LOOP_PER_DRIVER);
 
 	this->defaults.clock_max_quantum = SPA_CLAMP(this->defaults.clock_max_quantum,
 			CLOCK_MIN_QUANTUM, CLOCK_MAX_QUANTUM);
@@ -234,13 +268,32 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		pw_properties_set(pr, PW_KEY_LIBRARY_NAME_SYSTEM, str);
 
 	this->data_loop_impl = pw_data_loop_new(&pr->dict);
-	pw_properties_free(pr);
 	if (this->data_loop_impl == NULL)  {
 		res = -errno;
+		pw_properties_free(pr);
 		goto error_free;
 	}
 
-	this->pool = pw_mempool_new(NULL);
+	if (this->defaults.data_loop_workers > 0) {
+		if ((str = pw_properties_get(pr, "context.data-loop.workers.rt-prio")))
+			pw_properties_set(pr, "loop.rt-prio", str);
+
+		this->workers = pw_data_workers_new(this,
+				this->defaults.data_loop_workers, &pr->dict);
+		if (this->workers == NULL)
+			pw_log_warn(NAME" %p: can't create %u data loop workers: %m",
+					this, this->defaults.data_loop_workers);
+	}
+	pw_properties_free(pr);
+
+	pr = pw_properties_new(NULL, NULL);
+	if (pr != NULL) {
+		pw_properties_setf(pr, "mem.slab-size", "%u", this->defaults.mem_slab_size);
+		pw_properties_set(pr, "mem.hugepages", this->defaults.mem_hugepages ? "true" : "false");
+		pw_properties_set(pr, "mem.allow-mlock", this->defaults.mem_allow_mlock ? "true" : "false");
+	}
+
+	this->pool = pw_mempool_new(pr);
 	if (this->pool == NULL) {
 		res = -errno;
 		goto error_free_loop;
@@ -296,6 +349,8 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	spa_list_init(&this->control_list[1]);
 	spa_list_init(&this->export_list);
 	spa_list_init(&this->driver_list);
+	spa_list_init(&impl->invoke_list);
+	spa_list_init(&impl->driver_loops);
 	spa_hook_list_init(&this->listener_list);
 	spa_hook_list_init(&this->driver_listener_list);
 
@@ -323,6 +378,8 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	return this;
 
 error_free_loop:
+	if (this->workers)
+		pw_data_workers_destroy(this->workers);
 	pw_data_loop_destroy(this->data_loop_impl);
 error_free:
 	free(this);
@@ -351,10 +408,14 @@ void pw_context_destroy(struct pw_context *context)
 	struct pw_impl_node *node;
 	struct factory_entry *entry;
 	struct pw_impl_core *core_impl;
+	struct driver_loop *dl;
 
 	pw_log_debug(NAME" %p: destroy", context);
 	pw_context_emit_destroy(context);
 
+	impl->transaction = 0;
+	pw_context_flush_invoke(context);
+
 	spa_list_consume(core, &context->core_list, link)
 		pw_core_disconnect(core);
 
@@ -381,6 +442,12 @@ void pw_context_destroy(struct pw_context *context)
 
 	pw_mempool_destroy(context->pool);
 
+	if (context->workers)
+		pw_data_workers_destroy(context->workers);
+
+	spa_list_consume(dl, &impl->driver_loops, link)
+		free_driver_loop(impl, dl);
+
 	pw_data_loop_destroy(context->data_loop_impl);
 
 	pw_properties_free(context->properties);
@@ -397,6 +464,7 @@ void pw_context_destroy(struct pw_context *context)
 	pw_array_clear(&context->objects);
 
 	pw_map_clear(&context->globals);
+	free(context->registry_snapshot.data);
 
 	free(context);
 }
@@ -832,6 +900,8 @@ int pw_context_recalc_graph(struct pw_context *context, const char *reason)
 
 	impl->recalc = true;
 
+	pw_context_begin_transaction(context);
+
 	/* start from all drivers and group all nodes that are linked
 	 * to it. Some nodes are not (yet) linked to anything and they
 	 * will end up 'unassigned' to a master. Other nodes are master
@@ -942,10 +1012,358 @@ int pw_context_recalc_graph(struct pw_context *context, const char *reason)
 		}
 		ensure_state(n, running);
 	}
+	pw_context_commit_transaction(context);
+
 	impl->recalc = false;
 	return 0;
 }
 
+struct invoke_batch {
+	struct invoke_op *first;
+	uint32_t n_ops;
+};
+
+/* runs in the data loop, execute a run of queued invokes for the loop */
+static int do_invoke_ops(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	const struct invoke_batch *b = data;
+	struct invoke_op *op = b->first;
+	uint32_t i;
+	int res = 0;
+
+	for (i = 0; i < b->n_ops; i++) {
+		res = op->func(loop, async, op->seq, SPA_MEMBER(op, sizeof(*op), void),
+				op->size, op->user_data);
+		op = spa_list_next(op, link);
+	}
+	return res;
+}
+
+int pw_context_flush_invoke(struct pw_context *context)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct invoke_batch b;
+	struct invoke_op *op;
+	struct pw_loop *loop;
+	uint32_t i;
+	int res = 0;
+
+	/* the invokes are executed in the order they were queued, with one
+	 * blocking invoke for each run of invokes on the same loop */
+	while (!spa_list_is_empty(&impl->invoke_list)) {
+		b.first = spa_list_first(&impl->invoke_list, struct invoke_op, link);
+		b.n_ops = 0;
+		loop = b.first->loop;
+
+		spa_list_for_each(op, &impl->invoke_list, link) {
+			if (op->loop != loop)
+				break;
+			b.n_ops++;
+		}
+
+		pw_log_debug(NAME" %p: flush %u invokes for loop %p", context, b.n_ops, loop);
+		res = pw_loop_invoke(loop, do_invoke_ops, 1,
+				&b, sizeof(b), true, impl);
+
+		for (i = 0; i < b.n_ops; i++) {
+			op = spa_list_first(&impl->invoke_list, struct invoke_op, link);
+			spa_list_remove(&op->link);
+			free(op);
+		}
+	}
+	return res;
+}
+
+static int context_invoke(struct pw_context *context, struct pw_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, bool flush, void *user_data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct invoke_op *op;
+
+	if (impl->transaction == 0)
+		return pw_loop_invoke(loop, func, seq, data, size, block, user_data);
+
+	if ((op = malloc(sizeof(*op) + size)) == NULL) {
+		pw_context_flush_invoke(context);
+		return pw_loop_invoke(loop, func, seq, data, size, block, user_data);
+	}
+	op->loop = loop;
+	op->func = func;
+	op->seq = seq;
+	op->user_data = user_data;
+	op->size = size;
+	if (size > 0)
+		memcpy(SPA_MEMBER(op, sizeof(*op), void), data, size);
+	spa_list_append(&impl->invoke_list, &op->link);
+
+	if (flush)
+		return pw_context_flush_invoke(context);
+
+	return 0;
+}
+
+/* Invoke func in the data loop. Inside a transaction, a blocking invoke
+ * is executed together with all queued invokes and has completed when
+ * this returns. */
+int pw_context_invoke(struct pw_context *context, struct pw_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, void *user_data)
+{
+	return context_invoke(context, loop, func, seq, data, size, block, block, user_data);
+}
+
+SPA_EXPORT
+int pw_context_queue_invoke(struct pw_context *context, struct pw_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, void *user_data)
+{
+	return context_invoke(context, loop, func, seq, data, size, block, false, user_data);
+}
+
+static struct driver_loop *find_driver_loop(struct impl *impl, const char *name)
+{
+	struct driver_loop *l;
+
+	if (name == NULL)
+		return NULL;
+
+	spa_list_for_each(l, &impl->driver_loops, link) {
+		if (l->name != NULL && strcmp(l->name, name) == 0)
+			return l;
+	}
+	return NULL;
+}
+
+static struct driver_loop *make_driver_loop(struct impl *impl, const struct spa_dict *props)
+{
+	struct pw_context *this = &impl->this;
+	struct driver_loop *l;
+	struct pw_properties *p;
+	const char *str;
+	int res;
+
+	if ((l = calloc(1, sizeof(*l))) == NULL)
+		return NULL;
+
+	if ((p = pw_properties_new(NULL, NULL)) == NULL) {
+		res = -errno;
+		goto error_free;
+	}
+	if ((str = pw_properties_get(this->properties,
+			"context.data-loop." PW_KEY_LIBRARY_NAME_SYSTEM)))
+		pw_properties_set(p, PW_KEY_LIBRARY_NAME_SYSTEM, str);
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_LOOP_RT_PRIO)))
+		pw_properties_set(p, "loop.rt-prio", str);
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_LOOP_CPU_AFFINITY)))
+		pw_properties_set(p, "loop.cpu-affinity", str);
+
+	l->loop = pw_data_loop_new(&p->dict);
+	pw_properties_free(p);
+	if (l->loop == NULL) {
+		res = -errno;
+		goto error_free;
+	}
+	if ((res = pw_data_loop_start(l->loop)) < 0)
+		goto error_destroy;
+
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_NAME)))
+		l->name = strdup(str);
+	l->ref = 1;
+	spa_list_append(&impl->driver_loops, &l->link);
+
+	pw_log_info(NAME" %p: new driver loop %p for '%s'", this, l->loop, l->name);
+	return l;
+
+error_destroy:
+	pw_data_loop_destroy(l->loop);
+error_free:
+	free(l);
+	errno = -res;
+	return NULL;
+}
+
+static void free_driver_loop(struct impl *impl, struct driver_loop *l)
+{
+	pw_log_info(NAME" %p: free driver loop %p for '%s'", impl, l->loop, l->name);
+	spa_list_remove(&l->link);
+	pw_data_loop_stop(l->loop);
+	pw_data_loop_destroy(l->loop);
+	free(l->name);
+	free(l);
+}
+
+/* a driver with these properties runs its graph in a separate data loop */
+static bool want_driver_loop(struct pw_context *context, const struct spa_dict *props)
+{
+	const char *str;
+
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_LOOP_SEPARATE)))
+		return pw_properties_parse_bool(str);
+	if (!context->defaults.data_loop_per_driver)
+		return false;
+	if ((str = spa_dict_lookup(props, PW_KEY_NODE_DRIVER)))
+		return pw_properties_parse_bool(str);
+	return false;
+}
+
+/* Get the separate data loop of the driver with props. A loop made when
+ * the plugin of the driver was loaded is reused, the plugin has its timers
+ * in that loop already. When there is no loop for the driver, a new one
+ * is made when create is true. */
+struct pw_data_loop *pw_context_acquire_driver_loop(struct pw_context *context,
+		const struct spa_dict *props, bool create)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct driver_loop *l;
+
+	if ((l = find_driver_loop(impl, spa_dict_lookup(props, PW_KEY_NODE_NAME))) != NULL) {
+		if (l->pending)
+			l->pending = false;
+		else
+			l->ref++;
+		return l->loop;
+	}
+	if (!create) {
+		errno = ENOENT;
+		return NULL;
+	}
+	if ((l = make_driver_loop(impl, props)) == NULL)
+		return NULL;
+
+	return l->loop;
+}
+
+void pw_context_release_driver_loop(struct pw_context *context, struct pw_data_loop *loop)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct driver_loop *l;
+
+	spa_list_for_each(l, &impl->driver_loops, link) {
+		if (l->loop != loop)
+			continue;
+		if (--l->ref == 0)
+			free_driver_loop(impl, l);
+		return;
+	}
+}
+
+struct stop_loops {
+	struct pw_loop **loops;
+	uint32_t n_loops;
+	uint32_t index;
+	void (*func) (void *data);
+	void *data;
+};
+
+/* runs in each data loop in turn and keeps it blocked until func has run
+ * with all the data loops blocked */
+static int do_stop_loops(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct stop_loops *s = user_data;
+
+	if (++s->index < s->n_loops)
+		return pw_loop_invoke(s->loops[s->index], do_stop_loops,
+				SPA_ID_INVALID, NULL, 0, true, s);
+	s->func(s->data);
+	return 0;
+}
+
+static int stop_data_loops(struct pw_context *context, void (*func) (void *data), void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct stop_loops s;
+	struct driver_loop *l;
+	uint32_t i;
+	int res;
+
+	s.n_loops = 1 + (context->workers ? context->workers->n_workers : 0);
+	spa_list_for_each(l, &impl->driver_loops, link)
+		s.n_loops++;
+	if ((s.loops = calloc(s.n_loops, sizeof(struct pw_loop *))) == NULL)
+		return -errno;
+
+	s.n_loops = 0;
+	s.loops[s.n_loops++] = context->data_loop;
+	spa_list_for_each(l, &impl->driver_loops, link)
+		s.loops[s.n_loops++] = pw_data_loop_get_loop(l->loop);
+	for (i = 0; context->workers && i < context->workers->n_workers; i++)
+		s.loops[s.n_loops++] = pw_data_loop_get_loop(context->workers->loops[i]);
+	s.index = 0;
+	s.func = func;
+	s.data = data;
+
+	res = pw_loop_invoke(s.loops[0], do_stop_loops, SPA_ID_INVALID, NULL, 0, true, &s);
+	free(s.loops);
+	return res;
+}
+
+struct driver_listener {
+	struct pw_context *context;
+	struct spa_hook *listener;
+	const struct pw_context_driver_events *events;
+	void *data;
+};
+
+static void add_driver_listener(void *data)
+{
+	struct driver_listener *d = data;
+	spa_hook_list_append(&d->context->driver_listener_list,
+			d->listener, d->events, d->data);
+}
+
+static void remove_driver_listener(void *data)
+{
+	struct driver_listener *d = data;
+	spa_hook_remove(d->listener);
+}
+
+/* The driver events are emitted from all the data loops, the listener
+ * list is only changed when they are all blocked. */
+SPA_EXPORT
+int pw_context_driver_add_listener(struct pw_context *context,
+			  struct spa_hook *listener,
+			  const struct pw_context_driver_events *events,
+			  void *data)
+{
+	struct driver_listener d = { context, listener, events, data };
+	return stop_data_loops(context, add_driver_listener, &d);
+}
+
+SPA_EXPORT
+int pw_context_driver_remove_listener(struct pw_context *context,
+			  struct spa_hook *listener)
+{
+	struct driver_listener d = { context, listener, NULL, NULL };
+	return stop_data_loops(context, remove_driver_listener, &d);
+}
+
+SPA_EXPORT
+int pw_context_begin_transaction(struct pw_context *context)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+
+	impl->transaction++;
+	pw_log_debug(NAME" %p: begin transaction %u", context, impl->transaction);
+	return 0;
+}
+
+SPA_EXPORT
+int pw_context_commit_transaction(struct pw_context *context)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+
+	spa_return_val_if_fail(impl->transaction > 0, -EINVAL);
+
+	pw_log_debug(NAME" %p: commit transaction %u", context, impl->transaction);
+	if (--impl->transaction > 0)
+		return 0;
+
+	return pw_context_flush_invoke(context);
+}
+
 SPA_EXPORT
 int pw_context_add_spa_lib(struct pw_context *context,
 		const char *factory_regexp, const char *lib)
@@ -988,10 +1406,14 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 		const char *factory_name,
 		const struct spa_dict *info)
 {
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	const char *lib;
 	const struct spa_support *support;
-	uint32_t n_support;
+	struct spa_support dl_support[SPA_N_ELEMENTS(context->support)];
+	struct driver_loop *dl = NULL;
+	uint32_t i, n_support;
 	struct spa_handle *handle;
+	bool made = false;
 
 	pw_log_debug(NAME" %p: load factory %s", context, factory_name);
 
@@ -1007,9 +1429,34 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 
 	support = pw_context_get_support(context, &n_support);
 
+	/* let the plugin of a driver with a separate loop add its sources
+	 * to that loop */
+	if (info != NULL && want_driver_loop(context, info) &&
+	    spa_dict_lookup(info, PW_KEY_NODE_NAME) != NULL) {
+		if ((dl = find_driver_loop(impl, spa_dict_lookup(info, PW_KEY_NODE_NAME))) == NULL) {
+			if ((dl = make_driver_loop(impl, info)) != NULL)
+				dl->pending = made = true;
+			else
+				pw_log_warn(NAME" %p: can't make driver loop: %m", context);
+		}
+	}
+	if (dl != NULL) {
+		for (i = 0; i < n_support; i++) {
+			dl_support[i] = support[i];
+			if (strcmp(support[i].type, SPA_TYPE_INTERFACE_DataLoop) == 0)
+				dl_support[i].data = pw_data_loop_get_loop(dl->loop)->loop;
+		}
+		support = dl_support;
+	}
+
 	handle = pw_load_spa_handle(lib, factory_name,
 			info, n_support, support);
 
+	if (handle == NULL && made) {
+		int res = -errno;
+		free_driver_loop(impl, dl);
+		errno = -res;
+	}
 	return handle;
 }
 
@@ -176,6 +176,27 @@ int pw_context_register_export_type(struct pw_context *context, struct pw_export
 /** find information about registered export type */
 const struct pw_export_type *pw_context_find_export_type(struct pw_context *context, const char *type);
 
+/** Start a transaction on the processing graph. Until the matching
+ * pw_context_commit_transaction(), changes to the graph in the data loops,
+ * like adding nodes, ports and links, are collected instead of being applied
+ * one by one. Transactions can be nested. */
+int pw_context_begin_transaction(struct pw_context *context);
+
+/** Commit a transaction. When the outermost transaction is committed, the
+ * collected changes are applied in order, with one invoke for each run of
+ * changes in the same data loop. */
+int pw_context_commit_transaction(struct pw_context *context);
+
+/** Invoke \a func in \a loop, a data loop of the context. Outside of a
+ * transaction this is the same as pw_loop_invoke(). Inside a transaction,
+ * the invoke is queued, also when \a block is true, and executed in order
+ * with the other changes when the outermost transaction is committed.
+ * \a data is copied. Returns 0 when the invoke was queued, or the result
+ * of pw_loop_invoke(). */
+int pw_context_queue_invoke(struct pw_context *context, struct pw_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, void *user_data);
+
 /** add an object to the context */
 int pw_context_set_object(struct pw_context *context, const char *type, void *value);
 /** get an object from the context */
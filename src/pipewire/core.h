@@ -33,13 +33,14 @@ extern "C" {
 #include <errno.h>
 
 #include <spa/utils/hook.h>
+#include <spa/pod/pod.h>
 
 #define PW_TYPE_INTERFACE_Core		PW_TYPE_INFO_INTERFACE_BASE "Core"
 #define PW_TYPE_INTERFACE_Registry	PW_TYPE_INFO_INTERFACE_BASE "Registry"
 
 #define PW_VERSION_CORE		3
 struct pw_core;
-#define PW_VERSION_REGISTRY	3
+#define PW_VERSION_REGISTRY	4
 struct pw_registry;
 
 /* default ID for the core object after connect */
@@ -389,6 +390,11 @@ pw_core_create_object(struct pw_core *core,
  * events, the client can use the pw_core.sync methosd immediately
  * after calling pw_core.get_registry.
  *
+ * Since version 4, the server sends the initial globals in one snapshot
+ * message. The protocol delivers it to the client as the same global
+ * events. A client can limit the registry to some interface types with
+ * the \ref PW_KEY_REGISTRY_TYPES property.
+ *
  * A client can bind to a global object by using the bind
  * request.  This creates a client-side proxy that lets the object
  * emit events to the client and lets the client invoke methods on
@@ -403,11 +409,12 @@ pw_core_create_object(struct pw_core *core,
 
 #define PW_REGISTRY_EVENT_GLOBAL             0
 #define PW_REGISTRY_EVENT_GLOBAL_REMOVE      1
-#define PW_REGISTRY_EVENT_NUM                2
+#define PW_REGISTRY_EVENT_SNAPSHOT           2
+#define PW_REGISTRY_EVENT_NUM                3
 
 /** Registry events */
 struct pw_registry_events {
-#define PW_VERSION_REGISTRY_EVENTS	0
+#define PW_VERSION_REGISTRY_EVENTS	1
 	uint32_t version;
 	/**
 	 * Notify of a new global object
@@ -434,6 +441,21 @@ struct pw_registry_events {
 	 * \param id the id of the global that was removed
 	 */
 	void (*global_remove) (void *object, uint32_t id);
+	/**
+	 * Notify of all global objects at once
+	 *
+	 * Emited instead of a global event for each object when a registry
+	 * of version 4 or newer is created. The protocol delivers it to the
+	 * client as global events.
+	 *
+	 * \param n_globals the number of global objects
+	 * \param permissions the permissions of each object
+	 * \param globals a struct with a struct for each object with its
+	 *	id, type, version and a struct of properties
+	 * \return 0 on success, < 0 when the snapshot could not be sent
+	 */
+	int (*snapshot) (void *object, uint32_t n_globals,
+			const uint32_t *permissions, const struct spa_pod *globals);
 };
 
 #define PW_REGISTRY_METHOD_ADD_LISTENER	0
@@ -24,10 +24,17 @@
 
 #include <pthread.h>
 #include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "pipewire/log.h"
 #include "pipewire/data-loop.h"
+#include "pipewire/utils.h"
 #include "pipewire/private.h"
 
 #define NAME "data-loop"
@@ -63,12 +70,59 @@ static void thread_cleanup(void *arg)
 	pw_loop_leave(this->loop);
 }
 
+static void make_realtime(struct pw_data_loop *this)
+{
+	struct sched_param sp;
+	int err;
+
+	spa_zero(sp);
+	sp.sched_priority = this->rt_prio;
+#ifndef __FreeBSD__
+	if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO | SCHED_RESET_ON_FORK, &sp)) != 0)
+#else
+	if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) != 0)
+#endif
+		pw_log_warn(NAME" %p: can't set realtime priority %d: %s", this,
+				this->rt_prio, strerror(err));
+	else
+		pw_log_info(NAME" %p: thread made realtime with priority %d", this,
+				this->rt_prio);
+}
+
+static void set_affinity(struct pw_data_loop *this)
+{
+	cpu_set_t set;
+	const char *str, *state = NULL;
+	size_t len;
+	int err;
+
+	CPU_ZERO(&set);
+	while ((str = pw_split_walk(this->affinity, ", ", &len, &state)) != NULL) {
+		int cpu = atoi(str);
+		if (cpu >= 0 && cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	}
+	if (CPU_COUNT(&set) == 0)
+		return;
+
+	if ((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0)
+		pw_log_warn(NAME" %p: can't set affinity %s: %s", this,
+				this->affinity, strerror(err));
+	else
+		pw_log_info(NAME" %p: thread affinity set to %s", this, this->affinity);
+}
+
 static void *do_loop(void *user_data)
 {
 	struct pw_data_loop *this = user_data;
 	int res;
 
 	pw_log_debug(NAME" %p: enter thread", this);
+	if (this->rt_prio > 0)
+		make_realtime(this);
+	if (this->affinity)
+		set_affinity(this);
+
 	pw_loop_enter(this->loop);
 
 	pthread_cleanup_push(thread_cleanup, this);
@@ -128,6 +182,13 @@ static struct pw_data_loop *loop_new(struct pw_loop *loop, const struct spa_dict
 			goto error_loop_destroy;
 		}
 	}
+	if (props != NULL &&
+	    (str = spa_dict_lookup(props, "loop.rt-prio")) != NULL)
+		this->rt_prio = atoi(str);
+	if (props != NULL &&
+	    (str = spa_dict_lookup(props, "loop.cpu-affinity")) != NULL)
+		this->affinity = strdup(str);
+
 	spa_hook_list_init(&this->listener_list);
 
 	return this;
@@ -171,6 +232,7 @@ void pw_data_loop_destroy(struct pw_data_loop *loop)
 		pw_loop_destroy_source(loop->loop, loop->event);
 	if (loop->created)
 		pw_loop_destroy(loop->loop);
+	free(loop->affinity);
 	free(loop);
 }
 
@@ -183,6 +245,7 @@ void pw_data_loop_add_listener(struct pw_data_loop *loop,
 	spa_hook_list_append(&loop->listener_list, listener, events, data);
 }
 
+SPA_EXPORT
 struct pw_loop *
 pw_data_loop_get_loop(struct pw_data_loop *loop)
 {
@@ -265,3 +328,183 @@ int pw_data_loop_invoke(struct pw_data_loop *loop,
 		res = func(loop->loop->loop, false, seq, data, size, user_data);
 	return res;
 }
+
+static inline bool queue_work(struct pw_data_workers *workers,
+		struct pw_data_work_group *group,
+		int (*signal) (void *data), void *data)
+{
+	struct pw_data_work *w;
+	uint32_t pos = ATOMIC_LOAD(workers->tail);
+
+	while (true) {
+		int32_t diff;
+
+		w = &workers->queue[pos & PW_DATA_WORK_QUEUE_MASK];
+		diff = (int32_t) (ATOMIC_LOAD(w->seq) - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&workers->tail, &pos, pos + 1,
+					true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = ATOMIC_LOAD(workers->tail);
+		}
+	}
+	w->group = group;
+	w->signal = signal;
+	w->data = data;
+	ATOMIC_STORE(w->seq, pos + 1);
+	return true;
+}
+
+static inline bool dequeue_work(struct pw_data_workers *workers,
+		struct pw_data_work_group **group,
+		int (**signal) (void *data), void **data)
+{
+	struct pw_data_work *w;
+	uint32_t pos = ATOMIC_LOAD(workers->head);
+
+	while (true) {
+		int32_t diff;
+
+		w = &workers->queue[pos & PW_DATA_WORK_QUEUE_MASK];
+		diff = (int32_t) (ATOMIC_LOAD(w->seq) - (pos + 1));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&workers->head, &pos, pos + 1,
+					true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = ATOMIC_LOAD(workers->head);
+		}
+	}
+	*group = w->group;
+	*signal = w->signal;
+	*data = w->data;
+	ATOMIC_STORE(w->seq, pos + PW_DATA_WORK_QUEUE_SIZE);
+	return true;
+}
+
+static inline void work_done(struct pw_data_work_group *group)
+{
+	if (ATOMIC_DEC(group->busy) == 0 &&
+	    SPA_UNLIKELY(ATOMIC_LOAD(group->waiting) > 0))
+		syscall(SYS_futex, &group->busy, FUTEX_WAKE_PRIVATE, INT32_MAX,
+				NULL, NULL, 0);
+}
+
+static void do_work(void *data, uint64_t count)
+{
+	struct pw_data_workers *workers = data;
+	struct pw_data_work_group *group;
+	int (*signal) (void *data);
+	void *d;
+
+	while (dequeue_work(workers, &group, &signal, &d)) {
+		signal(d);
+		work_done(group);
+	}
+}
+
+bool pw_data_workers_dispatch(struct pw_data_workers *workers,
+		struct pw_data_work_group *group,
+		int (*signal) (void *data), void *data)
+{
+	uint32_t idx;
+
+	if (workers == NULL || workers->n_workers == 0)
+		return false;
+
+	ATOMIC_INC(group->busy);
+	if (SPA_UNLIKELY(!queue_work(workers, group, signal, data))) {
+		work_done(group);
+		return false;
+	}
+	idx = ATOMIC_INC(workers->next) % workers->n_workers;
+	pw_loop_signal_event(workers->loops[idx]->loop, workers->wakeups[idx]);
+	return true;
+}
+
+/* sleep until the last worker that finishes work of the group wakes us up */
+void pw_data_workers_sync(struct pw_data_workers *workers,
+		struct pw_data_work_group *group)
+{
+	int32_t busy;
+
+	if (workers == NULL || group == NULL)
+		return;
+
+	ATOMIC_INC(group->waiting);
+	while ((busy = ATOMIC_LOAD(group->busy)) > 0)
+		syscall(SYS_futex, &group->busy, FUTEX_WAIT_PRIVATE, busy,
+				NULL, NULL, 0);
+	ATOMIC_DEC(group->waiting);
+}
+
+/** Make a new pool of \a n_workers data loops. The loops are made with
+ * \a props and started */
+struct pw_data_workers *pw_data_workers_new(struct pw_context *context,
+		uint32_t n_workers, const struct spa_dict *props)
+{
+	struct pw_data_workers *workers;
+	uint32_t i;
+	int res;
+
+	workers = calloc(1, sizeof(struct pw_data_workers));
+	if (workers == NULL)
+		return NULL;
+
+	workers->context = context;
+	for (i = 0; i < PW_DATA_WORK_QUEUE_SIZE; i++)
+		workers->queue[i].seq = i;
+
+	n_workers = SPA_MIN(n_workers, PW_DATA_WORKERS_MAX);
+
+	for (i = 0; i < n_workers; i++) {
+		struct pw_data_loop *loop;
+
+		if ((loop = pw_data_loop_new(props)) == NULL) {
+			res = -errno;
+			goto error_free;
+		}
+		workers->loops[i] = loop;
+		workers->n_workers++;
+
+		workers->wakeups[i] = pw_loop_add_event(loop->loop, do_work, workers);
+		if (workers->wakeups[i] == NULL) {
+			res = -errno;
+			goto error_free;
+		}
+		if ((res = pw_data_loop_start(loop)) < 0)
+			goto error_free;
+	}
+	pw_log_debug(NAME" %p: new %u workers", workers, workers->n_workers);
+
+	return workers;
+
+error_free:
+	pw_log_error(NAME" %p: can't create worker %u: %s", workers, i, spa_strerror(res));
+	pw_data_workers_destroy(workers);
+	errno = -res;
+	return NULL;
+}
+
+void pw_data_workers_destroy(struct pw_data_workers *workers)
+{
+	uint32_t i;
+
+	pw_log_debug(NAME" %p: destroy", workers);
+
+	/* the graphs synced their work when their nodes were removed */
+	for (i = 0; i < workers->n_workers; i++) {
+		struct pw_data_loop *loop = workers->loops[i];
+
+		pw_data_loop_stop(loop);
+		if (workers->wakeups[i])
+			pw_loop_destroy_source(loop->loop, workers->wakeups[i]);
+		pw_data_loop_destroy(loop);
+	}
+	free(workers);
+}
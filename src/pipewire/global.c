@@ -136,11 +136,13 @@ int pw_global_register(struct pw_global *global)
 
 	spa_list_append(&context->global_list, &global->link);
 	impl->registered = true;
+	pw_context_snapshot_add_global(context, global);
 
 	spa_list_for_each(registry, &context->registry_resource_list, link) {
 		uint32_t permissions = pw_global_get_permissions(global, registry->client);
 		pw_log_debug("registry %p: global %d %08x", registry, global->id, permissions);
-		if (PW_PERM_IS_R(permissions))
+		if (PW_PERM_IS_R(permissions) &&
+		    pw_impl_client_registry_wants(registry->client, global->type))
 			pw_registry_resource_global(registry,
 						    global->id,
 						    permissions,
@@ -167,13 +169,15 @@ static int global_unregister(struct pw_global *global)
 	spa_list_for_each(resource, &context->registry_resource_list, link) {
 		uint32_t permissions = pw_global_get_permissions(global, resource->client);
 		pw_log_debug("registry %p: global %d %08x", resource, global->id, permissions);
-		if (PW_PERM_IS_R(permissions))
+		if (PW_PERM_IS_R(permissions) &&
+		    pw_impl_client_registry_wants(resource->client, global->type))
 			pw_registry_resource_global_remove(resource, global->id);
 	}
 
 	spa_list_remove(&global->link);
 	pw_map_remove(&context->globals, global->id);
 	impl->registered = false;
+	pw_context_snapshot_remove_global(context, global);
 
 	pw_log_debug(NAME" %p: unregistered %u", global, global->id);
 	pw_context_emit_global_removed(context, global);
@@ -324,7 +328,8 @@ int pw_global_update_permissions(struct pw_global *global, struct pw_impl_client
 	pw_global_emit_permissions_changed(global, client, old_permissions, new_permissions);
 
 	spa_list_for_each(resource, &context->registry_resource_list, link) {
-		if (resource->client != client)
+		if (resource->client != client ||
+		    !pw_impl_client_registry_wants(client, global->type))
 			continue;
 
 		if (do_hide) {
@@ -380,6 +385,7 @@ void pw_global_destroy(struct pw_global *global)
 	pw_global_emit_free(global);
 
 	pw_properties_free(global->properties);
+	free(global->snapshot);
 
 	free(global);
 }
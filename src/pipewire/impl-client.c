@@ -463,6 +463,30 @@ void *pw_impl_client_get_user_data(struct pw_impl_client *client)
 	return client->user_data;
 }
 
+/* a type matches an entry of the registry.types list with its full
+ * name or with the part after the last ':' */
+bool pw_registry_types_match(const char *types, const char *type)
+{
+	const char *name, *str, *state = NULL;
+	size_t len;
+
+	name = strrchr(type, ':');
+	name = name ? name + 1 : type;
+
+	while ((str = pw_split_walk(types, ", ", &len, &state)) != NULL) {
+		if ((strncmp(str, type, len) == 0 && type[len] == '\0') ||
+		    (strncmp(str, name, len) == 0 && name[len] == '\0'))
+			return true;
+	}
+	return false;
+}
+
+bool pw_impl_client_registry_wants(struct pw_impl_client *client, const char *type)
+{
+	const char *types = pw_properties_get(client->properties, PW_KEY_REGISTRY_TYPES);
+	return types == NULL || pw_registry_types_match(types, type);
+}
+
 static int destroy_resource(void *object, void *data)
 {
 	if (object)
@@ -481,6 +505,7 @@ SPA_EXPORT
 void pw_impl_client_destroy(struct pw_impl_client *client)
 {
 	struct impl *impl = SPA_CONTAINER_OF(client, struct impl, this);
+	struct pw_impl_node *node;
 
 	pw_log_debug(NAME" %p: destroy", client);
 	pw_impl_client_emit_destroy(client);
@@ -492,6 +517,14 @@ void pw_impl_client_destroy(struct pw_impl_client *client)
 
 	pw_map_for_each(&client->objects, destroy_resource, client);
 
+	/* nodes that linger don't get new memory in the slabs of the client,
+	 * a new client at the same address must not see it */
+	spa_list_for_each(node, &client->context->node_list, link) {
+		if (node->client == client)
+			node->client = NULL;
+	}
+	pw_mempool_disown(client->context->pool, client);
+
 	if (client->global) {
 		spa_hook_remove(&client->global_listener);
 		pw_global_destroy(client->global);
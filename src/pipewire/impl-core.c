@@ -24,8 +24,10 @@
 
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
 
 #include <spa/debug/types.h>
+#include <spa/pod/builder.h>
 
 #include "pipewire/impl.h"
 #include "pipewire/private.h"
@@ -34,6 +36,8 @@
 
 #define NAME "impl-core"
 
+#define MAX_SNAPSHOT_REMOVED	64
+
 struct resource_data {
 	struct spa_hook resource_listener;
 	struct spa_hook object_listener;
@@ -211,6 +215,221 @@ static int core_error(void *object, uint32_t id, int seq, int res, const char *m
 	return 0;
 }
 
+static int snapshot_overflow(void *data, uint32_t size)
+{
+	struct spa_pod_builder *b = data;
+	void *p;
+
+	size = SPA_ROUND_UP_N(SPA_MAX(size, b->size * 2), 4096);
+	if ((p = realloc(b->data, size)) == NULL)
+		return -errno;
+	b->data = p;
+	b->size = size;
+	return 0;
+}
+
+static const struct spa_pod_builder_callbacks snapshot_callbacks = {
+	SPA_VERSION_POD_BUILDER_CALLBACKS,
+	.overflow = snapshot_overflow
+};
+
+/* a global is serialized as a struct with the id, type, version and a struct
+ * with the number of properties and the keys and values. The properties of a
+ * registered global don't change so this is done only once. */
+static struct spa_pod *global_serialize(struct pw_global *global)
+{
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(NULL, 0);
+	struct spa_pod_frame f[2];
+	const struct spa_dict_item *it;
+	const char *str;
+	void *p;
+
+	spa_pod_builder_set_callbacks(&b, &snapshot_callbacks, &b);
+
+	spa_pod_builder_push_struct(&b, &f[0]);
+	spa_pod_builder_add(&b,
+			SPA_POD_Int(global->id),
+			SPA_POD_String(global->type),
+			SPA_POD_Int(global->version),
+			NULL);
+	spa_pod_builder_push_struct(&b, &f[1]);
+	spa_pod_builder_int(&b, global->properties->dict.n_items);
+	spa_dict_for_each(it, &global->properties->dict) {
+		str = it->value;
+		if (strstr(str, "pointer:") == str)
+			str = "";
+		spa_pod_builder_string(&b, it->key);
+		spa_pod_builder_string(&b, str);
+	}
+	spa_pod_builder_pop(&b, &f[1]);
+	spa_pod_builder_pop(&b, &f[0]);
+
+	if (b.state.offset > b.size) {
+		free(b.data);
+		errno = ENOMEM;
+		return NULL;
+	}
+	/* give back what the builder allocated too much */
+	if ((p = realloc(b.data, b.state.offset)) != NULL)
+		b.data = p;
+	return b.data;
+}
+
+/* the snapshot is a struct with the serialized globals at the start of the
+ * builder memory */
+static int snapshot_init(struct spa_pod_builder *b)
+{
+	struct spa_pod_frame f;
+
+	spa_pod_builder_init(b, NULL, 0);
+	spa_pod_builder_set_callbacks(b, &snapshot_callbacks, b);
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_pop(b, &f);
+
+	return b->state.offset > b->size ? -ENOMEM : 0;
+}
+
+static void snapshot_clear(struct spa_pod_builder *b)
+{
+	free(b->data);
+	spa_pod_builder_init(b, NULL, 0);
+}
+
+static int snapshot_append(struct spa_pod_builder *b, struct pw_global *global)
+{
+	uint32_t offset = b->state.offset;
+
+	if (global->snapshot == NULL &&
+	    (global->snapshot = global_serialize(global)) == NULL)
+		return -errno;
+
+	spa_pod_builder_primitive(b, global->snapshot);
+	if (b->state.offset > b->size)
+		return -ENOMEM;
+
+	((struct spa_pod*)b->data)->size += b->state.offset - offset;
+	return 0;
+}
+
+static inline bool registry_shows(const char *types, struct pw_global *global,
+		uint32_t permissions)
+{
+	return PW_PERM_IS_R(permissions) &&
+		(types == NULL || pw_registry_types_match(types, global->type));
+}
+
+/* serialize the globals that client can see, or all globals when client
+ * is NULL */
+static int snapshot_build(struct spa_pod_builder *b, struct pw_context *context,
+		struct pw_impl_client *client)
+{
+	struct pw_global *global;
+	const char *types = NULL;
+	int res;
+
+	if ((res = snapshot_init(b)) < 0)
+		goto error;
+
+	if (client)
+		types = pw_properties_get(client->properties, PW_KEY_REGISTRY_TYPES);
+
+	spa_list_for_each(global, &context->global_list, link) {
+		if (client != NULL && !registry_shows(types, global,
+				pw_global_get_permissions(global, client)))
+			continue;
+		if ((res = snapshot_append(b, global)) < 0)
+			goto error;
+	}
+	return 0;
+error:
+	snapshot_clear(b);
+	return res;
+}
+
+/** Add a new global to the snapshot of all globals */
+void pw_context_snapshot_add_global(struct pw_context *context, struct pw_global *global)
+{
+	struct spa_pod_builder *b = &context->registry_snapshot;
+
+	if (b->data != NULL && snapshot_append(b, global) < 0)
+		snapshot_clear(b);
+}
+
+/** Remove a global from the snapshot of all globals. Many removals in a row,
+ * like when a device goes away, make the next registry build a new snapshot. */
+void pw_context_snapshot_remove_global(struct pw_context *context, struct pw_global *global)
+{
+	struct spa_pod_builder *b = &context->registry_snapshot;
+	struct spa_pod *pod = b->data, *entry;
+	uint32_t size, end;
+	int32_t id;
+
+	if (pod == NULL)
+		return;
+
+	if (++context->registry_snapshot_removed <= MAX_SNAPSHOT_REMOVED) {
+		SPA_POD_STRUCT_FOREACH(pod, entry) {
+			if (spa_pod_get_int(SPA_POD_BODY(entry), &id) < 0)
+				break;
+			if ((uint32_t)id != global->id)
+				continue;
+
+			size = SPA_ROUND_UP_N(SPA_POD_SIZE(entry), 8);
+			end = SPA_PTRDIFF(entry, pod) + size;
+			memmove(entry, SPA_MEMBER(pod, end, void), b->state.offset - end);
+			b->state.offset -= size;
+			pod->size -= size;
+			return;
+		}
+	}
+	snapshot_clear(b);
+}
+
+/* send the globals to a new registry in one message. The snapshot of all
+ * globals is shared by the registries that can see every global. */
+static int registry_snapshot(struct pw_resource *resource)
+{
+	struct pw_impl_client *client = resource->client;
+	struct pw_context *context = client->context;
+	struct pw_global *global;
+	struct spa_pod_builder tmp = SPA_POD_BUILDER_INIT(NULL, 0), *b;
+	uint32_t *permissions, n_globals = 0, n_total = 0;
+	const char *types;
+	int res;
+
+	spa_list_for_each(global, &context->global_list, link)
+		n_total++;
+
+	if ((permissions = malloc(SPA_MAX(n_total, 1u) * sizeof(uint32_t))) == NULL)
+		return -errno;
+
+	types = pw_properties_get(client->properties, PW_KEY_REGISTRY_TYPES);
+	spa_list_for_each(global, &context->global_list, link) {
+		uint32_t p = pw_global_get_permissions(global, client);
+		if (registry_shows(types, global, p))
+			permissions[n_globals++] = p;
+	}
+
+	if (n_globals == n_total) {
+		b = &context->registry_snapshot;
+		res = b->data == NULL ? snapshot_build(b, context, NULL) : 0;
+		context->registry_snapshot_removed = 0;
+	} else {
+		b = &tmp;
+		res = snapshot_build(b, context, client);
+	}
+	if (res >= 0)
+		res = pw_registry_resource_snapshot(resource,
+				n_globals, permissions, b->data);
+
+	pw_log_debug("registry %p: snapshot of %u/%u globals: %d", resource,
+			n_globals, n_total, res);
+
+	free(tmp.data);
+	free(permissions);
+	return res;
+}
+
 static struct pw_registry * core_get_registry(void *object, uint32_t version, size_t user_data_size)
 {
 	struct pw_resource *resource = object;
@@ -245,9 +464,14 @@ static struct pw_registry * core_get_registry(void *object, uint32_t version, si
 
 	spa_list_append(&context->registry_resource_list, &registry_resource->link);
 
+	/* older clients and protocols get a global event for each object */
+	if (version >= 4 && registry_snapshot(registry_resource) >= 0)
+		return (struct pw_registry *)registry_resource;
+
 	spa_list_for_each(global, &context->global_list, link) {
 		uint32_t permissions = pw_global_get_permissions(global, client);
-		if (PW_PERM_IS_R(permissions)) {
+		if (PW_PERM_IS_R(permissions) &&
+		    pw_impl_client_registry_wants(client, global->type)) {
 			pw_registry_resource_global(registry_resource,
 						    global->id,
 						    permissions,
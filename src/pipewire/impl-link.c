@@ -433,9 +433,11 @@ static int do_allocation(struct pw_impl_link *this)
 			flags |= SPA_NODE_BUFFERS_FLAG_ALLOC;
 		}
 
-		if ((res = pw_buffers_negotiate(this->context, alloc_flags,
+		/* only the clients of the two nodes see the buffers */
+		if ((res = pw_buffers_negotiate_shared(this->context, alloc_flags,
 						output->node->node, output->port_id,
 						input->node->node, input->port_id,
+						output->node->client, input->node->client,
 						&output->buffers)) < 0) {
 			error = spa_aprintf("error alloc buffers: %s", spa_strerror(res));
 			goto error;
@@ -497,6 +499,9 @@ do_activate_link(struct spa_loop *loop,
 
 	pw_log_trace(NAME" %p: activate", this);
 
+	pw_impl_node_sync_workers(this->output->node);
+	pw_impl_node_sync_workers(this->input->node);
+
 	spa_list_append(&this->output->rt.mix_list, &this->rt.out_mix.rt_link);
 	spa_list_append(&this->input->rt.mix_list, &this->rt.in_mix.rt_link);
 
@@ -538,7 +543,7 @@ int pw_impl_link_activate(struct pw_impl_link *this)
 			return res;
 		impl->io_set = true;
 	}
-	pw_loop_invoke(this->output->node->data_loop,
+	pw_context_queue_invoke(this->context, this->output->node->data_loop,
 	       do_activate_link, SPA_ID_INVALID, NULL, 0, false, this);
 
 	impl->activated = true;
@@ -701,6 +706,9 @@ do_deactivate_link(struct spa_loop *loop,
 
 	pw_log_trace(NAME" %p: disable %p and %p", this, &this->rt.in_mix, &this->rt.out_mix);
 
+	pw_impl_node_sync_workers(this->output->node);
+	pw_impl_node_sync_workers(this->input->node);
+
 	spa_list_remove(&this->rt.out_mix.rt_link);
 	spa_list_remove(&this->rt.in_mix.rt_link);
 
@@ -727,7 +735,7 @@ int pw_impl_link_deactivate(struct pw_impl_link *this)
 	if (!impl->activated)
 		return 0;
 
-	pw_loop_invoke(this->output->node->data_loop,
+	pw_context_invoke(this->context, this->output->node->data_loop,
 		       do_deactivate_link, SPA_ID_INVALID, NULL, 0, true, this);
 
 	port_set_io(this, this->output, SPA_IO_Buffers, NULL, 0,
@@ -1220,6 +1228,9 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 	pw_log_info("(%s) destroy", link->name);
 	pw_impl_link_emit_destroy(link);
 
+	/* queued invokes might still reference the link */
+	pw_context_flush_invoke(link->context);
+
 	pw_impl_link_deactivate(link);
 
 	if (link->registered)
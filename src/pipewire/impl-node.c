@@ -28,9 +28,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <pthread.h>
 
 #include <spa/support/system.h>
 #include <spa/pod/parser.h>
+#include <spa/pod/filter.h>
 #include <spa/node/utils.h>
 #include <spa/debug/types.h>
 
@@ -40,6 +42,7 @@
 #define NAME "node"
 
 #define DEFAULT_SYNC_TIMEOUT  ((uint64_t)(5 * SPA_NSEC_PER_SEC))
+#define MAX_SPIN_TIME		((uint64_t)(200 * SPA_NSEC_PER_USEC))
 
 /** \cond */
 struct impl {
@@ -49,7 +52,18 @@ struct impl {
 
 	int last_error;
 
+	struct pw_data_loop *loop;	/**< separate data loop for the graph of this driver */
+	struct spa_source *ready_event;	/**< to run the driver ready callback in the loop */
+	int ready_status;		/**< status of the ready callback, set from the loop of
+					  *  the plugin, read in the separate loop */
+
+	uint64_t spin_time;		/**< time to poll for a wakeup before sleeping */
+	pthread_t spin_thread;
+	struct spa_hook spin_hook;
+
 	unsigned int pause_on_idle:1;
+	unsigned int separate_loop:1;
+	unsigned int spin_hooked:1;
 };
 
 #define pw_node_resource(r,m,v,...)	pw_resource_call(r,struct pw_node_events,m,v,__VA_ARGS__)
@@ -141,13 +155,71 @@ static void remove_node(struct pw_impl_node *this)
 			nstate, nstate->pending, nstate->required);
 }
 
+static inline void sync_workers(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	if (driver != NULL)
+		pw_data_workers_sync(this->context->workers, &driver->rt.work);
+}
+
+void pw_impl_node_sync_workers(struct pw_impl_node *node)
+{
+	if (node->source.loop != NULL)
+		sync_workers(node, node->rt.driver_target.node);
+}
+
+/* called in the data loop before it goes to sleep, poll for a wakeup while
+ * we are waiting to be triggered in the current cycle */
+static void node_spin_before(void *data)
+{
+	struct impl *impl = data;
+	struct pw_impl_node *this = &impl->this;
+	struct pw_node_activation *a = this->rt.activation;
+
+	if (!pthread_equal(impl->spin_thread, pthread_self()) ||
+	    a->status != PW_NODE_ACTIVATION_NOT_TRIGGERED)
+		return;
+
+	if (pw_node_activation_spin(a, impl->spin_time)) {
+		pw_log_trace_fp(NAME" %p: got process after spin", this);
+		this->rt.target.signal(this->rt.target.data);
+	}
+}
+
+static const struct spa_loop_control_hooks spin_hooks = {
+	SPA_VERSION_LOOP_CONTROL_HOOKS,
+	.before = node_spin_before,
+};
+
+/* spinning blocks the other sources of the loop, only spin in the
+ * separate loop of a driver, never in the shared data loop */
+static void add_spin_hook(struct pw_impl_node *this, struct pw_loop *loop)
+{
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
+	if (impl->spin_time == 0 || loop == this->context->data_loop)
+		return;
+	impl->spin_thread = pthread_self();
+	pw_loop_add_hook(loop, &impl->spin_hook, &spin_hooks, impl);
+	impl->spin_hooked = true;
+}
+
+static void remove_spin_hook(struct pw_impl_node *this)
+{
+	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
+	if (!impl->spin_hooked)
+		return;
+	spa_hook_remove(&impl->spin_hook);
+	impl->spin_hooked = false;
+}
+
 static int
 do_node_remove(struct spa_loop *loop,
 	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct pw_impl_node *this = user_data;
 	if (this->source.loop != NULL) {
+		sync_workers(this, this->rt.driver_target.node);
 		spa_loop_remove_source(loop, &this->source);
+		remove_spin_hook(this);
 		remove_node(this);
 	}
 	return 0;
@@ -166,7 +238,8 @@ static int pause_node(struct pw_impl_node *this)
 
 	node_deactivate(this);
 
-	pw_loop_invoke(this->data_loop, do_node_remove, 1, NULL, 0, true, this);
+	pw_context_invoke(this->context, this->data_loop,
+			do_node_remove, 1, NULL, 0, true, this);
 
 	res = spa_node_send_command(this->node,
 				    &SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Pause));
@@ -276,7 +349,9 @@ do_node_add(struct spa_loop *loop,
 	struct pw_impl_node *driver = this->driver_node;
 
 	if (this->source.loop == NULL) {
+		sync_workers(this, driver);
 		spa_loop_add_source(loop, &this->source);
+		add_spin_hook(this, this->data_loop);
 		add_node(this, driver);
 	}
 	return 0;
@@ -307,7 +382,8 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 
 	switch (state) {
 	case PW_NODE_STATE_RUNNING:
-		pw_loop_invoke(node->data_loop, do_node_add, 1, NULL, 0, true, node);
+		pw_context_queue_invoke(node->context, node->data_loop,
+				do_node_add, 1, NULL, 0, true, node);
 		break;
 	default:
 		break;
@@ -642,12 +718,136 @@ do_move_nodes(struct spa_loop *loop,
 	pw_log_trace(NAME" %p: driver:%p->%p", this, this->driver_node, driver);
 
 	if (this->source.loop != NULL) {
+		sync_workers(this, this->rt.driver_target.node);
+		sync_workers(this, driver);
 		remove_node(this);
 		add_node(this, driver);
 	}
 	return 0;
 }
 
+struct move_loop {
+	struct pw_impl_node *driver;
+	struct pw_loop *loop;
+};
+
+static int
+do_move_loop(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	struct pw_impl_node *this = &impl->this;
+	const struct move_loop *d = data;
+
+	pw_log_trace(NAME" %p: driver:%p->%p loop:%p", this, this->driver_node,
+			d->driver, d->loop);
+
+	if (this->source.loop != NULL) {
+		sync_workers(this, this->rt.driver_target.node);
+		sync_workers(this, d->driver);
+		spa_loop_remove_source(this->source.loop, &this->source);
+		remove_spin_hook(this);
+		remove_node(this);
+		spa_loop_add_source(loop, &this->source);
+		add_spin_hook(this, d->loop);
+		add_node(this, d->driver);
+	}
+	return 0;
+}
+
+/* runs in the old loop of the node and blocks it while the node is
+ * moved in the new loop */
+static int
+do_switch_loop(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	const struct move_loop *d = data;
+	return pw_loop_invoke(d->loop, do_move_loop, SPA_ID_INVALID,
+			data, size, true, user_data);
+}
+
+static void move_loop(struct pw_impl_node *node, struct pw_impl_node *driver,
+		struct pw_loop *loop)
+{
+	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
+	struct move_loop d = { driver, loop };
+
+	pw_log_debug(NAME" %p: move from loop %p to %p", node, node->data_loop, loop);
+
+	pw_context_invoke(node->context, node->data_loop, do_switch_loop,
+			SPA_ID_INVALID, &d, sizeof(d), true, impl);
+	node->data_loop = loop;
+}
+
+static int node_ready(void *data, int status);
+
+static void do_driver_ready(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	node_ready(&impl->this, ATOMIC_LOAD(impl->ready_status));
+}
+
+static int do_destroy_ready(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct impl *impl = user_data;
+	pw_loop_destroy_source(pw_data_loop_get_loop(impl->loop), impl->ready_event);
+	impl->ready_event = NULL;
+	return 0;
+}
+
+static int make_driver_loop(struct pw_impl_node *driver, bool create)
+{
+	struct impl *impl = SPA_CONTAINER_OF(driver, struct impl, this);
+	struct pw_context *context = driver->context;
+	int res;
+
+	impl->loop = pw_context_acquire_driver_loop(context,
+			&driver->properties->dict, create);
+	if (impl->loop == NULL)
+		return -errno;
+
+	impl->ready_event = pw_loop_add_event(pw_data_loop_get_loop(impl->loop),
+			do_driver_ready, impl);
+	if (impl->ready_event == NULL) {
+		res = -errno;
+		pw_context_release_driver_loop(context, impl->loop);
+		impl->loop = NULL;
+		return res;
+	}
+
+	pw_log_info("(%s-%u) using separate data loop", driver->name, driver->info.id);
+
+	/* the driver itself goes first, the followers are moved when
+	 * they are assigned to the driver */
+	move_loop(driver, driver->driver_node, pw_data_loop_get_loop(impl->loop));
+
+	return 0;
+}
+
+/* get the data loop for the graph of driver. A loop that was made when the
+ * plugin of the driver was loaded is used right away, otherwise the loop is
+ * made when the first follower is added to a driver that wants a separate
+ * loop */
+static struct pw_loop *get_driver_loop(struct pw_impl_node *driver, bool create)
+{
+	struct impl *impl = SPA_CONTAINER_OF(driver, struct impl, this);
+	int res;
+
+	if (!driver->driver || !impl->separate_loop)
+		return driver->context->data_loop;
+
+	if (impl->loop == NULL) {
+		if ((res = make_driver_loop(driver, create)) < 0 && create)
+			pw_log_warn(NAME" %p: can't make data loop: %s", driver,
+					spa_strerror(res));
+	}
+	if (impl->loop == NULL)
+		return driver->context->data_loop;
+
+	return pw_data_loop_get_loop(impl->loop);
+}
+
 static void remove_segment_master(struct pw_impl_node *driver, uint32_t node_id)
 {
 	struct pw_node_activation *a = driver->rt.activation;
@@ -660,6 +860,7 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 {
 	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
 	struct pw_impl_node *old = node->driver_node;
+	struct pw_loop *loop;
 	int res;
 
 	if (driver == NULL)
@@ -668,8 +869,13 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 	spa_list_remove(&node->follower_link);
 	spa_list_append(&driver->follower_list, &node->follower_link);
 
-	if (old == driver)
+	loop = get_driver_loop(driver, driver != node);
+
+	if (old == driver) {
+		if (loop != node->data_loop)
+			move_loop(node, driver, loop);
 		return 0;
+	}
 
 	remove_segment_master(old, node->info.id);
 
@@ -694,7 +900,10 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 	pw_log_trace(NAME" %p: set position %p", node, &driver->rt.activation->position);
 	node->rt.position = &driver->rt.activation->position;
 
-	pw_loop_invoke(node->data_loop,
+	if (loop != node->data_loop)
+		move_loop(node, driver, loop);
+	else
+		pw_context_queue_invoke(node->context, node->data_loop,
 		       do_move_nodes, SPA_ID_INVALID, &driver, sizeof(struct pw_impl_node *),
 		       true, impl);
 	return 0;
@@ -744,6 +953,15 @@ static void check_properties(struct pw_impl_node *node)
 	else
 		node->want_driver = false;
 
+	if ((str = pw_properties_get(node->properties, PW_KEY_NODE_SPIN_TIME)) &&
+	    node->source.loop == NULL)
+		impl->spin_time = SPA_MIN(strtoull(str, NULL, 10), MAX_SPIN_TIME);
+
+	if ((str = pw_properties_get(node->properties, PW_KEY_NODE_LOOP_SEPARATE)))
+		impl->separate_loop = pw_properties_parse_bool(str);
+	else
+		impl->separate_loop = context->defaults.data_loop_per_driver;
+
 	if (node->driver != driver) {
 		pw_log_debug(NAME" %p: driver %d -> %d", node, node->driver, driver);
 		node->driver = driver;
@@ -815,12 +1033,67 @@ static void dump_states(struct pw_impl_node *driver)
 	}
 }
 
-static inline int resume_node(struct pw_impl_node *this, int status)
+/* called from the driver when the graph completed, only the driver of a
+ * node updates its timing. The driver is in its own target list, its
+ * signal_time is still the time it was triggered at the end of the graph. */
+static inline void update_timing(struct pw_impl_node *driver)
 {
 	struct pw_node_target *t;
+
+	spa_list_for_each(t, &driver->rt.target_list, link) {
+		struct pw_impl_node *n = t->node;
+		struct pw_node_activation *a;
+		struct pw_node_timing *tm;
+		uint64_t wakeup, process;
+
+		if (n == NULL)
+			continue;
+
+		a = t->activation;
+		if (a->status != PW_NODE_ACTIVATION_FINISHED ||
+		    a->awake_time < a->signal_time ||
+		    a->finish_time < a->awake_time)
+			continue;
+
+		tm = &n->rt.timing;
+		wakeup = a->awake_time - a->signal_time;
+		process = a->finish_time - a->awake_time;
+
+		tm->wakeup[pw_node_timing_bucket(wakeup)]++;
+		tm->process[pw_node_timing_bucket(process)]++;
+		if (wakeup > tm->wakeup_max)
+			tm->wakeup_max = wakeup;
+		if (process > tm->process_max)
+			tm->process_max = process;
+		tm->cycles++;
+	}
+}
+
+static inline int process_node(void *data);
+
+/* complete the cycle of a local driver from its data loop */
+static inline void signal_driver(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	struct impl *impl = SPA_CONTAINER_OF(driver, struct impl, this);
+	struct pw_context *context = this->context;
+
+	if (driver->rt.target.signal != process_node ||
+	    pw_data_loop_in_thread(impl->loop ? impl->loop : context->data_loop_impl)) {
+		process_node(driver);
+	} else if (pw_node_activation_wakeup(driver->rt.activation) &&
+	    SPA_UNLIKELY(spa_system_eventfd_write(context->data_system,
+					driver->source.fd, 1) < 0)) {
+		pw_log_warn(NAME" %p: write failed %m", this);
+	}
+}
+
+static inline int resume_node(struct pw_impl_node *this, int status)
+{
+	struct pw_node_target *t, *ready = NULL;
 	struct timespec ts;
 	struct pw_node_activation *activation = this->rt.activation;
 	struct spa_system *data_system = this->context->data_system;
+	struct pw_data_workers *workers = this->context->workers;
 	uint64_t nsec;
 
 	spa_system_clock_gettime(data_system, CLOCK_MONOTONIC, &ts);
@@ -840,9 +1113,24 @@ static inline int resume_node(struct pw_impl_node *this, int status)
 		if (pw_node_activation_state_dec(state, 1)) {
 			a->status = PW_NODE_ACTIVATION_TRIGGERED;
 			a->signal_time = nsec;
-			t->signal(t->data);
+
+			/* with workers, we keep one local target for ourselves and
+			 * let the workers process the others in parallel */
+			if (SPA_LIKELY(workers == NULL) || t->signal != process_node)
+				t->signal(t->data);
+			else if (t == &this->rt.driver_target)
+				signal_driver(this, t->node);
+			else if (ready == NULL)
+				ready = t;
+			else if (!pw_data_workers_dispatch(workers,
+					&this->rt.driver_target.node->rt.work,
+					t->signal, t->data))
+				t->signal(t->data);
 		}
 	}
+	if (ready != NULL)
+		ready->signal(ready->data);
+
 	return 0;
 }
 
@@ -889,12 +1177,15 @@ static inline int process_node(void *data)
 	}
 
 	if (SPA_UNLIKELY(this == this->driver_node && !this->exported)) {
+		uint64_t start_time = a->finish_time;
+
 		spa_system_clock_gettime(data_system, CLOCK_MONOTONIC, &ts);
 		a->status = PW_NODE_ACTIVATION_FINISHED;
-		a->signal_time = a->finish_time;
 		a->finish_time = SPA_TIMESPEC_TO_NSEC(&ts);
+		update_timing(this);
 
 		/* calculate CPU time */
+		a->signal_time = start_time;
 		calculate_stats(this, a);
 
 		pw_log_trace_fp(NAME" %p: graph completed wait:%"PRIu64" run:%"PRIu64
@@ -965,6 +1256,26 @@ static void reset_position(struct pw_impl_node *this, struct spa_io_position *po
 		reset_segment(&pos->segments[i]);
 }
 
+/* the client in PW_KEY_CLIENT_ID, set by the factories that make nodes
+ * for a client */
+static struct pw_impl_client *find_client(struct pw_context *context,
+		const struct pw_properties *properties)
+{
+	struct pw_impl_client *client;
+	const char *str;
+	uint32_t id;
+
+	if ((str = pw_properties_get(properties, PW_KEY_CLIENT_ID)) == NULL)
+		return NULL;
+
+	id = pw_properties_parse_int(str);
+	spa_list_for_each(client, &context->client_list, link) {
+		if (client->global != NULL && client->global->id == id)
+			return client;
+	}
+	return NULL;
+}
+
 SPA_EXPORT
 struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 			    struct pw_properties *properties,
@@ -1011,11 +1322,15 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 
 	size = sizeof(struct pw_node_activation);
 
-	this->activation = pw_mempool_alloc(this->context->pool,
+	/* the activations of the nodes of a client share a slab, the peers
+	 * of a node can see the activations of the other nodes of the client */
+	this->client = find_client(context, properties);
+	this->activation = pw_mempool_alloc_owned(this->context->pool,
 			PW_MEMBLOCK_FLAG_READWRITE |
 			PW_MEMBLOCK_FLAG_SEAL |
-			PW_MEMBLOCK_FLAG_MAP,
-			SPA_DATA_MemFd, size);
+			PW_MEMBLOCK_FLAG_MAP |
+			PW_MEMBLOCK_FLAG_SLAB,
+			SPA_DATA_MemFd, size, this->client);
 	if (this->activation == NULL) {
 		res = -errno;
                 goto error_clean;
@@ -1036,6 +1351,8 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 	this->info.state = PW_NODE_STATE_CREATING;
 	this->info.props = &this->properties->dict;
 	this->info.params = this->params;
+	this->params[this->info.n_params++] =
+		SPA_PARAM_INFO(SPA_PARAM_Timing, SPA_PARAM_INFO_READ);
 
 	spa_list_init(&this->input_ports);
 	pw_map_init(&this->input_port_map, 64, 64);
@@ -1154,23 +1471,38 @@ static void node_info(void *data, const struct spa_node_info *info)
 		update_properties(node, info->props);
 	}
 	if (info->change_mask & SPA_NODE_CHANGE_MASK_PARAMS) {
-		uint32_t i;
+		struct spa_param_info old[MAX_PARAMS];
+		uint32_t i, j, n_old, flags;
+
+		n_old = node->info.n_params;
+		memcpy(old, node->info.params, n_old * sizeof(old[0]));
 
 		node->info.change_mask |= PW_NODE_CHANGE_MASK_PARAMS;
-		node->info.n_params = SPA_MIN(info->n_params, SPA_N_ELEMENTS(node->params));
+		/* keep room for the timing param */
+		node->info.n_params = SPA_MIN(info->n_params, SPA_N_ELEMENTS(node->params) - 1);
 
 		for (i = 0; i < node->info.n_params; i++) {
+			/* params are matched by id, their position can change */
+			for (j = 0, flags = 0; j < n_old; j++) {
+				if (old[j].id == info->params[i].id) {
+					flags = old[j].flags;
+					break;
+				}
+			}
 			pw_log_debug(NAME" %p: param %d id:%d (%s) %08x:%08x", node, i,
 					info->params[i].id,
 					spa_debug_type_find_name(spa_type_param, info->params[i].id),
-					node->info.params[i].flags, info->params[i].flags);
+					flags, info->params[i].flags);
 
-			if (node->info.params[i].flags != info->params[i].flags &&
+			if (flags != info->params[i].flags &&
 			    info->params[i].flags & SPA_PARAM_INFO_READ)
 				changed_ids[n_changed_ids++] = info->params[i].id;
 
 			node->info.params[i] = info->params[i];
 		}
+		/* timing is handled here, not in the spa node */
+		node->info.params[node->info.n_params++] =
+			SPA_PARAM_INFO(SPA_PARAM_Timing, SPA_PARAM_INFO_READ);
 	}
 	emit_info_changed(node);
 
@@ -1354,12 +1686,23 @@ static int node_ready(void *data, int status)
 			node->driver, node->exported, driver, status);
 
 	if (SPA_UNLIKELY(node == driver)) {
+		struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
 		struct pw_node_activation *a = node->rt.activation;
 		struct pw_node_activation_state *state = &a->state[0];
 		int sync_type, all_ready, update_sync, target_sync;
 		uint32_t owner[2], reposition_owner;
 		uint64_t min_timeout = UINT64_MAX;
 
+		/* the driver wakes up in the loop it was made with, run
+		 * the graph in the separate loop */
+		if (SPA_UNLIKELY(impl->loop != NULL &&
+		    !pw_data_loop_in_thread(impl->loop))) {
+			ATOMIC_STORE(impl->ready_status, status);
+			pw_loop_signal_event(pw_data_loop_get_loop(impl->loop),
+					impl->ready_event);
+			return 0;
+		}
+
 		if (SPA_UNLIKELY(state->pending > 0)) {
 			pw_context_driver_emit_incomplete(node->context, node);
 			if (ratelimit_test(&node->rt.rate_limit, a->signal_time)) {
@@ -1541,6 +1884,9 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 	pw_log_info("(%s-%u) destroy", node->name, node->info.id);
 	pw_impl_node_emit_destroy(node);
 
+	/* queued invokes might still reference the node */
+	pw_context_flush_invoke(node->context);
+
 	suspend_node(node);
 
 	pw_log_debug(NAME" %p: driver node %p", impl, node->driver_node);
@@ -1585,9 +1931,22 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 	if (active)
 		pw_context_recalc_graph(node->context, "active node destroy");
 
+	if (impl->loop) {
+		pw_context_invoke(node->context, node->data_loop,
+				do_node_remove, 1, NULL, 0, true, node);
+		pw_loop_invoke(pw_data_loop_get_loop(impl->loop),
+				do_destroy_ready, 1, NULL, 0, true, impl);
+		node->data_loop = node->context->data_loop;
+	}
+
 	pw_log_debug(NAME" %p: free", node);
 	pw_impl_node_emit_free(node);
 
+	/* the plugin is unloaded now and has removed its sources from
+	 * the loop */
+	if (impl->loop)
+		pw_context_release_driver_loop(node->context, impl->loop);
+
 	pw_memblock_unref(node->activation);
 
 	pw_work_queue_destroy(impl->work);
@@ -1648,6 +2007,52 @@ static void result_node_params(void *data, int seq, int res, uint32_t type, cons
 	}
 }
 
+static int enum_timing(struct pw_impl_node *node, int seq,
+		uint32_t index, uint32_t max, const struct spa_pod *filter,
+		int (*callback) (void *data, int seq,
+			uint32_t id, uint32_t index, uint32_t next,
+			struct spa_pod *param),
+		void *data)
+{
+	struct pw_node_timing *tm = &node->rt.timing;
+	int64_t bounds[PW_NODE_TIMING_BUCKETS];
+	uint64_t wakeup[PW_NODE_TIMING_BUCKETS];
+	uint64_t process[PW_NODE_TIMING_BUCKETS];
+	uint8_t buffer[8192];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *param;
+	uint32_t i;
+
+	if (index > 0 || max == 0)
+		return 0;
+
+	/* the data thread updates the values while we copy them, this
+	 * is fine for statistics */
+	for (i = 0; i < PW_NODE_TIMING_BUCKETS; i++) {
+		bounds[i] = pw_node_timing_bound(i);
+		wakeup[i] = tm->wakeup[i];
+		process[i] = tm->process[i];
+	}
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamTiming, SPA_PARAM_Timing,
+			SPA_PARAM_TIMING_cycles,	SPA_POD_Long(tm->cycles),
+			SPA_PARAM_TIMING_bounds,	SPA_POD_Array(sizeof(int64_t), SPA_TYPE_Long,
+								PW_NODE_TIMING_BUCKETS, bounds),
+			SPA_PARAM_TIMING_wakeup,	SPA_POD_Array(sizeof(int64_t), SPA_TYPE_Long,
+								PW_NODE_TIMING_BUCKETS, wakeup),
+			SPA_PARAM_TIMING_wakeupMax,	SPA_POD_Long(tm->wakeup_max),
+			SPA_PARAM_TIMING_process,	SPA_POD_Array(sizeof(int64_t), SPA_TYPE_Long,
+								PW_NODE_TIMING_BUCKETS, process),
+			SPA_PARAM_TIMING_processMax,	SPA_POD_Long(tm->process_max));
+
+	if (filter != NULL && spa_pod_filter(&b, &param, param, filter) < 0)
+		return 0;
+
+	return callback(data, seq, SPA_PARAM_Timing, 0, 1, param);
+}
+
 SPA_EXPORT
 int pw_impl_node_for_each_param(struct pw_impl_node *node,
 			   int seq, uint32_t param_id,
@@ -1673,6 +2078,9 @@ int pw_impl_node_for_each_param(struct pw_impl_node *node,
 			spa_debug_type_find_name(spa_type_param, param_id),
 			index, max);
 
+	if (param_id == SPA_PARAM_Timing)
+		return enum_timing(node, seq, index, max, filter, callback, data);
+
 	spa_zero(listener);
 	spa_node_add_listener(node->node, &listener, &node_events, &user_data);
 	res = spa_node_enum_params(node->node, seq,
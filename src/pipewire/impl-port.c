@@ -622,6 +622,8 @@ static int do_add_port(struct spa_loop *loop,
 {
         struct pw_impl_port *this = user_data;
 
+	pw_impl_node_sync_workers(this->node);
+
 	if (this->direction == PW_DIRECTION_INPUT)
 		spa_list_append(&this->node->rt.input_mix, &this->rt.node_link);
 	else
@@ -901,7 +903,8 @@ int pw_impl_port_add(struct pw_impl_port *port, struct pw_impl_node *node)
 	if (node->global)
 		pw_impl_port_register(port, NULL);
 
-	pw_loop_invoke(node->data_loop, do_add_port, SPA_ID_INVALID, NULL, 0, false, port);
+	pw_context_queue_invoke(node->context, node->data_loop,
+			do_add_port, SPA_ID_INVALID, NULL, 0, false, port);
 
 	if (port->state <= PW_IMPL_PORT_STATE_INIT)
 		pw_impl_port_update_state(port, PW_IMPL_PORT_STATE_CONFIGURE, NULL);
@@ -928,6 +931,8 @@ static int do_remove_port(struct spa_loop *loop,
 {
         struct pw_impl_port *this = user_data;
 
+	pw_impl_node_sync_workers(this->node);
+
 	spa_list_remove(&this->rt.node_link);
 
 	return 0;
@@ -943,7 +948,7 @@ static void pw_impl_port_remove(struct pw_impl_port *port)
 
 	pw_log_debug(NAME" %p: remove", port);
 
-	pw_loop_invoke(port->node->data_loop, do_remove_port,
+	pw_context_invoke(node->context, node->data_loop, do_remove_port,
 		       SPA_ID_INVALID, NULL, 0, true, port);
 
 	if (SPA_FLAG_IS_SET(port->flags, PW_IMPL_PORT_FLAG_TO_REMOVE)) {
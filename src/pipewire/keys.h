@@ -119,6 +119,10 @@ extern "C" {
 #define PW_KEY_CLIENT_NAME		"client.name"		/**< the client name */
 #define PW_KEY_CLIENT_API		"client.api"		/**< the client api used to access
 								  *  PipeWire */
+#define PW_KEY_REGISTRY_TYPES		"registry.types"	/**< comma separated list of interface
+								  *  types the registry of the client
+								  *  announces, all types when not set.
+								  *  Ex. "Node,Port,Link" */
 
 /** Node keys */
 #define PW_KEY_NODE_ID			"node.id"		/**< node id */
@@ -143,6 +147,16 @@ extern "C" {
 #define PW_KEY_NODE_DRIVER		"node.driver"		/**< node can drive the graph */
 #define PW_KEY_NODE_STREAM		"node.stream"		/**< node is a stream, the server side should
 								  *  add a converter */
+#define PW_KEY_NODE_LOOP_SEPARATE	"node.loop.separate"	/**< a driver node runs its graph in its
+								  *  own data loop */
+#define PW_KEY_NODE_LOOP_RT_PRIO	"node.loop.rt-prio"	/**< realtime priority of the separate
+								  *  data loop */
+#define PW_KEY_NODE_LOOP_CPU_AFFINITY	"node.loop.cpu-affinity"	/**< comma separated list of CPUs for
+								  *  the separate data loop. Ex: "2,3" */
+#define PW_KEY_NODE_SPIN_TIME		"node.spin-time"	/**< time in nanoseconds to poll for a
+								  *  wakeup before waiting on the eventfd,
+								  *  at most 200000. Only used in the
+								  *  separate data loop of a driver */
 /** Port keys */
 #define PW_KEY_PORT_ID			"port.id"		/**< port id */
 #define PW_KEY_PORT_NAME		"port.name"		/**< port name */
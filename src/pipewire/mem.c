@@ -33,8 +33,13 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <sys/syscall.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
 
 #include <spa/utils/list.h>
+#include <spa/utils/result.h>
 #include <spa/buffer/buffer.h>
 
 #include <pipewire/log.h>
@@ -72,6 +77,14 @@ static inline int memfd_create(const char *name, unsigned int flags)
 #define MFD_ALLOW_SEALING 0x0002U
 #endif
 
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB       0x0004U
+#endif
+
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC   0x958458f6
+#endif
+
 /* fcntl() seals-related flags */
 
 #ifndef F_LINUX_SPECIFIC_BASE
@@ -105,6 +118,37 @@ struct mempool {
 	struct pw_map map;
 	struct spa_list blocks;
 	uint32_t pagesize;
+
+	uint32_t slab_size;		/**< 0 when slabs are disabled */
+	struct spa_list slabs;
+
+	uint32_t hugepage_size;		/**< size of a huge page of a memfd */
+	unsigned int hugepages:1;	/**< try to back slabs and large blocks
+					  *  with huge pages */
+	unsigned int mlock:1;		/**< prefault and lock allocated memory */
+	unsigned int mlock_failed:1;
+};
+
+/* a large sealed memfd that small blocks are carved out of. All blocks
+ * share the fd so that it is only sent once to a client. Anyone with the
+ * fd can map all of it, so a slab only holds blocks of one owner, or of
+ * one owner and peer pair. */
+struct slab {
+	struct spa_list link;
+	const void *owners[2];		/**< sorted, owners[1] is NULL without peer */
+	int fd;
+	void *ptr;
+	uint32_t size;
+	uint32_t used;
+	uint32_t n_blocks;
+	unsigned int retired:1;		/**< the owner is gone, no new blocks */
+	struct spa_list free;		/**< free ranges, sorted by offset */
+};
+
+struct slab_range {
+	struct spa_list link;
+	uint32_t offset;
+	uint32_t size;
 };
 
 struct memblock {
@@ -112,6 +156,10 @@ struct memblock {
 	struct spa_list link;
 	struct spa_list mappings;
 	struct spa_list maps;
+	struct slab *slab;		/**< slab when carved out of one */
+	uint32_t slab_offset;
+	uint32_t slab_size;
+	uint32_t pagesize;		/**< mapping granularity of the fd */
 };
 
 struct mapping {
@@ -130,10 +178,26 @@ struct memmap {
 	struct spa_list link;
 };
 
+static int create_hugetlb_fd(struct mempool *impl, size_t *size);
+
+/* the size of the huge pages of a memfd or 0 when there are none */
+static uint32_t probe_hugepage_size(struct mempool *impl)
+{
+	size_t size = 1;
+	int fd;
+
+	if ((fd = create_hugetlb_fd(impl, &size)) < 0)
+		return 0;
+	close(fd);
+	return size;
+}
+
+SPA_EXPORT
 struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 {
 	struct mempool *impl;
 	struct pw_mempool *this;
+	const char *str;
 
 	impl = calloc(1, sizeof(struct mempool));
 	if (impl == NULL)
@@ -149,6 +213,21 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 	spa_hook_list_init(&impl->listener_list);
 	pw_map_init(&impl->map, 64, 64);
 	spa_list_init(&impl->blocks);
+	spa_list_init(&impl->slabs);
+
+	if (props && (str = pw_properties_get(props, "mem.slab-size")) != NULL)
+		impl->slab_size = SPA_ROUND_UP_N(pw_properties_parse_int(str),
+				impl->pagesize);
+	if (props && (str = pw_properties_get(props, "mem.hugepages")) != NULL)
+		impl->hugepages = pw_properties_parse_bool(str);
+	if (props && (str = pw_properties_get(props, "mem.allow-mlock")) != NULL)
+		impl->mlock = pw_properties_parse_bool(str);
+
+	if (impl->hugepages &&
+	    (impl->hugepage_size = probe_hugepage_size(impl)) == 0) {
+		pw_log_warn(NAME" %p: no huge pages, using normal pages", this);
+		impl->hugepages = false;
+	}
 
 	spa_list_append(&_mempools, &impl->link);
 
@@ -164,6 +243,7 @@ void pw_mempool_clear(struct pw_mempool *pool)
 		pw_memblock_free(&b->this);
 }
 
+SPA_EXPORT
 void pw_mempool_destroy(struct pw_mempool *pool)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
@@ -174,6 +254,9 @@ void pw_mempool_destroy(struct pw_mempool *pool)
 
 	pw_mempool_clear(pool);
 
+	/* slabs go away with their last block */
+	spa_assert(spa_list_is_empty(&impl->slabs));
+
 	spa_list_remove(&impl->link);
 
 	pw_map_clear(&impl->map);
@@ -183,6 +266,27 @@ void pw_mempool_destroy(struct pw_mempool *pool)
 }
 
 
+SPA_EXPORT
+int pw_mempool_get_stats(struct pw_mempool *pool, struct pw_mempool_stats *stats)
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	struct slab *s;
+	struct slab_range *r;
+
+	spa_zero(*stats);
+	spa_list_for_each(s, &impl->slabs, link) {
+		stats->n_slabs++;
+		stats->n_blocks += s->n_blocks;
+		stats->size += s->size;
+		stats->used += s->used;
+		spa_list_for_each(r, &s->free, link) {
+			stats->n_free++;
+			stats->max_free = SPA_MAX(stats->max_free, r->size);
+		}
+	}
+	return 0;
+}
+
 void pw_mempool_add_listener(struct pw_mempool *pool,
 			     struct spa_hook *listener,
 			     const struct pw_mempool_events *events,
@@ -347,7 +451,7 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 	struct memmap *mm;
 	struct pw_map_range range;
 
-	pw_map_range_init(&range, offset, size, p->pagesize);
+	pw_map_range_init(&range, offset, size, b->pagesize);
 
 	m = memblock_find_mapping(b, flags, range.offset, range.size);
 	if (m == NULL)
@@ -428,22 +532,406 @@ static inline enum pw_memmap_flags block_flags_to_mem(enum pw_memblock_flags fla
 	return fl;
 }
 
-/** Create a new memblock
+static int create_fd(struct mempool *impl, size_t size, bool seal)
+{
+	int fd, res;
+
+#ifdef USE_MEMFD
+	fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd == -1) {
+		res = -errno;
+		pw_log_error(NAME" %p: Failed to create memfd: %m", impl);
+		return res;
+	}
+#else
+	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
+	fd = mkostemp(filename, O_CLOEXEC);
+	if (fd == -1) {
+		res = -errno;
+		pw_log_error(NAME" %p: Failed to create temporary file: %m", impl);
+		return res;
+	}
+	unlink(filename);
+#endif
+
+	if (ftruncate(fd, size) < 0) {
+		res = -errno;
+		pw_log_warn(NAME" %p: Failed to truncate temporary file: %m", impl);
+		close(fd);
+		return res;
+	}
+#ifdef USE_MEMFD
+	if (seal) {
+		unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+		if (fcntl(fd, F_ADD_SEALS, seals) == -1) {
+			pw_log_warn(NAME" %p: Failed to add seals: %m", impl);
+		}
+	}
+#endif
+	return fd;
+}
+
+/* make a memfd backed by huge pages, size is rounded up to the huge
+ * page size */
+static int create_hugetlb_fd(struct mempool *impl, size_t *size)
+{
+#ifdef USE_MEMFD
+	struct stat st;
+	int fd, res;
+
+	fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+	if (fd == -1)
+		return -errno;
+
+	if (fstat(fd, &st) < 0 || st.st_blksize <= 0)
+		goto error_close;
+
+	*size = SPA_ROUND_UP_N(*size, (size_t)st.st_blksize);
+	if (ftruncate(fd, *size) < 0)
+		goto error_close;
+
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL) == -1)
+		pw_log_debug(NAME" %p: Failed to add seals: %m", impl);
+
+	return fd;
+
+error_close:
+	res = -errno;
+	close(fd);
+	return res;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/* the granularity that an fd can be mapped with, huge pages can only be
+ * mapped in units of the huge page size */
+static uint32_t fd_pagesize(struct mempool *impl, int fd)
+{
+#ifdef __linux__
+	struct statfs st;
+
+	if (fd >= 0 && fstatfs(fd, &st) == 0 &&
+	    (uint32_t)st.f_type == HUGETLBFS_MAGIC && st.f_bsize > impl->pagesize)
+		return st.f_bsize;
+#endif
+	return impl->pagesize;
+}
+
+/* mapped blocks of at least half a huge page get huge pages of their own,
+ * smaller blocks only get them in a slab */
+static int memblock_create_fd(struct mempool *impl, struct memblock *b)
+{
+	size_t size = b->this.size;
+	void *ptr;
+	int fd, res;
+
+	if (impl->hugepages &&
+	    (b->this.flags & PW_MEMBLOCK_FLAG_MAP) &&
+	    size >= impl->hugepage_size / 2) {
+		if ((fd = create_hugetlb_fd(impl, &size)) < 0) {
+			res = fd;
+		} else if ((ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+						MAP_SHARED, fd, 0)) == MAP_FAILED) {
+			/* no huge pages could be reserved */
+			res = -errno;
+			close(fd);
+		} else {
+			/* the pages reserved by a shared mapping stay with
+			 * the fd for the real mapping */
+			munmap(ptr, size);
+			b->pagesize = fd_pagesize(impl, fd);
+			return fd;
+		}
+		pw_log_warn(NAME" %p: can't use huge pages, using normal pages: %s",
+				impl, spa_strerror(res));
+		impl->hugepages = false;
+	}
+	return create_fd(impl, b->this.size, b->this.flags & PW_MEMBLOCK_FLAG_SEAL);
+}
+
+static void lock_memory(struct mempool *impl, void *ptr, size_t size)
+{
+	if (mlock(ptr, size) < 0) {
+		/* usually the memlock limit, only warn the first time */
+		if (!impl->mlock_failed)
+			pw_log_warn(NAME" %p: Failed to mlock memory %p %zd: %m",
+					impl, ptr, size);
+		else
+			pw_log_debug(NAME" %p: Failed to mlock memory %p %zd: %m",
+					impl, ptr, size);
+		impl->mlock_failed = true;
+	}
+}
+
+static void *slab_map(struct mempool *impl, int fd, size_t size)
+{
+	void *ptr;
+	int flags = MAP_SHARED;
+
+	/* fault in all pages now instead of in the processing thread */
+	if (impl->mlock)
+		flags |= MAP_POPULATE;
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+
+	if (impl->mlock)
+		lock_memory(impl, ptr, size);
+
+	return ptr;
+}
+
+/* the slab key doesn't depend on the order of owner and peer */
+static void slab_owners(const void *owners[2], const void *owner, const void *peer)
+{
+	if (owner == NULL || owner == peer) {
+		owner = peer;
+		peer = NULL;
+	}
+	if (peer != NULL && (uintptr_t)peer < (uintptr_t)owner) {
+		owners[0] = peer;
+		owners[1] = owner;
+	} else {
+		owners[0] = owner;
+		owners[1] = peer;
+	}
+}
+
+static struct slab *slab_new(struct mempool *impl, const void *owners[2])
+{
+	struct slab *s;
+	struct slab_range *r;
+	size_t size;
+	int res;
+
+	if ((s = calloc(1, sizeof(struct slab))) == NULL)
+		return NULL;
+	if ((r = calloc(1, sizeof(struct slab_range))) == NULL) {
+		res = -errno;
+		goto error_free;
+	}
+
+	s->ptr = NULL;
+	if (impl->hugepages) {
+		size = impl->slab_size;
+		if ((s->fd = create_hugetlb_fd(impl, &size)) < 0) {
+			res = s->fd;
+		} else if ((s->ptr = slab_map(impl, s->fd, size)) == NULL) {
+			/* no huge pages could be reserved */
+			res = -errno;
+			close(s->fd);
+		}
+		if (s->ptr == NULL) {
+			pw_log_warn(NAME" %p: can't use huge pages, using normal pages: %s",
+					impl, spa_strerror(res));
+			impl->hugepages = false;
+		}
+	}
+	if (s->ptr == NULL) {
+		size = impl->slab_size;
+		if ((s->fd = create_fd(impl, size, true)) < 0) {
+			res = s->fd;
+			goto error_free_range;
+		}
+		if ((s->ptr = slab_map(impl, s->fd, size)) == NULL) {
+			res = -errno;
+			pw_log_error(NAME" %p: Failed to mmap slab fd:%d size:%zd: %m",
+					impl, s->fd, size);
+			goto error_close;
+		}
+	}
+	s->owners[0] = owners[0];
+	s->owners[1] = owners[1];
+	s->size = size;
+	spa_list_init(&s->free);
+	r->offset = 0;
+	r->size = s->size;
+	spa_list_append(&s->free, &r->link);
+	spa_list_append(&impl->slabs, &s->link);
+
+	pw_log_debug(NAME" %p: new slab %p owners:%p,%p fd:%d size:%u hugepages:%d",
+			impl, s, owners[0], owners[1], s->fd, s->size, impl->hugepages);
+
+	return s;
+
+error_close:
+	close(s->fd);
+error_free_range:
+	free(r);
+error_free:
+	free(s);
+	errno = -res;
+	return NULL;
+}
+
+static void slab_free(struct mempool *impl, struct slab *s)
+{
+	struct slab_range *r;
+
+	pw_log_debug(NAME" %p: free slab %p fd:%d", impl, s, s->fd);
+
+	spa_list_consume(r, &s->free, link) {
+		spa_list_remove(&r->link);
+		free(r);
+	}
+	spa_list_remove(&s->link);
+	munmap(s->ptr, s->size);
+	close(s->fd);
+	free(s);
+}
+
+/* first fit, the range is split when it is larger */
+static int slab_alloc_range(struct slab *s, uint32_t size, uint32_t *offset)
+{
+	struct slab_range *r;
+
+	spa_list_for_each(r, &s->free, link) {
+		if (r->size < size)
+			continue;
+
+		*offset = r->offset;
+		r->offset += size;
+		r->size -= size;
+		if (r->size == 0) {
+			spa_list_remove(&r->link);
+			free(r);
+		}
+		s->used += size;
+		s->n_blocks++;
+		return 0;
+	}
+	return -ENOSPC;
+}
+
+/* put a range back, merging it with its free neighbours */
+static int slab_free_range(struct slab *s, uint32_t offset, uint32_t size)
+{
+	struct slab_range *r, *prev = NULL, *next = NULL;
+
+	spa_list_for_each(r, &s->free, link) {
+		if (r->offset > offset) {
+			next = r;
+			break;
+		}
+		prev = r;
+	}
+	s->used -= size;
+	s->n_blocks--;
+
+	if (prev && prev->offset + prev->size == offset) {
+		prev->size += size;
+		if (next && offset + size == next->offset) {
+			prev->size += next->size;
+			spa_list_remove(&next->link);
+			free(next);
+		}
+		return 0;
+	}
+	if (next && offset + size == next->offset) {
+		next->offset = offset;
+		next->size += size;
+		return 0;
+	}
+	if ((r = calloc(1, sizeof(struct slab_range))) == NULL)
+		return -errno;
+	r->offset = offset;
+	r->size = size;
+	if (next)
+		spa_list_append(&next->link, &r->link);
+	else
+		spa_list_append(&s->free, &r->link);
+	return 0;
+}
+
+/* carve the block out of a slab and add a mapping for it that points
+ * into the slab mapping */
+static int memblock_slab_alloc(struct mempool *impl, struct memblock *b,
+		const void *owners[2])
+{
+	struct slab *s;
+	struct mapping *m;
+	uint32_t size, offset = 0;
+	int res;
+
+	size = SPA_ROUND_UP_N(b->this.size, impl->pagesize);
+
+	if ((m = calloc(1, sizeof(struct mapping))) == NULL)
+		return -errno;
+
+	res = -ENOSPC;
+	spa_list_for_each(s, &impl->slabs, link) {
+		if (s->retired ||
+		    s->owners[0] != owners[0] || s->owners[1] != owners[1])
+			continue;
+		if ((res = slab_alloc_range(s, size, &offset)) == 0)
+			break;
+	}
+	if (res < 0) {
+		if ((s = slab_new(impl, owners)) == NULL) {
+			res = -errno;
+			free(m);
+			return res;
+		}
+		slab_alloc_range(s, size, &offset);
+	}
+
+	b->slab = s;
+	b->slab_offset = offset;
+	b->slab_size = size;
+	b->this.fd = s->fd;
+
+	m->ptr = SPA_MEMBER(s->ptr, offset, void);
+	m->block = b;
+	m->offset = offset;
+	m->size = size;
+	b->this.ref++;
+	spa_list_append(&b->mappings, &m->link);
+
+	pw_log_debug(NAME" %p: block:%p slab:%p fd:%d offset:%u size:%u", impl,
+			&b->this, s, s->fd, offset, size);
+	return 0;
+}
+
+static void memblock_slab_free(struct mempool *impl, struct memblock *b)
+{
+	struct slab *s = b->slab;
+	struct mapping *m;
+
+	/* the mappings point into the slab mapping */
+	spa_list_consume(m, &b->mappings, link) {
+		spa_list_remove(&m->link);
+		free(m);
+	}
+	slab_free_range(s, b->slab_offset, b->slab_size);
+	if (s->n_blocks == 0)
+		slab_free(impl, s);
+	b->slab = NULL;
+}
+
+/** Create a new memblock that is only shared with \a owner and \a peer
  * \param pool the pool to use
  * \param flags memblock flags
  * \param type the requested memory type one of enum spa_data_type
  * \param size size to allocate
+ * \param owner the owner of the block or NULL
+ * \param peer the other user of the block or NULL
  * \return a memblock structure or NULL with errno on error
  * \memberof pw_memblock
  */
 SPA_EXPORT
-struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_flags flags,
-		uint32_t type, size_t size)
+struct pw_memblock * pw_mempool_alloc_shared(struct pw_mempool *pool, enum pw_memblock_flags flags,
+		uint32_t type, size_t size, const void *owner, const void *peer)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
+	const void *owners[2];
+	uint32_t offset = 0;
 	int res;
 
+	slab_owners(owners, owner, peer);
+
 	b = calloc(1, sizeof(struct memblock));
 	if (b == NULL)
 		return NULL;
@@ -453,67 +941,116 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 	b->this.flags = flags;
 	b->this.type = type;
 	b->this.size = size;
+	b->pagesize = impl->pagesize;
 	spa_list_init(&b->mappings);
 	spa_list_init(&b->maps);
 
-#ifdef USE_MEMFD
-	b->this.fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
-	if (b->this.fd == -1) {
-		res = -errno;
-		pw_log_error(NAME" %p: Failed to create memfd: %m", pool);
-		goto error_free;
-	}
-#else
-	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
-	b->this.fd = mkostemp(filename, O_CLOEXEC);
-	if (b->this.fd == -1) {
-		res = -errno;
-		pw_log_error(NAME" %p: Failed to create temporary file: %m", pool);
-		goto error_free;
-	}
-	unlink(filename);
-#endif
-
-	if (ftruncate(b->this.fd, size) < 0) {
-		res = -errno;
-		pw_log_warn(NAME" %p: Failed to truncate temporary file: %m", pool);
-		goto error_close;
-	}
-#ifdef USE_MEMFD
-	if (flags & PW_MEMBLOCK_FLAG_SEAL) {
-		unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
-		if (fcntl(b->this.fd, F_ADD_SEALS, seals) == -1) {
-			pw_log_warn(NAME" %p: Failed to add seals: %m", pool);
+	/* small mapped blocks of an owner are carved out of a slab of that
+	 * owner and peer, large ones get their own fd */
+	if (impl->slab_size > 0 && size > 0 && size <= impl->slab_size / 4 &&
+	    owners[0] != NULL &&
+	    (flags & PW_MEMBLOCK_FLAG_SLAB) &&
+	    (flags & PW_MEMBLOCK_FLAG_MAP)) {
+		if ((res = memblock_slab_alloc(impl, b, owners)) < 0)
+			goto error_free;
+		offset = b->slab_offset;
+	} else {
+		if ((b->this.fd = memblock_create_fd(impl, b)) < 0) {
+			res = b->this.fd;
+			goto error_free;
 		}
 	}
-#endif
+
 	if (flags & PW_MEMBLOCK_FLAG_MAP && size > 0) {
 		b->this.map = pw_memblock_map(&b->this,
-				block_flags_to_mem(flags), 0, size, NULL);
+				block_flags_to_mem(flags), offset, size, NULL);
 		if (b->this.map == NULL) {
 			res = -errno;
 			pw_log_warn(NAME" %p: Failed to map: %m", pool);
 			goto error_close;
 		}
 		b->this.ref--;
+
+		/* slabs are locked when they are made */
+		if (impl->mlock && b->slab == NULL)
+			lock_memory(impl, b->this.map->ptr, size);
 	}
 
 	b->this.id = pw_map_insert_new(&impl->map, b);
 	spa_list_append(&impl->blocks, &b->link);
-	pw_log_debug(NAME" %p: block:%p id:%d type:%u", pool, &b->this, b->this.id, type);
+	pw_log_debug(NAME" %p: block:%p id:%d type:%u size:%zu pagesize:%u", pool,
+			&b->this, b->this.id, type, size, b->pagesize);
 
 	pw_mempool_emit_added(impl, &b->this);
 
 	return &b->this;
 
 error_close:
-	close(b->this.fd);
+	if (b->slab)
+		memblock_slab_free(impl, b);
+	else
+		close(b->this.fd);
 error_free:
 	free(b);
 	errno = -res;
 	return NULL;
 }
 
+/** Create a new memblock that is only shared with \a owner
+ * \param pool the pool to use
+ * \param flags memblock flags
+ * \param type the requested memory type one of enum spa_data_type
+ * \param size size to allocate
+ * \param owner the owner of the block or NULL
+ * \return a memblock structure or NULL with errno on error
+ * \memberof pw_memblock
+ */
+SPA_EXPORT
+struct pw_memblock * pw_mempool_alloc_owned(struct pw_mempool *pool, enum pw_memblock_flags flags,
+		uint32_t type, size_t size, const void *owner)
+{
+	return pw_mempool_alloc_shared(pool, flags, type, size, owner, NULL);
+}
+
+/** Stop carving new blocks out of the slabs of \a owner. Call this
+ * when the owner goes away so that a new owner at the same address
+ * can't get a block in a slab that was shared with the old one.
+ * \param pool the pool to use
+ * \param owner the owner
+ * \memberof pw_memblock
+ */
+SPA_EXPORT
+void pw_mempool_disown(struct pw_mempool *pool, const void *owner)
+{
+	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
+	struct slab *s;
+
+	if (owner == NULL)
+		return;
+
+	spa_list_for_each(s, &impl->slabs, link) {
+		if (s->owners[0] != owner && s->owners[1] != owner)
+			continue;
+		pw_log_debug(NAME" %p: disown slab %p owner:%p", impl, s, owner);
+		s->retired = true;
+	}
+}
+
+/** Create a new memblock
+ * \param pool the pool to use
+ * \param flags memblock flags
+ * \param type the requested memory type one of enum spa_data_type
+ * \param size size to allocate
+ * \return a memblock structure or NULL with errno on error
+ * \memberof pw_memblock
+ */
+SPA_EXPORT
+struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_flags flags,
+		uint32_t type, size_t size)
+{
+	return pw_mempool_alloc_owned(pool, flags, type, size, NULL);
+}
+
 static struct memblock * mempool_find_fd(struct pw_mempool *pool, int fd)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
@@ -554,6 +1091,7 @@ struct pw_memblock * pw_mempool_import(struct pw_mempool *pool,
 	b->this.type = type;
 	b->this.fd = fd;
 	b->this.flags = flags;
+	b->pagesize = fd_pagesize(impl, fd);
 	b->this.id = pw_map_insert_new(&impl->map, b);
 	spa_list_append(&impl->blocks, &b->link);
 
@@ -569,9 +1107,18 @@ SPA_EXPORT
 struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 		struct pw_memblock *mem)
 {
-	return pw_mempool_import(pool,
+	struct memblock *o = SPA_CONTAINER_OF(mem, struct memblock, this), *b;
+	struct pw_memblock *block;
+
+	block = pw_mempool_import(pool,
 			mem->flags | PW_MEMBLOCK_FLAG_DONT_CLOSE,
 			mem->type, mem->fd);
+	/* mappings are shared with the other pool, keep its granularity */
+	if (block != NULL) {
+		b = SPA_CONTAINER_OF(block, struct memblock, this);
+		b->pagesize = o->pagesize;
+	}
+	return block;
 }
 
 SPA_EXPORT
@@ -581,7 +1128,7 @@ struct pw_memmap * pw_mempool_import_map(struct pw_mempool *pool,
 	struct pw_memblock *old, *block;
 	struct memblock *b;
 	struct pw_memmap *map;
-	struct mapping *m;
+	struct mapping *m, *om;
 	uint32_t offset;
 
 	old = pw_mempool_find_ptr(other, data);
@@ -594,24 +1141,28 @@ struct pw_memmap * pw_mempool_import_map(struct pw_mempool *pool,
 	if (block == NULL)
 		return NULL;
 
-	if (block->ref == 1) {
-		b = SPA_CONTAINER_OF(block, struct memblock, this);
+	b = SPA_CONTAINER_OF(block, struct memblock, this);
+	om = (SPA_CONTAINER_OF(old->map, struct memmap, this))->mapping;
 
+	/* reuse the mapping of the other pool, blocks carved out of the
+	 * same slab share the block but each bring their own mapping */
+	if (block->ref == 1 ||
+	    memblock_find_mapping(b, 0, om->offset, om->size) == NULL) {
 		m = calloc(1, sizeof(struct mapping));
 		if (m == NULL) {
 			pw_memblock_unref(block);
 			return NULL;
 		}
-		m->ptr = old->map->ptr;
+		m->ptr = om->ptr;
 		m->block = b;
-		m->offset = old->map->offset;
-		m->size = old->map->size;
+		m->offset = om->offset;
+		m->size = om->size;
 		spa_list_append(&b->mappings, &m->link);
 	} else {
 		block->ref--;
 	}
 
-	offset = SPA_PTRDIFF(data, old->map->ptr);
+	offset = om->offset + SPA_PTRDIFF(data, om->ptr);
 
 	map = pw_memblock_map(block,
 			block_flags_to_mem(block->flags), offset, size, tag);
@@ -672,7 +1223,9 @@ void pw_memblock_free(struct pw_memblock *block)
 	spa_list_consume(mm, &b->maps, link)
 		pw_memmap_free(&mm->this);
 
-	if (block->fd != -1 && !(block->flags & PW_MEMBLOCK_FLAG_DONT_CLOSE)) {
+	if (b->slab) {
+		memblock_slab_free(impl, b);
+	} else if (block->fd != -1 && !(block->flags & PW_MEMBLOCK_FLAG_DONT_CLOSE)) {
 		pw_log_debug(NAME" %p: close fd:%d", pool, block->fd);
 		close(block->fd);
 	}
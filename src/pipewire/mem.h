@@ -39,6 +39,12 @@ enum pw_memblock_flags {
 	PW_MEMBLOCK_FLAG_SEAL = (1 << 2),
 	PW_MEMBLOCK_FLAG_MAP = (1 << 3),
 	PW_MEMBLOCK_FLAG_DONT_CLOSE = (1 << 4),
+	PW_MEMBLOCK_FLAG_SLAB = (1 << 5),	/**< the block can be carved out of a
+						  *  larger fd of its owner when the pool
+						  *  has slabs, see pw_mempool_alloc_owned().
+						  *  Use with PW_MEMBLOCK_FLAG_MAP, the
+						  *  offset of the block in the fd is
+						  *  then in map->offset */
 
 	PW_MEMBLOCK_FLAG_READWRITE = PW_MEMBLOCK_FLAG_READABLE | PW_MEMBLOCK_FLAG_WRITABLE,
 };
@@ -96,7 +102,21 @@ struct pw_mempool_events {
 	void (*removed) (void *data, struct pw_memblock *block);
 };
 
-/** Create a new memory pool */
+/** Statistics of the slabs of a pool */
+struct pw_mempool_stats {
+	uint32_t n_slabs;		/**< number of slabs */
+	uint32_t n_blocks;		/**< number of blocks allocated in slabs */
+	uint64_t size;			/**< total size of the slabs */
+	uint64_t used;			/**< bytes used by blocks */
+	uint32_t n_free;		/**< number of free ranges */
+	uint64_t max_free;		/**< size of the largest free range */
+};
+
+/** Create a new memory pool. When the "mem.slab-size" property is set
+ * to a non zero size, blocks of an owner allocated with
+ * PW_MEMBLOCK_FLAG_SLAB are carved out of memfds of that size. With
+ * "mem.hugepages", slabs and mapped blocks of at least half a huge page
+ * use huge pages when there are any. */
 struct pw_mempool *pw_mempool_new(struct pw_properties *props);
 
 /** Listen for events */
@@ -105,6 +125,9 @@ void pw_mempool_add_listener(struct pw_mempool *pool,
                             const struct pw_mempool_events *events,
                             void *data);
 
+/** Get the slab statistics of a pool */
+int pw_mempool_get_stats(struct pw_mempool *pool, struct pw_mempool_stats *stats);
+
 /** Clear a pool */
 void pw_mempool_clear(struct pw_mempool *pool);
 
@@ -116,6 +139,25 @@ void pw_mempool_destroy(struct pw_mempool *pool);
 struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool,
 		enum pw_memblock_flags flags, uint32_t type, size_t size);
 
+/** Allocate a memory block that is only shared with \a owner, usually a
+ * client. Blocks with PW_MEMBLOCK_FLAG_SLAB can be carved out of a slab
+ * that only holds blocks of the same owner. */
+struct pw_memblock * pw_mempool_alloc_owned(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size,
+		const void *owner);
+
+/** Allocate a memory block that is only shared with \a owner and \a peer,
+ * usually the clients at the two ends of a link. Blocks with
+ * PW_MEMBLOCK_FLAG_SLAB can be carved out of a slab that only holds blocks
+ * of the same owner and peer, in any order. */
+struct pw_memblock * pw_mempool_alloc_shared(struct pw_mempool *pool,
+		enum pw_memblock_flags flags, uint32_t type, size_t size,
+		const void *owner, const void *peer);
+
+/** Don't carve new blocks out of the slabs of \a owner, call this when
+ * the owner is destroyed */
+void pw_mempool_disown(struct pw_mempool *pool, const void *owner);
+
 /** Import a block from another pool */
 struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 		struct pw_memblock *mem);
@@ -31,6 +31,7 @@ extern "C" {
 
 #include <sys/socket.h>
 #include <sys/types.h> /* for pthread_t */
+#include <time.h>
 
 #include "pipewire/impl.h"
 
@@ -57,6 +58,10 @@ struct defaults {
 	struct spa_fraction video_rate;
 	uint32_t link_max_buffers;
 	unsigned int mem_allow_mlock;
+	uint32_t mem_slab_size;
+	unsigned int mem_hugepages;
+	uint32_t data_loop_workers;
+	unsigned int data_loop_per_driver;
 };
 
 struct ratelimit {
@@ -218,6 +223,8 @@ struct pw_global {
 	pw_global_bind_func_t func;	/**< bind function */
 	void *object;			/**< object associated with the interface */
 
+	struct spa_pod *snapshot;	/**< serialized for registry snapshots */
+
 	struct spa_list resource_list;	/**< The list of resources of this global */
 };
 
@@ -279,6 +286,7 @@ struct pw_context_driver_events {
 #define pw_registry_resource(r,m,v,...) pw_resource_call(r, struct pw_registry_events,m,v,##__VA_ARGS__)
 #define pw_registry_resource_global(r,...)        pw_registry_resource(r,global,0,__VA_ARGS__)
 #define pw_registry_resource_global_remove(r,...) pw_registry_resource(r,global_remove,0,__VA_ARGS__)
+#define pw_registry_resource_snapshot(r,...)	pw_resource_call_res(r,struct pw_registry_events,snapshot,1,__VA_ARGS__)
 
 #define pw_context_emit(o,m,v,...) spa_hook_list_call(&o->listener_list, struct pw_context_events, m, v, ##__VA_ARGS__)
 #define pw_context_emit_destroy(c)		pw_context_emit(c, destroy, 0)
@@ -306,6 +314,10 @@ struct pw_context {
 	struct spa_list module_list;		/**< list of modules */
 	struct spa_list device_list;		/**< list of devices */
 	struct spa_list global_list;		/**< list of globals */
+	struct spa_pod_builder registry_snapshot;	/**< all globals serialized for new registries,
+							  *  no data when it needs to be made */
+	uint32_t registry_snapshot_removed;	/**< globals removed from the snapshot since
+						  *  it was last used */
 	struct spa_list client_list;		/**< list of clients */
 	struct spa_list node_list;		/**< list of nodes */
 	struct spa_list factory_list;		/**< list of factories */
@@ -321,6 +333,8 @@ struct pw_context {
 	struct pw_loop *data_loop;	/**< data loop for data passing */
         struct pw_data_loop *data_loop_impl;
 	struct spa_system *data_system;	/**< data system for data passing */
+	struct pw_data_workers *workers;	/**< pool of data loops to process ready nodes,
+						  *  NULL when processing on the data loop only */
 
 	struct spa_support support[16];	/**< support for spa plugins */
 	uint32_t n_support;		/**< number of support items */
@@ -345,10 +359,65 @@ struct pw_data_loop {
 	struct spa_source *event;
 
 	pthread_t thread;
+	int rt_prio;			/**< realtime priority of the thread, 0 to leave unchanged */
+	char *affinity;			/**< comma separated list of CPUs or NULL */
 	unsigned int created:1;
 	unsigned int running:1;
 };
 
+#define PW_DATA_WORKERS_MAX		64u
+#define PW_DATA_WORK_QUEUE_SIZE		1024u
+#define PW_DATA_WORK_QUEUE_MASK		(PW_DATA_WORK_QUEUE_SIZE - 1)
+
+/** counts the work dispatched to the workers by one graph */
+struct pw_data_work_group {
+	int32_t busy;			/**< number of queued and running work items */
+	int32_t waiting;		/**< number of threads waiting for busy to drop to 0 */
+};
+
+struct pw_data_work {
+	uint32_t seq;			/**< sequence number of the queue slot */
+	struct pw_data_work_group *group;
+	int (*signal) (void *data);
+	void *data;
+};
+
+/** a pool of data loops that process nodes when they become ready.
+ * Ready nodes are pushed on a bounded multi-producer multi-consumer
+ * queue and idle workers are woken up to pull and process them. */
+struct pw_data_workers {
+	struct pw_context *context;
+	uint32_t n_workers;
+	struct pw_data_loop *loops[PW_DATA_WORKERS_MAX];
+	struct spa_source *wakeups[PW_DATA_WORKERS_MAX];
+
+	uint32_t next;			/**< next worker to wake up */
+
+	uint32_t head;			/**< read position */
+	uint32_t tail;			/**< write position */
+	struct pw_data_work queue[PW_DATA_WORK_QUEUE_SIZE];
+};
+
+struct pw_data_workers *pw_data_workers_new(struct pw_context *context,
+		uint32_t n_workers, const struct spa_dict *props);
+
+void pw_data_workers_destroy(struct pw_data_workers *workers);
+
+/** Dispatch \a signal to the workers and count it in \a group. Returns false
+ * when there are no workers or when the queue is full, the caller should then
+ * call \a signal itself. */
+bool pw_data_workers_dispatch(struct pw_data_workers *workers,
+		struct pw_data_work_group *group,
+		int (*signal) (void *data), void *data);
+
+/** Wait until the work dispatched for \a group has completed. This should be
+ * called from the data loop before changing the scheduling lists of the nodes
+ * of the graph. The caller sleeps until the last worker of the group wakes it
+ * up, work of other graphs is not waited for. Nodes in other processes are
+ * not waited for, they are never dispatched to the workers. */
+void pw_data_workers_sync(struct pw_data_workers *workers,
+		struct pw_data_work_group *group);
+
 #define pw_main_loop_emit(o,m,v,...) spa_hook_list_call(&o->listener_list, struct pw_main_loop_events, m, v, ##__VA_ARGS__)
 #define pw_main_loop_emit_destroy(o) pw_main_loop_emit(o, destroy, 0)
 
@@ -482,6 +551,10 @@ struct pw_node_activation {
 	uint32_t command;				/* next command */
 	uint32_t reposition_owner;			/* owner id with new reposition info, last one
 							 * to update wins */
+
+	uint32_t spinning;				/* the node is polling the activation, cleared
+							 * by the peer that wakes it up instead of
+							 * writing the eventfd */
 };
 
 #define ATOMIC_CAS(v,ov,nv)						\
@@ -497,6 +570,90 @@ struct pw_node_activation {
 #define ATOMIC_STORE(s,v)		__atomic_store_n(&(s), (v), __ATOMIC_SEQ_CST)
 #define ATOMIC_XCHG(s,v)		__atomic_exchange_n(&(s), (v), __ATOMIC_SEQ_CST)
 
+/** Wake up the node of \a a. Returns true when the node is not polling
+ * for the wakeup and its eventfd needs to be written. Peers that don't
+ * know about polling always write the eventfd. */
+static inline bool pw_node_activation_wakeup(struct pw_node_activation *a)
+{
+	return !ATOMIC_CAS(a->spinning, 1u, 0u);
+}
+
+/** Poll for a wakeup of \a a for at most \a spin_ns nanoseconds. Returns
+ * true when there was a wakeup, false when the node needs to wait on the
+ * eventfd. A wakeup is delivered either here or on the eventfd, never on
+ * both. */
+static inline bool pw_node_activation_spin(struct pw_node_activation *a, uint64_t spin_ns)
+{
+	struct timespec ts;
+	uint64_t end;
+	int i;
+
+	ATOMIC_STORE(a->spinning, 1u);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	end = SPA_TIMESPEC_TO_NSEC(&ts) + spin_ns;
+	do {
+		for (i = 0; i < 64; i++) {
+			if (ATOMIC_LOAD(a->spinning) == 0)
+				return true;
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+	} while ((uint64_t) SPA_TIMESPEC_TO_NSEC(&ts) < end);
+
+	/* when the flag was cleared in the meantime, the peer took the
+	 * wakeup and did not write the eventfd */
+	return !ATOMIC_CAS(a->spinning, 1u, 0u);
+}
+
+/* log-linear histogram buckets. The first bucket has everything below
+ * 1 << PW_NODE_TIMING_MIN_SHIFT nsec, then each power of 2 is split in
+ * 1 << PW_NODE_TIMING_SUB_BITS buckets up to 1 << PW_NODE_TIMING_MAX_SHIFT
+ * nsec. The last bucket has all larger values. */
+#define PW_NODE_TIMING_MIN_SHIFT	10
+#define PW_NODE_TIMING_MAX_SHIFT	30
+#define PW_NODE_TIMING_SUB_BITS		2
+#define PW_NODE_TIMING_BUCKETS		(2 + ((PW_NODE_TIMING_MAX_SHIFT - PW_NODE_TIMING_MIN_SHIFT) \
+						<< PW_NODE_TIMING_SUB_BITS))
+
+struct pw_node_timing {
+	uint64_t cycles;
+	uint64_t wakeup[PW_NODE_TIMING_BUCKETS];
+	uint64_t wakeup_max;
+	uint64_t process[PW_NODE_TIMING_BUCKETS];
+	uint64_t process_max;
+};
+
+static inline uint32_t pw_node_timing_bucket(uint64_t nsec)
+{
+	uint32_t e, sub;
+
+	if (nsec < (1ULL << PW_NODE_TIMING_MIN_SHIFT))
+		return 0;
+	e = 63 - __builtin_clzll(nsec);
+	if (e >= PW_NODE_TIMING_MAX_SHIFT)
+		return PW_NODE_TIMING_BUCKETS - 1;
+	sub = (nsec >> (e - PW_NODE_TIMING_SUB_BITS)) & ((1 << PW_NODE_TIMING_SUB_BITS) - 1);
+	return 1 + ((e - PW_NODE_TIMING_MIN_SHIFT) << PW_NODE_TIMING_SUB_BITS) + sub;
+}
+
+/* the upper bound of a bucket, values in the bucket are smaller */
+static inline int64_t pw_node_timing_bound(uint32_t bucket)
+{
+	uint32_t e, sub;
+
+	if (bucket == 0)
+		return 1LL << PW_NODE_TIMING_MIN_SHIFT;
+	if (bucket >= PW_NODE_TIMING_BUCKETS - 1)
+		return INT64_MAX;
+	bucket--;
+	e = PW_NODE_TIMING_MIN_SHIFT + (bucket >> PW_NODE_TIMING_SUB_BITS);
+	sub = bucket & ((1 << PW_NODE_TIMING_SUB_BITS) - 1);
+	return (1LL << e) + ((int64_t)(sub + 1) << (e - PW_NODE_TIMING_SUB_BITS));
+}
+
 #define SEQ_WRITE(s)			ATOMIC_INC(s)
 #define SEQ_WRITE_SUCCESS(s1,s2)	((s1) + 1 == (s2) && ((s2) & 1) == 0)
 
@@ -529,6 +686,9 @@ struct pw_impl_node {
 	struct spa_hook global_listener;
 
 	struct pw_properties *properties;	/**< properties of the node */
+	struct pw_impl_client *client;		/**< client the node was made for or NULL,
+						  *  the memory of the node is carved out
+						  *  of slabs of this client */
 
 	struct pw_node_info info;		/**< introspectable node info */
 	struct spa_param_info params[MAX_PARAMS];
@@ -589,6 +749,11 @@ struct pw_impl_node {
 		struct spa_list driver_link;		/* our link in driver */
 
 		struct ratelimit rate_limit;
+
+		struct pw_node_timing timing;		/* updated by the driver of the node */
+
+		struct pw_data_work_group work;		/* work dispatched to the workers by
+							 * the graph of this driver */
 	} rt;
 
         void *user_data;                /**< extra user data */
@@ -995,6 +1160,43 @@ void pw_proxy_remove(struct pw_proxy *proxy);
 
 int pw_context_recalc_graph(struct pw_context *context, const char *reason);
 
+int pw_context_invoke(struct pw_context *context, struct pw_loop *loop,
+		spa_invoke_func_t func, uint32_t seq, const void *data, size_t size,
+		bool block, void *user_data);
+int pw_context_flush_invoke(struct pw_context *context);
+
+/** Get the separate data loop for the driver with \a props, made when
+ * \a create is true and there is none */
+struct pw_data_loop *pw_context_acquire_driver_loop(struct pw_context *context,
+		const struct spa_dict *props, bool create);
+void pw_context_release_driver_loop(struct pw_context *context, struct pw_data_loop *loop);
+
+/** Add and remove driver event listeners, the data loops are blocked
+ * while the listener list is changed */
+int pw_context_driver_add_listener(struct pw_context *context,
+			  struct spa_hook *listener,
+			  const struct pw_context_driver_events *events,
+			  void *data);
+int pw_context_driver_remove_listener(struct pw_context *context,
+			  struct spa_hook *listener);
+
+/** Keep the registry snapshot of the context up to date */
+void pw_context_snapshot_add_global(struct pw_context *context, struct pw_global *global);
+void pw_context_snapshot_remove_global(struct pw_context *context, struct pw_global *global);
+
+/** Check if \a type is in a \ref PW_KEY_REGISTRY_TYPES list */
+bool pw_registry_types_match(const char *types, const char *type);
+/** Check if the registry of \a client announces globals of \a type */
+bool pw_impl_client_registry_wants(struct pw_impl_client *client, const char *type);
+
+/** Negotiate buffers that are only shared with \a owner and \a peer, see
+ * pw_mempool_alloc_shared() */
+int pw_buffers_negotiate_shared(struct pw_context *context, uint32_t flags,
+		struct spa_node *outnode, uint32_t out_port_id,
+		struct spa_node *innode, uint32_t in_port_id,
+		const void *owner, const void *peer,
+		struct pw_buffers *result);
+
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
 int pw_impl_port_register(struct pw_impl_port *port,
@@ -1066,6 +1268,10 @@ int pw_impl_node_update_ports(struct pw_impl_node *node);
 
 int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driver);
 
+/** Wait for the work the graph of \a node dispatched to the workers, call
+ * from the data loop of the node */
+void pw_impl_node_sync_workers(struct pw_impl_node *node);
+
 /** Prepare a link \memberof pw_impl_link
   * Starts the negotiation of formats and buffers on \a link */
 int pw_impl_link_prepare(struct pw_impl_link *link);
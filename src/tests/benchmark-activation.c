@@ -0,0 +1,234 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "pipewire/private.h"
+
+#define MAX_COUNT 20000
+#define MAX_FOLLOWERS 16
+
+/* a node that is woken up with the activation and an eventfd, like a
+ * node in another thread or process */
+struct peer {
+	struct pw_node_activation *activation;
+	int fd;
+	uint64_t spin_ns;
+};
+
+struct bench {
+	struct peer peer[2];
+	pthread_t thread;
+};
+
+static void peer_wakeup(struct peer *p)
+{
+	uint64_t cmd = 1;
+
+	if (pw_node_activation_wakeup(p->activation) &&
+	    write(p->fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+		fprintf(stderr, "write failed: %m\n");
+}
+
+static void peer_wait(struct peer *p)
+{
+	struct pollfd pfd = { .fd = p->fd, .events = POLLIN };
+	uint64_t cmd;
+
+	if (p->spin_ns > 0 &&
+	    pw_node_activation_spin(p->activation, p->spin_ns))
+		return;
+
+	while (true) {
+		if (poll(&pfd, 1, -1) < 0)
+			continue;
+		if (read(p->fd, &cmd, sizeof(cmd)) == sizeof(cmd))
+			return;
+	}
+}
+
+static int peer_init(struct peer *p, uint64_t spin_ns)
+{
+	p->activation = calloc(1, sizeof(struct pw_node_activation));
+	p->fd = eventfd(0, EFD_CLOEXEC);
+	p->spin_ns = spin_ns;
+	return p->activation == NULL || p->fd < 0 ? -1 : 0;
+}
+
+static void peer_clear(struct peer *p)
+{
+	close(p->fd);
+	free(p->activation);
+}
+
+static void *pong_thread(void *data)
+{
+	struct bench *b = data;
+	int i;
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		peer_wait(&b->peer[1]);
+		peer_wakeup(&b->peer[0]);
+	}
+	return NULL;
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void run_bench(const char *name, uint64_t spin_ns)
+{
+	struct bench b;
+	uint64_t t1, t2;
+	int i;
+
+	spa_zero(b);
+	for (i = 0; i < 2; i++)
+		peer_init(&b.peer[i], spin_ns);
+
+	pthread_create(&b.thread, NULL, pong_thread, &b);
+
+	t1 = get_time();
+	for (i = 0; i < MAX_COUNT; i++) {
+		peer_wakeup(&b.peer[1]);
+		peer_wait(&b.peer[0]);
+	}
+	t2 = get_time();
+
+	pthread_join(b.thread, NULL);
+
+	fprintf(stderr, "%s: elapsed %"PRIu64" count %d = %"PRIu64"/sec, %"PRIu64" nsec/cycle\n",
+			name, t2 - t1, MAX_COUNT,
+			MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+			(t2 - t1) / MAX_COUNT);
+
+	for (i = 0; i < 2; i++)
+		peer_clear(&b.peer[i]);
+}
+
+/* a driver and its followers, each in its own thread like nodes in
+ * different clients. The driver wakes up all followers, the last one to
+ * finish wakes up the driver again to complete the cycle. */
+struct graph {
+	struct peer driver;
+	struct peer followers[MAX_FOLLOWERS];
+	pthread_t threads[MAX_FOLLOWERS];
+	uint32_t n_followers;
+};
+
+struct follower {
+	struct graph *g;
+	uint32_t index;
+};
+
+static void *follower_thread(void *data)
+{
+	struct follower *f = data;
+	struct graph *g = f->g;
+	struct peer *p = &g->followers[f->index];
+	struct pw_node_activation_state *state = &g->driver.activation->state[0];
+	int i;
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		peer_wait(p);
+		if (pw_node_activation_state_dec(state, 1))
+			peer_wakeup(&g->driver);
+	}
+	free(f);
+	return NULL;
+}
+
+static void run_graph(const char *name, uint32_t n_followers, uint64_t spin_ns)
+{
+	struct graph g;
+	struct pw_node_activation_state *state;
+	uint64_t t1, t2, t, max = 0;
+	uint32_t i;
+	int j;
+
+	spa_zero(g);
+	g.n_followers = n_followers;
+	peer_init(&g.driver, spin_ns);
+	for (i = 0; i < n_followers; i++)
+		peer_init(&g.followers[i], spin_ns);
+
+	state = &g.driver.activation->state[0];
+	state->required = n_followers;
+
+	for (i = 0; i < n_followers; i++) {
+		struct follower *f = calloc(1, sizeof(*f));
+		f->g = &g;
+		f->index = i;
+		pthread_create(&g.threads[i], NULL, follower_thread, f);
+	}
+
+	t1 = get_time();
+	for (j = 0; j < MAX_COUNT; j++) {
+		t = get_time();
+		pw_node_activation_state_reset(state);
+		for (i = 0; i < n_followers; i++)
+			peer_wakeup(&g.followers[i]);
+		peer_wait(&g.driver);
+		max = SPA_MAX(max, get_time() - t);
+	}
+	t2 = get_time();
+
+	for (i = 0; i < n_followers; i++)
+		pthread_join(g.threads[i], NULL);
+
+	fprintf(stderr, "%s: %u followers, elapsed %"PRIu64" count %d, %"PRIu64" nsec/cycle, max %"PRIu64"\n",
+			name, n_followers, t2 - t1, MAX_COUNT, (t2 - t1) / MAX_COUNT, max);
+
+	peer_clear(&g.driver);
+	for (i = 0; i < n_followers; i++)
+		peer_clear(&g.followers[i]);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t n_followers = 4;
+
+	if (argc > 1)
+		n_followers = SPA_CLAMP(atoi(argv[1]), 1, MAX_FOLLOWERS);
+
+	run_bench("eventfd", 0);
+	run_bench("spin 10us", 10 * SPA_NSEC_PER_USEC);
+	run_bench("spin 50us", 50 * SPA_NSEC_PER_USEC);
+
+	run_graph("graph eventfd", n_followers, 0);
+	run_graph("graph spin 10us", n_followers, 10 * SPA_NSEC_PER_USEC);
+	run_graph("graph spin 50us", n_followers, 50 * SPA_NSEC_PER_USEC);
+	return 0;
+}
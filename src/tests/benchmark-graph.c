@@ -0,0 +1,494 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include <spa/utils/names.h>
+#include <spa/node/node.h>
+#include <spa/param/audio/format-utils.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#include "pipewire/private.h"
+
+#define DEFAULT_CHAINS		4
+#define DEFAULT_DEPTH		4
+#define DEFAULT_CYCLES		2000
+#define DEFAULT_QUANTUM		64
+#define DEFAULT_WORKERS		0
+
+#define WARMUP_CYCLES		16
+#define MAX_NODES		1024
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	uint32_t n_chains;
+	uint32_t depth;
+	uint32_t n_cycles;
+	uint32_t quantum;
+	uint32_t n_workers;
+	bool transaction;
+	bool mlock;
+	bool hugepages;
+	bool separate;
+	uint32_t slab_size;
+
+	struct pw_impl_client *client;
+
+	struct pw_impl_node *driver;
+	struct pw_impl_node *nodes[MAX_NODES];
+	uint32_t n_nodes;
+
+	struct spa_hook driver_listener;
+
+	/* written from the data loop */
+	uint32_t warmup;
+	uint32_t cycle;
+	uint32_t incomplete;
+	uint32_t xrun;
+	uint64_t *cycle_time;
+	uint64_t *driver_wakeup;
+	uint64_t *node_wakeup;
+	uint32_t n_node_wakeup;
+};
+
+static struct pw_impl_node *make_node(struct data *d, const char *factory_name,
+		const char *name, bool driver)
+{
+	struct pw_impl_node *node;
+	struct pw_properties *props;
+	struct spa_handle *handle;
+	void *iface;
+	int res;
+
+	props = pw_properties_new(PW_KEY_NODE_NAME, name, NULL);
+	if (!driver) {
+		pw_properties_set(props, PW_KEY_NODE_ALWAYS_PROCESS, "true");
+		pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/48000", d->quantum);
+	} else if (d->separate) {
+		pw_properties_set(props, PW_KEY_NODE_LOOP_SEPARATE, "true");
+	}
+	/* the activations of the nodes of a client share a slab */
+	if (d->client != NULL)
+		pw_properties_setf(props, PW_KEY_CLIENT_ID, "%u", d->client->global->id);
+
+	handle = pw_context_load_spa_handle(d->context, factory_name, &props->dict);
+	if (handle == NULL) {
+		pw_properties_free(props);
+		return NULL;
+	}
+
+	if ((res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface)) < 0) {
+		pw_properties_free(props);
+		errno = -res;
+		return NULL;
+	}
+
+	node = pw_context_create_node(d->context, props, 0);
+	if (node == NULL)
+		return NULL;
+
+	pw_impl_node_set_implementation(node, iface);
+	pw_impl_node_register(node, NULL);
+	pw_impl_node_set_active(node, true);
+
+	return node;
+}
+
+static struct pw_impl_port *get_port(struct pw_impl_node *node, enum spa_direction direction)
+{
+	struct pw_impl_port *p;
+	uint32_t port_id;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_audio_info_raw info = {
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = 1,
+	};
+	int res;
+
+	p = pw_impl_node_find_port(node, direction, PW_ID_ANY);
+	if (p == NULL || pw_impl_port_is_linked(p)) {
+		/* the node makes the port when the mixer announces it */
+		port_id = pw_impl_node_get_free_port_id(node, direction);
+		if (port_id == SPA_ID_INVALID)
+			return NULL;
+
+		if ((res = spa_node_add_port(node->node, direction, port_id, NULL)) < 0) {
+			errno = -res;
+			return NULL;
+		}
+		if ((p = pw_impl_node_find_port(node, direction, port_id)) == NULL) {
+			errno = ENOENT;
+			return NULL;
+		}
+	}
+
+	/* the link uses the format of the ports */
+	if ((res = pw_impl_port_set_param(p, SPA_PARAM_Format, 0,
+			spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info))) < 0) {
+		errno = -res;
+		return NULL;
+	}
+	return p;
+}
+
+static int link_nodes(struct data *d, struct pw_impl_node *output, struct pw_impl_node *input)
+{
+	struct pw_impl_port *outport, *inport;
+	struct pw_impl_link *link;
+
+	if ((outport = get_port(output, SPA_DIRECTION_OUTPUT)) == NULL ||
+	    (inport = get_port(input, SPA_DIRECTION_INPUT)) == NULL)
+		return -errno;
+
+	link = pw_context_create_link(d->context, outport, inport, NULL, NULL, 0);
+	if (link == NULL)
+		return -errno;
+
+	return pw_impl_link_register(link, NULL);
+}
+
+static int build_graph(struct data *d)
+{
+	struct pw_impl_node *prev;
+	uint32_t i, j;
+	char name[64];
+	int res;
+
+	if (d->slab_size > 0) {
+		d->client = pw_context_create_client(d->context->core, NULL, NULL, 0);
+		if (d->client == NULL)
+			return -errno;
+		if ((res = pw_impl_client_register(d->client, NULL)) < 0)
+			return res;
+	}
+
+	if ((d->driver = make_node(d, SPA_NAME_SUPPORT_NODE_DRIVER, "driver", true)) == NULL)
+		return -errno;
+
+	for (i = 0; i < d->n_chains; i++) {
+		prev = NULL;
+		for (j = 0; j < d->depth; j++) {
+			struct pw_impl_node *node;
+
+			snprintf(name, sizeof(name), "chain-%u-%u", i, j);
+			if ((node = make_node(d, SPA_NAME_AUDIO_MIXER, name, false)) == NULL)
+				return -errno;
+
+			d->nodes[d->n_nodes++] = node;
+
+			if (prev && (res = link_nodes(d, prev, node)) < 0)
+				return res;
+			prev = node;
+		}
+	}
+	return 0;
+}
+
+static int make_graph(struct data *d)
+{
+	struct spa_loop_stats before, after;
+	struct timespec t0, t1;
+	int res;
+
+	pw_loop_get_stats(d->context->data_loop, &before);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	if (d->transaction)
+		pw_context_begin_transaction(d->context);
+	res = build_graph(d);
+	if (d->transaction)
+		pw_context_commit_transaction(d->context);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	pw_loop_get_stats(d->context->data_loop, &after);
+
+	fprintf(stdout, "%-16s %8"PRIu64" usec, %"PRIu64" invokes%s\n", "graph setup",
+			(uint64_t)(SPA_TIMESPEC_TO_NSEC(&t1) - SPA_TIMESPEC_TO_NSEC(&t0)) / 1000,
+			after.invoked - before.invoked,
+			d->transaction ? " (transaction)" : "");
+	return res;
+}
+
+static int do_quit(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct data *d = user_data;
+	pw_main_loop_quit(d->loop);
+	return 0;
+}
+
+static void driver_start(void *data, struct pw_impl_node *node)
+{
+	struct data *d = data;
+	struct pw_node_activation *a = node->rt.activation;
+	struct pw_node_target *t;
+
+	if (node != d->driver || d->cycle >= d->n_cycles)
+		return;
+
+	if (d->warmup < WARMUP_CYCLES) {
+		d->warmup++;
+		d->incomplete = d->xrun = 0;
+		return;
+	}
+
+	d->cycle_time[d->cycle] = a->finish_time - a->signal_time;
+	d->driver_wakeup[d->cycle] = a->signal_time > a->position.clock.nsec ?
+		a->signal_time - a->position.clock.nsec : 0;
+
+	spa_list_for_each(t, &node->rt.target_list, link) {
+		struct pw_node_activation *ta = t->activation;
+
+		if (t->node == NULL || t->node == node ||
+		    ta->status != PW_NODE_ACTIVATION_FINISHED ||
+		    ta->awake_time < ta->signal_time)
+			continue;
+
+		d->node_wakeup[d->n_node_wakeup++] = ta->awake_time - ta->signal_time;
+	}
+
+	if (++d->cycle == d->n_cycles)
+		pw_loop_invoke(pw_main_loop_get_loop(d->loop),
+				do_quit, 1, NULL, 0, false, d);
+}
+
+static void driver_incomplete(void *data, struct pw_impl_node *node)
+{
+	struct data *d = data;
+	if (node == d->driver)
+		d->incomplete++;
+}
+
+static void driver_xrun(void *data, struct pw_impl_node *node)
+{
+	struct data *d = data;
+	if (node == d->driver)
+		d->xrun++;
+}
+
+static const struct pw_context_driver_events driver_events = {
+	PW_VERSION_CONTEXT_DRIVER_EVENTS,
+	.start = driver_start,
+	.xrun = driver_xrun,
+	.incomplete = driver_incomplete,
+};
+
+static int compare_uint64(const void *a, const void *b)
+{
+	const uint64_t *v1 = a, *v2 = b;
+	return *v1 < *v2 ? -1 : *v1 > *v2 ? 1 : 0;
+}
+
+static void print_stats(const char *name, uint64_t *values, uint32_t n_values)
+{
+	uint64_t sum = 0;
+	uint32_t i;
+
+	if (n_values == 0) {
+		fprintf(stdout, "%-16s no samples\n", name);
+		return;
+	}
+
+	qsort(values, n_values, sizeof(uint64_t), compare_uint64);
+	for (i = 0; i < n_values; i++)
+		sum += values[i];
+
+	fprintf(stdout, "%-16s avg %8"PRIu64" p50 %8"PRIu64" p90 %8"PRIu64
+			" p99 %8"PRIu64" max %8"PRIu64" nsec\n", name,
+			sum / n_values,
+			values[n_values / 2],
+			values[n_values * 90 / 100],
+			values[n_values * 99 / 100],
+			values[n_values - 1]);
+}
+
+static void on_timeout(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+	fprintf(stderr, "timeout after %u cycles\n", d->cycle);
+	pw_main_loop_quit(d->loop);
+}
+
+static void show_help(const char *name)
+{
+	fprintf(stdout, "%s [options]\n"
+		"  -h, --help                            Show this help\n"
+		"  -c, --chains                          Number of chains (default %d)\n"
+		"  -d, --depth                           Nodes per chain (default %d)\n"
+		"  -n, --cycles                          Cycles to measure (default %d)\n"
+		"  -q, --quantum                         Quantum in samples (default %d)\n"
+		"  -w, --workers                         Data loop workers (default %d)\n"
+		"  -t, --transaction                     Make the graph in one transaction\n"
+		"  -l, --mlock                           Lock buffer and activation memory\n"
+		"  -H, --hugepages                       Use huge pages for slabs and large buffers\n"
+		"  -S, --slab-size                       Put the nodes in a client with slabs of this size\n"
+		"  -s, --separate                        Run the graph in a separate loop of the driver\n",
+		name, DEFAULT_CHAINS, DEFAULT_DEPTH, DEFAULT_CYCLES,
+		DEFAULT_QUANTUM, DEFAULT_WORKERS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0, };
+	struct pw_properties *props;
+	struct spa_source *timeout;
+	struct timespec value;
+	int c, res = 0;
+	static const struct option long_options[] = {
+		{ "help",	no_argument,		NULL, 'h' },
+		{ "chains",	required_argument,	NULL, 'c' },
+		{ "depth",	required_argument,	NULL, 'd' },
+		{ "cycles",	required_argument,	NULL, 'n' },
+		{ "quantum",	required_argument,	NULL, 'q' },
+		{ "workers",	required_argument,	NULL, 'w' },
+		{ "transaction", no_argument,		NULL, 't' },
+		{ "mlock",	no_argument,		NULL, 'l' },
+		{ "hugepages",	no_argument,		NULL, 'H' },
+		{ "slab-size",	required_argument,	NULL, 'S' },
+		{ "separate",	no_argument,		NULL, 's' },
+		{ NULL, 0, NULL, 0}
+	};
+
+	pw_init(&argc, &argv);
+
+	data.n_chains = DEFAULT_CHAINS;
+	data.depth = DEFAULT_DEPTH;
+	data.n_cycles = DEFAULT_CYCLES;
+	data.quantum = DEFAULT_QUANTUM;
+	data.n_workers = DEFAULT_WORKERS;
+
+	while ((c = getopt_long(argc, argv, "hc:d:n:q:w:tlHS:s", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			show_help(argv[0]);
+			return 0;
+		case 'c':
+			data.n_chains = atoi(optarg);
+			break;
+		case 'd':
+			data.depth = atoi(optarg);
+			break;
+		case 'n':
+			data.n_cycles = atoi(optarg);
+			break;
+		case 'q':
+			data.quantum = atoi(optarg);
+			break;
+		case 'w':
+			data.n_workers = atoi(optarg);
+			break;
+		case 't':
+			data.transaction = true;
+			break;
+		case 'l':
+			data.mlock = true;
+			break;
+		case 'H':
+			data.hugepages = true;
+			break;
+		case 'S':
+			data.slab_size = atoi(optarg);
+			break;
+		case 's':
+			data.separate = true;
+			break;
+		default:
+			show_help(argv[0]);
+			return -1;
+		}
+	}
+	if (data.n_chains * data.depth > MAX_NODES || data.n_cycles == 0 ||
+	    data.quantum == 0) {
+		fprintf(stderr, "invalid arguments\n");
+		return -1;
+	}
+
+	data.cycle_time = calloc(data.n_cycles, sizeof(uint64_t));
+	data.driver_wakeup = calloc(data.n_cycles, sizeof(uint64_t));
+	data.node_wakeup = calloc(data.n_cycles * data.n_chains * data.depth, sizeof(uint64_t));
+
+	data.loop = pw_main_loop_new(NULL);
+
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, "context.data-loop.workers", "%u", data.n_workers);
+	pw_properties_set(props, "mem.allow-mlock", data.mlock ? "true" : "false");
+	pw_properties_set(props, "mem.hugepages", data.hugepages ? "true" : "false");
+	pw_properties_setf(props, "mem.slab-size", "%u", data.slab_size);
+	data.context = pw_context_new(pw_main_loop_get_loop(data.loop), props, 0);
+
+	pw_context_add_spa_lib(data.context, "audio.*", "audiomixer/libspa-audiomixer");
+	pw_context_add_spa_lib(data.context, "support.*", "support/libspa-support");
+
+	if ((res = make_graph(&data)) < 0) {
+		fprintf(stderr, "can't make graph: %s\n", spa_strerror(res));
+		goto exit;
+	}
+
+	pw_context_driver_add_listener(data.context,
+			&data.driver_listener, &driver_events, &data);
+
+	/* give up when the graph does not run */
+	timeout = pw_loop_add_timer(pw_main_loop_get_loop(data.loop), on_timeout, &data);
+	value.tv_sec = 10 + (uint64_t)(data.n_cycles + WARMUP_CYCLES) * data.quantum / 48000 * 2;
+	value.tv_nsec = 0;
+	pw_loop_update_timer(pw_main_loop_get_loop(data.loop), timeout, &value, NULL, false);
+
+	pw_main_loop_run(data.loop);
+
+	pw_context_driver_remove_listener(data.context, &data.driver_listener);
+
+	fprintf(stdout, "graph: %u chains x %u depth, quantum %u, workers %u, %u cycles\n",
+			data.n_chains, data.depth, data.quantum, data.n_workers, data.cycle);
+	fprintf(stdout, "memory: mlock %s, hugepages %s, slab size %u\n",
+			data.mlock ? "yes" : "no", data.hugepages ? "yes" : "no",
+			data.slab_size);
+	fprintf(stdout, "driver loop: %s\n", data.separate ? "separate" : "shared");
+	print_stats("cycle time", data.cycle_time, data.cycle);
+	print_stats("driver wakeup", data.driver_wakeup, data.cycle);
+	print_stats("node wakeup", data.node_wakeup, data.n_node_wakeup);
+	fprintf(stdout, "%-16s %u incomplete, %u xrun\n", "xruns", data.incomplete, data.xrun);
+
+	if (data.cycle < data.n_cycles)
+		res = -ETIMEDOUT;
+
+exit:
+	pw_context_destroy(data.context);
+	pw_main_loop_destroy(data.loop);
+
+	free(data.cycle_time);
+	free(data.driver_wakeup);
+	free(data.node_wakeup);
+
+	return res < 0 ? 1 : 0;
+}
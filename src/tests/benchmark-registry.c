@@ -0,0 +1,298 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include <spa/utils/result.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#define DEFAULT_GLOBALS		10000
+#define DEFAULT_CONNECTS	50
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	uint32_t n_globals;
+	uint32_t n_connects;
+	uint32_t version;
+	const char *types;
+
+	struct pw_global **globals;
+
+	struct pw_core *core;
+	struct spa_hook core_listener;
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+
+	int seq;
+	uint32_t n_seen;
+	int res;
+
+	uint64_t *connect_time;
+};
+
+static int global_bind(void *object, struct pw_impl_client *client,
+		uint32_t permissions, uint32_t version, uint32_t id)
+{
+	return -ENOTSUP;
+}
+
+/* globals that look like the ports of a big graph */
+static int make_globals(struct data *d)
+{
+	struct pw_properties *props;
+	uint32_t i;
+	int res;
+
+	d->globals = calloc(d->n_globals, sizeof(struct pw_global *));
+	if (d->globals == NULL)
+		return -errno;
+
+	for (i = 0; i < d->n_globals; i++) {
+		props = pw_properties_new(NULL, NULL);
+		pw_properties_setf(props, PW_KEY_NODE_ID, "%u", i / 8);
+		pw_properties_setf(props, PW_KEY_PORT_ID, "%u", i % 8);
+		pw_properties_setf(props, PW_KEY_PORT_NAME, "%s_%u",
+				i % 2 ? "playback" : "capture", i % 8);
+		pw_properties_set(props, PW_KEY_PORT_DIRECTION, i % 2 ? "in" : "out");
+		pw_properties_set(props, PW_KEY_FORMAT_DSP, "32 bit float mono audio");
+		pw_properties_setf(props, PW_KEY_OBJECT_PATH, "benchmark:%u:%u", i / 8, i % 8);
+
+		d->globals[i] = pw_global_new(d->context, PW_TYPE_INTERFACE_Port,
+				PW_VERSION_PORT, props, global_bind, d);
+		if (d->globals[i] == NULL)
+			return -errno;
+		if ((res = pw_global_register(d->globals[i])) < 0)
+			return res;
+	}
+	return 0;
+}
+
+static void registry_global(void *data, uint32_t id,
+		uint32_t permissions, const char *type, uint32_t version,
+		const struct spa_dict *props)
+{
+	struct data *d = data;
+	d->n_seen++;
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = registry_global,
+};
+
+static void core_done(void *data, uint32_t id, int seq)
+{
+	struct data *d = data;
+	if (id == PW_ID_CORE && seq == d->seq)
+		pw_main_loop_quit(d->loop);
+}
+
+static void core_error(void *data, uint32_t id, int seq, int res, const char *message)
+{
+	struct data *d = data;
+	fprintf(stderr, "error id:%u seq:%d res:%d (%s): %s\n", id, seq, res,
+			spa_strerror(res), message);
+	d->res = res;
+	pw_main_loop_quit(d->loop);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = core_done,
+	.error = core_error,
+};
+
+/* connect, get the registry and wait until all globals are announced */
+static int connect_once(struct data *d, uint64_t *nsec)
+{
+	struct pw_properties *props = NULL;
+	struct timespec t0, t1;
+
+	if (d->types)
+		props = pw_properties_new(PW_KEY_REGISTRY_TYPES, d->types, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	d->core = pw_context_connect_self(d->context, props, 0);
+	if (d->core == NULL)
+		return -errno;
+
+	pw_core_add_listener(d->core, &d->core_listener, &core_events, d);
+	d->registry = pw_core_get_registry(d->core, d->version, 0);
+	pw_registry_add_listener(d->registry, &d->registry_listener,
+			&registry_events, d);
+	d->seq = pw_core_sync(d->core, PW_ID_CORE, 0);
+
+	pw_main_loop_run(d->loop);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*nsec = SPA_TIMESPEC_TO_NSEC(&t1) - SPA_TIMESPEC_TO_NSEC(&t0);
+
+	spa_hook_remove(&d->registry_listener);
+	pw_proxy_destroy((struct pw_proxy*)d->registry);
+	spa_hook_remove(&d->core_listener);
+	pw_core_disconnect(d->core);
+
+	return d->res;
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+	const uint64_t *v1 = a, *v2 = b;
+	return *v1 < *v2 ? -1 : *v1 > *v2 ? 1 : 0;
+}
+
+static void print_stats(const char *name, uint64_t *values, uint32_t n_values)
+{
+	uint64_t sum = 0;
+	uint32_t i;
+
+	if (n_values == 0) {
+		fprintf(stdout, "%-16s no samples\n", name);
+		return;
+	}
+
+	qsort(values, n_values, sizeof(uint64_t), compare_uint64);
+	for (i = 0; i < n_values; i++)
+		sum += values[i];
+
+	fprintf(stdout, "%-16s avg %8"PRIu64" p50 %8"PRIu64" p90 %8"PRIu64
+			" p99 %8"PRIu64" max %8"PRIu64" usec\n", name,
+			sum / n_values / 1000,
+			values[n_values / 2] / 1000,
+			values[n_values * 90 / 100] / 1000,
+			values[n_values * 99 / 100] / 1000,
+			values[n_values - 1] / 1000);
+}
+
+static void show_help(const char *name)
+{
+	fprintf(stdout, "%s [options]\n"
+		"  -h, --help                            Show this help\n"
+		"  -g, --globals                         Number of globals (default %d)\n"
+		"  -n, --connects                        Connects to measure (default %d)\n"
+		"  -e, --events                          Use a global event per object\n"
+		"  -t, --types                           Only announce these types\n",
+		name, DEFAULT_GLOBALS, DEFAULT_CONNECTS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0, };
+	uint32_t i, n_expected = 0;
+	int c, res = 0;
+	static const struct option long_options[] = {
+		{ "help",	no_argument,		NULL, 'h' },
+		{ "globals",	required_argument,	NULL, 'g' },
+		{ "connects",	required_argument,	NULL, 'n' },
+		{ "events",	no_argument,		NULL, 'e' },
+		{ "types",	required_argument,	NULL, 't' },
+		{ NULL, 0, NULL, 0}
+	};
+
+	pw_init(&argc, &argv);
+
+	data.n_globals = DEFAULT_GLOBALS;
+	data.n_connects = DEFAULT_CONNECTS;
+	data.version = PW_VERSION_REGISTRY;
+
+	while ((c = getopt_long(argc, argv, "hg:n:et:", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			show_help(argv[0]);
+			return 0;
+		case 'g':
+			data.n_globals = atoi(optarg);
+			break;
+		case 'n':
+			data.n_connects = atoi(optarg);
+			break;
+		case 'e':
+			/* registries before version 4 get no snapshot */
+			data.version = 3;
+			break;
+		case 't':
+			data.types = optarg;
+			break;
+		default:
+			show_help(argv[0]);
+			return -1;
+		}
+	}
+	if (data.n_connects == 0) {
+		fprintf(stderr, "invalid arguments\n");
+		return -1;
+	}
+
+	data.connect_time = calloc(data.n_connects, sizeof(uint64_t));
+
+	data.loop = pw_main_loop_new(NULL);
+	data.context = pw_context_new(pw_main_loop_get_loop(data.loop), NULL, 0);
+
+	if ((res = make_globals(&data)) < 0) {
+		fprintf(stderr, "can't make globals: %s\n", spa_strerror(res));
+		goto exit;
+	}
+
+	for (i = 0; i < data.n_connects; i++) {
+		data.n_seen = 0;
+		if ((res = connect_once(&data, &data.connect_time[i])) < 0) {
+			fprintf(stderr, "can't connect: %s\n", spa_strerror(res));
+			goto exit;
+		}
+		if (i == 0)
+			n_expected = data.n_seen;
+		else if (data.n_seen != n_expected) {
+			fprintf(stderr, "saw %u globals, expected %u\n",
+					data.n_seen, n_expected);
+			res = -EIO;
+			goto exit;
+		}
+	}
+
+	fprintf(stdout, "registry: %u globals, %u announced, %s, %u connects\n",
+			data.n_globals, data.n_seen,
+			data.version >= 4 ? "snapshot" : "global events",
+			data.n_connects);
+	print_stats("connect to ready", data.connect_time, data.n_connects);
+
+exit:
+	for (i = 0; data.globals && i < data.n_globals && data.globals[i]; i++)
+		pw_global_destroy(data.globals[i]);
+	pw_context_destroy(data.context);
+	pw_main_loop_destroy(data.loop);
+
+	free(data.globals);
+	free(data.connect_time);
+
+	return res < 0 ? -1 : 0;
+}
@@ -236,6 +236,97 @@ static void test_support(void)
 	pw_main_loop_destroy(loop);
 }
 
+struct invoke_data {
+	uint32_t order[8];
+	uint32_t n_order;
+};
+
+static int do_invoke(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct invoke_data *d = user_data;
+	d->order[d->n_order++] = *(const uint32_t *)data;
+	return 0;
+}
+
+static void queue_invoke(struct pw_context *context, struct pw_loop *loop,
+		struct invoke_data *d, uint32_t id)
+{
+	spa_assert(pw_context_queue_invoke(context, loop, do_invoke, 0,
+			&id, sizeof(id), true, d) == 0);
+}
+
+static uint64_t get_wakeups(struct pw_loop *loop)
+{
+	struct spa_loop_stats stats;
+	spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	return stats.wakeups;
+}
+
+static void test_transaction(void)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_data_loop *dl[2];
+	struct pw_loop *l[2];
+	struct invoke_data d;
+	uint64_t wakeups[2];
+	uint32_t i;
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+
+	for (i = 0; i < 2; i++) {
+		dl[i] = pw_data_loop_new(NULL);
+		spa_assert(dl[i] != NULL);
+		spa_assert(pw_data_loop_start(dl[i]) == 0);
+		l[i] = pw_data_loop_get_loop(dl[i]);
+		wakeups[i] = get_wakeups(l[i]);
+	}
+
+	/* invokes in one loop are executed with one wakeup */
+	spa_zero(d);
+	spa_assert(pw_context_begin_transaction(context) == 0);
+	queue_invoke(context, l[0], &d, 1);
+	queue_invoke(context, l[0], &d, 2);
+	queue_invoke(context, l[0], &d, 3);
+	spa_assert(d.n_order == 0);
+	spa_assert(pw_context_commit_transaction(context) == 0);
+
+	spa_assert(d.n_order == 3);
+	for (i = 0; i < 3; i++)
+		spa_assert(d.order[i] == i + 1);
+	spa_assert(get_wakeups(l[0]) == wakeups[0] + 1);
+	spa_assert(get_wakeups(l[1]) == wakeups[1]);
+	wakeups[0]++;
+
+	/* invokes in different loops keep their order, each run of invokes
+	 * in the same loop is executed with one wakeup */
+	spa_zero(d);
+	spa_assert(pw_context_begin_transaction(context) == 0);
+	queue_invoke(context, l[0], &d, 1);
+	queue_invoke(context, l[0], &d, 2);
+	/* nested transactions are committed with the outermost one */
+	spa_assert(pw_context_begin_transaction(context) == 0);
+	queue_invoke(context, l[1], &d, 3);
+	spa_assert(pw_context_commit_transaction(context) == 0);
+	queue_invoke(context, l[0], &d, 4);
+	queue_invoke(context, l[0], &d, 5);
+	spa_assert(d.n_order == 0);
+	spa_assert(pw_context_commit_transaction(context) == 0);
+
+	spa_assert(d.n_order == 5);
+	for (i = 0; i < 5; i++)
+		spa_assert(d.order[i] == i + 1);
+	spa_assert(get_wakeups(l[0]) == wakeups[0] + 2);
+	spa_assert(get_wakeups(l[1]) == wakeups[1] + 1);
+
+	for (i = 0; i < 2; i++)
+		pw_data_loop_destroy(dl[i]);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+}
+
 int main(int argc, char *argv[])
 {
 	pw_init(&argc, &argv);
@@ -243,6 +334,7 @@ int main(int argc, char *argv[])
 	test_abi();
 	test_create();
 	test_properties();
+	test_transaction();
 	test_support();
 
 	return 0;
@@ -111,6 +111,8 @@ static void test_registry_abi(void)
 			uint32_t permissions, const char *type, uint32_t version,
 			const struct spa_dict *props);
 		void (*global_remove) (void *object, uint32_t id);
+		int (*snapshot) (void *object, uint32_t n_globals,
+			const uint32_t *permissions, const struct spa_pod *globals);
 	} events = { PW_VERSION_REGISTRY_EVENTS, };
 
 	TEST_FUNC(m, methods, version);
@@ -123,7 +125,8 @@ static void test_registry_abi(void)
 	TEST_FUNC(e, events, version);
 	TEST_FUNC(e, events, global);
 	TEST_FUNC(e, events, global_remove);
-	spa_assert(PW_VERSION_REGISTRY_EVENTS == 0);
+	TEST_FUNC(e, events, snapshot);
+	spa_assert(PW_VERSION_REGISTRY_EVENTS == 1);
 	spa_assert(sizeof(e) == sizeof(events));
 }
 
@@ -0,0 +1,293 @@
+/* PipeWire
+ *
+ * Copyright © 2019 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/data-loop.h>
+
+#define N_PRODUCERS	4
+#define N_INVOKES	2000
+#define N_BLOCKING	32
+#define BIG_SIZE	1024
+#define HUGE_SIZE	(16 * 1024)
+
+struct data {
+	uint32_t count[N_PRODUCERS];
+	uint32_t last[N_PRODUCERS];
+	uint32_t n_blocking;
+	uint32_t n_big;
+	uint32_t n_huge;
+	bool release;
+};
+
+struct msg {
+	uint32_t producer;
+	uint32_t index;
+	uint8_t payload[];
+};
+
+static int do_invoke(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct data *d = user_data;
+	const struct msg *m = data;
+	size_t i;
+
+	spa_assert(size >= sizeof(struct msg));
+	spa_assert(m->producer < N_PRODUCERS);
+	/* invokes from one thread are executed in order */
+	spa_assert(m->index == d->last[m->producer] + 1);
+
+	for (i = 0; i < size - sizeof(struct msg); i++)
+		spa_assert(m->payload[i] == (uint8_t)(m->index + i));
+	if (size > sizeof(struct msg) + BIG_SIZE)
+		d->n_huge++;
+	else if (size > sizeof(struct msg))
+		d->n_big++;
+	if (seq == 1)
+		d->n_blocking++;
+
+	d->last[m->producer] = m->index;
+	d->count[m->producer]++;
+	return seq == 1 ? (int)m->index : 0;
+}
+
+static int invoke_msg(struct pw_loop *loop, struct data *d,
+		uint32_t producer, uint32_t index, size_t extra, bool block)
+{
+	uint8_t buffer[sizeof(struct msg) + HUGE_SIZE];
+	struct msg *m = (struct msg *) buffer;
+	size_t i;
+
+	m->producer = producer;
+	m->index = index;
+	for (i = 0; i < extra; i++)
+		m->payload[i] = (uint8_t)(index + i);
+
+	return pw_loop_invoke(loop, do_invoke, block ? 1 : SPA_ID_INVALID,
+			m, sizeof(struct msg) + extra, block, d);
+}
+
+static void test_queue(void)
+{
+	struct pw_loop *loop;
+	struct spa_loop_stats stats;
+	struct data d;
+	uint32_t i, n_queued = N_INVOKES;
+
+	spa_zero(d);
+	loop = pw_loop_new(NULL);
+	spa_assert(loop != NULL);
+
+	/* the loop is not running, everything is queued and the queue
+	 * grows, also past the 32 KiB of the old ringbuffer */
+	for (i = 1; i <= n_queued; i++) {
+		size_t extra = i % 100 == 0 ? HUGE_SIZE : i % 8 == 0 ? BIG_SIZE : 0;
+		spa_assert(invoke_msg(loop, &d, 0, i, extra, false) == 0);
+	}
+
+	spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	spa_assert(stats.queued == n_queued);
+	spa_assert(stats.max_queued == n_queued);
+	spa_assert(stats.invoked == n_queued);
+	spa_assert(stats.failed == 0);
+	/* all items are batched in one wakeup */
+	spa_assert(stats.wakeups == 1);
+	spa_assert(d.count[0] == 0);
+
+	pw_loop_enter(loop);
+	pw_loop_iterate(loop, 0);
+	pw_loop_leave(loop);
+
+	spa_assert(d.count[0] == n_queued);
+	spa_assert(d.last[0] == n_queued);
+	spa_assert(d.n_huge == n_queued / 100);
+	spa_assert(d.n_big == n_queued / 8 - n_queued / 200);
+
+	spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	spa_assert(stats.queued == 0);
+
+	/* the items are reused */
+	for (i = n_queued + 1; i <= 2 * n_queued; i++)
+		spa_assert(invoke_msg(loop, &d, 0, i, i % 100 == 0 ? HUGE_SIZE : 0, false) == 0);
+	spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	spa_assert(stats.failed == 0);
+
+	pw_loop_destroy(loop);
+}
+
+struct producer {
+	pthread_t thread;
+	uint32_t id;
+	struct pw_loop *loop;
+	struct data *d;
+};
+
+static void *producer_func(void *data)
+{
+	struct producer *p = data;
+	uint32_t i;
+
+	for (i = 1; i <= N_INVOKES; i++) {
+		bool block = i % 64 == 0;
+		size_t extra = i % 16 == 0 ? BIG_SIZE : i % 32;
+
+		/* the queue grows when the consumer is slower than the
+		 * producers */
+		spa_assert(invoke_msg(p->loop, p->d, p->id, i, extra, block) ==
+				(block ? (int)i : 0));
+	}
+	return NULL;
+}
+
+static void test_producers(void)
+{
+	struct pw_data_loop *data_loop;
+	struct pw_loop *loop;
+	struct producer producers[N_PRODUCERS];
+	struct spa_loop_stats stats;
+	struct data d;
+	uint32_t i;
+
+	spa_zero(d);
+	data_loop = pw_data_loop_new(NULL);
+	spa_assert(data_loop != NULL);
+	loop = pw_data_loop_get_loop(data_loop);
+	spa_assert(pw_data_loop_start(data_loop) == 0);
+
+	for (i = 0; i < N_PRODUCERS; i++) {
+		producers[i].id = i;
+		producers[i].loop = loop;
+		producers[i].d = &d;
+		spa_assert(pthread_create(&producers[i].thread, NULL,
+					producer_func, &producers[i]) == 0);
+	}
+	for (i = 0; i < N_PRODUCERS; i++)
+		pthread_join(producers[i].thread, NULL);
+
+	/* wait for the last items */
+	pw_loop_invoke(loop, NULL, 0, NULL, 0, true, NULL);
+
+	for (i = 0; i < N_PRODUCERS; i++) {
+		spa_assert(d.count[i] == N_INVOKES);
+		spa_assert(d.last[i] == N_INVOKES);
+	}
+	spa_assert(d.n_blocking == N_PRODUCERS * (N_INVOKES / 64));
+
+	spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	spa_assert(stats.queued == 0);
+	spa_assert(stats.invoked == N_PRODUCERS * N_INVOKES + 1);
+	spa_assert(stats.max_queued >= 1);
+	spa_assert(stats.wakeups >= 1);
+	spa_assert(stats.wakeups <= stats.invoked);
+
+	pw_data_loop_destroy(data_loop);
+}
+
+static int do_wait_release(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct data *d = user_data;
+
+	while (!__atomic_load_n(&d->release, __ATOMIC_ACQUIRE))
+		usleep(1000);
+	return 0;
+}
+
+static int do_blocking(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	return (int)seq;
+}
+
+struct blocker {
+	pthread_t thread;
+	uint32_t id;
+	struct pw_loop *loop;
+};
+
+static void *blocker_func(void *data)
+{
+	struct blocker *b = data;
+
+	spa_assert(pw_loop_invoke(b->loop, do_blocking, b->id, NULL, 0, true, NULL) ==
+			(int)b->id);
+	return NULL;
+}
+
+static void test_blocking(void)
+{
+	struct pw_data_loop *data_loop;
+	struct pw_loop *loop;
+	struct blocker blockers[N_BLOCKING];
+	struct spa_loop_stats stats;
+	struct data d;
+	uint32_t i;
+
+	spa_zero(d);
+	data_loop = pw_data_loop_new(NULL);
+	spa_assert(data_loop != NULL);
+	loop = pw_data_loop_get_loop(data_loop);
+	spa_assert(pw_data_loop_start(data_loop) == 0);
+
+	/* keep the loop busy until all threads wait at the same time */
+	spa_assert(pw_loop_invoke(loop, do_wait_release, SPA_ID_INVALID,
+				NULL, 0, false, &d) == 0);
+
+	for (i = 0; i < N_BLOCKING; i++) {
+		blockers[i].id = i;
+		blockers[i].loop = loop;
+		spa_assert(pthread_create(&blockers[i].thread, NULL,
+					blocker_func, &blockers[i]) == 0);
+	}
+	do {
+		usleep(1000);
+		spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	} while (stats.queued < N_BLOCKING + 1);
+
+	__atomic_store_n(&d.release, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < N_BLOCKING; i++)
+		pthread_join(blockers[i].thread, NULL);
+
+	spa_assert(pw_loop_get_stats(loop, &stats) == 0);
+	spa_assert(stats.failed == 0);
+	spa_assert(stats.max_queued == N_BLOCKING + 1);
+
+	pw_data_loop_destroy(data_loop);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_queue();
+	test_producers();
+	test_blocking();
+
+	return 0;
+}
@@ -0,0 +1,479 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <spa/utils/names.h>
+#include <spa/param/audio/format-utils.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+#include <pipewire/mem.h>
+
+#include "pipewire/private.h"
+
+#define FLAGS	(PW_MEMBLOCK_FLAG_READWRITE |	\
+		 PW_MEMBLOCK_FLAG_SEAL |	\
+		 PW_MEMBLOCK_FLAG_MAP |		\
+		 PW_MEMBLOCK_FLAG_SLAB)
+
+static int owners[2];
+
+static struct pw_memblock *alloc(struct pw_mempool *pool, int owner, size_t size)
+{
+	return pw_mempool_alloc_owned(pool, FLAGS, SPA_DATA_MemFd, size, &owners[owner]);
+}
+
+static struct pw_mempool *pool_new(uint32_t slab_size)
+{
+	struct pw_properties *props;
+
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, "mem.slab-size", "%u", slab_size);
+	return pw_mempool_new(props);
+}
+
+static void test_no_slab(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *m1, *m2;
+	struct pw_mempool_stats stats;
+
+	pool = pw_mempool_new(NULL);
+	spa_assert(pool != NULL);
+
+	m1 = pw_mempool_alloc(pool, FLAGS, SPA_DATA_MemFd, 1000);
+	m2 = pw_mempool_alloc(pool, FLAGS, SPA_DATA_MemFd, 1000);
+	spa_assert(m1 != NULL && m2 != NULL);
+	spa_assert(m1->fd != m2->fd);
+	spa_assert(m1->map->offset == 0);
+	spa_assert(m2->map->offset == 0);
+
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 0);
+
+	pw_memblock_unref(m1);
+	pw_memblock_unref(m2);
+	pw_mempool_destroy(pool);
+}
+
+static void test_slab(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *m[4], *big, *own, *none;
+	struct pw_mempool_stats stats;
+	uint32_t page = sysconf(_SC_PAGESIZE), offset;
+	size_t i;
+
+	pool = pool_new(64 * page);
+	spa_assert(pool != NULL);
+
+	for (i = 0; i < SPA_N_ELEMENTS(m); i++) {
+		m[i] = alloc(pool, 0, page + 100);
+		spa_assert(m[i] != NULL);
+		spa_assert(m[i]->fd == m[0]->fd);
+		spa_assert(m[i]->map->offset == i * 2 * page);
+		spa_assert(pw_mempool_find_ptr(pool, m[i]->map->ptr) == m[i]);
+		memset(m[i]->map->ptr, i, m[i]->size);
+	}
+	/* blocks larger than a quarter of the slab, blocks that don't
+	 * ask for it and blocks without an owner get their own fd */
+	big = alloc(pool, 0, 17 * page);
+	spa_assert(big != NULL);
+	spa_assert(big->fd != m[0]->fd);
+	own = pw_mempool_alloc_owned(pool, FLAGS & ~PW_MEMBLOCK_FLAG_SLAB,
+			SPA_DATA_MemFd, 100, &owners[0]);
+	spa_assert(own != NULL);
+	spa_assert(own->fd != m[0]->fd);
+	none = pw_mempool_alloc(pool, FLAGS, SPA_DATA_MemFd, 100);
+	spa_assert(none != NULL);
+	spa_assert(none->fd != m[0]->fd);
+
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 1);
+	spa_assert(stats.n_blocks == 4);
+	spa_assert(stats.size == 64 * page);
+	spa_assert(stats.used == 8 * page);
+	spa_assert(stats.n_free == 1);
+	spa_assert(stats.max_free == 56 * page);
+
+	/* a hole, reused by the next block that fits */
+	offset = m[1]->map->offset;
+	pw_memblock_unref(m[1]);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_free == 2);
+	spa_assert(stats.max_free == 56 * page);
+	spa_assert(((uint8_t*)m[2]->map->ptr)[0] == 2);
+
+	m[1] = alloc(pool, 0, 100);
+	spa_assert(m[1] != NULL);
+	spa_assert(m[1]->map->offset == offset);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_free == 2);
+	spa_assert(stats.used == 7 * page);
+
+	/* freed neighbours are merged */
+	pw_memblock_unref(m[2]);
+	pw_memblock_unref(m[1]);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_free == 2);
+	spa_assert(stats.used == 4 * page);
+
+	pw_memblock_unref(m[3]);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_free == 1);
+	spa_assert(stats.max_free == 62 * page);
+
+	/* the slab goes away with its last block */
+	pw_memblock_unref(m[0]);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 0);
+
+	pw_memblock_unref(big);
+	pw_memblock_unref(own);
+	pw_memblock_unref(none);
+	pw_mempool_destroy(pool);
+}
+
+static void test_owners(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *m1, *m2, *o1, *o2;
+	struct pw_mempool_stats stats;
+	uint32_t page = sysconf(_SC_PAGESIZE);
+
+	pool = pool_new(16 * page);
+	spa_assert(pool != NULL);
+
+	/* the fd of a slab can map all of it, owners never share one */
+	m1 = alloc(pool, 0, 256);
+	o1 = alloc(pool, 1, 256);
+	m2 = alloc(pool, 0, 256);
+	o2 = alloc(pool, 1, 256);
+	spa_assert(m1 != NULL && m2 != NULL && o1 != NULL && o2 != NULL);
+	spa_assert(m1->fd == m2->fd);
+	spa_assert(o1->fd == o2->fd);
+	spa_assert(m1->fd != o1->fd);
+
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 2);
+	spa_assert(stats.n_blocks == 4);
+
+	pw_memblock_unref(m1);
+	pw_memblock_unref(m2);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 1);
+
+	pw_memblock_unref(o1);
+	pw_memblock_unref(o2);
+	pw_mempool_destroy(pool);
+}
+
+static void test_import(void)
+{
+	struct pw_mempool *pool, *client;
+	struct pw_memblock *m1, *m2;
+	struct pw_memmap *mm1, *mm2;
+	uint32_t page = sysconf(_SC_PAGESIZE);
+
+	pool = pool_new(16 * page);
+	client = pw_mempool_new(NULL);
+	spa_assert(pool != NULL && client != NULL);
+
+	m1 = alloc(pool, 0, 256);
+	m2 = alloc(pool, 0, 256);
+	spa_assert(m1 != NULL && m2 != NULL);
+	spa_assert(m1->fd == m2->fd);
+
+	/* both blocks end up in the same block of the client, so the fd is
+	 * only sent once, the offsets are in the shared fd */
+	mm1 = pw_mempool_import_map(client, pool,
+			SPA_MEMBER(m1->map->ptr, 16, void), 32, NULL);
+	mm2 = pw_mempool_import_map(client, pool,
+			SPA_MEMBER(m2->map->ptr, 16, void), 32, NULL);
+	spa_assert(mm1 != NULL && mm2 != NULL);
+	spa_assert(mm1->block == mm2->block);
+	spa_assert(mm1->offset == m1->map->offset + 16);
+	spa_assert(mm2->offset == m2->map->offset + 16);
+	spa_assert(mm1->ptr == SPA_MEMBER(m1->map->ptr, 16, void));
+	spa_assert(mm2->ptr == SPA_MEMBER(m2->map->ptr, 16, void));
+
+	pw_memmap_free(mm1);
+	pw_memmap_free(mm2);
+	pw_mempool_destroy(client);
+
+	pw_memblock_unref(m1);
+	pw_memblock_unref(m2);
+	pw_mempool_destroy(pool);
+}
+
+static void test_hugepages(void)
+{
+	struct pw_properties *props;
+	struct pw_mempool *pool, *client;
+	struct pw_memblock *m1, *m2, *cm;
+	struct pw_memmap *mm;
+	struct pw_mempool_stats stats;
+
+	/* huge pages alone don't enable slabs, large blocks get huge pages
+	 * of their own when there are any */
+	props = pw_properties_new("mem.hugepages", "true", NULL);
+	pool = pw_mempool_new(props);
+	client = pw_mempool_new(NULL);
+	spa_assert(pool != NULL && client != NULL);
+	m1 = alloc(pool, 0, 1000);
+	m2 = alloc(pool, 0, 1024 * 1024 + 1000);
+	spa_assert(m1 != NULL && m2 != NULL);
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 0);
+
+	memset(m2->map->ptr, 0x5a, m2->size);
+	cm = pw_mempool_import(client, PW_MEMBLOCK_FLAG_READWRITE,
+			SPA_DATA_MemFd, dup(m2->fd));
+	spa_assert(cm != NULL);
+	mm = pw_mempool_map_id(client, cm->id, PW_MEMMAP_FLAG_READWRITE,
+			0, m2->size, NULL);
+	spa_assert(mm != NULL);
+	spa_assert(((uint8_t*)mm->ptr)[m2->size - 1] == 0x5a);
+
+	pw_memmap_free(mm);
+	pw_mempool_destroy(client);
+	pw_memblock_unref(m1);
+	pw_memblock_unref(m2);
+	pw_mempool_destroy(pool);
+
+	/* falls back to normal pages when there are no huge pages */
+	props = pw_properties_new(
+			"mem.slab-size", "2097152",
+			"mem.hugepages", "true",
+			"mem.allow-mlock", "true",
+			NULL);
+	pool = pw_mempool_new(props);
+	client = pw_mempool_new(NULL);
+	spa_assert(pool != NULL && client != NULL);
+
+	m1 = alloc(pool, 0, 1000);
+	m2 = alloc(pool, 0, 1000);
+	spa_assert(m1 != NULL && m2 != NULL);
+	spa_assert(m1->fd == m2->fd);
+
+	pw_mempool_get_stats(pool, &stats);
+	spa_assert(stats.n_slabs == 1);
+	spa_assert(stats.size >= 2 * 1024 * 1024);
+
+	memset(m2->map->ptr, 0x5a, 1000);
+
+	/* a client maps the block at its offset in the slab */
+	cm = pw_mempool_import(client, PW_MEMBLOCK_FLAG_READWRITE,
+			SPA_DATA_MemFd, dup(m2->fd));
+	spa_assert(cm != NULL);
+	mm = pw_mempool_map_id(client, cm->id, PW_MEMMAP_FLAG_READWRITE,
+			m2->map->offset, 1000, NULL);
+	spa_assert(mm != NULL);
+	spa_assert(((uint8_t*)mm->ptr)[0] == 0x5a);
+	spa_assert(((uint8_t*)mm->ptr)[999] == 0x5a);
+
+	pw_memmap_free(mm);
+	pw_mempool_destroy(client);
+
+	pw_memblock_unref(m1);
+	pw_memblock_unref(m2);
+	pw_mempool_destroy(pool);
+}
+
+/* number of open memfds, the eventfds of the nodes don't depend on slabs */
+static uint32_t count_memfds(void)
+{
+	DIR *dir;
+	struct dirent *e;
+	char path[PATH_MAX], target[PATH_MAX];
+	uint32_t count = 0;
+	ssize_t len;
+
+	dir = opendir("/proc/self/fd");
+	spa_assert(dir != NULL);
+	while ((e = readdir(dir)) != NULL) {
+		snprintf(path, sizeof(path), "/proc/self/fd/%s", e->d_name);
+		if ((len = readlink(path, target, sizeof(target) - 1)) < 0)
+			continue;
+		target[len] = '\0';
+		if (strncmp(target, "/memfd:", 7) == 0)
+			count++;
+	}
+	closedir(dir);
+	return count;
+}
+
+static struct pw_impl_node *make_node(struct pw_context *context, const char *factory_name,
+		struct pw_impl_client *client)
+{
+	struct pw_impl_node *node;
+	struct pw_properties *props;
+	struct spa_handle *handle;
+	void *iface;
+
+	props = pw_properties_new(PW_KEY_NODE_ALWAYS_PROCESS, "true", NULL);
+	if (client != NULL)
+		pw_properties_setf(props, PW_KEY_CLIENT_ID, "%u", client->global->id);
+
+	handle = pw_context_load_spa_handle(context, factory_name, &props->dict);
+	spa_assert(handle != NULL);
+	spa_assert(spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface) >= 0);
+
+	node = pw_context_create_node(context, props, 0);
+	spa_assert(node != NULL);
+	spa_assert(node->client == client);
+
+	pw_impl_node_set_implementation(node, iface);
+	pw_impl_node_register(node, NULL);
+	pw_impl_node_set_active(node, true);
+	return node;
+}
+
+static struct pw_impl_port *get_port(struct pw_impl_node *node, enum spa_direction direction)
+{
+	struct pw_impl_port *p;
+	uint32_t port_id;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_audio_info_raw info = {
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = 1,
+	};
+
+	p = pw_impl_node_find_port(node, direction, PW_ID_ANY);
+	if (p != NULL && !pw_impl_port_is_linked(p))
+		goto done;
+
+	/* a dynamic port of the mixer, the node makes the port when the
+	 * mixer announces it */
+	port_id = pw_impl_node_get_free_port_id(node, direction);
+	spa_assert(port_id != SPA_ID_INVALID);
+	spa_assert(spa_node_add_port(node->node, direction, port_id, NULL) >= 0);
+	p = pw_impl_node_find_port(node, direction, port_id);
+	spa_assert(p != NULL);
+done:
+	/* the link uses the format of the ports */
+	spa_assert(pw_impl_port_set_param(p, SPA_PARAM_Format, 0,
+			spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info)) >= 0);
+	return p;
+}
+
+/* the memfds of n_links links between the nodes of two clients */
+static uint32_t link_memfds(uint32_t slab_size, uint32_t n_links)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_properties *props;
+	struct pw_impl_client *clients[2];
+	struct pw_impl_link *links[16];
+	uint32_t i, j, before, after, n_ready;
+
+	spa_assert(n_links <= SPA_N_ELEMENTS(links));
+
+	loop = pw_main_loop_new(NULL);
+	props = pw_properties_new(NULL, NULL);
+	pw_properties_setf(props, "mem.slab-size", "%u", slab_size);
+	context = pw_context_new(pw_main_loop_get_loop(loop), props, 0);
+	spa_assert(context != NULL);
+
+	pw_context_add_spa_lib(context, "audio.*", "audiomixer/libspa-audiomixer");
+	pw_context_add_spa_lib(context, "support.*", "support/libspa-support");
+
+	for (i = 0; i < 2; i++) {
+		clients[i] = pw_context_create_client(context->core, NULL, NULL, 0);
+		spa_assert(clients[i] != NULL);
+		spa_assert(pw_impl_client_register(clients[i], NULL) >= 0);
+	}
+	make_node(context, SPA_NAME_SUPPORT_NODE_DRIVER, NULL);
+
+	before = count_memfds();
+	for (i = 0; i < n_links; i++) {
+		struct pw_impl_node *out, *in;
+
+		out = make_node(context, SPA_NAME_AUDIO_MIXER, clients[0]);
+		in = make_node(context, SPA_NAME_AUDIO_MIXER, clients[1]);
+		links[i] = pw_context_create_link(context,
+				get_port(out, SPA_DIRECTION_OUTPUT),
+				get_port(in, SPA_DIRECTION_INPUT),
+				NULL, NULL, 0);
+		spa_assert(links[i] != NULL);
+		spa_assert(pw_impl_link_register(links[i], NULL) >= 0);
+	}
+
+	/* wait for the buffers of all links */
+	for (j = 0; j < 100; j++) {
+		for (i = 0, n_ready = 0; i < n_links; i++) {
+			const struct pw_link_info *info = pw_impl_link_get_info(links[i]);
+			spa_assert(info->state != PW_LINK_STATE_ERROR);
+			if (info->state >= PW_LINK_STATE_PAUSED)
+				n_ready++;
+		}
+		if (n_ready == n_links)
+			break;
+		pw_loop_iterate(pw_main_loop_get_loop(loop), 10);
+	}
+	spa_assert(n_ready == n_links);
+	after = count_memfds();
+
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return after - before;
+}
+
+static void test_links(void)
+{
+	uint32_t n1, n8;
+
+	/* without slabs, each node activation and link buffer has an fd */
+	n1 = link_memfds(0, 1);
+	n8 = link_memfds(0, 8);
+	spa_assert(n8 == 8 * n1);
+
+	/* with slabs, the activations of each client share a slab and the
+	 * buffers between the two clients share another one */
+	n1 = link_memfds(16 * 1024 * 1024, 1);
+	n8 = link_memfds(16 * 1024 * 1024, 8);
+	spa_assert(n1 == 3);
+	spa_assert(n8 == n1);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_no_slab();
+	test_slab();
+	test_owners();
+	test_import();
+	test_hugepages();
+	test_links();
+
+	return 0;
+}
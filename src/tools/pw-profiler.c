@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <signal.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <spa/utils/result.h>
 #include <spa/pod/parser.h>
@@ -36,6 +39,7 @@
 #define MAX_NAME		128
 #define MAX_FOLLOWERS		64
 #define DEFAULT_FILENAME	"profiler.log"
+#define SHM_INTERVAL_MSEC	10
 
 struct follower {
 	uint32_t id;
@@ -67,6 +71,14 @@ struct data {
 
 	int n_followers;
 	struct follower followers[MAX_FOLLOWERS];
+
+	bool use_shm;
+	void *shm_map;
+	size_t shm_size;
+	struct pw_profiler_shm_header *shm_header;
+	uint64_t shm_pos;
+	struct spa_source *shm_timer;
+	bool have_point;
 };
 
 struct measurement {
@@ -86,6 +98,8 @@ struct point {
 	struct measurement follower[MAX_FOLLOWERS];
 };
 
+static struct point shm_point;
+
 static int process_info(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	spa_pod_parse_struct(pod,
@@ -429,6 +443,10 @@ static void profiler_profile(void *data, const struct spa_pod *pod)
 	struct spa_pod_prop *p;
 	struct point point;
 
+	/* the ring has all the data when reading it */
+	if (d->use_shm)
+		return;
+
 	SPA_POD_STRUCT_FOREACH(pod, o) {
 		int res = 0;
 		if (!spa_pod_is_object_type(o, SPA_TYPE_OBJECT_Profiler))
@@ -462,9 +480,163 @@ static void profiler_profile(void *data, const struct spa_pod *pod)
 	}
 }
 
+static void process_shm_block(struct data *d, const struct pw_profiler_shm_block *b)
+{
+	struct point *point = &shm_point;
+	struct measurement m;
+	int idx;
+
+	m.prev_signal = b->prev_signal_time;
+	m.signal = b->signal_time;
+	m.awake = b->awake_time;
+	m.finish = b->finish_time;
+	m.status = b->status;
+
+	if (b->flags & PW_PROFILER_SHM_FLAG_DRIVER) {
+		if (d->driver_id == 0) {
+			d->driver_id = b->id;
+			fprintf(stderr, "logging driver %u\n", b->id);
+		}
+		else if (d->driver_id != b->id)
+			return;
+
+		/* a new cycle starts, the previous one is complete */
+		if (d->have_point)
+			dump_point(d, point);
+
+		spa_zero(*point);
+		point->count = d->count;
+		point->cpu_load[0] = b->cpu_load[0];
+		point->cpu_load[1] = b->cpu_load[1];
+		point->cpu_load[2] = b->cpu_load[2];
+		point->clock.nsec = b->clock_nsec;
+		point->clock.rate = SPA_FRACTION(1, b->clock_rate);
+		point->clock.position = b->clock_position;
+		point->clock.duration = b->clock_duration;
+		point->clock.delay = b->clock_delay;
+		point->clock.rate_diff = b->clock_rate_diff;
+		point->driver = m;
+		d->have_point = true;
+	} else {
+		if (!d->have_point || b->driver_id != d->driver_id ||
+		    b->clock_position != point->clock.position)
+			return;
+
+		if ((idx = find_follower(d, b->id, b->name)) < 0) {
+			if ((idx = add_follower(d, b->id, b->name)) < 0)
+				return;
+		}
+		point->follower[idx] = m;
+	}
+}
+
+static void on_shm_timeout(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+	struct pw_profiler_shm_header *h = d->shm_header;
+	struct pw_profiler_shm_block b;
+	const void *p;
+	uint64_t write_pos, seq;
+
+	write_pos = __atomic_load_n(&h->write_seq, __ATOMIC_ACQUIRE);
+	if (write_pos - d->shm_pos > h->n_blocks) {
+		fprintf(stderr, "lost %"PRIu64" blocks\n", write_pos - d->shm_pos - h->n_blocks);
+		d->shm_pos = write_pos - h->n_blocks;
+	}
+
+	for (; d->shm_pos < write_pos; d->shm_pos++) {
+		p = SPA_MEMBER(h, sizeof(*h) +
+				(d->shm_pos & (h->n_blocks - 1)) * h->block_size, void);
+
+		seq = __atomic_load_n((uint64_t*)p, __ATOMIC_ACQUIRE);
+		/* still being written, try again later */
+		if (seq < (d->shm_pos + 1) * 2)
+			break;
+		/* overwritten by a newer block */
+		if (seq != (d->shm_pos + 1) * 2)
+			continue;
+
+		memcpy(&b, p, sizeof(b));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n((uint64_t*)p, __ATOMIC_RELAXED) != seq)
+			continue;
+
+		b.name[sizeof(b.name) - 1] = '\0';
+		process_shm_block(d, &b);
+	}
+}
+
+static int open_shm(struct data *d, int fd)
+{
+	struct pw_profiler_shm_header *h;
+	struct pw_loop *l = pw_main_loop_get_loop(d->loop);
+	struct timespec value, interval;
+	struct stat st;
+	int res;
+
+	if (fd < 0)
+		return -EBADF;
+
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(*h)) {
+		res = -EINVAL;
+		goto error_close;
+	}
+	d->shm_size = st.st_size;
+	d->shm_map = mmap(NULL, d->shm_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (d->shm_map == MAP_FAILED) {
+		res = -errno;
+		goto error_close;
+	}
+	close(fd);
+
+	h = d->shm_map;
+	if (h->magic != PW_PROFILER_SHM_MAGIC ||
+	    h->version != PW_PROFILER_SHM_VERSION ||
+	    h->block_size < sizeof(struct pw_profiler_shm_block) ||
+	    h->n_blocks == 0 || (h->n_blocks & (h->n_blocks - 1)) ||
+	    sizeof(*h) + (size_t)h->n_blocks * h->block_size > d->shm_size) {
+		munmap(d->shm_map, d->shm_size);
+		return -EINVAL;
+	}
+	d->shm_header = h;
+	/* start from the current cycle */
+	d->shm_pos = __atomic_load_n(&h->write_seq, __ATOMIC_ACQUIRE);
+
+	d->shm_timer = pw_loop_add_timer(l, on_shm_timeout, d);
+	value.tv_sec = 0;
+	value.tv_nsec = SHM_INTERVAL_MSEC * SPA_NSEC_PER_MSEC;
+	interval = value;
+	pw_loop_update_timer(l, d->shm_timer, &value, &interval, false);
+
+	return 0;
+
+error_close:
+	close(fd);
+	return res;
+}
+
+static void profiler_shm(void *data, int fd, uint32_t size)
+{
+	struct data *d = data;
+	int res;
+
+	if (!d->use_shm || d->shm_header != NULL) {
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	if ((res = open_shm(d, fd)) < 0) {
+		fprintf(stderr, "Can't map profiler shared memory: %s\n",
+				spa_strerror(res));
+		return;
+	}
+	fprintf(stderr, "Reading profiler shared memory of %u bytes\n", size);
+}
+
 static const struct pw_profiler_events profiler_events = {
 	PW_VERSION_PROFILER_EVENTS,
         .profile = profiler_profile,
+	.shm = profiler_shm,
 };
 
 static void registry_event_global(void *data, uint32_t id,
@@ -473,15 +645,25 @@ static void registry_event_global(void *data, uint32_t id,
 {
 	struct data *d = data;
 	struct pw_proxy *proxy;
+	const char *str;
 
 	if (strcmp(type, PW_TYPE_INTERFACE_Profiler) != 0)
 		return;
 
-	if (d->profiler != NULL) {
+	if (d->profiler != NULL || d->shm_header != NULL) {
 		fprintf(stderr, "Ignoring profiler %d: already attached\n", id);
 		return;
 	}
 
+	if (d->use_shm &&
+	    (props == NULL ||
+	     (str = spa_dict_lookup(props, PW_KEY_PROFILER_SHM)) == NULL ||
+	     !pw_properties_parse_bool(str))) {
+		fprintf(stderr, "Profiler %d has no shared memory, load it with "
+				PW_KEY_PROFILER_SHM"=true\n", id);
+		return;
+	}
+
 	proxy = pw_registry_bind(d->registry, id, type, PW_VERSION_PROFILER, 0);
 	if (proxy == NULL)
 		goto error_proxy;
@@ -490,6 +672,10 @@ static void registry_event_global(void *data, uint32_t id,
 	d->profiler = proxy;
 	pw_proxy_add_object_listener(proxy, &d->profiler_listener, &profiler_events, d);
 
+	/* wait for the shm event of the bind */
+	if (d->use_shm)
+		d->check_profiler = pw_core_sync(d->core, 0, 0);
+
 	return;
 
 error_proxy:
@@ -518,7 +704,13 @@ static void on_core_done(void *_data, uint32_t id, int seq)
 	struct data *d = _data;
 
 	if (seq == d->check_profiler) {
-		if (d->profiler == NULL) {
+		/* the ring is sent when binding, we don't need the
+		 * profile events */
+		if (d->use_shm && d->profiler != NULL) {
+			pw_proxy_destroy(d->profiler);
+			d->profiler = NULL;
+		}
+		if (d->profiler == NULL && d->shm_header == NULL) {
 			pw_log_error("no Profiler Interface found, please load one in the server");
 			pw_main_loop_quit(d->loop);
 		}
@@ -544,7 +736,8 @@ static void show_help(const char *name)
 		"  -h, --help                            Show this help\n"
 		"      --version                         Show version\n"
 		"  -r, --remote                          Remote daemon name\n"
-		"  -o, --output                          Profiler output name (default \"%s\")\n",
+		"  -o, --output                          Profiler output name (default \"%s\")\n"
+		"  -s, --shm                             Read from the shared memory ring\n",
 		name,
 		DEFAULT_FILENAME);
 }
@@ -560,13 +753,14 @@ int main(int argc, char *argv[])
 		{ "version",	no_argument,		NULL, 'V' },
 		{ "remote",	required_argument,	NULL, 'r' },
 		{ "output",	required_argument,	NULL, 'o' },
+		{ "shm",	no_argument,		NULL, 's' },
 		{ NULL, 0, NULL, 0}
 	};
 	int c;
 
 	pw_init(&argc, &argv);
 
-	while ((c = getopt_long(argc, argv, "hVr:o:", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hVr:o:s", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			show_help(argv[0]);
@@ -585,6 +779,9 @@ int main(int argc, char *argv[])
 		case 'r':
 			opt_remote = optarg;
 			break;
+		case 's':
+			data.use_shm = true;
+			break;
 		default:
 			show_help(argv[0]);
 			return -1;
@@ -642,6 +839,11 @@ int main(int argc, char *argv[])
 
 	pw_main_loop_run(data.loop);
 
+	if (data.have_point)
+		dump_point(&data, &shm_point);
+	if (data.shm_map)
+		munmap(data.shm_map, data.shm_size);
+
 	pw_context_destroy(data.context);
 	pw_main_loop_destroy(data.loop);
 
@@ -0,0 +1,509 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <signal.h>
+#include <getopt.h>
+
+#include <spa/utils/result.h>
+#include <spa/pod/parser.h>
+#include <spa/param/profiler.h>
+
+#include <pipewire/impl.h>
+#include <extensions/profiler.h>
+
+#define MAX_NAME		128
+#define MAX_NODES		1024
+
+struct node {
+	uint32_t id;
+	char name[MAX_NAME];
+	uint32_t driver_id;		/* id of the driver, our own id for drivers */
+
+	struct spa_fraction rate;
+	int64_t quantum;
+	uint32_t xrun_count;
+	float cpu_load[3];		/* dsp load of the driver, averaged over
+					 * 2, 8 and 32 cycles */
+
+	/* measured in the last interval */
+	uint32_t cycles;
+	uint32_t incomplete;
+	int64_t wait_max;
+	int64_t busy_max;
+	int64_t busy_sum;
+
+	int64_t count;			/* profiler count when last seen */
+};
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+
+	struct pw_core *core;
+	struct spa_hook core_listener;
+
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+
+	struct pw_proxy *profiler;
+	struct spa_hook profiler_listener;
+	int check_profiler;
+
+	bool batch;
+	uint32_t iterations;
+	uint32_t n_printed;
+
+	int64_t count;			/* last profiler count */
+
+	uint32_t n_nodes;
+	struct node nodes[MAX_NODES];
+};
+
+struct measurement {
+	uint32_t id;
+	const char *name;
+	int64_t prev_signal;
+	int64_t signal;
+	int64_t awake;
+	int64_t finish;
+	int32_t status;
+	int32_t xrun_count;
+};
+
+static struct node *find_node(struct data *d, uint32_t id, const char *name)
+{
+	struct node *n;
+	uint32_t i;
+
+	for (i = 0; i < d->n_nodes; i++) {
+		n = &d->nodes[i];
+		if (n->id == id)
+			goto done;
+	}
+	if (d->n_nodes == MAX_NODES)
+		return NULL;
+
+	n = &d->nodes[d->n_nodes++];
+	spa_zero(*n);
+	n->id = id;
+done:
+	if (strncmp(n->name, name, MAX_NAME - 1) != 0) {
+		strncpy(n->name, name, MAX_NAME);
+		n->name[MAX_NAME - 1] = '\0';
+	}
+	return n;
+}
+
+static void update_node(struct node *n, int64_t count, int64_t wait, int64_t busy,
+		bool complete, int32_t xrun_count)
+{
+	n->count = count;
+	n->cycles++;
+	n->xrun_count = xrun_count;
+	if (!complete) {
+		n->incomplete++;
+		return;
+	}
+	n->wait_max = SPA_MAX(n->wait_max, wait);
+	n->busy_max = SPA_MAX(n->busy_max, busy);
+	n->busy_sum += busy;
+}
+
+static int parse_block(const struct spa_pod *pod, struct measurement *m)
+{
+	spa_zero(*m);
+	return spa_pod_parse_struct(pod,
+			SPA_POD_Int(&m->id),
+			SPA_POD_String(&m->name),
+			SPA_POD_Long(&m->prev_signal),
+			SPA_POD_Long(&m->signal),
+			SPA_POD_Long(&m->awake),
+			SPA_POD_Long(&m->finish),
+			SPA_POD_Int(&m->status),
+			SPA_POD_OPT_Int(&m->xrun_count));
+}
+
+static void process_point(struct data *d, struct spa_pod_object *o)
+{
+	struct spa_pod_prop *p;
+	struct spa_io_clock clock;
+	struct measurement m;
+	struct node *driver = NULL, *n;
+	int64_t count = 0;
+	float cpu_load[3] = { 0.0f, };
+	bool complete;
+
+	spa_zero(clock);
+
+	SPA_POD_OBJECT_FOREACH(o, p) {
+		switch(p->key) {
+		case SPA_PROFILER_info:
+			spa_pod_parse_struct(&p->value,
+					SPA_POD_Long(&count),
+					SPA_POD_Float(&cpu_load[0]),
+					SPA_POD_Float(&cpu_load[1]),
+					SPA_POD_Float(&cpu_load[2]));
+			break;
+		case SPA_PROFILER_clock:
+			spa_pod_parse_struct(&p->value,
+					SPA_POD_Int(&clock.flags),
+					SPA_POD_Int(&clock.id),
+					SPA_POD_Stringn(clock.name, sizeof(clock.name)),
+					SPA_POD_Long(&clock.nsec),
+					SPA_POD_Fraction(&clock.rate),
+					SPA_POD_Long(&clock.position),
+					SPA_POD_Long(&clock.duration),
+					SPA_POD_Long(&clock.delay),
+					SPA_POD_Double(&clock.rate_diff),
+					SPA_POD_Long(&clock.next_nsec));
+			break;
+		case SPA_PROFILER_driverBlock:
+			if (parse_block(&p->value, &m) < 0 ||
+			    (driver = find_node(d, m.id, m.name)) == NULL)
+				return;
+
+			/* for the driver, the time from the start of the cycle
+			 * until all followers completed */
+			complete = m.finish >= m.signal;
+			driver->driver_id = driver->id;
+			driver->rate = clock.rate;
+			driver->quantum = clock.duration;
+			memcpy(driver->cpu_load, cpu_load, sizeof(cpu_load));
+			update_node(driver, count, 0, m.finish - m.signal, complete, m.xrun_count);
+			break;
+		case SPA_PROFILER_followerBlock:
+			if (driver == NULL ||
+			    parse_block(&p->value, &m) < 0 ||
+			    (n = find_node(d, m.id, m.name)) == NULL)
+				break;
+
+			complete = m.awake >= m.signal && m.finish >= m.awake;
+			n->driver_id = driver->id;
+			n->rate = driver->rate;
+			n->quantum = driver->quantum;
+			update_node(n, count, m.awake - m.signal, m.finish - m.awake,
+					complete, m.xrun_count);
+			break;
+		default:
+			break;
+		}
+	}
+	d->count = SPA_MAX(d->count, count);
+}
+
+static const char *print_time(char *buf, size_t len, int64_t nsec)
+{
+	if (nsec < 0)
+		snprintf(buf, len, "%8s", "---");
+	else if (nsec < 1000 * SPA_NSEC_PER_USEC)
+		snprintf(buf, len, "%6.1fus", nsec / (float)SPA_NSEC_PER_USEC);
+	else
+		snprintf(buf, len, "%6.2fms", nsec / (float)SPA_NSEC_PER_MSEC);
+	return buf;
+}
+
+static const char *print_perc(char *buf, size_t len, int64_t nsec, int64_t period)
+{
+	if (nsec < 0 || period <= 0)
+		snprintf(buf, len, "%5s", "---");
+	else
+		snprintf(buf, len, "%5.2f", nsec / (float)period);
+	return buf;
+}
+
+static int compare_nodes(const void *a, const void *b)
+{
+	const struct node *na = *(const struct node **)a, *nb = *(const struct node **)b;
+	bool da = na->driver_id == na->id, db = nb->driver_id == nb->id;
+
+	/* group by driver, driver first, then the busiest follower */
+	if (na->driver_id != nb->driver_id)
+		return na->driver_id < nb->driver_id ? -1 : 1;
+	if (da != db)
+		return da ? -1 : 1;
+	if (na->busy_max != nb->busy_max)
+		return na->busy_max > nb->busy_max ? -1 : 1;
+	return na->id < nb->id ? -1 : na->id > nb->id;
+}
+
+static void print_node(struct node *n)
+{
+	char wait[16], busy[16], avg[16], wq[16], bq[16], load[16];
+	int64_t period = 0, wait_max = -1, busy_max = -1, busy_avg = -1;
+	bool is_driver = n->driver_id == n->id;
+	uint32_t complete = n->cycles - n->incomplete;
+
+	if (n->rate.denom > 0)
+		period = n->quantum * SPA_NSEC_PER_SEC / n->rate.denom;
+	if (complete > 0) {
+		wait_max = is_driver ? -1 : n->wait_max;
+		busy_max = n->busy_max;
+		busy_avg = n->busy_sum / complete;
+	}
+	if (is_driver)
+		snprintf(load, sizeof(load), "%5.2f", n->cpu_load[2]);
+	else
+		snprintf(load, sizeof(load), "%5s", "---");
+
+	fprintf(stdout, "%c %5u %6"PRIi64" %6u %s %s %s %s %s %s %6u %s%s\n",
+			n->incomplete > 0 ? '!' : 'R',
+			n->id, n->quantum, n->rate.denom,
+			print_time(wait, sizeof(wait), wait_max),
+			print_time(busy, sizeof(busy), busy_max),
+			print_time(avg, sizeof(avg), busy_avg),
+			print_perc(wq, sizeof(wq), wait_max, period),
+			print_perc(bq, sizeof(bq), busy_max, period),
+			load, n->xrun_count,
+			is_driver ? "" : " + ", n->name);
+}
+
+static void print_table(struct data *d)
+{
+	struct node *sorted[MAX_NODES];
+	uint32_t i, n_sorted = 0;
+
+	/* forget about nodes that did not run for a while */
+	for (i = 0; i < d->n_nodes;) {
+		if (d->count - d->nodes[i].count > 1000 && d->nodes[i].cycles == 0)
+			d->nodes[i] = d->nodes[--d->n_nodes];
+		else
+			i++;
+	}
+	for (i = 0; i < d->n_nodes; i++) {
+		if (d->nodes[i].cycles > 0)
+			sorted[n_sorted++] = &d->nodes[i];
+	}
+	qsort(sorted, n_sorted, sizeof(struct node *), compare_nodes);
+
+	if (!d->batch)
+		fprintf(stdout, "\033[H\033[2J");
+
+	fprintf(stdout, "S    ID  QUANT   RATE     WAIT     BUSY  BUSYAVG   W/Q   B/Q  LOAD    ERR NAME\n");
+	for (i = 0; i < n_sorted; i++) {
+		struct node *n = sorted[i];
+		if (n->driver_id == n->id && i > 0 && d->batch)
+			fprintf(stdout, "\n");
+		print_node(n);
+	}
+	if (d->batch)
+		fprintf(stdout, "\n");
+	fflush(stdout);
+
+	/* start a new interval */
+	for (i = 0; i < d->n_nodes; i++) {
+		struct node *n = &d->nodes[i];
+		n->cycles = n->incomplete = 0;
+		n->wait_max = n->busy_max = n->busy_sum = 0;
+	}
+
+	if (d->iterations > 0 && ++d->n_printed >= d->iterations)
+		pw_main_loop_quit(d->loop);
+}
+
+static void profiler_profile(void *data, const struct spa_pod *pod)
+{
+	struct data *d = data;
+	struct spa_pod *o;
+
+	SPA_POD_STRUCT_FOREACH(pod, o) {
+		if (!spa_pod_is_object_type(o, SPA_TYPE_OBJECT_Profiler))
+			continue;
+		process_point(d, (struct spa_pod_object*)o);
+	}
+	print_table(d);
+}
+
+static const struct pw_profiler_events profiler_events = {
+	PW_VERSION_PROFILER_EVENTS,
+	.profile = profiler_profile,
+};
+
+static void registry_event_global(void *data, uint32_t id,
+				  uint32_t permissions, const char *type, uint32_t version,
+				  const struct spa_dict *props)
+{
+	struct data *d = data;
+	struct pw_proxy *proxy;
+
+	if (strcmp(type, PW_TYPE_INTERFACE_Profiler) != 0)
+		return;
+
+	if (d->profiler != NULL) {
+		fprintf(stderr, "Ignoring profiler %d: already attached\n", id);
+		return;
+	}
+
+	proxy = pw_registry_bind(d->registry, id, type, PW_VERSION_PROFILER, 0);
+	if (proxy == NULL) {
+		pw_log_error("failed to create proxy: %m");
+		return;
+	}
+
+	d->profiler = proxy;
+	pw_proxy_add_object_listener(proxy, &d->profiler_listener, &profiler_events, d);
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = registry_event_global,
+};
+
+static void on_core_error(void *_data, uint32_t id, int seq, int res, const char *message)
+{
+	struct data *data = _data;
+
+	pw_log_error("error id:%u seq:%d res:%d (%s): %s",
+			id, seq, res, spa_strerror(res), message);
+
+	if (id == PW_ID_CORE)
+		pw_main_loop_quit(data->loop);
+}
+
+static void on_core_done(void *_data, uint32_t id, int seq)
+{
+	struct data *d = _data;
+
+	if (seq == d->check_profiler) {
+		if (d->profiler == NULL) {
+			pw_log_error("no Profiler Interface found, please load one in the server");
+			pw_main_loop_quit(d->loop);
+		}
+	}
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.error = on_core_error,
+	.done = on_core_done,
+};
+
+static void do_quit(void *data, int signal_number)
+{
+	struct data *d = data;
+	pw_main_loop_quit(d->loop);
+}
+
+static void show_help(const char *name)
+{
+        fprintf(stdout, "%s [options]\n"
+		"  -h, --help                            Show this help\n"
+		"      --version                         Show version\n"
+		"  -r, --remote                          Remote daemon name\n"
+		"  -b, --batch-mode                      Run in non-interactive batch mode\n"
+		"  -n, --iterations                      Exit after this many updates\n",
+		name);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0 };
+	struct pw_loop *l;
+	const char *opt_remote = NULL;
+	static const struct option long_options[] = {
+		{ "help",	no_argument,		NULL, 'h' },
+		{ "version",	no_argument,		NULL, 'V' },
+		{ "remote",	required_argument,	NULL, 'r' },
+		{ "batch-mode",	no_argument,		NULL, 'b' },
+		{ "iterations",	required_argument,	NULL, 'n' },
+		{ NULL, 0, NULL, 0}
+	};
+	int c;
+
+	pw_init(&argc, &argv);
+
+	while ((c = getopt_long(argc, argv, "hVr:bn:", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			show_help(argv[0]);
+			return 0;
+		case 'V':
+			fprintf(stdout, "%s\n"
+				"Compiled with libpipewire %s\n"
+				"Linked with libpipewire %s\n",
+				argv[0],
+				pw_get_headers_version(),
+				pw_get_library_version());
+			return 0;
+		case 'r':
+			opt_remote = optarg;
+			break;
+		case 'b':
+			data.batch = true;
+			break;
+		case 'n':
+			data.iterations = atoi(optarg);
+			break;
+		default:
+			show_help(argv[0]);
+			return -1;
+		}
+	}
+
+	data.loop = pw_main_loop_new(NULL);
+	if (data.loop == NULL) {
+		fprintf(stderr, "Can't create data loop: %m\n");
+		return -1;
+	}
+
+	l = pw_main_loop_get_loop(data.loop);
+	pw_loop_add_signal(l, SIGINT, do_quit, &data);
+	pw_loop_add_signal(l, SIGTERM, do_quit, &data);
+
+	data.context = pw_context_new(l, NULL, 0);
+	if (data.context == NULL) {
+		fprintf(stderr, "Can't create context: %m\n");
+		return -1;
+	}
+
+	pw_context_load_module(data.context, PW_EXTENSION_MODULE_PROFILER, NULL, NULL);
+
+	data.core = pw_context_connect(data.context,
+			pw_properties_new(
+				PW_KEY_REMOTE_NAME, opt_remote,
+				NULL),
+			0);
+	if (data.core == NULL) {
+		fprintf(stderr, "Can't connect: %m\n");
+		return -1;
+	}
+
+	pw_core_add_listener(data.core,
+				   &data.core_listener,
+				   &core_events, &data);
+	data.registry = pw_core_get_registry(data.core,
+					  PW_VERSION_REGISTRY, 0);
+	pw_registry_add_listener(data.registry,
+				       &data.registry_listener,
+				       &registry_events, &data);
+
+	data.check_profiler = pw_core_sync(data.core, 0, 0);
+
+	pw_main_loop_run(data.loop);
+
+	pw_context_destroy(data.context);
+	pw_main_loop_destroy(data.loop);
+
+	return 0;
+}